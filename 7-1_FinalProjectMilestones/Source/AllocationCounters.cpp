@@ -0,0 +1,134 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounters.cpp
+// ============
+// count the heap allocations made through operator new on every thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "AllocationCounters.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+// declaration of global variables
+namespace
+{
+	// counters of the replaced operators; they are updated
+	// from every thread, and need no ordering of their own
+	std::atomic<long long> g_Allocations(0);
+	std::atomic<long long> g_Frees(0);
+	std::atomic<long long> g_AllocatedBytes(0);
+
+	// take memory from the heap and count it; NULL is returned
+	// when the heap is exhausted
+	void* CountedAllocate(std::size_t size)
+	{
+		g_Allocations.fetch_add(1, std::memory_order_relaxed);
+		g_AllocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+
+		// every allocation has to return a distinct pointer,
+		// even for no bytes
+		return(malloc((size > 0) ? size : 1));
+	}
+
+	// give memory back to the heap and count it
+	void CountedFree(void* pMemory)
+	{
+		if (pMemory != NULL)
+		{
+			g_Frees.fetch_add(1, std::memory_order_relaxed);
+			free(pMemory);
+		}
+	}
+}
+
+/***********************************************************
+ *  GetAllocations()
+ *
+ *  This method is used for getting the number of heap
+ *  allocations made through operator new so far.
+ ***********************************************************/
+long long AllocationCounters::GetAllocations()
+{
+	return(g_Allocations.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  GetFrees()
+ *
+ *  This method is used for getting the number of heap
+ *  allocations given back through operator delete so far.
+ ***********************************************************/
+long long AllocationCounters::GetFrees()
+{
+	return(g_Frees.load(std::memory_order_relaxed));
+}
+
+/***********************************************************
+ *  GetAllocatedBytes()
+ *
+ *  This method is used for getting the bytes asked for by
+ *  all the heap allocations so far.
+ ***********************************************************/
+long long AllocationCounters::GetAllocatedBytes()
+{
+	return(g_AllocatedBytes.load(std::memory_order_relaxed));
+}
+
+// replacements of the global allocation functions, which
+// send every allocation through the counters above
+void* operator new(std::size_t size)
+{
+	void* pMemory = CountedAllocate(size);
+	if (pMemory == NULL)
+	{
+		throw std::bad_alloc();
+	}
+	return(pMemory);
+}
+
+void* operator new[](std::size_t size)
+{
+	return(operator new(size));
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+	return(CountedAllocate(size));
+}
+
+void operator delete(void* pMemory) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete[](void* pMemory) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete(void* pMemory, std::size_t) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete[](void* pMemory, std::size_t) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete(void* pMemory, const std::nothrow_t&) noexcept
+{
+	CountedFree(pMemory);
+}
+
+void operator delete[](void* pMemory, const std::nothrow_t&) noexcept
+{
+	CountedFree(pMemory);
+}
\ No newline at end of file
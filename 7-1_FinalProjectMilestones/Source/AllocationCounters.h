@@ -0,0 +1,29 @@
+///////////////////////////////////////////////////////////////////////////////
+// allocationcounters.h
+// ============
+// count the heap allocations made through operator new on every thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+/***********************************************************
+ *  AllocationCounters
+ *
+ *  This class contains the counters of the replaced global
+ *  operator new and delete, which every allocation of the
+ *  program's C++ code goes through, on every thread.  The
+ *  counters only grow, so the allocations of a stretch of
+ *  frames are the difference of two readings.  Memory taken
+ *  with malloc(), such as by the C libraries, and the
+ *  over-aligned forms of operator new are not counted.
+ ***********************************************************/
+class AllocationCounters
+{
+public:
+	// number of allocations and frees made so far
+	static long long GetAllocations();
+	static long long GetFrees();
+	// bytes asked for by all the allocations so far
+	static long long GetAllocatedBytes();
+};
\ No newline at end of file
@@ -0,0 +1,231 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumes.cpp
+// ============
+// bounding boxes of the scene objects and the view frustum they are culled by
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "BoundingVolumes.h"
+
+#include <cmath>
+
+/***********************************************************
+ *  TransformBox()
+ *
+ *  This method is used for getting the axis aligned box that
+ *  bounds a box after it has been transformed by a model
+ *  matrix.  The center is transformed as a point, and the
+ *  half extents by the absolute values of the rotation and
+ *  scale, which avoids transforming all eight corners.
+ ***********************************************************/
+BoundingVolumes::BOUNDING_BOX BoundingVolumes::TransformBox(
+	const BOUNDING_BOX& box,
+	const glm::mat4& modelMatrix)
+{
+	glm::vec3 center = (box.minPoint + box.maxPoint) * 0.5f;
+	glm::vec3 extent = (box.maxPoint - box.minPoint) * 0.5f;
+
+	glm::vec3 worldCenter = glm::vec3(modelMatrix * glm::vec4(center, 1.0f));
+	glm::vec3 worldExtent;
+	for (int row = 0; row < 3; row++)
+	{
+		worldExtent[row] =
+			fabs(modelMatrix[0][row]) * extent.x +
+			fabs(modelMatrix[1][row]) * extent.y +
+			fabs(modelMatrix[2][row]) * extent.z;
+	}
+
+	BOUNDING_BOX worldBox;
+	worldBox.minPoint = worldCenter - worldExtent;
+	worldBox.maxPoint = worldCenter + worldExtent;
+
+	return(worldBox);
+}
+
+/***********************************************************
+ *  ExtractFrustum()
+ *
+ *  This method is used for getting the six planes of the
+ *  view frustum from the rows of the combined view and
+ *  projection matrix.  The planes are normalized so that
+ *  they could also be used for distance tests.
+ ***********************************************************/
+BoundingVolumes::FRUSTUM BoundingVolumes::ExtractFrustum(const glm::mat4& viewProjection)
+{
+	// rows of the matrix; glm stores the matrix by columns
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(
+			viewProjection[0][i],
+			viewProjection[1][i],
+			viewProjection[2][i],
+			viewProjection[3][i]);
+	}
+
+	FRUSTUM frustum;
+	frustum.planes[0] = rows[3] + rows[0];   // left
+	frustum.planes[1] = rows[3] - rows[0];   // right
+	frustum.planes[2] = rows[3] + rows[1];   // bottom
+	frustum.planes[3] = rows[3] - rows[1];   // top
+	frustum.planes[4] = rows[3] + rows[2];   // near
+	frustum.planes[5] = rows[3] - rows[2];   // far
+
+	for (int i = 0; i < 6; i++)
+	{
+		float length = glm::length(glm::vec3(frustum.planes[i]));
+		if (length > 0.0f)
+		{
+			frustum.planes[i] /= length;
+		}
+	}
+
+	return(frustum);
+}
+
+/***********************************************************
+ *  IsBoxVisible()
+ *
+ *  This method is used for testing a box against the
+ *  frustum.  For each plane only the corner furthest along
+ *  the plane normal is tested; when that corner is behind
+ *  any plane, the whole box is outside.  Boxes near the
+ *  frustum corners can be kept although they are outside,
+ *  which only costs a draw and never drops a visible one.
+ ***********************************************************/
+bool BoundingVolumes::IsBoxVisible(
+	const FRUSTUM& frustum,
+	const BOUNDING_BOX& box)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		glm::vec3 corner(
+			(plane.x >= 0.0f) ? box.maxPoint.x : box.minPoint.x,
+			(plane.y >= 0.0f) ? box.maxPoint.y : box.minPoint.y,
+			(plane.z >= 0.0f) ? box.maxPoint.z : box.minPoint.z);
+
+		if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+
+/***********************************************************
+ *  MergeBoxes()
+ *
+ *  This method is used for getting the smallest box that
+ *  holds both of the passed in boxes.
+ ***********************************************************/
+BoundingVolumes::BOUNDING_BOX BoundingVolumes::MergeBoxes(
+	const BOUNDING_BOX& first,
+	const BOUNDING_BOX& second)
+{
+	BOUNDING_BOX box;
+	box.minPoint = glm::min(first.minPoint, second.minPoint);
+	box.maxPoint = glm::max(first.maxPoint, second.maxPoint);
+
+	return(box);
+}
+
+/***********************************************************
+ *  GetSurfaceArea()
+ *
+ *  This method is used for getting the surface area of a
+ *  box.  Empty boxes, whose minimum is above the maximum,
+ *  have no area.
+ ***********************************************************/
+float BoundingVolumes::GetSurfaceArea(const BOUNDING_BOX& box)
+{
+	glm::vec3 size = box.maxPoint - box.minPoint;
+	if ((size.x < 0.0f) || (size.y < 0.0f) || (size.z < 0.0f))
+	{
+		return(0.0f);
+	}
+
+	return(2.0f * (size.x * size.y + size.y * size.z + size.z * size.x));
+}
+
+/***********************************************************
+ *  IntersectRay()
+ *
+ *  This method is used for testing a ray against a box with
+ *  the slab method.  The ray direction is passed in as its
+ *  inverse so that it is only divided once per ray, and the
+ *  distance along the ray where it enters the box is
+ *  returned through the hit distance.  A ray starting
+ *  inside the box hits it at a distance of zero.
+ ***********************************************************/
+bool BoundingVolumes::IntersectRay(
+	const BOUNDING_BOX& box,
+	const glm::vec3& origin,
+	const glm::vec3& inverseDirection,
+	float maxDistance,
+	float& hitDistance)
+{
+	float nearDistance = 0.0f;
+	float farDistance = maxDistance;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float t1 = (box.minPoint[axis] - origin[axis]) * inverseDirection[axis];
+		float t2 = (box.maxPoint[axis] - origin[axis]) * inverseDirection[axis];
+
+		nearDistance = glm::max(nearDistance, glm::min(t1, t2));
+		farDistance = glm::min(farDistance, glm::max(t1, t2));
+	}
+
+	if (nearDistance > farDistance)
+	{
+		return(false);
+	}
+
+	hitDistance = nearDistance;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetDistance()
+ *
+ *  This method is used for getting the distance from a
+ *  point to the closest point of a box, which is zero for
+ *  points inside the box.
+ ***********************************************************/
+float BoundingVolumes::GetDistance(
+	const BOUNDING_BOX& box,
+	const glm::vec3& point)
+{
+	glm::vec3 closest = glm::clamp(point, box.minPoint, box.maxPoint);
+
+	return(glm::length(point - closest));
+}
+
+/***********************************************************
+ *  GetDepthRange()
+ *
+ *  This method is used for getting the view depths of the
+ *  near and far clip planes back from the depth terms of a
+ *  projection matrix.  Perspective projections are told
+ *  apart by their last row.
+ ***********************************************************/
+void BoundingVolumes::GetDepthRange(
+	const glm::mat4& projection,
+	float& nearDepth,
+	float& farDepth)
+{
+	if (projection[3][3] == 0.0f)
+	{
+		nearDepth = projection[3][2] / (projection[2][2] - 1.0f);
+		farDepth = projection[3][2] / (projection[2][2] + 1.0f);
+	}
+	else
+	{
+		nearDepth = (projection[3][2] + 1.0f) / projection[2][2];
+		farDepth = (projection[3][2] - 1.0f) / projection[2][2];
+	}
+}
\ No newline at end of file
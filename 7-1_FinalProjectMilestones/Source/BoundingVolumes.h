@@ -0,0 +1,78 @@
+///////////////////////////////////////////////////////////////////////////////
+// boundingvolumes.h
+// ============
+// bounding boxes of the scene objects and the view frustum they are culled by
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  BoundingVolumes
+ *
+ *  This class contains the axis aligned bounding boxes used
+ *  for culling the scene objects, and the view frustum that
+ *  the boxes are tested against.  The frustum planes are
+ *  taken straight from the combined view and projection
+ *  matrix, so perspective and orthographic views are
+ *  handled the same way.
+ ***********************************************************/
+class BoundingVolumes
+{
+public:
+	struct BOUNDING_BOX
+	{
+		glm::vec3 minPoint;
+		glm::vec3 maxPoint;
+	};
+
+	// planes of a view frustum, with normals pointing inwards
+	struct FRUSTUM
+	{
+		glm::vec4 planes[6];
+	};
+
+	// bounding box of a box transformed by a model matrix
+	static BOUNDING_BOX TransformBox(
+		const BOUNDING_BOX& box,
+		const glm::mat4& modelMatrix);
+
+	// extract the frustum planes of a view and projection matrix
+	static FRUSTUM ExtractFrustum(const glm::mat4& viewProjection);
+
+	// true when a box is at least partly inside the frustum
+	static bool IsBoxVisible(
+		const FRUSTUM& frustum,
+		const BOUNDING_BOX& box);
+
+	// smallest box holding both passed in boxes
+	static BOUNDING_BOX MergeBoxes(
+		const BOUNDING_BOX& first,
+		const BOUNDING_BOX& second);
+
+	// surface area of a box, used for the surface area heuristic
+	static float GetSurfaceArea(const BOUNDING_BOX& box);
+
+	// true when a ray hits a box closer than the maximum
+	// distance; the ray direction is passed in inverted
+	static bool IntersectRay(
+		const BOUNDING_BOX& box,
+		const glm::vec3& origin,
+		const glm::vec3& inverseDirection,
+		float maxDistance,
+		float& hitDistance);
+
+	// distance from a point to the closest point of a box
+	static float GetDistance(
+		const BOUNDING_BOX& box,
+		const glm::vec3& point);
+
+	// view depths of the near and far planes of a perspective
+	// or orthographic projection
+	static void GetDepthRange(
+		const glm::mat4& projection,
+		float& nearDepth,
+		float& farDepth);
+};
@@ -0,0 +1,368 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlighting.cpp
+// ============
+// bin the light sources of the view into screen space and depth clusters
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ClusteredLighting.h"
+#include "BoundingVolumes.h"
+#include "GLStateCache.h"
+#include "LightManager.h"
+#include "ShaderUniforms.h"
+#include "ShaderLoader.h"
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// shader storage binding points, matching the shader
+	const GLuint g_LightCountBufferBinding = 3;
+	const GLuint g_LightIndexBufferBinding = 4;
+
+	// clusters binned by one compute work group
+	const GLuint g_ClusterGroupSize = 64;
+
+	// the first depth slice starts no closer than this, since
+	// the slices are spaced by the log of the depth
+	const float g_MinSliceDepth = 0.05f;
+
+	// texture units the fragment shaders need next to those
+	// of the texture arrays
+	const GLint g_RequiredTextureUnits = ShaderUniforms::CLUSTER_LIGHT_INDEX_UNIT + 1;
+}
+
+/***********************************************************
+ *  ClusteredLighting()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ClusteredLighting::ClusteredLighting()
+{
+	m_program = 0;
+	m_clusterUBO = 0;
+	m_lightCountBuffer = 0;
+	m_lightIndexBuffer = 0;
+	m_lightCountTexture = 0;
+	m_lightIndexTexture = 0;
+	m_block = CLUSTER_BLOCK();
+	m_bEnabled = false;
+}
+
+/***********************************************************
+ *  ~ClusteredLighting()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ClusteredLighting::~ClusteredLighting()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the program, the cluster
+ *  buffers and their textures, and the uniform buffer.
+ ***********************************************************/
+void ClusteredLighting::Destroy()
+{
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+	if (m_lightCountTexture != 0)
+	{
+		glDeleteTextures(1, &m_lightCountTexture);
+		glDeleteTextures(1, &m_lightIndexTexture);
+		m_lightCountTexture = 0;
+		m_lightIndexTexture = 0;
+		GLStateCache::Invalidate();
+	}
+	if (m_lightCountBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_lightCountBuffer);
+		glDeleteBuffers(1, &m_lightIndexBuffer);
+		m_lightCountBuffer = 0;
+		m_lightIndexBuffer = 0;
+	}
+	if (m_clusterUBO != 0)
+	{
+		glDeleteBuffers(1, &m_clusterUBO);
+		m_clusterUBO = 0;
+	}
+	m_bEnabled = false;
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for building the binning compute
+ *  shader from the stored path and attaching its uniform
+ *  blocks to the binding points of the scene shaders.  The
+ *  built program only replaces the current one when it
+ *  succeeds.
+ ***********************************************************/
+bool ClusteredLighting::BuildProgram()
+{
+	std::string source;
+	if (ShaderLoader::LoadSource(m_shaderPath.c_str(), NULL, source) == false)
+	{
+		return(false);
+	}
+
+	GLuint shader = ShaderLoader::CompileShader(GL_COMPUTE_SHADER, source, m_shaderPath.c_str());
+	if (shader == 0)
+	{
+		return(false);
+	}
+	GLuint program = ShaderLoader::LinkProgram(&shader, 1);
+	if (program == 0)
+	{
+		return(false);
+	}
+
+	const char* blockNames[3] = { "FrameBlock", "LightBlock", "ClusterBlock" };
+	const GLuint bindings[3] =
+	{
+		ShaderUniforms::FRAME_BLOCK_BINDING,
+		ShaderUniforms::LIGHT_BLOCK_BINDING,
+		ShaderUniforms::CLUSTER_BLOCK_BINDING
+	};
+	for (int i = 0; i < 3; i++)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(program, blockNames[i]);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(program, blockIndex, bindings[i]);
+		}
+	}
+
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+	}
+	m_program = program;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the uniform buffer of
+ *  the ClusterBlock, which the scene shaders always read,
+ *  and, where the context can run the binning, the program
+ *  and the cluster buffers.  Each cluster sets aside room
+ *  for every light, so binning never runs out of space.
+ *  False is returned when the context is older than OpenGL
+ *  4.3, has too few texture units for the cluster buffers,
+ *  or when the shader fails to build.
+ ***********************************************************/
+bool ClusteredLighting::Initialize(const char* shaderPath)
+{
+	Destroy();
+
+	m_block = CLUSTER_BLOCK();
+	glGenBuffers(1, &m_clusterUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_clusterUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(CLUSTER_BLOCK), &m_block, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ShaderUniforms::CLUSTER_BLOCK_BINDING, m_clusterUBO);
+
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Clustered lighting needs OpenGL 4.3" << std::endl;
+		return(false);
+	}
+
+	GLint textureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	if (textureUnits < g_RequiredTextureUnits)
+	{
+		std::cout << "Clustered lighting needs " << g_RequiredTextureUnits << " texture units" << std::endl;
+		return(false);
+	}
+
+	m_shaderPath = shaderPath;
+	if (BuildProgram() == false)
+	{
+		return(false);
+	}
+
+	glGenBuffers(1, &m_lightCountBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightCountBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glGenBuffers(1, &m_lightIndexBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, m_lightIndexBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * LightManager::MAX_LIGHTS * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	// the cluster units are not used by anything else, so the
+	// textures stay bound to them
+	glGenTextures(1, &m_lightCountTexture);
+	GLStateCache::EditTexture(ShaderUniforms::CLUSTER_LIGHT_COUNT_UNIT, GL_TEXTURE_BUFFER, m_lightCountTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_lightCountBuffer);
+	glGenTextures(1, &m_lightIndexTexture);
+	GLStateCache::EditTexture(ShaderUniforms::CLUSTER_LIGHT_INDEX_UNIT, GL_TEXTURE_BUFFER, m_lightIndexTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32UI, m_lightIndexBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the program
+ *  and the cluster buffers have been created.
+ ***********************************************************/
+bool ClusteredLighting::IsSupported() const
+{
+	return((m_program != 0) && (m_lightCountBuffer != 0));
+}
+
+/***********************************************************
+ *  ReloadShader()
+ *
+ *  This method is used for building the program again
+ *  after its shader file changed.  The previous program is
+ *  kept when the build fails.
+ ***********************************************************/
+bool ClusteredLighting::ReloadShader()
+{
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	return(BuildProgram());
+}
+
+/***********************************************************
+ *  GetShaderPath()
+ *
+ *  This method is used for getting the path of the binning
+ *  compute shader, so that it can be watched for changes.
+ ***********************************************************/
+const std::string& ClusteredLighting::GetShaderPath() const
+{
+	return(m_shaderPath);
+}
+
+/***********************************************************
+ *  SetEnabled()
+ *
+ *  This method is used for turning clustered lighting on or
+ *  off.  The switch is read by the scene shaders from the
+ *  ClusterBlock, so the next frame already uses the other
+ *  mode.  False is returned when the context cannot support
+ *  it, which leaves it off.
+ ***********************************************************/
+bool ClusteredLighting::SetEnabled(bool bEnabled)
+{
+	if ((bEnabled == true) && (IsSupported() == false))
+	{
+		m_bEnabled = false;
+		return(false);
+	}
+
+	m_bEnabled = bEnabled;
+
+	CLUSTER_BLOCK block = m_block;
+	block.clusterCounts.w = (m_bEnabled == true) ? 1 : 0;
+	UploadBlock(block);
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsEnabled()
+ *
+ *  This method is used for checking whether the fragments
+ *  only visit the lights of their cluster.
+ ***********************************************************/
+bool ClusteredLighting::IsEnabled() const
+{
+	return(m_bEnabled);
+}
+
+/***********************************************************
+ *  UploadBlock()
+ *
+ *  This method is used for uploading the ClusterBlock when
+ *  its contents differ from the last upload.
+ ***********************************************************/
+void ClusteredLighting::UploadBlock(const CLUSTER_BLOCK& block)
+{
+	if ((m_clusterUBO == 0) || (memcmp(&block, &m_block, sizeof(CLUSTER_BLOCK)) == 0))
+	{
+		return;
+	}
+
+	m_block = block;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_clusterUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CLUSTER_BLOCK), &m_block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  Update()
+ *
+ *  This method is used for binning the lights into the
+ *  clusters of the current view.  The depth slices are
+ *  spread between the near and far planes of the passed in
+ *  projection, which can be a perspective or orthographic
+ *  one, and the tiles over the current viewport.  The
+ *  binning runs entirely on the GPU, one invocation per
+ *  cluster, and the draws after it wait for its results.
+ ***********************************************************/
+void ClusteredLighting::Update(const glm::mat4& projection)
+{
+	if ((m_bEnabled == false) || (IsSupported() == false))
+	{
+		return;
+	}
+
+	float nearDepth = 0.0f;
+	float farDepth = 0.0f;
+	BoundingVolumes::GetDepthRange(projection, nearDepth, farDepth);
+	if (nearDepth < g_MinSliceDepth)
+	{
+		nearDepth = g_MinSliceDepth;
+	}
+	if (farDepth < nearDepth * 2.0f)
+	{
+		farDepth = nearDepth * 2.0f;
+	}
+
+	// the tiles cover the viewport the frame is drawn with
+	GLint viewport[4];
+	GLStateCache::GetViewport(viewport);
+
+	CLUSTER_BLOCK block;
+	block.clusterCounts = glm::uvec4(TILES_X, TILES_Y, DEPTH_SLICES, 1);
+	float sliceScale = DEPTH_SLICES / logf(farDepth / nearDepth);
+	block.clusterScale = glm::vec4(
+		(float)TILES_X / (float)((viewport[2] > 0) ? viewport[2] : 1),
+		(float)TILES_Y / (float)((viewport[3] > 0) ? viewport[3] : 1),
+		sliceScale,
+		logf(nearDepth) * sliceScale);
+	UploadBlock(block);
+
+	// the scene program is put back in use after the dispatch
+	GLuint sceneProgram = GLStateCache::GetProgram();
+
+	GLStateCache::UseProgram(m_program);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightCountBufferBinding, m_lightCountBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_LightIndexBufferBinding, m_lightIndexBuffer);
+	glDispatchCompute((CLUSTER_COUNT + g_ClusterGroupSize - 1) / g_ClusterGroupSize, 1, 1);
+
+	// the fragments read the clusters through buffer textures
+	glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+	GLStateCache::UseProgram(sceneProgram);
+}
\ No newline at end of file
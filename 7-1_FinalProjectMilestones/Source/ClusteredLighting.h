@@ -0,0 +1,101 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusteredlighting.h
+// ============
+// bin the light sources of the view into screen space and depth clusters
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+
+/***********************************************************
+ *  ClusteredLighting
+ *
+ *  This class contains the code for clustered forward
+ *  lighting.  The view is split into a grid of screen tiles
+ *  and logarithmic depth slices, and a compute shader bins
+ *  every light with a range into the clusters its sphere
+ *  touches, so that each fragment only visits the lights
+ *  of its own cluster instead of every light of the scene.
+ *  The grid is described by the ClusterBlock of the scene
+ *  shaders, which also switches between the two lighting
+ *  modes, so that they can be compared without building
+ *  the shaders again.  Binning needs an OpenGL 4.3 context;
+ *  without one, lighting stays with every light.
+ ***********************************************************/
+class ClusteredLighting
+{
+public:
+	// constructor
+	ClusteredLighting();
+	// destructor
+	~ClusteredLighting();
+
+	// size of the cluster grid
+	static const int TILES_X = 16;
+	static const int TILES_Y = 9;
+	static const int DEPTH_SLICES = 24;
+	static const int CLUSTER_COUNT = TILES_X * TILES_Y * DEPTH_SLICES;
+
+	// std140 layout of the ClusterBlock uniform block
+	struct CLUSTER_BLOCK
+	{
+		// tiles across and down, depth slices, and 1 while
+		// clustered lighting is on
+		glm::uvec4 clusterCounts;
+		// tiles per pixel across and down, and the scale and
+		// bias turning the log of the view depth into a slice
+		glm::vec4 clusterScale;
+	};
+
+private:
+	// program binning the lights into the clusters
+	GLuint m_program;
+	// uniform buffer object for the ClusterBlock
+	GLuint m_clusterUBO;
+	// buffers of the light counts and light indices of the
+	// clusters, and the buffer textures the fragments read
+	// them through
+	GLuint m_lightCountBuffer;
+	GLuint m_lightIndexBuffer;
+	GLuint m_lightCountTexture;
+	GLuint m_lightIndexTexture;
+	// copy of the block contents last uploaded
+	CLUSTER_BLOCK m_block;
+	// true while the fragments only visit their cluster's lights
+	bool m_bEnabled;
+	// compute shader file the program is built from
+	std::string m_shaderPath;
+
+	// build the program from the shader file, replacing the
+	// current one only on success
+	bool BuildProgram();
+	// upload the block when it differs from the last upload
+	void UploadBlock(const CLUSTER_BLOCK& block);
+	// free the program, buffers and textures
+	void Destroy();
+
+public:
+	// create the ClusterBlock, and the program and cluster
+	// buffers where the context supports them
+	bool Initialize(const char* shaderPath);
+	// true once the program and cluster buffers exist
+	bool IsSupported() const;
+	// build the program again after its file changed
+	bool ReloadShader();
+	// path of the binning compute shader
+	const std::string& GetShaderPath() const;
+
+	// turn clustered lighting on or off; false when it is not
+	// supported, which leaves it off
+	bool SetEnabled(bool bEnabled);
+	bool IsEnabled() const;
+
+	// bin the lights into the clusters of the current view;
+	// the frame and light blocks have to be up to date
+	void Update(const glm::mat4& projection);
+};
\ No newline at end of file
@@ -0,0 +1,148 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.cpp
+// ============
+// poll files for changes so that they can be reloaded while running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FileWatcher.h"
+
+#include <sys/stat.h>
+
+// declaration of global variables
+namespace
+{
+	// milliseconds between two polls of the watched files
+	const int g_PollIntervalMilliseconds = 250;
+}
+
+/***********************************************************
+ *  FileWatcher()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FileWatcher::FileWatcher()
+{
+	m_lastPoll = std::chrono::steady_clock::now();
+}
+
+/***********************************************************
+ *  ReadFileState()
+ *
+ *  This method is used for reading the modification time
+ *  and the size of a file.  False is returned when the file
+ *  is missing.
+ ***********************************************************/
+bool FileWatcher::ReadFileState(
+	const std::string& filename,
+	long long& modifiedTime,
+	long long& size)
+{
+	struct stat fileInfo;
+	if (stat(filename.c_str(), &fileInfo) != 0)
+	{
+		modifiedTime = -1;
+		size = -1;
+		return(false);
+	}
+
+	modifiedTime = (long long)fileInfo.st_mtime;
+	size = (long long)fileInfo.st_size;
+	return(true);
+}
+
+/***********************************************************
+ *  Watch()
+ *
+ *  This method is used for adding a file to the watched
+ *  files.  Its current state counts as unchanged, so only
+ *  later changes are reported.
+ ***********************************************************/
+int FileWatcher::Watch(const std::string& filename)
+{
+	for (int i = 0; i < m_files.size(); i++)
+	{
+		if (m_files[i].filename == filename)
+		{
+			return(i);
+		}
+	}
+
+	WATCHED_FILE file;
+	file.filename = filename;
+	file.bChanging = false;
+	ReadFileState(filename, file.modifiedTime, file.size);
+	m_files.push_back(file);
+
+	return((int)m_files.size() - 1);
+}
+
+/***********************************************************
+ *  Poll()
+ *
+ *  This method is used for finding the watched files that
+ *  changed.  The ids of the files whose new state has been
+ *  stable for one interval are returned, and true when
+ *  there was at least one.  Files that are missing, which
+ *  happens while some editors save, are not reported.
+ ***********************************************************/
+bool FileWatcher::Poll(std::vector<int>& changedFiles)
+{
+	changedFiles.clear();
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (now - m_lastPoll < std::chrono::milliseconds(g_PollIntervalMilliseconds))
+	{
+		return(false);
+	}
+	m_lastPoll = now;
+
+	for (int i = 0; i < m_files.size(); i++)
+	{
+		WATCHED_FILE& file = m_files[i];
+
+		long long modifiedTime = 0;
+		long long size = 0;
+		if (ReadFileState(file.filename, modifiedTime, size) == false)
+		{
+			continue;
+		}
+
+		if ((modifiedTime != file.modifiedTime) || (size != file.size))
+		{
+			// wait for the file to settle before reporting it
+			file.modifiedTime = modifiedTime;
+			file.size = size;
+			file.bChanging = true;
+		}
+		else if (file.bChanging == true)
+		{
+			file.bChanging = false;
+			changedFiles.push_back(i);
+		}
+	}
+
+	return(changedFiles.empty() == false);
+}
+
+/***********************************************************
+ *  GetFilename()
+ *
+ *  This method is used for getting the name of the file
+ *  watched under an id.
+ ***********************************************************/
+const std::string& FileWatcher::GetFilename(int fileID) const
+{
+	return(m_files[fileID].filename);
+}
+
+/***********************************************************
+ *  GetFileCount()
+ *
+ *  This method is used for getting the number of watched
+ *  files.
+ ***********************************************************/
+int FileWatcher::GetFileCount() const
+{
+	return((int)m_files.size());
+}
@@ -0,0 +1,66 @@
+///////////////////////////////////////////////////////////////////////////////
+// filewatcher.h
+// ============
+// poll files for changes so that they can be reloaded while running
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FileWatcher
+ *
+ *  This class contains the code for noticing changed files.
+ *  The modification time and size of every watched file
+ *  are polled at a fixed interval, which costs one stat()
+ *  per file and works the same on every platform.  A file
+ *  is reported once its values have stayed the same for a
+ *  whole interval after a change, so that a file an editor
+ *  is still writing is not read halfway.
+ ***********************************************************/
+class FileWatcher
+{
+public:
+	// constructor
+	FileWatcher();
+
+private:
+	// state of one watched file
+	struct WATCHED_FILE
+	{
+		std::string filename;
+		// values when the file was last reported, or -1
+		// while it is missing
+		long long modifiedTime;
+		long long size;
+		// true when the values changed at the last poll
+		bool bChanging;
+	};
+
+	// watched files, indexed by the id returned from Watch()
+	std::vector<WATCHED_FILE> m_files;
+	// time of the last poll
+	std::chrono::steady_clock::time_point m_lastPoll;
+
+	// read the modification time and size of a file
+	static bool ReadFileState(
+		const std::string& filename,
+		long long& modifiedTime,
+		long long& size);
+
+public:
+	// start watching a file; the id of the file is returned,
+	// and a file that is already watched keeps its id
+	int Watch(const std::string& filename);
+	// find the files that changed since the last report; the
+	// files are only checked once per poll interval
+	bool Poll(std::vector<int>& changedFiles);
+	// file watched under an id
+	const std::string& GetFilename(int fileID) const;
+	// number of watched files
+	int GetFileCount() const;
+};
@@ -0,0 +1,189 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.cpp
+// ============
+// hand out memory for the transient data of a frame and drop it all at once
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameArena.h"
+
+// declaration of global variables
+namespace
+{
+	// alignment of every block, enough for any plain type
+	const size_t g_BlockAlignment = alignof(std::max_align_t);
+
+	// round an offset up to a power of two alignment
+	size_t AlignOffset(size_t offset, size_t alignment)
+	{
+		return((offset + alignment - 1) & ~(alignment - 1));
+	}
+}
+
+/***********************************************************
+ *  FrameArena()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameArena::FrameArena(size_t blockSize)
+{
+	m_blockSize = AlignOffset((blockSize > 0) ? blockSize : g_BlockAlignment, g_BlockAlignment);
+	m_pBlock = new unsigned char[m_blockSize];
+	m_blockUsed = 0;
+	m_overflowSize = 0;
+	m_overflowUsed = 0;
+	m_bytesUsed = 0;
+	m_peakBytes = 0;
+	m_blockAllocations = 1;
+	// room for a few extra blocks, so that a frame that does
+	// not fit only allocates the blocks themselves
+	m_overflowBlocks.reserve(8);
+}
+
+/***********************************************************
+ *  ~FrameArena()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameArena::~FrameArena()
+{
+	for (int i = 0; i < m_overflowBlocks.size(); i++)
+	{
+		delete[] m_overflowBlocks[i];
+	}
+	m_overflowBlocks.clear();
+	delete[] m_pBlock;
+	m_pBlock = NULL;
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out memory for size
+ *  bytes at the passed in alignment.  The memory stays
+ *  valid until the next reset.
+ ***********************************************************/
+void* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	if (alignment < 1)
+	{
+		alignment = 1;
+	}
+
+	size_t offset = AlignOffset(m_blockUsed, alignment);
+	if ((m_overflowBlocks.empty() == true) && (offset + size <= m_blockSize))
+	{
+		m_bytesUsed += (offset - m_blockUsed) + size;
+		m_blockUsed = offset + size;
+		return(m_pBlock + offset);
+	}
+
+	return(AllocateOverflow(size, alignment));
+}
+
+/***********************************************************
+ *  AllocateOverflow()
+ *
+ *  This method is used for handing out memory once the
+ *  block is full.  Allocations go into the last extra block
+ *  while they fit, and otherwise into a new one at least
+ *  the size of the block.
+ ***********************************************************/
+void* FrameArena::AllocateOverflow(size_t size, size_t alignment)
+{
+	size_t offset = AlignOffset(m_overflowUsed, alignment);
+	if ((m_overflowBlocks.empty() == true) || (offset + size > m_overflowSize))
+	{
+		m_overflowSize = AlignOffset((size + alignment > m_blockSize) ? (size + alignment) : m_blockSize, g_BlockAlignment);
+		m_overflowBlocks.push_back(new unsigned char[m_overflowSize]);
+		m_overflowUsed = 0;
+		m_blockAllocations++;
+		offset = 0;
+	}
+
+	m_bytesUsed += (offset - m_overflowUsed) + size;
+	m_overflowUsed = offset + size;
+	return(m_overflowBlocks.back() + offset);
+}
+
+/***********************************************************
+ *  Reset()
+ *
+ *  This method is used for dropping everything allocated
+ *  since the last reset, at the top of a frame.  When the
+ *  frame needed extra blocks, they are freed and the block
+ *  is replaced with one that holds the whole frame.
+ ***********************************************************/
+void FrameArena::Reset()
+{
+	if (m_bytesUsed > m_peakBytes)
+	{
+		m_peakBytes = m_bytesUsed;
+	}
+
+	if (m_overflowBlocks.empty() == false)
+	{
+		for (int i = 0; i < m_overflowBlocks.size(); i++)
+		{
+			delete[] m_overflowBlocks[i];
+		}
+		m_overflowBlocks.clear();
+
+		// the padding of the next frame may differ, so the new
+		// block gets some room to spare
+		delete[] m_pBlock;
+		m_blockSize = AlignOffset(m_peakBytes + m_peakBytes / 2, g_BlockAlignment);
+		m_pBlock = new unsigned char[m_blockSize];
+		m_blockAllocations++;
+	}
+
+	m_blockUsed = 0;
+	m_overflowSize = 0;
+	m_overflowUsed = 0;
+	m_bytesUsed = 0;
+}
+
+/***********************************************************
+ *  GetBytesUsed()
+ *
+ *  This method is used for getting the bytes handed out
+ *  since the last reset, including the alignment padding.
+ ***********************************************************/
+size_t FrameArena::GetBytesUsed() const
+{
+	return(m_bytesUsed);
+}
+
+/***********************************************************
+ *  GetPeakBytes()
+ *
+ *  This method is used for getting the most bytes handed
+ *  out in any frame that was reset.
+ ***********************************************************/
+size_t FrameArena::GetPeakBytes() const
+{
+	return(m_peakBytes);
+}
+
+/***********************************************************
+ *  GetBlockSize()
+ *
+ *  This method is used for getting the size of the block
+ *  most frames fit in.
+ ***********************************************************/
+size_t FrameArena::GetBlockSize() const
+{
+	return(m_blockSize);
+}
+
+/***********************************************************
+ *  GetBlockAllocations()
+ *
+ *  This method is used for getting the number of blocks
+ *  taken from the heap so far, starting with the first.  It
+ *  stops growing once the block holds a whole frame.
+ ***********************************************************/
+int FrameArena::GetBlockAllocations() const
+{
+	return(m_blockAllocations);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+///////////////////////////////////////////////////////////////////////////////
+// framearena.h
+// ============
+// hand out memory for the transient data of a frame and drop it all at once
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+/***********************************************************
+ *  FrameArena
+ *
+ *  This class contains the code for a linear allocator of
+ *  the data that only lives for one frame.  Allocating just
+ *  moves an offset into one large block, and nothing is
+ *  freed on its own; Reset() at the top of the frame drops
+ *  everything at once.  A frame that needs more than the
+ *  block takes extra blocks, and the next reset replaces
+ *  them with a single block large enough for that frame, so
+ *  that a steady frame never goes to the heap.  The arena
+ *  belongs to one thread, and the memory is not constructed
+ *  or destroyed, so it is only meant for plain data.
+ ***********************************************************/
+class FrameArena
+{
+public:
+	// constructor
+	FrameArena(size_t blockSize);
+	// destructor
+	~FrameArena();
+
+private:
+	// block most frames fit in, and the bytes used of it
+	unsigned char* m_pBlock;
+	size_t m_blockSize;
+	size_t m_blockUsed;
+	// blocks taken when the frame did not fit, and the bytes
+	// used of the last one
+	std::vector<unsigned char*> m_overflowBlocks;
+	size_t m_overflowSize;
+	size_t m_overflowUsed;
+	// bytes handed out since the last reset, and at most in
+	// any frame
+	size_t m_bytesUsed;
+	size_t m_peakBytes;
+	// number of blocks that had to be taken from the heap
+	int m_blockAllocations;
+
+	// take an extra block for an allocation that did not fit
+	void* AllocateOverflow(size_t size, size_t alignment);
+
+public:
+	// memory for size bytes at the passed in alignment, which
+	// has to be a power of two; valid until the next reset
+	void* Allocate(size_t size, size_t alignment);
+	// memory for count plain values of a type
+	template <typename T>
+	T* AllocateArray(int count)
+	{
+		return((T*)Allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	// drop everything allocated since the last reset
+	void Reset();
+
+	// bytes handed out since the last reset, and at most in
+	// any frame
+	size_t GetBytesUsed() const;
+	size_t GetPeakBytes() const;
+	// size of the block most frames fit in
+	size_t GetBlockSize() const;
+	// number of blocks taken from the heap so far
+	int GetBlockAllocations() const;
+};
\ No newline at end of file
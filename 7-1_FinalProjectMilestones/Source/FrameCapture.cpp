@@ -0,0 +1,515 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.cpp
+// ============
+// read the shown frames back without waiting and write them as image files
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameCapture.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// nanoseconds to wait for a readback when recording stops,
+	// before the frame is given up
+	const GLuint64 g_StopWaitTimeout = 1000000000;
+}
+
+/***********************************************************
+ *  FrameCapture()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameCapture::FrameCapture()
+{
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		m_readbackBuffers[i] = 0;
+		m_readbackBytes[i] = 0;
+		m_readbackFences[i] = 0;
+		m_readbackWidths[i] = 0;
+		m_readbackHeights[i] = 0;
+		m_readbackFrames[i] = 0;
+	}
+	m_nextReadback = 0;
+	for (int i = 0; i < QUEUED_IMAGES; i++)
+	{
+		m_images[i].filename[0] = '\0';
+		m_images[i].width = 0;
+		m_images[i].height = 0;
+	}
+	m_firstQueued = 0;
+	m_queuedCount = 0;
+	m_bStopping = false;
+	m_bWriteFailed = false;
+	m_bRecording = false;
+	m_frame = 0;
+	m_capturedFrames = 0;
+	m_writtenFrames = 0;
+	m_droppedFrames = 0;
+
+	m_writer = std::thread(&FrameCapture::WriterLoop, this);
+}
+
+/***********************************************************
+ *  ~FrameCapture()
+ *
+ *  The destructor for the class.  The frames still queued
+ *  are written before the writer exits.
+ ***********************************************************/
+FrameCapture::~FrameCapture()
+{
+	StopRecording();
+
+	{
+		std::lock_guard<std::mutex> lock(m_imageMutex);
+		m_bStopping = true;
+	}
+	m_imageReady.notify_all();
+	m_writer.join();
+
+	DestroyBuffers();
+}
+
+/***********************************************************
+ *  DestroyBuffers()
+ *
+ *  This method is used for freeing the pixel buffers and
+ *  the fences of the readbacks in flight.
+ ***********************************************************/
+void FrameCapture::DestroyBuffers()
+{
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		if (m_readbackFences[i] != 0)
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = 0;
+		}
+	}
+	if (m_readbackBuffers[0] != 0)
+	{
+		glDeleteBuffers(READBACK_BUFFERS, m_readbackBuffers);
+		for (int i = 0; i < READBACK_BUFFERS; i++)
+		{
+			m_readbackBuffers[i] = 0;
+			m_readbackBytes[i] = 0;
+		}
+	}
+}
+
+/***********************************************************
+ *  WriterLoop()
+ *
+ *  This method is used by the writer thread for writing the
+ *  queued images in order.  Once the capture is destroyed
+ *  the queue is emptied before the thread exits.
+ ***********************************************************/
+void FrameCapture::WriterLoop()
+{
+	while (true)
+	{
+		int imageIndex = 0;
+		{
+			std::unique_lock<std::mutex> lock(m_imageMutex);
+			while ((m_bStopping == false) && (m_queuedCount == 0))
+			{
+				m_imageReady.wait(lock);
+			}
+			if (m_queuedCount == 0)
+			{
+				return;
+			}
+			imageIndex = m_firstQueued;
+		}
+
+		// the GL thread leaves queued images alone, so the image
+		// is written without holding the lock
+		if (WriteImage(m_images[imageIndex]) == true)
+		{
+			m_writtenFrames++;
+		}
+
+		std::lock_guard<std::mutex> lock(m_imageMutex);
+		m_firstQueued = (m_firstQueued + 1) % QUEUED_IMAGES;
+		m_queuedCount--;
+		m_imageWritten.notify_all();
+	}
+}
+
+/***********************************************************
+ *  WriteImage()
+ *
+ *  This method is used by the writer thread for writing an
+ *  image as a binary PPM file.  The rows are read from the
+ *  bottom up, since that is the order OpenGL reads them
+ *  in, and the alpha of every pixel is left out.  The file
+ *  is written through stdio, which needs no allocation of
+ *  a stream object for every frame.
+ ***********************************************************/
+bool FrameCapture::WriteImage(const CAPTURED_IMAGE& image)
+{
+	FILE* pFile = NULL;
+#ifdef _WIN32
+	if (fopen_s(&pFile, image.filename, "wb") != 0)
+	{
+		pFile = NULL;
+	}
+#else
+	pFile = fopen(image.filename, "wb");
+#endif
+	if (pFile == NULL)
+	{
+		if (m_bWriteFailed == false)
+		{
+			std::cout << "Could not write captured frame:" << image.filename << std::endl;
+			m_bWriteFailed = true;
+		}
+		return(false);
+	}
+
+	bool bReturn = (fprintf(pFile, "P6\n%d %d\n255\n", image.width, image.height) > 0);
+
+	// the row is only grown here after the window was resized
+	size_t rowBytes = (size_t)image.width * 3;
+	if (m_row.size() < rowBytes)
+	{
+		m_row.resize(rowBytes);
+	}
+	for (int y = image.height - 1; (y >= 0) && (bReturn == true); y--)
+	{
+		const unsigned char* pSource = &image.pixels[(size_t)y * image.width * 4];
+		for (int x = 0; x < image.width; x++)
+		{
+			m_row[x * 3 + 0] = pSource[x * 4 + 0];
+			m_row[x * 3 + 1] = pSource[x * 4 + 1];
+			m_row[x * 3 + 2] = pSource[x * 4 + 2];
+		}
+		bReturn = (fwrite(&m_row[0], 1, rowBytes, pFile) == rowBytes);
+	}
+
+	if (fclose(pFile) != 0)
+	{
+		bReturn = false;
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  ReserveImages()
+ *
+ *  This method is used for sizing the pixel buffers, the
+ *  images of the ring and the row of the writer for frames
+ *  of a size, so that recording them allocates nothing.
+ *  The images still queued from an earlier recording are
+ *  written first, since the writer uses the row and the
+ *  images until then.
+ ***********************************************************/
+void FrameCapture::ReserveImages(int width, int height)
+{
+	if ((width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(m_imageMutex);
+	while (m_queuedCount > 0)
+	{
+		m_imageWritten.wait(lock);
+	}
+
+	// RGBA rows need no padding for the default pack alignment
+	int bytes = width * height * 4;
+	if (m_readbackBuffers[0] == 0)
+	{
+		glGenBuffers(READBACK_BUFFERS, m_readbackBuffers);
+	}
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		if (bytes > m_readbackBytes[i])
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[i]);
+			glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+			m_readbackBytes[i] = bytes;
+		}
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	for (int i = 0; i < QUEUED_IMAGES; i++)
+	{
+		if (m_images[i].pixels.size() < (size_t)bytes)
+		{
+			m_images[i].pixels.resize(bytes);
+		}
+	}
+	if (m_row.size() < (size_t)width * 3)
+	{
+		m_row.resize((size_t)width * 3);
+	}
+}
+
+/***********************************************************
+ *  StartRecording()
+ *
+ *  This method is used for starting to write the frames
+ *  into a directory.  The directory is made when it does
+ *  not exist yet; a directory that cannot be written is
+ *  reported by the writer with the first frame.  The
+ *  capture is sized for frames of the passed in window
+ *  framebuffer size.
+ ***********************************************************/
+bool FrameCapture::StartRecording(const char* directory, int width, int height)
+{
+	if ((directory == NULL) || (directory[0] == '\0'))
+	{
+		return(false);
+	}
+	// room is left for the file names of the frames
+	if (strlen(directory) > MAX_PATH_LENGTH - 32)
+	{
+		std::cout << "Frame capture directory path is too long:" << directory << std::endl;
+		return(false);
+	}
+
+	StopRecording();
+	ReserveImages(width, height);
+
+#ifdef _WIN32
+	_mkdir(directory);
+#else
+	mkdir(directory, 0755);
+#endif
+
+	m_directory = directory;
+	m_bRecording = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  StopRecording()
+ *
+ *  This method is used for stopping the recording.  The
+ *  readbacks in flight are waited for and handed to the
+ *  writer, so that the last frames are not lost; this is
+ *  the only place the capture waits for the GPU.
+ ***********************************************************/
+void FrameCapture::StopRecording()
+{
+	if (m_bRecording == false)
+	{
+		return;
+	}
+
+	CollectReadbacks(true);
+	m_bRecording = false;
+}
+
+/***********************************************************
+ *  IsRecording()
+ *
+ *  This method is used for checking whether the frames are
+ *  being recorded.
+ ***********************************************************/
+bool FrameCapture::IsRecording() const
+{
+	return(m_bRecording);
+}
+
+/***********************************************************
+ *  GetDirectory()
+ *
+ *  This method is used for getting the directory the frames
+ *  were last recorded into.
+ ***********************************************************/
+const std::string& FrameCapture::GetDirectory() const
+{
+	return(m_directory);
+}
+
+/***********************************************************
+ *  Capture()
+ *
+ *  This method is used for reading the frame in the window
+ *  framebuffer into the next pixel buffer.  The readbacks
+ *  the GPU has finished are handed to the writer first.
+ *  When the next pixel buffer is still in flight, the GPU
+ *  is that far behind and the frame is dropped.  The
+ *  buffers were sized when recording started, and are only
+ *  grown here after the window was resized.
+ ***********************************************************/
+void FrameCapture::Capture(int width, int height)
+{
+	if ((m_bRecording == false) || (width <= 0) || (height <= 0))
+	{
+		return;
+	}
+
+	CollectReadbacks(false);
+
+	long long frame = m_frame;
+	m_frame++;
+
+	int readback = m_nextReadback;
+	if (m_readbackFences[readback] != 0)
+	{
+		m_droppedFrames++;
+		return;
+	}
+
+	if (m_readbackBuffers[0] == 0)
+	{
+		glGenBuffers(READBACK_BUFFERS, m_readbackBuffers);
+	}
+
+	int bytes = width * height * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[readback]);
+	if (bytes > m_readbackBytes[readback])
+	{
+		glBufferData(GL_PIXEL_PACK_BUFFER, bytes, NULL, GL_STREAM_READ);
+		m_readbackBytes[readback] = bytes;
+	}
+	glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	m_readbackFences[readback] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_readbackWidths[readback] = width;
+	m_readbackHeights[readback] = height;
+	m_readbackFrames[readback] = frame;
+	m_nextReadback = (readback + 1) % READBACK_BUFFERS;
+}
+
+/***********************************************************
+ *  CollectReadbacks()
+ *
+ *  This method is used for copying the readbacks the GPU
+ *  has finished, oldest first, into free images of the
+ *  ring and queueing them for the writer.  Without bWait
+ *  the fences are only polled, and the first one not
+ *  passed yet ends the collection.  A frame is dropped when
+ *  every image is still queued.
+ ***********************************************************/
+void FrameCapture::CollectReadbacks(bool bWait)
+{
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		// the oldest readback is in the buffer the next one goes into
+		int readback = (m_nextReadback + i) % READBACK_BUFFERS;
+		if (m_readbackFences[readback] == 0)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(
+			m_readbackFences[readback],
+			GL_SYNC_FLUSH_COMMANDS_BIT,
+			(bWait == true) ? g_StopWaitTimeout : 0);
+		if ((result == GL_TIMEOUT_EXPIRED) && (bWait == false))
+		{
+			return;
+		}
+		glDeleteSync(m_readbackFences[readback]);
+		m_readbackFences[readback] = 0;
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			m_droppedFrames++;
+			continue;
+		}
+
+		int imageIndex = -1;
+		{
+			std::lock_guard<std::mutex> lock(m_imageMutex);
+			if (m_queuedCount < QUEUED_IMAGES)
+			{
+				imageIndex = (m_firstQueued + m_queuedCount) % QUEUED_IMAGES;
+			}
+		}
+		if (imageIndex < 0)
+		{
+			m_droppedFrames++;
+			continue;
+		}
+
+		// the free image is not touched by the writer until it
+		// has been queued
+		CAPTURED_IMAGE& image = m_images[imageIndex];
+		int width = m_readbackWidths[readback];
+		int height = m_readbackHeights[readback];
+		size_t bytes = (size_t)width * height * 4;
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[readback]);
+		const void* pPixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, bytes, GL_MAP_READ_BIT);
+		if (pPixels == NULL)
+		{
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			m_droppedFrames++;
+			continue;
+		}
+		if (image.pixels.size() < bytes)
+		{
+			image.pixels.resize(bytes);
+		}
+		memcpy(&image.pixels[0], pPixels, bytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		image.width = width;
+		image.height = height;
+		snprintf(
+			image.filename,
+			MAX_PATH_LENGTH,
+			"%s/frame_%06lld.ppm",
+			m_directory.c_str(),
+			m_readbackFrames[readback]);
+
+		{
+			std::lock_guard<std::mutex> lock(m_imageMutex);
+			m_queuedCount++;
+		}
+		m_imageReady.notify_one();
+		m_capturedFrames++;
+	}
+}
+
+/***********************************************************
+ *  GetCapturedFrames()
+ *
+ *  This method is used for getting the number of frames
+ *  read back and handed to the writer.
+ ***********************************************************/
+long long FrameCapture::GetCapturedFrames() const
+{
+	return(m_capturedFrames);
+}
+
+/***********************************************************
+ *  GetWrittenFrames()
+ *
+ *  This method is used for getting the number of frames the
+ *  writer has written to files so far.
+ ***********************************************************/
+long long FrameCapture::GetWrittenFrames() const
+{
+	return(m_writtenFrames.load());
+}
+
+/***********************************************************
+ *  GetDroppedFrames()
+ *
+ *  This method is used for getting the number of frames
+ *  that were not recorded, since the GPU or the writer was
+ *  behind.
+ ***********************************************************/
+long long FrameCapture::GetDroppedFrames() const
+{
+	return(m_droppedFrames);
+}
\ No newline at end of file
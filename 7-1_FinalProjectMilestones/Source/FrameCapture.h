@@ -0,0 +1,136 @@
+///////////////////////////////////////////////////////////////////////////////
+// framecapture.h
+// ============
+// read the shown frames back without waiting and write them as image files
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  FrameCapture
+ *
+ *  This class contains the code for recording the frames
+ *  shown in the window as a numbered image sequence, for
+ *  comparing runs against each other.  Every frame is read
+ *  into one of a few pixel buffers behind a fence, and is
+ *  copied out a frame or two later once the GPU has passed
+ *  the fence, so the render loop never waits for a
+ *  readback.  A writer thread then writes the copied
+ *  images as binary PPM files.  When the GPU or the disk
+ *  falls behind, frames are dropped instead of waiting,
+ *  and the numbers of the files keep counting so that a
+ *  file always holds the frame its number says.  The
+ *  buffers and images are sized when recording starts, so
+ *  that recorded frames allocate nothing until the window
+ *  is resized.
+ ***********************************************************/
+class FrameCapture
+{
+public:
+	// constructor
+	FrameCapture();
+	// destructor
+	~FrameCapture();
+
+private:
+	// readbacks that can be in flight at the same time
+	static const int READBACK_BUFFERS = 3;
+	// copied images that can wait for the writer
+	static const int QUEUED_IMAGES = 8;
+	// longest path of an image file
+	static const int MAX_PATH_LENGTH = 512;
+
+	// frame copied out of a pixel buffer, waiting to be written
+	struct CAPTURED_IMAGE
+	{
+		char filename[MAX_PATH_LENGTH];
+		int width;
+		int height;
+		// RGBA rows, from the bottom of the frame up
+		std::vector<unsigned char> pixels;
+	};
+
+	// pixel buffers the frames are read into, and their sizes
+	GLuint m_readbackBuffers[READBACK_BUFFERS];
+	int m_readbackBytes[READBACK_BUFFERS];
+	// fence, size and number of the frame of every readback
+	// in flight, and the buffer the next readback goes into
+	GLsync m_readbackFences[READBACK_BUFFERS];
+	int m_readbackWidths[READBACK_BUFFERS];
+	int m_readbackHeights[READBACK_BUFFERS];
+	long long m_readbackFrames[READBACK_BUFFERS];
+	int m_nextReadback;
+
+	// ring of images for the writer; the queued ones start at
+	// the first, and the rest can be filled on the GL thread
+	CAPTURED_IMAGE m_images[QUEUED_IMAGES];
+	int m_firstQueued;
+	int m_queuedCount;
+	std::mutex m_imageMutex;
+	std::condition_variable m_imageReady;
+	// signalled by the writer every time a queued image is done
+	std::condition_variable m_imageWritten;
+	// true when the writer has to exit once the queue is empty
+	bool m_bStopping;
+	// thread writing the queued images, and the row it converts
+	// the pixels of an image in, which is sized before recording
+	std::thread m_writer;
+	std::vector<unsigned char> m_row;
+	// true once the writer reported a file it could not write,
+	// so that a directory that cannot be written is reported
+	// once and not for every frame
+	bool m_bWriteFailed;
+
+	// directory the frames are written into while recording
+	std::string m_directory;
+	bool m_bRecording;
+	// number of the next captured frame, which counts on over
+	// the recordings so that one never overwrites another
+	long long m_frame;
+	// frames handed to the writer, written, and dropped
+	long long m_capturedFrames;
+	std::atomic<long long> m_writtenFrames;
+	long long m_droppedFrames;
+
+	// write the queued images until the capture is destroyed
+	void WriterLoop();
+	// write one image as a binary PPM file
+	bool WriteImage(const CAPTURED_IMAGE& image);
+	// copy the readbacks the GPU has finished to the writer;
+	// with bWait, wait for every readback in flight
+	void CollectReadbacks(bool bWait);
+	// size the pixel buffers, the images and the row of the
+	// writer for frames of a size
+	void ReserveImages(int width, int height);
+	// free the pixel buffers and the fences
+	void DestroyBuffers();
+
+public:
+	// start writing the frames of a window framebuffer size
+	// into a directory, which is made when it does not exist
+	bool StartRecording(const char* directory, int width, int height);
+	// finish the readbacks in flight and stop recording
+	void StopRecording();
+	bool IsRecording() const;
+	const std::string& GetDirectory() const;
+
+	// read the frame in the window framebuffer back; call once
+	// the frame has been drawn and before it is swapped
+	void Capture(int width, int height);
+
+	// frames handed to the writer, written to files, and
+	// dropped since the capture was made
+	long long GetCapturedFrames() const;
+	long long GetWrittenFrames() const;
+	long long GetDroppedFrames() const;
+};
\ No newline at end of file
@@ -0,0 +1,292 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.cpp
+// ============
+// choose the swap interval and hold frames to a target rate
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePacer.h"
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+// declaration of global variables
+namespace
+{
+	// names of the pacing modes in PACING_MODE order
+	const char* g_ModeNames[FramePacer::PACING_COUNT] =
+	{
+		"vsync",
+		"adaptive",
+		"limit",
+		"uncapped"
+	};
+
+	// frame rate of the limiter when the display rate is unknown
+	const double g_DefaultRate = 60.0;
+	// bounds of the time spent spinning before a frame is due;
+	// it starts at the coarse sleep granularity of some systems
+	const double g_MinSpinMargin = 0.0005;
+	const double g_MaxSpinMargin = 0.004;
+	const double g_InitialSpinMargin = 0.002;
+	// part of the gap to the observed overshoot the spin margin
+	// shrinks by after every sleep that woke in time
+	const double g_SpinMarginDecay = 0.01;
+}
+
+/***********************************************************
+ *  FramePacer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePacer::FramePacer(GLFWwindow* window)
+{
+	m_pWindow = window;
+	m_mode = PACING_VSYNC;
+	m_targetRate = g_DefaultRate;
+	m_nextFrameTime = 0.0;
+	m_spinMargin = g_InitialSpinMargin;
+	m_lastWait = 0.0;
+	m_totalWait = 0.0;
+	m_pacedFrames = 0;
+	m_bModeKeyDown = false;
+
+	// the swap can only be told to skip waiting for late frames
+	// through the tear control extensions
+	m_bAdaptiveSupported =
+		(glfwExtensionSupported("WGL_EXT_swap_control_tear") == GLFW_TRUE) ||
+		(glfwExtensionSupported("GLX_EXT_swap_control_tear") == GLFW_TRUE);
+
+	// the limiter follows the display unless a rate is chosen
+	GLFWmonitor* pMonitor = glfwGetPrimaryMonitor();
+	if (pMonitor != NULL)
+	{
+		const GLFWvidmode* pVideoMode = glfwGetVideoMode(pMonitor);
+		if ((pVideoMode != NULL) && (pVideoMode->refreshRate > 0))
+		{
+			m_targetRate = (double)pVideoMode->refreshRate;
+		}
+	}
+}
+
+/***********************************************************
+ *  ApplySwapInterval()
+ *
+ *  This method is used for setting the swap interval of the
+ *  current pacing mode into the context of the window.  The
+ *  limiter paces the frames itself, so it swaps without
+ *  waiting, and adaptive sync falls back to vertical sync
+ *  where the driver cannot tear late frames.
+ ***********************************************************/
+void FramePacer::ApplySwapInterval()
+{
+	switch (m_mode)
+	{
+	case PACING_VSYNC:
+		glfwSwapInterval(1);
+		break;
+	case PACING_ADAPTIVE:
+		glfwSwapInterval((m_bAdaptiveSupported == true) ? -1 : 1);
+		break;
+	default:
+		glfwSwapInterval(0);
+		break;
+	}
+}
+
+/***********************************************************
+ *  SetMode()
+ *
+ *  This method is used for choosing the way the frames are
+ *  paced.  The target rate is only used by the frame
+ *  limiter; 0 or less keeps the rate already set, which
+ *  starts out as the refresh rate of the display.  The
+ *  schedule of the limiter starts again from now.
+ ***********************************************************/
+void FramePacer::SetMode(PACING_MODE mode, double targetRate)
+{
+	if ((mode < 0) || (mode >= PACING_COUNT))
+	{
+		mode = PACING_VSYNC;
+	}
+	if ((mode == PACING_ADAPTIVE) && (m_bAdaptiveSupported == false))
+	{
+		std::cout << "Adaptive sync is not supported, using vertical sync" << std::endl;
+	}
+
+	m_mode = mode;
+	if (targetRate > 0.0)
+	{
+		m_targetRate = targetRate;
+	}
+	m_nextFrameTime = glfwGetTime();
+
+	ApplySwapInterval();
+}
+
+/***********************************************************
+ *  GetMode()
+ *
+ *  This method is used for getting the current way of
+ *  pacing the frames.
+ ***********************************************************/
+FramePacer::PACING_MODE FramePacer::GetMode() const
+{
+	return(m_mode);
+}
+
+/***********************************************************
+ *  GetTargetRate()
+ *
+ *  This method is used for getting the frame rate the
+ *  limiter holds the frames to.
+ ***********************************************************/
+double FramePacer::GetTargetRate() const
+{
+	return(m_targetRate);
+}
+
+/***********************************************************
+ *  GetModeName()
+ *
+ *  This method is used for getting the name of a pacing
+ *  mode, as it is written on the command line.
+ ***********************************************************/
+const char* FramePacer::GetModeName(PACING_MODE mode)
+{
+	if ((mode < 0) || (mode >= PACING_COUNT))
+	{
+		return("");
+	}
+
+	return(g_ModeNames[mode]);
+}
+
+/***********************************************************
+ *  FindMode()
+ *
+ *  This method is used for finding a pacing mode by its
+ *  name.  False is returned when no mode has the name.
+ ***********************************************************/
+bool FramePacer::FindMode(const char* name, PACING_MODE& mode)
+{
+	for (int i = 0; i < PACING_COUNT; i++)
+	{
+		if (strcmp(name, g_ModeNames[i]) == 0)
+		{
+			mode = (PACING_MODE)i;
+			return(true);
+		}
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  WaitForFrame()
+ *
+ *  This method is used for holding back the start of the
+ *  next frame until it is due, while the frame limiter is
+ *  on.  The thread sleeps until the spin margin before the
+ *  deadline and spins from there, and the margin follows
+ *  how late the sleeps wake up.  A frame that starts more
+ *  than a whole frame late starts the schedule again, so
+ *  that the frames after a stall are not rushed out to
+ *  catch up.
+ ***********************************************************/
+void FramePacer::WaitForFrame()
+{
+	m_lastWait = 0.0;
+	if (m_mode != PACING_LIMITED)
+	{
+		return;
+	}
+
+	double period = 1.0 / m_targetRate;
+	double waitStart = glfwGetTime();
+	m_nextFrameTime += period;
+	if (m_nextFrameTime < waitStart - period)
+	{
+		m_nextFrameTime = waitStart;
+	}
+
+	double sleepUntil = m_nextFrameTime - m_spinMargin;
+	if (sleepUntil > waitStart)
+	{
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepUntil - waitStart));
+
+		// a late wake up widens the margin right away, and an
+		// early one only narrows it slowly
+		double overshoot = glfwGetTime() - sleepUntil;
+		if (overshoot > m_spinMargin)
+		{
+			m_spinMargin = overshoot;
+		}
+		else
+		{
+			m_spinMargin -= (m_spinMargin - overshoot) * g_SpinMarginDecay;
+		}
+		m_spinMargin = (m_spinMargin < g_MinSpinMargin) ? g_MinSpinMargin : m_spinMargin;
+		m_spinMargin = (m_spinMargin > g_MaxSpinMargin) ? g_MaxSpinMargin : m_spinMargin;
+	}
+
+	while (glfwGetTime() < m_nextFrameTime)
+	{
+		std::this_thread::yield();
+	}
+
+	m_lastWait = glfwGetTime() - waitStart;
+	m_totalWait += m_lastWait;
+	m_pacedFrames++;
+}
+
+/***********************************************************
+ *  GetLastWait()
+ *
+ *  This method is used for getting the seconds the last
+ *  frame was held back by the limiter.
+ ***********************************************************/
+double FramePacer::GetLastWait() const
+{
+	return(m_lastWait);
+}
+
+/***********************************************************
+ *  GetAverageWait()
+ *
+ *  This method is used for getting the average seconds the
+ *  frames were held back by the limiter.
+ ***********************************************************/
+double FramePacer::GetAverageWait() const
+{
+	if (m_pacedFrames == 0)
+	{
+		return(0.0);
+	}
+
+	return(m_totalWait / (double)m_pacedFrames);
+}
+
+/***********************************************************
+ *  ProcessKeyboardEvents()
+ *
+ *  This method is used for switching to the next pacing
+ *  mode when F7 is pressed.
+ ***********************************************************/
+void FramePacer::ProcessKeyboardEvents()
+{
+	if (m_pWindow == NULL)
+	{
+		return;
+	}
+
+	bool bModeKey = (glfwGetKey(m_pWindow, GLFW_KEY_F7) == GLFW_PRESS);
+	if ((bModeKey == true) && (m_bModeKeyDown == false))
+	{
+		SetMode((PACING_MODE)((m_mode + 1) % PACING_COUNT), 0.0);
+		std::cout << "Frame pacing: " << GetModeName(m_mode) << std::endl;
+	}
+	m_bModeKeyDown = bModeKey;
+}
\ No newline at end of file
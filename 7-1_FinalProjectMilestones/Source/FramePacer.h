@@ -0,0 +1,88 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepacer.h
+// ============
+// choose the swap interval and hold frames to a target rate
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+/***********************************************************
+ *  FramePacer
+ *
+ *  This class contains the code for pacing the main loop.
+ *  With vertical sync the swap waits for the display, and
+ *  adaptive sync lets a late frame tear instead of waiting
+ *  a whole refresh, where the driver supports it.  The
+ *  frame limiter instead starts every frame on a fixed
+ *  schedule, sleeping for most of the wait and spinning
+ *  for the rest, so that frames start on time without a
+ *  core busy for the whole wait.  The wait comes before
+ *  the input of the frame is captured, so the frame shows
+ *  input that is as fresh as possible.  Uncapped frames
+ *  neither wait nor sync, for measuring throughput.
+ ***********************************************************/
+class FramePacer
+{
+public:
+	// constructor
+	FramePacer(GLFWwindow* window);
+
+	// ways of pacing the frames
+	enum PACING_MODE
+	{
+		PACING_VSYNC,
+		PACING_ADAPTIVE,
+		PACING_LIMITED,
+		PACING_UNCAPPED,
+		PACING_COUNT
+	};
+
+private:
+	// window whose swaps are paced
+	GLFWwindow* m_pWindow;
+	// current way of pacing and the rate of the frame limiter
+	PACING_MODE m_mode;
+	double m_targetRate;
+	// true when the driver can swap late frames without waiting
+	bool m_bAdaptiveSupported;
+	// time the next frame is due to start, while limiting
+	double m_nextFrameTime;
+	// time before the deadline at which sleeping gives way to
+	// spinning; it grows with the sleeps that overshoot
+	double m_spinMargin;
+	// seconds waited before the last frame and over all frames
+	double m_lastWait;
+	double m_totalWait;
+	long long m_pacedFrames;
+	// key state of the last frame, for detecting presses
+	bool m_bModeKeyDown;
+
+	// set the swap interval of the current mode
+	void ApplySwapInterval();
+
+public:
+	// choose the way of pacing; the target rate is only used
+	// by the frame limiter
+	void SetMode(PACING_MODE mode, double targetRate);
+	PACING_MODE GetMode() const;
+	double GetTargetRate() const;
+	// name of a pacing mode, as used on the command line
+	static const char* GetModeName(PACING_MODE mode);
+	// find a pacing mode by its name; false when there is none
+	static bool FindMode(const char* name, PACING_MODE& mode);
+
+	// wait until the next frame is due; call before the input
+	// of the frame is captured
+	void WaitForFrame();
+
+	// seconds waited before the last frame, and on average
+	double GetLastWait() const;
+	double GetAverageWait() const;
+
+	// cycle through the pacing modes on key presses
+	void ProcessKeyboardEvents();
+};
\ No newline at end of file
@@ -0,0 +1,244 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.cpp
+// ============
+// build the next frame on an update thread while the GL thread draws the last
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FramePipeline.h"
+
+/***********************************************************
+ *  FramePipeline()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FramePipeline::FramePipeline(
+	ViewManager* pViewManager,
+	SceneManager* pSceneManager,
+	bool bThreaded)
+{
+	m_pViewManager = pViewManager;
+	m_pSceneManager = pSceneManager;
+	m_buildIndex = 0;
+	m_readyIndex = 0;
+	m_bBuildAllowed = false;
+	m_bFrameReady = false;
+	m_acquiredFrames = 0;
+	m_pendingInput = ViewManager::INPUT_STATE();
+	m_bHasInput = false;
+	m_bStopping = false;
+	m_bThreaded = bThreaded;
+
+	for (int i = 0; i < 2; i++)
+	{
+		m_frames[i].pickedObject = -1;
+	}
+
+	if (m_bThreaded == true)
+	{
+		m_updateThread = std::thread(&FramePipeline::UpdateLoop, this);
+	}
+}
+
+/***********************************************************
+ *  ~FramePipeline()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FramePipeline::~FramePipeline()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_bStopping = true;
+	}
+	m_changed.notify_all();
+
+	if (m_updateThread.joinable() == true)
+	{
+		m_updateThread.join();
+	}
+
+	m_pViewManager = NULL;
+	m_pSceneManager = NULL;
+}
+
+/***********************************************************
+ *  UpdateLoop()
+ *
+ *  This method is used by the update thread for building
+ *  a frame each time the GL thread has acquired the last
+ *  one and allowed the next build, until the pipeline is
+ *  stopped.
+ ***********************************************************/
+void FramePipeline::UpdateLoop()
+{
+	while (true)
+	{
+		int buildIndex = 0;
+		ViewManager::INPUT_STATE input;
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while ((m_bStopping == false) && (m_bBuildAllowed == false))
+			{
+				m_changed.wait(lock);
+			}
+			if (m_bStopping == true)
+			{
+				return;
+			}
+			m_bBuildAllowed = false;
+			buildIndex = m_buildIndex;
+			input = TakeInput();
+		}
+
+		// the frame being built is not drawn, and the scene is
+		// not changed until the GL thread has acquired it
+		BuildFrame(m_frames[buildIndex], input);
+
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_readyIndex = buildIndex;
+			m_bFrameReady = true;
+		}
+		m_changed.notify_all();
+	}
+}
+
+/***********************************************************
+ *  BuildFrame()
+ *
+ *  This method is used for updating the view by the passed
+ *  in input and building the frame packet for that view,
+ *  including the scene object hit by a pick ray.
+ ***********************************************************/
+void FramePipeline::BuildFrame(FRAME& frame, const ViewManager::INPUT_STATE& input)
+{
+	m_pViewManager->UpdateView(input, frame.view);
+	m_pSceneManager->SetViewProjection(frame.view.view, frame.view.projection);
+
+	frame.pickedObject = -1;
+	if (frame.view.bPickRay == true)
+	{
+		frame.pickedObject = m_pSceneManager->PickSceneObject(
+			frame.view.pickOrigin,
+			frame.view.pickDirection);
+	}
+
+	m_pSceneManager->BuildFramePacket(frame.scene);
+}
+
+/***********************************************************
+ *  TakeInput()
+ *
+ *  This method is used for taking the input captured since
+ *  the last built frame.  The events are cleared, while the
+ *  held keys are kept for frames built without new input.
+ ***********************************************************/
+ViewManager::INPUT_STATE FramePipeline::TakeInput()
+{
+	ViewManager::INPUT_STATE input = m_pendingInput;
+
+	ViewManager::ConsumeInput(m_pendingInput);
+
+	return(input);
+}
+
+/***********************************************************
+ *  SubmitInput()
+ *
+ *  This method is used for handing input captured on the
+ *  GL thread to the next built frame.  Input that arrives
+ *  before the last one was used is merged into it.
+ ***********************************************************/
+void FramePipeline::SubmitInput(const ViewManager::INPUT_STATE& input)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_bHasInput == false)
+	{
+		m_pendingInput = input;
+		m_bHasInput = true;
+	}
+	else
+	{
+		ViewManager::AccumulateInput(m_pendingInput, input);
+	}
+}
+
+/***********************************************************
+ *  AcquireFrame()
+ *
+ *  This method is used by the GL thread for getting the
+ *  next frame to draw.  With the update thread it waits for
+ *  the frame built from the input of the last frame, which
+ *  gives one frame of latency; the first frame is built
+ *  from the first input on request.  Without the update
+ *  thread the frame is built right here.
+ ***********************************************************/
+const FramePipeline::FRAME& FramePipeline::AcquireFrame()
+{
+	if (m_bThreaded == false)
+	{
+		ViewManager::INPUT_STATE input;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			input = TakeInput();
+		}
+		BuildFrame(m_frames[0], input);
+		m_acquiredFrames++;
+		return(m_frames[0]);
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// nothing has been built ahead of the first frame
+	if (m_acquiredFrames == 0)
+	{
+		m_buildIndex = 0;
+		m_bBuildAllowed = true;
+		m_changed.notify_all();
+	}
+
+	while (m_bFrameReady == false)
+	{
+		m_changed.wait(lock);
+	}
+	m_bFrameReady = false;
+	m_acquiredFrames++;
+
+	return(m_frames[m_readyIndex]);
+}
+
+/***********************************************************
+ *  ResumeUpdate()
+ *
+ *  This method is used by the GL thread for letting the
+ *  update thread build the next frame into the frame that
+ *  is not being drawn.  The scene must not be changed
+ *  again until the next AcquireFrame().
+ ***********************************************************/
+void FramePipeline::ResumeUpdate()
+{
+	if (m_bThreaded == false)
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_buildIndex = 1 - m_readyIndex;
+		m_bBuildAllowed = true;
+	}
+	m_changed.notify_all();
+}
+
+/***********************************************************
+ *  IsThreaded()
+ *
+ *  This method is used for checking whether the frames are
+ *  built on the update thread.
+ ***********************************************************/
+bool FramePipeline::IsThreaded() const
+{
+	return(m_bThreaded);
+}
@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// framepipeline.h
+// ============
+// build the next frame on an update thread while the GL thread draws the last
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ViewManager.h"
+#include "SceneManager.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+/***********************************************************
+ *  FramePipeline
+ *
+ *  This class contains the code for running the scene
+ *  update on its own thread.  The update thread moves the
+ *  camera by the captured input and builds the frame packet
+ *  of the visible draws into one of two frames, while the
+ *  GL thread draws the other one.  A built frame is never
+ *  changed while it is drawn, and the update thread waits
+ *  between frames, so the scene can be changed on the GL
+ *  thread after AcquireFrame() until ResumeUpdate().
+ ***********************************************************/
+class FramePipeline
+{
+public:
+	// constructor; without the update thread every frame is
+	// built on the GL thread when it is acquired
+	FramePipeline(
+		ViewManager* pViewManager,
+		SceneManager* pSceneManager,
+		bool bThreaded);
+	// destructor
+	~FramePipeline();
+
+	// state of one frame, built on the update thread and drawn
+	// unchanged on the GL thread
+	struct FRAME
+	{
+		ViewManager::VIEW_STATE view;
+		SceneManager::FRAME_PACKET scene;
+		// scene object hit by the pick ray of the view, or -1
+		int pickedObject;
+	};
+
+private:
+	// pointer to the view manager moving the camera
+	ViewManager* m_pViewManager;
+	// pointer to the scene manager building the frame packets
+	SceneManager* m_pSceneManager;
+	// the two frames being built and drawn in turn
+	FRAME m_frames[2];
+	// frame the update thread builds into, and the frame that
+	// was built last, waiting for the GL thread
+	int m_buildIndex;
+	int m_readyIndex;
+	// true when the update thread may build the next frame,
+	// and true when a built frame waits for the GL thread
+	bool m_bBuildAllowed;
+	bool m_bFrameReady;
+	// number of frames handed to the GL thread
+	long long m_acquiredFrames;
+	// input captured since the last frame was built
+	ViewManager::INPUT_STATE m_pendingInput;
+	bool m_bHasInput;
+	// true when the update thread has to exit
+	bool m_bStopping;
+	// true when frames are built on the update thread
+	bool m_bThreaded;
+	// update thread building the frames
+	std::thread m_updateThread;
+	std::mutex m_mutex;
+	std::condition_variable m_changed;
+
+	// build frames until the pipeline is stopped
+	void UpdateLoop();
+	// update the view and build the frame packet of one frame
+	void BuildFrame(FRAME& frame, const ViewManager::INPUT_STATE& input);
+	// take the input captured since the last built frame; the
+	// mutex has to be held
+	ViewManager::INPUT_STATE TakeInput();
+
+public:
+	// hand input captured on the GL thread to the next frame
+	void SubmitInput(const ViewManager::INPUT_STATE& input);
+
+	// wait for the next built frame; the update thread waits as
+	// well until ResumeUpdate(), so the scene can be changed
+	// in between without racing the next frame packet
+	const FRAME& AcquireFrame();
+	// let the update thread build the next frame while the
+	// acquired one is drawn
+	void ResumeUpdate();
+
+	// true when frames are built on the update thread
+	bool IsThreaded() const;
+};
@@ -0,0 +1,505 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.cpp
+// ============
+// measure CPU and GPU frame timing per pass and report it as an overlay or CSV
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// frames of timer queries in flight before they are read
+	const int g_QueryFrames = 4;
+	// frames kept in the rolling window
+	const int g_HistoryFrames = 240;
+	// 1 ms buckets of the frame time histogram
+	const int g_HistogramBuckets = 50;
+	// seconds between refreshes of the overlay
+	const double g_OverlayInterval = 0.5;
+	// file the frame window is dumped to
+	const char* g_CSVFilename = "frame_profile.csv";
+
+	// names of the passes in PROFILE_PASS order
+	const char* g_PassNames[FrameProfiler::PASS_COUNT] =
+	{
+		"clear",
+		"view",
+		"shadow",
+		"scene",
+		"swap"
+	};
+}
+
+/***********************************************************
+ *  FrameProfiler()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+FrameProfiler::FrameProfiler(GLFWwindow* window, const char* windowTitle)
+{
+	m_pWindow = window;
+	if (windowTitle != NULL)
+	{
+		m_windowTitle = windowTitle;
+	}
+	m_frame = 0;
+	m_frameStart = 0.0;
+	m_passStart = 0.0;
+	m_bInFrame = false;
+	m_bShowOverlay = false;
+	m_lastOverlayUpdate = 0.0;
+	m_bOverlayKeyDown = false;
+	m_bDumpKeyDown = false;
+
+	m_queries.resize(g_QueryFrames * PASS_COUNT, 0);
+	m_queryFrames.resize(g_QueryFrames, -1);
+	glGenQueries((GLsizei)m_queries.size(), m_queries.data());
+
+	FRAME_SAMPLE empty = FRAME_SAMPLE();
+	empty.frame = -1;
+	m_samples.resize(g_HistoryFrames, empty);
+	m_sortedFrameTimes.reserve(g_HistoryFrames);
+}
+
+/***********************************************************
+ *  ~FrameProfiler()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+FrameProfiler::~FrameProfiler()
+{
+	if (m_queries.size() > 0)
+	{
+		glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+		m_queries.clear();
+	}
+	m_pWindow = NULL;
+}
+
+/***********************************************************
+ *  CurrentSample()
+ *
+ *  This method is used for getting the sample of the frame
+ *  being measured.
+ ***********************************************************/
+FrameProfiler::FRAME_SAMPLE& FrameProfiler::CurrentSample()
+{
+	return(m_samples[m_frame % g_HistoryFrames]);
+}
+
+/***********************************************************
+ *  CollectQueries()
+ *
+ *  This method is used for reading the GPU times of the
+ *  frame that last used a set of queries.  The results are
+ *  only read when they are available, so a slow GPU drops
+ *  a measurement instead of stalling the CPU.
+ ***********************************************************/
+void FrameProfiler::CollectQueries(int querySet)
+{
+	long long frame = m_queryFrames[querySet];
+	if (frame < 0)
+	{
+		return;
+	}
+	m_queryFrames[querySet] = -1;
+
+	FRAME_SAMPLE& sample = m_samples[frame % g_HistoryFrames];
+	if (sample.frame != frame)
+	{
+		return;
+	}
+
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		GLuint query = m_queries[querySet * PASS_COUNT + pass];
+		GLint available = 0;
+		glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (available == 0)
+		{
+			return;
+		}
+	}
+
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(m_queries[querySet * PASS_COUNT + pass], GL_QUERY_RESULT, &elapsed);
+		sample.gpuPassMs[pass] = (double)elapsed / 1000000.0;
+	}
+	sample.bGpuValid = true;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for marking the start of a frame.
+ *  The queries issued g_QueryFrames frames ago are read
+ *  here before they are used again.
+ ***********************************************************/
+void FrameProfiler::BeginFrame()
+{
+	CollectQueries((int)(m_frame % g_QueryFrames));
+
+	FRAME_SAMPLE& sample = CurrentSample();
+	sample = FRAME_SAMPLE();
+	sample.frame = m_frame;
+
+	m_frameStart = glfwGetTime();
+	m_bInFrame = true;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for marking the end of a frame and
+ *  recording the counters of the frame.
+ ***********************************************************/
+void FrameProfiler::EndFrame(int drawCalls, int uniformSets, int blockUploads, int shadowMapsRendered, int redundantCalls)
+{
+	if (m_bInFrame == false)
+	{
+		return;
+	}
+
+	FRAME_SAMPLE& sample = CurrentSample();
+	sample.cpuFrameMs = (glfwGetTime() - m_frameStart) * 1000.0;
+	sample.drawCalls = drawCalls;
+	sample.uniformSets = uniformSets;
+	sample.blockUploads = blockUploads;
+	sample.shadowMapsRendered = shadowMapsRendered;
+	sample.redundantCalls = redundantCalls;
+
+	m_queryFrames[m_frame % g_QueryFrames] = m_frame;
+	m_bInFrame = false;
+	m_frame++;
+
+	UpdateOverlay();
+}
+
+/***********************************************************
+ *  BeginPass()
+ *
+ *  This method is used for marking the start of a pass.
+ *  Passes follow each other and are not nested, since only
+ *  one GL_TIME_ELAPSED query can be active at a time.
+ ***********************************************************/
+void FrameProfiler::BeginPass(PROFILE_PASS pass)
+{
+	if (m_bInFrame == false)
+	{
+		return;
+	}
+
+	int querySet = (int)(m_frame % g_QueryFrames);
+	glBeginQuery(GL_TIME_ELAPSED, m_queries[querySet * PASS_COUNT + pass]);
+	m_passStart = glfwGetTime();
+}
+
+/***********************************************************
+ *  EndPass()
+ *
+ *  This method is used for marking the end of a pass.
+ ***********************************************************/
+void FrameProfiler::EndPass(PROFILE_PASS pass)
+{
+	if (m_bInFrame == false)
+	{
+		return;
+	}
+
+	glEndQuery(GL_TIME_ELAPSED);
+	CurrentSample().cpuPassMs[pass] = (glfwGetTime() - m_passStart) * 1000.0;
+}
+
+/***********************************************************
+ *  GetLastSample()
+ *
+ *  This method is used for getting the measurements of the
+ *  last frame that was ended.  Its GPU times are only read
+ *  a few frames later.
+ ***********************************************************/
+const FrameProfiler::FRAME_SAMPLE& FrameProfiler::GetLastSample() const
+{
+	return(m_samples[(m_frame + g_HistoryFrames - 1) % g_HistoryFrames]);
+}
+
+/***********************************************************
+ *  GetFrameTimePercentile()
+ *
+ *  This method is used for getting the CPU frame time at a
+ *  percentile, from 0 to 100, of the frames in the window.
+ ***********************************************************/
+double FrameProfiler::GetFrameTimePercentile(double percentile) const
+{
+	std::vector<double>& frameTimes = m_sortedFrameTimes;
+	frameTimes.clear();
+	for (int i = 0; i < m_samples.size(); i++)
+	{
+		if ((m_samples[i].frame >= 0) && (m_samples[i].frame < m_frame))
+		{
+			frameTimes.push_back(m_samples[i].cpuFrameMs);
+		}
+	}
+
+	if (frameTimes.size() == 0)
+	{
+		return(0.0);
+	}
+
+	size_t index = (size_t)(percentile / 100.0 * (frameTimes.size() - 1) + 0.5);
+	if (index >= frameTimes.size())
+	{
+		index = frameTimes.size() - 1;
+	}
+	std::nth_element(frameTimes.begin(), frameTimes.begin() + index, frameTimes.end());
+
+	return(frameTimes[index]);
+}
+
+/***********************************************************
+ *  GetAverageGpuTime()
+ *
+ *  This method is used for getting the average GPU time of
+ *  a pass over the frames of the window whose queries have
+ *  been read.
+ ***********************************************************/
+double FrameProfiler::GetAverageGpuTime(PROFILE_PASS pass) const
+{
+	double total = 0.0;
+	int count = 0;
+	for (int i = 0; i < m_samples.size(); i++)
+	{
+		if ((m_samples[i].frame >= 0) && (m_samples[i].bGpuValid == true))
+		{
+			total += m_samples[i].gpuPassMs[pass];
+			count++;
+		}
+	}
+
+	if (count == 0)
+	{
+		return(0.0);
+	}
+
+	return(total / count);
+}
+
+/***********************************************************
+ *  GetLatestGpuFrameTime()
+ *
+ *  This method is used for getting the GPU time of the
+ *  latest frame whose queries have been read, for reacting
+ *  to the GPU load while running.  The swap pass is left
+ *  out, since its time is spent presenting and not drawing.
+ ***********************************************************/
+double FrameProfiler::GetLatestGpuFrameTime() const
+{
+	// the queries are read g_QueryFrames frames late, or later
+	// when the GPU was slow
+	for (int i = 1; (i <= g_HistoryFrames) && (i <= m_frame); i++)
+	{
+		const FRAME_SAMPLE& sample = m_samples[(m_frame - i) % g_HistoryFrames];
+		if ((sample.frame == m_frame - i) && (sample.bGpuValid == true))
+		{
+			double total = 0.0;
+			for (int pass = 0; pass < PASS_SWAP; pass++)
+			{
+				total += sample.gpuPassMs[pass];
+			}
+			return(total);
+		}
+	}
+
+	return(0.0);
+}
+
+/***********************************************************
+ *  GetHistogram()
+ *
+ *  This method is used for counting the frames of the
+ *  window in 1 ms frame time buckets.
+ ***********************************************************/
+void FrameProfiler::GetHistogram(std::vector<int>& buckets) const
+{
+	buckets.assign(g_HistogramBuckets, 0);
+	for (int i = 0; i < m_samples.size(); i++)
+	{
+		if ((m_samples[i].frame >= 0) && (m_samples[i].frame < m_frame))
+		{
+			int bucket = (int)m_samples[i].cpuFrameMs;
+			if (bucket >= g_HistogramBuckets)
+			{
+				bucket = g_HistogramBuckets - 1;
+			}
+			buckets[bucket]++;
+		}
+	}
+}
+
+/***********************************************************
+ *  WriteCSV()
+ *
+ *  This method is used for writing the frames of the window
+ *  to a CSV file, oldest first, followed by the frame time
+ *  histogram.
+ ***********************************************************/
+bool FrameProfiler::WriteCSV(const char* filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Could not write frame profile:" << filename << std::endl;
+		return(false);
+	}
+
+	file << "frame,cpu_frame_ms";
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		file << ",cpu_" << g_PassNames[pass] << "_ms";
+	}
+	for (int pass = 0; pass < PASS_COUNT; pass++)
+	{
+		file << ",gpu_" << g_PassNames[pass] << "_ms";
+	}
+	file << ",draw_calls,uniform_sets,block_uploads,shadow_maps,redundant_calls\n";
+
+	long long first = m_frame - g_HistoryFrames;
+	if (first < 0)
+	{
+		first = 0;
+	}
+	for (long long frame = first; frame < m_frame; frame++)
+	{
+		const FRAME_SAMPLE& sample = m_samples[frame % g_HistoryFrames];
+		if (sample.frame != frame)
+		{
+			continue;
+		}
+
+		file << sample.frame << "," << sample.cpuFrameMs;
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			file << "," << sample.cpuPassMs[pass];
+		}
+		for (int pass = 0; pass < PASS_COUNT; pass++)
+		{
+			// frames whose queries were not read yet are left empty
+			file << ",";
+			if (sample.bGpuValid == true)
+			{
+				file << sample.gpuPassMs[pass];
+			}
+		}
+		file << "," << sample.drawCalls << "," << sample.uniformSets << "," << sample.blockUploads << "," << sample.shadowMapsRendered << "," << sample.redundantCalls << "\n";
+	}
+
+	std::vector<int> buckets;
+	GetHistogram(buckets);
+	file << "\nhistogram_ms,frames\n";
+	for (int i = 0; i < buckets.size(); i++)
+	{
+		file << i << "," << buckets[i] << "\n";
+	}
+	file << "\np50_ms," << GetFrameTimePercentile(50.0) << "\n";
+	file << "p99_ms," << GetFrameTimePercentile(99.0) << "\n";
+
+	std::cout << "Wrote frame profile:" << filename << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  UpdateOverlay()
+ *
+ *  This method is used for showing the frame times and
+ *  counters in the window title, refreshed twice a second
+ *  so that the title itself does not cost frame time.
+ ***********************************************************/
+void FrameProfiler::UpdateOverlay()
+{
+	if ((m_bShowOverlay == false) || (m_pWindow == NULL))
+	{
+		return;
+	}
+
+	double now = glfwGetTime();
+	if (now - m_lastOverlayUpdate < g_OverlayInterval)
+	{
+		return;
+	}
+	m_lastOverlayUpdate = now;
+
+	const FRAME_SAMPLE& last = m_samples[(m_frame - 1) % g_HistoryFrames];
+
+	// the title is put together on the stack, so that showing
+	// it does not allocate
+	char overlay[512];
+	snprintf(
+		overlay,
+		sizeof(overlay),
+		"%s | cpu p50 %.2f p99 %.2f ms | gpu shadow %.2f scene %.2f swap %.2f ms | draws %d uniforms %d uploads %d redundant %d",
+		m_windowTitle.c_str(),
+		GetFrameTimePercentile(50.0),
+		GetFrameTimePercentile(99.0),
+		GetAverageGpuTime(PASS_SHADOW),
+		GetAverageGpuTime(PASS_SCENE),
+		GetAverageGpuTime(PASS_SWAP),
+		last.drawCalls,
+		last.uniformSets,
+		last.blockUploads,
+		last.redundantCalls);
+
+	glfwSetWindowTitle(m_pWindow, overlay);
+}
+
+/***********************************************************
+ *  SetShowOverlay()
+ *
+ *  This method is used for showing or hiding the overlay.
+ ***********************************************************/
+void FrameProfiler::SetShowOverlay(bool bShow)
+{
+	m_bShowOverlay = bShow;
+	m_lastOverlayUpdate = 0.0;
+
+	if ((m_bShowOverlay == false) && (m_pWindow != NULL))
+	{
+		glfwSetWindowTitle(m_pWindow, m_windowTitle.c_str());
+	}
+}
+
+/***********************************************************
+ *  ProcessKeyboardEvents()
+ *
+ *  This method is used for toggling the overlay with F3 and
+ *  dumping the frame window to CSV with F4.
+ ***********************************************************/
+void FrameProfiler::ProcessKeyboardEvents()
+{
+	if (m_pWindow == NULL)
+	{
+		return;
+	}
+
+	bool bOverlayKey = (glfwGetKey(m_pWindow, GLFW_KEY_F3) == GLFW_PRESS);
+	if ((bOverlayKey == true) && (m_bOverlayKeyDown == false))
+	{
+		SetShowOverlay(!m_bShowOverlay);
+	}
+	m_bOverlayKeyDown = bOverlayKey;
+
+	bool bDumpKey = (glfwGetKey(m_pWindow, GLFW_KEY_F4) == GLFW_PRESS);
+	if ((bDumpKey == true) && (m_bDumpKeyDown == false))
+	{
+		WriteCSV(g_CSVFilename);
+	}
+	m_bDumpKeyDown = bDumpKey;
+}
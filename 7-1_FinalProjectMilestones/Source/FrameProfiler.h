@@ -0,0 +1,129 @@
+///////////////////////////////////////////////////////////////////////////////
+// frameprofiler.h
+// ============
+// measure CPU and GPU frame timing per pass and report it as an overlay or CSV
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include "GLFW/glfw3.h"
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  FrameProfiler
+ *
+ *  This class contains the code for instrumenting the main
+ *  loop.  Every pass of a frame is timed on the CPU and, with
+ *  GL_TIME_ELAPSED queries, on the GPU.  The query results
+ *  are read a few frames later so that the CPU never waits
+ *  for the GPU.  A rolling window of frames is kept for the
+ *  p50/p99 frame times, the histogram, the window title
+ *  overlay and the CSV dump.
+ ***********************************************************/
+class FrameProfiler
+{
+public:
+	// constructor
+	FrameProfiler(GLFWwindow* window, const char* windowTitle);
+	// destructor
+	~FrameProfiler();
+
+	// passes of a frame that are timed separately
+	enum PROFILE_PASS
+	{
+		PASS_CLEAR,
+		PASS_VIEW,
+		PASS_SHADOW,
+		PASS_SCENE,
+		PASS_SWAP,
+		PASS_COUNT
+	};
+
+	// measurements of one frame
+	struct FRAME_SAMPLE
+	{
+		long long frame;
+		double cpuFrameMs;
+		double cpuPassMs[PASS_COUNT];
+		double gpuPassMs[PASS_COUNT];
+		// true once the GPU times of the frame have been read
+		bool bGpuValid;
+		int drawCalls;
+		int uniformSets;
+		int blockUploads;
+		// shadow cascades drawn again in the frame
+		int shadowMapsRendered;
+		// state changes and uniforms skipped by the caches for
+		// holding the value already
+		int redundantCalls;
+	};
+
+private:
+	// window the overlay is shown in
+	GLFWwindow* m_pWindow;
+	// window title shown in front of the overlay
+	std::string m_windowTitle;
+	// timer queries of the frames in flight, per pass
+	std::vector<GLuint> m_queries;
+	// frame each set of queries was issued in, or -1
+	std::vector<long long> m_queryFrames;
+	// rolling window of frame measurements
+	std::vector<FRAME_SAMPLE> m_samples;
+	// frame times the percentiles are picked from, kept so that
+	// picking them does not allocate every time
+	mutable std::vector<double> m_sortedFrameTimes;
+	// number of the current frame
+	long long m_frame;
+	// start times of the current frame and pass
+	double m_frameStart;
+	double m_passStart;
+	// true while a frame is being measured
+	bool m_bInFrame;
+	// true when the overlay is shown in the window title
+	bool m_bShowOverlay;
+	// time the overlay was last refreshed
+	double m_lastOverlayUpdate;
+	// key states of the last frame, for detecting presses
+	bool m_bOverlayKeyDown;
+	bool m_bDumpKeyDown;
+
+	// read the GPU times of an earlier frame when available
+	void CollectQueries(int querySet);
+	// current sample of the frame being measured
+	FRAME_SAMPLE& CurrentSample();
+	// refresh the overlay in the window title
+	void UpdateOverlay();
+
+public:
+	// mark the start and the end of a frame
+	void BeginFrame();
+	void EndFrame(int drawCalls, int uniformSets, int blockUploads, int shadowMapsRendered, int redundantCalls);
+
+	// mark the start and the end of a pass
+	void BeginPass(PROFILE_PASS pass);
+	void EndPass(PROFILE_PASS pass);
+
+	// measurements of the last frame that was ended
+	const FRAME_SAMPLE& GetLastSample() const;
+	// frame time in milliseconds at a percentile of the window
+	double GetFrameTimePercentile(double percentile) const;
+	// average GPU time in milliseconds of a pass over the window
+	double GetAverageGpuTime(PROFILE_PASS pass) const;
+	// GPU time in milliseconds of the passes drawing the latest
+	// frame whose queries were read, or 0 when there is none
+	double GetLatestGpuFrameTime() const;
+	// frame time histogram of the window in 1 ms buckets; the
+	// last bucket holds every slower frame
+	void GetHistogram(std::vector<int>& buckets) const;
+
+	// write the frames of the window to a CSV file
+	bool WriteCSV(const char* filename) const;
+
+	// toggle the overlay and dump the CSV on key presses
+	void ProcessKeyboardEvents();
+	void SetShowOverlay(bool bShow);
+};
@@ -0,0 +1,533 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.cpp
+// ============
+// shadow the bound OpenGL state and skip the calls that would not change it
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GLStateCache.h"
+
+// declaration of global variables
+namespace
+{
+	// value of a name or enum the cache does not know yet
+	const GLint g_Unknown = -1;
+
+	// OpenGL targets and capabilities in the order of the
+	// TEXTURE_TARGET and CAPABILITY enums
+	const GLenum g_TextureTargets[] =
+	{
+		GL_TEXTURE_2D,
+		GL_TEXTURE_2D_ARRAY,
+		GL_TEXTURE_BUFFER
+	};
+	const GLenum g_Capabilities[] =
+	{
+		GL_DEPTH_TEST,
+		GL_BLEND,
+		GL_CULL_FACE,
+		GL_POLYGON_OFFSET_FILL
+	};
+
+	// last values set through the cache, or g_Unknown
+	GLint g_Program = g_Unknown;
+	GLint g_VertexArray = g_Unknown;
+	GLint g_DrawFramebuffer = g_Unknown;
+	GLint g_ReadFramebuffer = g_Unknown;
+	GLint g_Viewport[4] = { g_Unknown, g_Unknown, g_Unknown, g_Unknown };
+	GLint g_ActiveUnit = g_Unknown;
+	GLint g_Textures[GLStateCache::MAX_TEXTURE_UNITS][sizeof(g_TextureTargets) / sizeof(GLenum)];
+	GLint g_CapabilityStates[sizeof(g_Capabilities) / sizeof(GLenum)];
+	GLint g_DepthMask = g_Unknown;
+	GLint g_DepthFunc = g_Unknown;
+	GLint g_ColorMask = g_Unknown;
+	GLint g_BlendSource = g_Unknown;
+	GLint g_BlendDestination = g_Unknown;
+	// true once the texture and capability tables are filled
+	bool g_bTablesCleared = false;
+
+	// calls issued and skipped since the counters were reset
+	int g_IssuedCalls = 0;
+	int g_RedundantCalls = 0;
+}
+
+/***********************************************************
+ *  FindTarget()
+ *
+ *  This method is used for finding the index of a texture
+ *  target whose bindings are kept.  -1 is returned for the
+ *  other targets.
+ ***********************************************************/
+int GLStateCache::FindTarget(GLenum target)
+{
+	for (int i = 0; i < TARGET_COUNT; i++)
+	{
+		if (g_TextureTargets[i] == target)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  FindCapability()
+ *
+ *  This method is used for finding the index of a
+ *  capability whose state is kept.  -1 is returned for the
+ *  other capabilities.
+ ***********************************************************/
+int GLStateCache::FindCapability(GLenum capability)
+{
+	for (int i = 0; i < CAPABILITY_COUNT; i++)
+	{
+		if (g_Capabilities[i] == capability)
+		{
+			return(i);
+		}
+	}
+
+	return(-1);
+}
+
+/***********************************************************
+ *  CountCall()
+ *
+ *  This method is used for counting a call that was passed
+ *  on to OpenGL or one that was skipped.
+ ***********************************************************/
+void GLStateCache::CountCall(bool bIssued)
+{
+	if (bIssued == true)
+	{
+		g_IssuedCalls++;
+	}
+	else
+	{
+		g_RedundantCalls++;
+	}
+}
+
+/***********************************************************
+ *  UseProgram()
+ *
+ *  This method is used for making a program current unless
+ *  it already is.
+ ***********************************************************/
+void GLStateCache::UseProgram(GLuint program)
+{
+	bool bChanged = (g_Program != (GLint)program);
+
+	if (bChanged == true)
+	{
+		glUseProgram(program);
+		g_Program = (GLint)program;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  GetProgram()
+ *
+ *  This method is used for getting the program that was
+ *  last made current.  OpenGL is only asked while the cache
+ *  does not know it, so that saving and restoring the
+ *  program around a compute pass costs no round trip.
+ ***********************************************************/
+GLuint GLStateCache::GetProgram()
+{
+	if (g_Program == g_Unknown)
+	{
+		GLint program = 0;
+		glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+		g_Program = program;
+	}
+
+	return((GLuint)g_Program);
+}
+
+/***********************************************************
+ *  BindVertexArray()
+ *
+ *  This method is used for binding a vertex array unless it
+ *  is already bound.
+ ***********************************************************/
+void GLStateCache::BindVertexArray(GLuint vertexArray)
+{
+	bool bChanged = (g_VertexArray != (GLint)vertexArray);
+
+	if (bChanged == true)
+	{
+		glBindVertexArray(vertexArray);
+		g_VertexArray = (GLint)vertexArray;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  BindFramebuffer()
+ *
+ *  This method is used for binding a framebuffer for
+ *  drawing, for reading, or for both with GL_FRAMEBUFFER,
+ *  unless it is already bound there.
+ ***********************************************************/
+void GLStateCache::BindFramebuffer(GLenum target, GLuint framebuffer)
+{
+	bool bDraw = (target == GL_FRAMEBUFFER) || (target == GL_DRAW_FRAMEBUFFER);
+	bool bRead = (target == GL_FRAMEBUFFER) || (target == GL_READ_FRAMEBUFFER);
+	bool bChanged =
+		((bDraw == true) && (g_DrawFramebuffer != (GLint)framebuffer)) ||
+		((bRead == true) && (g_ReadFramebuffer != (GLint)framebuffer));
+
+	if (bChanged == true)
+	{
+		glBindFramebuffer(target, framebuffer);
+		if (bDraw == true)
+		{
+			g_DrawFramebuffer = (GLint)framebuffer;
+		}
+		if (bRead == true)
+		{
+			g_ReadFramebuffer = (GLint)framebuffer;
+		}
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  GetDrawFramebuffer()
+ *
+ *  This method is used for getting the framebuffer that was
+ *  last bound for drawing.  OpenGL is only asked while the
+ *  cache does not know it, so that saving and restoring the
+ *  framebuffer around a pass costs no round trip.
+ ***********************************************************/
+GLuint GLStateCache::GetDrawFramebuffer()
+{
+	if (g_DrawFramebuffer == g_Unknown)
+	{
+		GLint framebuffer = 0;
+		glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+		g_DrawFramebuffer = framebuffer;
+	}
+
+	return((GLuint)g_DrawFramebuffer);
+}
+
+/***********************************************************
+ *  SetViewport()
+ *
+ *  This method is used for setting the viewport unless it
+ *  is already set.
+ ***********************************************************/
+void GLStateCache::SetViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+	bool bChanged =
+		(g_Viewport[0] != x) || (g_Viewport[1] != y) ||
+		(g_Viewport[2] != (GLint)width) || (g_Viewport[3] != (GLint)height);
+
+	if (bChanged == true)
+	{
+		glViewport(x, y, width, height);
+		g_Viewport[0] = x;
+		g_Viewport[1] = y;
+		g_Viewport[2] = (GLint)width;
+		g_Viewport[3] = (GLint)height;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  GetViewport()
+ *
+ *  This method is used for getting the viewport that was
+ *  last set, so that the passes sized by it need no round
+ *  trip.  OpenGL is only asked while the cache does not
+ *  know it.
+ ***********************************************************/
+void GLStateCache::GetViewport(GLint viewport[4])
+{
+	if (g_Viewport[2] == g_Unknown)
+	{
+		glGetIntegerv(GL_VIEWPORT, g_Viewport);
+	}
+
+	for (int i = 0; i < 4; i++)
+	{
+		viewport[i] = g_Viewport[i];
+	}
+}
+
+/***********************************************************
+ *  BindTexture()
+ *
+ *  This method is used for binding a texture to a target of
+ *  a texture unit.  The active unit is only switched when
+ *  the texture actually has to be bound, and it is left on
+ *  that unit, since only EditTexture() depends on it.
+ ***********************************************************/
+void GLStateCache::BindTexture(GLint unit, GLenum target, GLuint texture)
+{
+	if (g_bTablesCleared == false)
+	{
+		Invalidate();
+	}
+
+	int targetIndex = FindTarget(target);
+	if ((unit >= 0) && (unit < MAX_TEXTURE_UNITS) && (targetIndex >= 0) &&
+		(g_Textures[unit][targetIndex] == (GLint)texture))
+	{
+		CountCall(false);
+		return;
+	}
+
+	if (g_ActiveUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		g_ActiveUnit = unit;
+		CountCall(true);
+	}
+	glBindTexture(target, texture);
+	CountCall(true);
+
+	if ((unit >= 0) && (unit < MAX_TEXTURE_UNITS) && (targetIndex >= 0))
+	{
+		g_Textures[unit][targetIndex] = (GLint)texture;
+	}
+}
+
+/***********************************************************
+ *  EditTexture()
+ *
+ *  This method is used for binding a texture to a target of
+ *  a texture unit and making the unit active, even when the
+ *  texture is already bound there, so that the texture is
+ *  the one changed by the glTex calls that follow.
+ ***********************************************************/
+void GLStateCache::EditTexture(GLint unit, GLenum target, GLuint texture)
+{
+	if (g_bTablesCleared == false)
+	{
+		Invalidate();
+	}
+
+	if (g_ActiveUnit != unit)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		g_ActiveUnit = unit;
+		CountCall(true);
+	}
+	BindTexture(unit, target, texture);
+}
+
+/***********************************************************
+ *  SetCapability()
+ *
+ *  This method is used for enabling or disabling a
+ *  capability unless it is already in that state.
+ ***********************************************************/
+void GLStateCache::SetCapability(GLenum capability, bool bEnabled)
+{
+	if (g_bTablesCleared == false)
+	{
+		Invalidate();
+	}
+
+	int capabilityIndex = FindCapability(capability);
+	GLint state = (bEnabled == true) ? 1 : 0;
+	if ((capabilityIndex >= 0) && (g_CapabilityStates[capabilityIndex] == state))
+	{
+		CountCall(false);
+		return;
+	}
+
+	if (bEnabled == true)
+	{
+		glEnable(capability);
+	}
+	else
+	{
+		glDisable(capability);
+	}
+	CountCall(true);
+
+	if (capabilityIndex >= 0)
+	{
+		g_CapabilityStates[capabilityIndex] = state;
+	}
+}
+
+/***********************************************************
+ *  SetDepthMask()
+ *
+ *  This method is used for turning depth writes on or off
+ *  unless they already are.
+ ***********************************************************/
+void GLStateCache::SetDepthMask(bool bWrite)
+{
+	GLint state = (bWrite == true) ? 1 : 0;
+	bool bChanged = (g_DepthMask != state);
+
+	if (bChanged == true)
+	{
+		glDepthMask((bWrite == true) ? GL_TRUE : GL_FALSE);
+		g_DepthMask = state;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  SetDepthFunc()
+ *
+ *  This method is used for setting the depth comparison
+ *  unless it is already set.
+ ***********************************************************/
+void GLStateCache::SetDepthFunc(GLenum func)
+{
+	bool bChanged = (g_DepthFunc != (GLint)func);
+
+	if (bChanged == true)
+	{
+		glDepthFunc(func);
+		g_DepthFunc = (GLint)func;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  SetColorMask()
+ *
+ *  This method is used for turning writes to every color
+ *  channel on or off unless they already are.
+ ***********************************************************/
+void GLStateCache::SetColorMask(bool bWrite)
+{
+	GLint state = (bWrite == true) ? 1 : 0;
+	bool bChanged = (g_ColorMask != state);
+
+	if (bChanged == true)
+	{
+		GLboolean mask = (bWrite == true) ? GL_TRUE : GL_FALSE;
+		glColorMask(mask, mask, mask, mask);
+		g_ColorMask = state;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  SetBlendFunc()
+ *
+ *  This method is used for setting the blend factors unless
+ *  they are already set.
+ ***********************************************************/
+void GLStateCache::SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor)
+{
+	bool bChanged =
+		(g_BlendSource != (GLint)sourceFactor) ||
+		(g_BlendDestination != (GLint)destinationFactor);
+
+	if (bChanged == true)
+	{
+		glBlendFunc(sourceFactor, destinationFactor);
+		g_BlendSource = (GLint)sourceFactor;
+		g_BlendDestination = (GLint)destinationFactor;
+	}
+	CountCall(bChanged);
+}
+
+/***********************************************************
+ *  InvalidateProgram()
+ *
+ *  This method is used for forgetting the current program,
+ *  after a program was made current outside the cache.
+ ***********************************************************/
+void GLStateCache::InvalidateProgram()
+{
+	g_Program = g_Unknown;
+}
+
+/***********************************************************
+ *  InvalidateVertexArray()
+ *
+ *  This method is used for forgetting the bound vertex
+ *  array, after a vertex array was bound outside the cache.
+ ***********************************************************/
+void GLStateCache::InvalidateVertexArray()
+{
+	g_VertexArray = g_Unknown;
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for forgetting every value, so that
+ *  the next call of each goes through.  Deleting a bound
+ *  texture, vertex array or framebuffer unbinds it, and its
+ *  name can be handed out again, so the cache is
+ *  invalidated after such objects are freed.
+ ***********************************************************/
+void GLStateCache::Invalidate()
+{
+	g_Program = g_Unknown;
+	g_VertexArray = g_Unknown;
+	g_DrawFramebuffer = g_Unknown;
+	g_ReadFramebuffer = g_Unknown;
+	for (int i = 0; i < 4; i++)
+	{
+		g_Viewport[i] = g_Unknown;
+	}
+	g_ActiveUnit = g_Unknown;
+	for (int unit = 0; unit < MAX_TEXTURE_UNITS; unit++)
+	{
+		for (int target = 0; target < TARGET_COUNT; target++)
+		{
+			g_Textures[unit][target] = g_Unknown;
+		}
+	}
+	for (int i = 0; i < CAPABILITY_COUNT; i++)
+	{
+		g_CapabilityStates[i] = g_Unknown;
+	}
+	g_DepthMask = g_Unknown;
+	g_DepthFunc = g_Unknown;
+	g_ColorMask = g_Unknown;
+	g_BlendSource = g_Unknown;
+	g_BlendDestination = g_Unknown;
+	g_bTablesCleared = true;
+}
+
+/***********************************************************
+ *  GetIssuedCalls()
+ *
+ *  This method is used for getting the number of calls that
+ *  were passed on to OpenGL since the last reset.
+ ***********************************************************/
+int GLStateCache::GetIssuedCalls()
+{
+	return(g_IssuedCalls);
+}
+
+/***********************************************************
+ *  GetRedundantCalls()
+ *
+ *  This method is used for getting the number of calls that
+ *  were skipped since the last reset, because they would
+ *  have set the value already in place.
+ ***********************************************************/
+int GLStateCache::GetRedundantCalls()
+{
+	return(g_RedundantCalls);
+}
+
+/***********************************************************
+ *  ResetCounters()
+ *
+ *  This method is used for resetting the call counters,
+ *  usually at the start of a frame.
+ ***********************************************************/
+void GLStateCache::ResetCounters()
+{
+	g_IssuedCalls = 0;
+	g_RedundantCalls = 0;
+}
\ No newline at end of file
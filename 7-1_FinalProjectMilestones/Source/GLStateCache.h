@@ -0,0 +1,110 @@
+///////////////////////////////////////////////////////////////////////////////
+// glstatecache.h
+// ============
+// shadow the bound OpenGL state and skip the calls that would not change it
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  GLStateCache
+ *
+ *  This class contains the code for setting the OpenGL
+ *  state the renderer changes while drawing: the program in
+ *  use, the vertex array, the framebuffers and the
+ *  viewport, the textures of every unit, the enabled
+ *  capabilities and the depth, color and blend state.  The last value set is kept for each, and a call
+ *  that would set the same value again is skipped and
+ *  counted.  A value starts out unknown, so its first call
+ *  always goes through.  Code that changes the state behind
+ *  the cache, such as the ShaderManager and ShapeMeshes
+ *  libraries, has to be followed by an Invalidate call.
+ *  The context belongs to the GL thread, and so does the
+ *  cache.
+ ***********************************************************/
+class GLStateCache
+{
+public:
+	// texture units whose bindings are kept; binds to units
+	// past these always go through
+	static const int MAX_TEXTURE_UNITS = 32;
+
+	// make a program current
+	static void UseProgram(GLuint program);
+	// program last made current, asking OpenGL once when the
+	// cache does not know it yet
+	static GLuint GetProgram();
+	// bind a vertex array
+	static void BindVertexArray(GLuint vertexArray);
+	// bind a framebuffer to GL_FRAMEBUFFER, GL_DRAW_FRAMEBUFFER
+	// or GL_READ_FRAMEBUFFER
+	static void BindFramebuffer(GLenum target, GLuint framebuffer);
+	// framebuffer last bound for drawing, asking OpenGL once
+	// when the cache does not know it yet
+	static GLuint GetDrawFramebuffer();
+	// set the viewport
+	static void SetViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+	// viewport last set, asking OpenGL once when the cache does
+	// not know it yet
+	static void GetViewport(GLint viewport[4]);
+	// bind a texture to a target of a texture unit for the
+	// shaders to sample
+	static void BindTexture(GLint unit, GLenum target, GLuint texture);
+	// bind a texture the same way and make its unit active, so
+	// that the glTex calls that follow change that texture
+	static void EditTexture(GLint unit, GLenum target, GLuint texture);
+
+	// enable or disable a capability such as GL_DEPTH_TEST
+	static void SetCapability(GLenum capability, bool bEnabled);
+	// depth, color and blend state
+	static void SetDepthMask(bool bWrite);
+	static void SetDepthFunc(GLenum func);
+	static void SetColorMask(bool bWrite);
+	static void SetBlendFunc(GLenum sourceFactor, GLenum destinationFactor);
+
+	// forget the program or the vertex array after code
+	// outside the cache made another one current
+	static void InvalidateProgram();
+	static void InvalidateVertexArray();
+	// forget every value, after objects the cache may hold
+	// were deleted or the state was changed behind its back
+	static void Invalidate();
+
+	// calls passed on to OpenGL and calls skipped because
+	// they would not have changed anything, since the last
+	// reset
+	static int GetIssuedCalls();
+	static int GetRedundantCalls();
+	static void ResetCounters();
+
+private:
+	// targets whose bindings are kept for every texture unit;
+	// binds to other targets always go through
+	enum TEXTURE_TARGET
+	{
+		TARGET_2D,
+		TARGET_2D_ARRAY,
+		TARGET_BUFFER,
+		TARGET_COUNT
+	};
+
+	// capabilities whose state is kept; other capabilities
+	// are always set
+	enum CAPABILITY
+	{
+		CAPABILITY_DEPTH_TEST,
+		CAPABILITY_BLEND,
+		CAPABILITY_CULL_FACE,
+		CAPABILITY_POLYGON_OFFSET_FILL,
+		CAPABILITY_COUNT
+	};
+
+	// index of a target or capability, or -1 when it is not kept
+	static int FindTarget(GLenum target);
+	static int FindCapability(GLenum capability);
+	// count a call as skipped, or as issued when bIssued is true
+	static void CountCall(bool bIssued);
+};
\ No newline at end of file
@@ -0,0 +1,538 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenrenderer.cpp
+// ============
+// cull and draw the pooled scene objects on the GPU with indirect draws
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "GpuDrivenRenderer.h"
+#include "GLStateCache.h"
+#include "ShaderUniforms.h"
+#include "ShaderLoader.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// shader storage binding points, matching the shaders
+	const GLuint g_ObjectBufferBinding = 0;
+	const GLuint g_CommandBufferBinding = 1;
+	const GLuint g_MeshRangeBufferBinding = 2;
+
+	// objects culled by one compute work group
+	const GLuint g_CullGroupSize = 64;
+
+	// first line of the shared scene shaders, replaced when
+	// they are built for indirect drawing
+	const char* g_SceneShaderVersion = "#version 330 core";
+	// header of the shaders built for indirect drawing
+	const char* g_IndirectShaderHeader = "#version 460 core\n#define GPU_DRIVEN\n";
+	const char* g_CullShaderHeader = "#version 460 core\n";
+}
+
+/***********************************************************
+ *  GpuDrivenRenderer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+GpuDrivenRenderer::GpuDrivenRenderer()
+{
+	m_drawProgram = 0;
+	m_cullProgram = 0;
+	m_objectBuffer = 0;
+	m_meshRangeBuffer = 0;
+	m_commandBuffer = 0;
+	m_objectCount = 0;
+	m_objectCapacity = 0;
+	m_uploadStream = new StreamBuffer();
+	m_objectCountLocation = -1;
+	m_frustumPlanesLocation = -1;
+	m_cameraPositionLocation = -1;
+	m_projectionScaleLocation = -1;
+	m_orthographicLocation = -1;
+	m_frustumCullingLocation = -1;
+	m_levelOfDetailLocation = -1;
+	m_lodScreenSizesLocation = -1;
+	m_lodHysteresisLocation = -1;
+	m_occlusionCullingLocation = -1;
+	m_occlusionViewProjectionLocation = -1;
+	m_hiZLevelsLocation = -1;
+	m_sceneTexturesLocation = -1;
+	m_bReportedArrayLimit = false;
+	m_useLightingLocation = -1;
+	m_bLighting = false;
+}
+
+/***********************************************************
+ *  ~GpuDrivenRenderer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+GpuDrivenRenderer::~GpuDrivenRenderer()
+{
+	Destroy();
+	delete m_uploadStream;
+	m_uploadStream = NULL;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the programs and the
+ *  buffers.
+ ***********************************************************/
+void GpuDrivenRenderer::Destroy()
+{
+	if (m_drawProgram != 0)
+	{
+		glDeleteProgram(m_drawProgram);
+		m_drawProgram = 0;
+	}
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+		m_cullProgram = 0;
+	}
+	if (m_objectBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_objectBuffer);
+		glDeleteBuffers(1, &m_meshRangeBuffer);
+		glDeleteBuffers(1, &m_commandBuffer);
+		m_objectBuffer = 0;
+		m_meshRangeBuffer = 0;
+		m_commandBuffer = 0;
+	}
+	m_objectCount = 0;
+	m_objectCapacity = 0;
+}
+
+/***********************************************************
+ *  BindProgramBlocks()
+ *
+ *  This method is used for attaching the uniform blocks of
+ *  the draw program to the binding points used by the
+ *  scene shaders, and its cluster and shadow samplers to
+ *  their texture units, so that both programs read the same
+ *  frame, light, material, cluster and shadow buffers.
+ ***********************************************************/
+void GpuDrivenRenderer::BindProgramBlocks()
+{
+	const char* blockNames[5] = { "FrameBlock", "LightBlock", "MaterialBlock", "ClusterBlock", "ShadowBlock" };
+	const GLuint bindings[5] =
+	{
+		ShaderUniforms::FRAME_BLOCK_BINDING,
+		ShaderUniforms::LIGHT_BLOCK_BINDING,
+		ShaderUniforms::MATERIAL_BLOCK_BINDING,
+		ShaderUniforms::CLUSTER_BLOCK_BINDING,
+		ShaderUniforms::SHADOW_BLOCK_BINDING
+	};
+
+	for (int i = 0; i < 5; i++)
+	{
+		GLuint blockIndex = glGetUniformBlockIndex(m_drawProgram, blockNames[i]);
+		if (blockIndex != GL_INVALID_INDEX)
+		{
+			glUniformBlockBinding(m_drawProgram, blockIndex, bindings[i]);
+		}
+	}
+
+	glProgramUniform1i(
+		m_drawProgram,
+		glGetUniformLocation(m_drawProgram, "clusterLightCounts"),
+		ShaderUniforms::CLUSTER_LIGHT_COUNT_UNIT);
+	glProgramUniform1i(
+		m_drawProgram,
+		glGetUniformLocation(m_drawProgram, "clusterLightIndices"),
+		ShaderUniforms::CLUSTER_LIGHT_INDEX_UNIT);
+	glProgramUniform1i(
+		m_drawProgram,
+		glGetUniformLocation(m_drawProgram, "shadowMap"),
+		ShaderUniforms::SHADOW_MAP_UNIT);
+}
+
+/***********************************************************
+ *  BuildPrograms()
+ *
+ *  This method is used for building the indirect drawing
+ *  version of the scene shaders and the culling compute
+ *  shader from the stored paths.  The built programs only
+ *  replace the current ones when both succeed, so a shader
+ *  that fails to build keeps the previous programs.
+ ***********************************************************/
+bool GpuDrivenRenderer::BuildPrograms()
+{
+	GLuint drawProgram = ShaderLoader::BuildProgram(
+		m_vertexShaderPath.c_str(),
+		m_fragmentShaderPath.c_str(),
+		g_IndirectShaderHeader);
+
+	GLuint cullProgram = 0;
+	std::string cullSource;
+	if ((drawProgram != 0) &&
+		(ShaderLoader::LoadSource(m_cullShaderPath.c_str(), g_CullShaderHeader, cullSource) == true))
+	{
+		GLuint cullShader = ShaderLoader::CompileShader(GL_COMPUTE_SHADER, cullSource, m_cullShaderPath.c_str());
+		if (cullShader != 0)
+		{
+			cullProgram = ShaderLoader::LinkProgram(&cullShader, 1);
+		}
+	}
+
+	if ((drawProgram == 0) || (cullProgram == 0))
+	{
+		if (drawProgram != 0)
+		{
+			glDeleteProgram(drawProgram);
+		}
+		return(false);
+	}
+
+	if (m_drawProgram != 0)
+	{
+		glDeleteProgram(m_drawProgram);
+	}
+	if (m_cullProgram != 0)
+	{
+		glDeleteProgram(m_cullProgram);
+	}
+	m_drawProgram = drawProgram;
+	m_cullProgram = cullProgram;
+
+	BindProgramBlocks();
+	m_sceneTexturesLocation = glGetUniformLocation(m_drawProgram, "sceneTextures");
+	m_useLightingLocation = glGetUniformLocation(m_drawProgram, "bUseLighting");
+
+	m_objectCountLocation = glGetUniformLocation(m_cullProgram, "objectCount");
+	m_frustumPlanesLocation = glGetUniformLocation(m_cullProgram, "frustumPlanes");
+	m_cameraPositionLocation = glGetUniformLocation(m_cullProgram, "cameraPosition");
+	m_projectionScaleLocation = glGetUniformLocation(m_cullProgram, "projectionScale");
+	m_orthographicLocation = glGetUniformLocation(m_cullProgram, "bOrthographic");
+	m_frustumCullingLocation = glGetUniformLocation(m_cullProgram, "bFrustumCulling");
+	m_levelOfDetailLocation = glGetUniformLocation(m_cullProgram, "bLevelOfDetail");
+	m_lodScreenSizesLocation = glGetUniformLocation(m_cullProgram, "lodScreenSizes");
+	m_lodHysteresisLocation = glGetUniformLocation(m_cullProgram, "lodHysteresis");
+	m_occlusionCullingLocation = glGetUniformLocation(m_cullProgram, "bOcclusionCulling");
+	m_occlusionViewProjectionLocation = glGetUniformLocation(m_cullProgram, "occlusionViewProjection");
+	m_hiZLevelsLocation = glGetUniformLocation(m_cullProgram, "hiZLevels");
+	glProgramUniform1i(
+		m_cullProgram,
+		glGetUniformLocation(m_cullProgram, "hiZBuffer"),
+		ShaderUniforms::HIZ_BUFFER_UNIT);
+
+	// the lighting switch is state of the program it was set on
+	SetLighting(m_bLighting);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the programs and the
+ *  buffers for indirect drawing.  False is returned when
+ *  the context is older than OpenGL 4.6, which includes the
+ *  core profiles that macOS provides, or when a shader
+ *  fails to build.
+ ***********************************************************/
+bool GpuDrivenRenderer::Initialize(
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const char* cullShaderPath)
+{
+	Destroy();
+
+	if (!GLEW_VERSION_4_6)
+	{
+		std::cout << "GPU driven rendering needs OpenGL 4.6" << std::endl;
+		return(false);
+	}
+
+	m_vertexShaderPath = vertexShaderPath;
+	m_fragmentShaderPath = fragmentShaderPath;
+	m_cullShaderPath = cullShaderPath;
+	if (BuildPrograms() == false)
+	{
+		return(false);
+	}
+
+	glGenBuffers(1, &m_objectBuffer);
+	glGenBuffers(1, &m_meshRangeBuffer);
+	glGenBuffers(1, &m_commandBuffer);
+
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadShaders()
+ *
+ *  This method is used for building the programs again
+ *  after their shader files changed.  The buffers are kept,
+ *  and so are the previous programs when the build fails.
+ ***********************************************************/
+bool GpuDrivenRenderer::ReloadShaders()
+{
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	return(BuildPrograms());
+}
+
+/***********************************************************
+ *  GetCullShaderPath()
+ *
+ *  This method is used for getting the path of the culling
+ *  compute shader, so that it can be watched for changes.
+ ***********************************************************/
+const std::string& GpuDrivenRenderer::GetCullShaderPath() const
+{
+	return(m_cullShaderPath);
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the programs
+ *  for indirect drawing have been built.
+ ***********************************************************/
+bool GpuDrivenRenderer::IsSupported() const
+{
+	return((m_drawProgram != 0) && (m_cullProgram != 0));
+}
+
+/***********************************************************
+ *  SetMeshRanges()
+ *
+ *  This method is used for uploading the table of mesh
+ *  ranges in the pooled buffers.  Each object refers to the
+ *  first entry of its mesh, followed by one entry per
+ *  further level of detail.
+ ***********************************************************/
+void GpuDrivenRenderer::SetMeshRanges(const std::vector<MESH_RANGE_DATA>& meshRanges)
+{
+	if (IsSupported() == false)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_meshRangeBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, meshRanges.size() * sizeof(MESH_RANGE_DATA), meshRanges.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+/***********************************************************
+ *  SetObjects()
+ *
+ *  This method is used for replacing the per-object data.
+ *  The command buffer gets one command per object, and both
+ *  buffers only grow, by doubling, when there are more
+ *  objects than they were created for.  The objects are
+ *  written into the next region of the staging ring buffer
+ *  and copied into the object buffer in command order, so
+ *  neither the driver nor the CPU waits for the frames that
+ *  still read the old objects.  Uploads that do not fit the
+ *  ring buffer yet go through the driver once, and grow it.
+ ***********************************************************/
+void GpuDrivenRenderer::SetObjects(const std::vector<OBJECT_DATA>& objects)
+{
+	if (IsSupported() == false)
+	{
+		return;
+	}
+
+	m_objectCount = (int)objects.size();
+	if (m_objectCount > m_objectCapacity)
+	{
+		while (m_objectCapacity < m_objectCount)
+		{
+			m_objectCapacity = (m_objectCapacity == 0) ? 64 : m_objectCapacity * 2;
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, m_objectCapacity * sizeof(OBJECT_DATA), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, m_objectCapacity * sizeof(DRAW_COMMAND), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+
+	size_t objectBytes = m_objectCount * sizeof(OBJECT_DATA);
+	if (objectBytes == 0)
+	{
+		return;
+	}
+
+	if (m_uploadStream->IsInitialized() == false)
+	{
+		m_uploadStream->Initialize(objectBytes);
+	}
+
+	size_t offset = 0;
+	m_uploadStream->BeginFrame();
+	void* pWrite = m_uploadStream->Allocate(objectBytes, sizeof(OBJECT_DATA), offset);
+	if (pWrite != NULL)
+	{
+		memcpy(pWrite, objects.data(), objectBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, m_uploadStream->GetBuffer());
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_objectBuffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, (GLintptr)offset, 0, (GLsizeiptr)objectBytes);
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+	else
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_objectBuffer);
+		glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, objectBytes, objects.data());
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+	m_uploadStream->EndFrame();
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects
+ *  in the object buffer.
+ ***********************************************************/
+int GpuDrivenRenderer::GetObjectCount() const
+{
+	return(m_objectCount);
+}
+
+/***********************************************************
+ *  SetLighting()
+ *
+ *  This method is used for turning the lighting of the
+ *  draw program on or off, matching the scene shaders.
+ ***********************************************************/
+void GpuDrivenRenderer::SetLighting(bool bLighting)
+{
+	m_bLighting = bLighting;
+	if (IsSupported() == false)
+	{
+		return;
+	}
+
+	glProgramUniform1i(m_drawProgram, m_useLightingLocation, bLighting);
+}
+
+/***********************************************************
+ *  SetTextureArrays()
+ *
+ *  This method is used for setting the texture arrays into
+ *  the sampler array of the draw program, as bindless
+ *  handles or as the texture units the arrays are bound
+ *  to.  Streaming arrays are created again as they grow,
+ *  which changes their handles, so this is done every
+ *  frame; it is a single uniform call.  Only bindless arrays
+ *  can outnumber the samplers, and the objects in them are
+ *  drawn without their texture.
+ ***********************************************************/
+void GpuDrivenRenderer::SetTextureArrays(const TextureArrays* pTextureArrays)
+{
+	int arrayCount = pTextureArrays->GetArrayCount();
+	if (arrayCount > MAX_TEXTURE_ARRAYS)
+	{
+		if (m_bReportedArrayLimit == false)
+		{
+			std::cout << "Only " << MAX_TEXTURE_ARRAYS << " of the " << arrayCount << " texture arrays can be sampled by the GPU driven draws" << std::endl;
+			m_bReportedArrayLimit = true;
+		}
+		arrayCount = MAX_TEXTURE_ARRAYS;
+	}
+	if (arrayCount == 0)
+	{
+		return;
+	}
+
+	if (pTextureArrays->IsBindless() == true)
+	{
+		GLuint64 handles[MAX_TEXTURE_ARRAYS];
+		for (int i = 0; i < arrayCount; i++)
+		{
+			handles[i] = pTextureArrays->GetArrayHandle(i);
+		}
+		glProgramUniformHandleui64vARB(m_drawProgram, m_sceneTexturesLocation, arrayCount, handles);
+	}
+	else
+	{
+		// each array is bound to the unit matching its index
+		GLint units[MAX_TEXTURE_ARRAYS];
+		for (int i = 0; i < arrayCount; i++)
+		{
+			units[i] = i;
+		}
+		glProgramUniform1iv(m_drawProgram, m_sceneTexturesLocation, arrayCount, units);
+	}
+}
+
+/***********************************************************
+ *  Draw()
+ *
+ *  This method is used for culling and drawing the objects.
+ *  The compute shader writes one command per object, with
+ *  no instances for the culled ones and the object index as
+ *  the base instance, so the whole object buffer is drawn
+ *  with one glMultiDrawElementsIndirect() call.  With
+ *  occlusion culling on and a built depth pyramid, objects
+ *  inside the frustum are also tested against the pyramid,
+ *  which its buffer keeps bound to the texture unit of the
+ *  cull shader.  The scene program is made current again
+ *  afterwards.
+ ***********************************************************/
+void GpuDrivenRenderer::Draw(
+	const CULL_VIEW& view,
+	const HiZBuffer* pHiZBuffer,
+	PrimitiveMeshes* pMeshes,
+	const TextureArrays* pTextureArrays)
+{
+	if ((IsSupported() == false) || (m_objectCount == 0) || (NULL == pMeshes))
+	{
+		return;
+	}
+
+	GLuint sceneProgram = GLStateCache::GetProgram();
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_ObjectBufferBinding, m_objectBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_CommandBufferBinding, m_commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, g_MeshRangeBufferBinding, m_meshRangeBuffer);
+
+	// cull the objects and write their draw commands
+	GLStateCache::UseProgram(m_cullProgram);
+	glUniform1ui(m_objectCountLocation, (GLuint)m_objectCount);
+	glUniform4fv(m_frustumPlanesLocation, 6, glm::value_ptr(view.frustum.planes[0]));
+	glUniform3fv(m_cameraPositionLocation, 1, glm::value_ptr(view.cameraPosition));
+	glUniform1f(m_projectionScaleLocation, view.projectionScale);
+	glUniform1i(m_orthographicLocation, view.bOrthographic);
+	glUniform1i(m_frustumCullingLocation, view.bFrustumCulling);
+	glUniform1i(m_levelOfDetailLocation, view.bLevelOfDetail);
+	glUniform1fv(m_lodScreenSizesLocation, PrimitiveMeshes::LOD_LEVELS - 1, view.lodScreenSizes);
+	glUniform1f(m_lodHysteresisLocation, view.lodHysteresis);
+	bool bOcclusionCulling =
+		(view.bOcclusionCulling == true) &&
+		(pHiZBuffer != NULL) &&
+		(pHiZBuffer->IsReady() == true);
+	glUniform1i(m_occlusionCullingLocation, bOcclusionCulling);
+	if (bOcclusionCulling == true)
+	{
+		glUniformMatrix4fv(m_occlusionViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(pHiZBuffer->GetViewProjection()));
+		glUniform1i(m_hiZLevelsLocation, pHiZBuffer->GetLevelCount());
+	}
+	glDispatchCompute((m_objectCount + g_CullGroupSize - 1) / g_CullGroupSize, 1, 1);
+
+	// the draw reads the commands and the object data written above
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	GLStateCache::UseProgram(m_drawProgram);
+	SetTextureArrays(pTextureArrays);
+	pMeshes->BindIndirectPool();
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_SHORT, (void*)0, m_objectCount, 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+	GLStateCache::UseProgram(sceneProgram);
+}
@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// gpudrivenrenderer.h
+// ============
+// cull and draw the pooled scene objects on the GPU with indirect draws
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "HiZBuffer.h"
+#include "PrimitiveMeshes.h"
+#include "TextureArrays.h"
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  GpuDrivenRenderer
+ *
+ *  This class contains the code for drawing all the scene
+ *  objects that use the pooled meshes with a single
+ *  glMultiDrawElementsIndirect() call.  The per-object data
+ *  lives in a shader storage buffer, and a compute shader
+ *  culls every object against the view frustum and the
+ *  depth pyramid of the last frame, picks its level of
+ *  detail and writes its draw command, so the CPU does no
+ *  work per object.  Changed object data is written
+ *  into a persistently mapped staging buffer and copied on
+ *  the GPU, so the upload never waits for the last frame.
+ *  It needs an OpenGL 4.6 context, and reports itself
+ *  unsupported otherwise.
+ ***********************************************************/
+class GpuDrivenRenderer
+{
+public:
+	// constructor
+	GpuDrivenRenderer();
+	// destructor
+	~GpuDrivenRenderer();
+
+	// most texture arrays the draw shader can sample from, the
+	// same as the arrays bound without bindless handles
+	static const int MAX_TEXTURE_ARRAYS = TextureArrays::MAX_BOUND_ARRAYS;
+
+	// std430 layout of one object in the object buffer
+	struct OBJECT_DATA
+	{
+		glm::mat4 model;
+		glm::vec4 boundsMin;
+		glm::vec4 boundsMax;
+		int materialIndex;
+		// texture array and layer, or -1 for no texture
+		int textureArray;
+		int textureLayer;
+		// first entry of the mesh in the mesh range table
+		int meshRangeIndex;
+		glm::vec2 UVscale;
+		// level of detail, kept by the compute shader
+		int lodLevel;
+		// number of levels of detail of the mesh
+		int lodCount;
+	};
+
+	// std430 layout of one mesh range in the mesh range table
+	struct MESH_RANGE_DATA
+	{
+		GLuint indexCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint padding;
+	};
+
+	// layout of one command in the indirect draw buffer
+	struct DRAW_COMMAND
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	// view the objects are culled and sized against
+	struct CULL_VIEW
+	{
+		BoundingVolumes::FRUSTUM frustum;
+		glm::vec3 cameraPosition;
+		float projectionScale;
+		bool bOrthographic;
+		bool bFrustumCulling;
+		bool bLevelOfDetail;
+		// true when the objects hidden behind the depth pyramid
+		// passed to Draw() are culled as well
+		bool bOcclusionCulling;
+		// projected sizes switching to the next coarser level,
+		// and the band around them that keeps the current level
+		float lodScreenSizes[PrimitiveMeshes::LOD_LEVELS - 1];
+		float lodHysteresis;
+	};
+
+private:
+	// programs for drawing and for culling
+	GLuint m_drawProgram;
+	GLuint m_cullProgram;
+	// buffers of the objects, the mesh ranges and the commands
+	GLuint m_objectBuffer;
+	GLuint m_meshRangeBuffer;
+	GLuint m_commandBuffer;
+	// number of objects in the object buffer
+	int m_objectCount;
+	// number of objects the buffers were created for
+	int m_objectCapacity;
+	// pointer to the ring buffer changed objects are staged in
+	StreamBuffer* m_uploadStream;
+	// cached uniform locations of the cull program
+	GLint m_objectCountLocation;
+	GLint m_frustumPlanesLocation;
+	GLint m_cameraPositionLocation;
+	GLint m_projectionScaleLocation;
+	GLint m_orthographicLocation;
+	GLint m_frustumCullingLocation;
+	GLint m_levelOfDetailLocation;
+	GLint m_lodScreenSizesLocation;
+	GLint m_lodHysteresisLocation;
+	GLint m_occlusionCullingLocation;
+	GLint m_occlusionViewProjectionLocation;
+	GLint m_hiZLevelsLocation;
+	// cached uniform locations of the draw program
+	GLint m_sceneTexturesLocation;
+	GLint m_useLightingLocation;
+	// lighting switch, set again on rebuilt programs
+	bool m_bLighting;
+	// true once bindless arrays past the sampler array of the
+	// draw shader have been reported
+	bool m_bReportedArrayLimit;
+	// shader files the programs are built from
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	std::string m_cullShaderPath;
+
+	// build the programs from the shader files, replacing the
+	// current ones only on success
+	bool BuildPrograms();
+
+	// attach the uniform blocks and fixed samplers of the draw program
+	void BindProgramBlocks();
+	// set the texture arrays into the sampler array
+	void SetTextureArrays(const TextureArrays* pTextureArrays);
+	// free the programs and buffers
+	void Destroy();
+
+public:
+	// build the programs; false when the context cannot run them
+	bool Initialize(
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const char* cullShaderPath);
+	// true once the programs have been built
+	bool IsSupported() const;
+	// build the programs again after their files changed
+	bool ReloadShaders();
+	// path of the culling compute shader
+	const std::string& GetCullShaderPath() const;
+
+	// set the table of mesh ranges the objects refer to
+	void SetMeshRanges(const std::vector<MESH_RANGE_DATA>& meshRanges);
+	// replace the contents of the object buffer
+	void SetObjects(const std::vector<OBJECT_DATA>& objects);
+	// number of objects in the object buffer
+	int GetObjectCount() const;
+
+	// turn the lighting of the draw shader on or off
+	void SetLighting(bool bLighting);
+
+	// cull the objects on the GPU and draw them with one call;
+	// the depth pyramid can be NULL without occlusion culling
+	void Draw(
+		const CULL_VIEW& view,
+		const HiZBuffer* pHiZBuffer,
+		PrimitiveMeshes* pMeshes,
+		const TextureArrays* pTextureArrays);
+};
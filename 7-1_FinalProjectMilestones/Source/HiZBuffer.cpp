@@ -0,0 +1,663 @@
+///////////////////////////////////////////////////////////////////////////////
+// hizbuffer.cpp
+// ============
+// reduce the depth of the drawn frame into a pyramid for occlusion culling
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "HiZBuffer.h"
+#include "GLStateCache.h"
+#include "ShaderUniforms.h"
+#include "ShaderLoader.h"
+
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// image binding point of the level being written, matching
+	// the shader
+	const GLuint g_DestinationImageBinding = 0;
+
+	// texels reduced by one compute work group across and down
+	const int g_ReduceGroupSize = 8;
+
+	// the first level no wider or taller than this is read back
+	// for the CPU, which keeps every readback small
+	const int g_ReadbackSize = 256;
+
+	// corners this close to the eye or behind it cannot be
+	// projected, so their boxes always count as visible
+	const float g_MinClipDepth = 1.0e-5f;
+}
+
+/***********************************************************
+ *  HiZBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+HiZBuffer::HiZBuffer()
+{
+	m_program = 0;
+	m_depthTexture = 0;
+	m_pyramidTexture = 0;
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_viewProjection = glm::mat4(1.0f);
+	m_bReady = false;
+	m_sourceLevelLocation = -1;
+	m_readbackLevel = 0;
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		m_readbackBuffers[i] = 0;
+		m_readbackFences[i] = 0;
+		m_readbackViewProjections[i] = glm::mat4(1.0f);
+	}
+	m_nextReadback = 0;
+}
+
+/***********************************************************
+ *  ~HiZBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+HiZBuffer::~HiZBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  DestroyTextures()
+ *
+ *  This method is used for freeing the depth copy, the
+ *  pyramid, the pixel buffers and the fences of the
+ *  readbacks in flight.
+ ***********************************************************/
+void HiZBuffer::DestroyTextures()
+{
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		if (m_readbackFences[i] != 0)
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = 0;
+		}
+	}
+	if (m_readbackBuffers[0] != 0)
+	{
+		glDeleteBuffers(READBACK_BUFFERS, m_readbackBuffers);
+		for (int i = 0; i < READBACK_BUFFERS; i++)
+		{
+			m_readbackBuffers[i] = 0;
+		}
+	}
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		glDeleteTextures(1, &m_pyramidTexture);
+		m_depthTexture = 0;
+		m_pyramidTexture = 0;
+		GLStateCache::Invalidate();
+	}
+	m_width = 0;
+	m_height = 0;
+	m_levelCount = 0;
+	m_bReady = false;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the program and the
+ *  textures and buffers of the pyramid.
+ ***********************************************************/
+void HiZBuffer::Destroy()
+{
+	DestroyTextures();
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+		m_program = 0;
+	}
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for building the reduction compute
+ *  shader from the stored path.  The built program only
+ *  replaces the current one when it succeeds.
+ ***********************************************************/
+bool HiZBuffer::BuildProgram()
+{
+	std::string source;
+	if (ShaderLoader::LoadSource(m_shaderPath.c_str(), NULL, source) == false)
+	{
+		return(false);
+	}
+
+	GLuint shader = ShaderLoader::CompileShader(GL_COMPUTE_SHADER, source, m_shaderPath.c_str());
+	if (shader == 0)
+	{
+		return(false);
+	}
+	GLuint program = ShaderLoader::LinkProgram(&shader, 1);
+	if (program == 0)
+	{
+		return(false);
+	}
+
+	glProgramUniform1i(
+		program,
+		glGetUniformLocation(program, "sourceDepth"),
+		ShaderUniforms::HIZ_BUFFER_UNIT);
+
+	if (m_program != 0)
+	{
+		glDeleteProgram(m_program);
+	}
+	m_program = program;
+	m_sourceLevelLocation = glGetUniformLocation(m_program, "sourceLevel");
+
+	return(true);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for building the reduction program.
+ *  The textures are only made once the size of the depth
+ *  buffer is known, by the first Build().  False is
+ *  returned when the context is older than OpenGL 4.3, or
+ *  when the shader fails to build.
+ ***********************************************************/
+bool HiZBuffer::Initialize(const char* shaderPath)
+{
+	Destroy();
+
+	if (!GLEW_VERSION_4_3)
+	{
+		std::cout << "Occlusion culling needs OpenGL 4.3" << std::endl;
+		return(false);
+	}
+
+	GLint textureUnits = 0;
+	glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS, &textureUnits);
+	if (textureUnits <= ShaderUniforms::HIZ_BUFFER_UNIT)
+	{
+		std::cout << "Occlusion culling needs " << ShaderUniforms::HIZ_BUFFER_UNIT + 1 << " texture units" << std::endl;
+		return(false);
+	}
+
+	m_shaderPath = shaderPath;
+
+	return(BuildProgram());
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the program
+ *  has been built.
+ ***********************************************************/
+bool HiZBuffer::IsSupported() const
+{
+	return(m_program != 0);
+}
+
+/***********************************************************
+ *  ReloadShader()
+ *
+ *  This method is used for building the program again
+ *  after its shader file changed.  The previous program is
+ *  kept when the build fails.
+ ***********************************************************/
+bool HiZBuffer::ReloadShader()
+{
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	return(BuildProgram());
+}
+
+/***********************************************************
+ *  GetShaderPath()
+ *
+ *  This method is used for getting the path of the
+ *  reduction compute shader, so that it can be watched for
+ *  changes.
+ ***********************************************************/
+const std::string& HiZBuffer::GetShaderPath() const
+{
+	return(m_shaderPath);
+}
+
+/***********************************************************
+ *  GetLevelSizes()
+ *
+ *  This method is used for getting the size of every level
+ *  of a pyramid over a depth buffer.  The first level has
+ *  the size of the depth buffer, and every level after it
+ *  half the size of the one before, rounded down, until a
+ *  single texel is left.
+ ***********************************************************/
+void HiZBuffer::GetLevelSizes(int width, int height, std::vector<glm::ivec2>& levelSizes)
+{
+	levelSizes.clear();
+
+	glm::ivec2 size(width, height);
+	levelSizes.push_back(size);
+	while ((size.x > 1) || (size.y > 1))
+	{
+		size = glm::max(size / 2, glm::ivec2(1));
+		levelSizes.push_back(size);
+	}
+}
+
+/***********************************************************
+ *  ReduceLevel()
+ *
+ *  This method is used for reducing a level of a pyramid
+ *  into the next one on the CPU, the same way as the
+ *  shader does on the GPU.  Every texel takes the farthest
+ *  depth of the texels it covers, which are 2 by 2, and 3
+ *  along a side where the size of the level is odd, so no
+ *  texel is left out.
+ ***********************************************************/
+void HiZBuffer::ReduceLevel(
+	const float* source,
+	glm::ivec2 sourceSize,
+	float* destination,
+	glm::ivec2 destinationSize)
+{
+	for (int y = 0; y < destinationSize.y; y++)
+	{
+		int firstY = (y * sourceSize.y) / destinationSize.y;
+		int lastY = ((y + 1) * sourceSize.y + destinationSize.y - 1) / destinationSize.y - 1;
+		for (int x = 0; x < destinationSize.x; x++)
+		{
+			int firstX = (x * sourceSize.x) / destinationSize.x;
+			int lastX = ((x + 1) * sourceSize.x + destinationSize.x - 1) / destinationSize.x - 1;
+
+			float depth = 0.0f;
+			for (int sy = firstY; sy <= lastY; sy++)
+			{
+				for (int sx = firstX; sx <= lastX; sx++)
+				{
+					float sample = source[sy * sourceSize.x + sx];
+					depth = (sample > depth) ? sample : depth;
+				}
+			}
+			destination[y * destinationSize.x + x] = depth;
+		}
+	}
+}
+
+/***********************************************************
+ *  CreateTextures()
+ *
+ *  This method is used for making the depth copy and the
+ *  pyramid for a depth buffer size, and the pixel buffers
+ *  the readback level is read into.  The readbacks in
+ *  flight for the previous size are dropped.
+ ***********************************************************/
+void HiZBuffer::CreateTextures(int width, int height)
+{
+	DestroyTextures();
+
+	std::vector<glm::ivec2> levelSizes;
+	GetLevelSizes(width, height, levelSizes);
+	m_width = width;
+	m_height = height;
+	m_levelCount = (int)levelSizes.size();
+
+	// the readback level is the finest one that is small enough
+	m_readbackLevel = m_levelCount - 1;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		if ((levelSizes[level].x <= g_ReadbackSize) && (levelSizes[level].y <= g_ReadbackSize))
+		{
+			m_readbackLevel = level;
+			break;
+		}
+	}
+
+	glGenTextures(1, &m_depthTexture);
+	GLStateCache::EditTexture(ShaderUniforms::HIZ_BUFFER_UNIT, GL_TEXTURE_2D, m_depthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+	glGenTextures(1, &m_pyramidTexture);
+	GLStateCache::EditTexture(ShaderUniforms::HIZ_BUFFER_UNIT, GL_TEXTURE_2D, m_pyramidTexture);
+	glTexStorage2D(GL_TEXTURE_2D, m_levelCount, GL_R32F, width, height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+	glm::ivec2 readbackSize = levelSizes[m_readbackLevel];
+	glGenBuffers(READBACK_BUFFERS, m_readbackBuffers);
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[i]);
+		glBufferData(GL_PIXEL_PACK_BUFFER, readbackSize.x * readbackSize.y * sizeof(float), NULL, GL_STREAM_READ);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_nextReadback = 0;
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the pyramid from the
+ *  depth of the frame just drawn, which was drawn with the
+ *  passed in view and projection.  The depth buffer of the
+ *  current viewport is copied, and every level is reduced
+ *  from the one before it by a dispatch of its own.  The
+ *  pyramid is left bound to its texture unit for the cull
+ *  shader, and the readback level is copied into the next
+ *  pixel buffer, fenced, to be collected a frame or two
+ *  later without waiting for the GPU.  The textures are
+ *  made again when the size of the viewport changed; the
+ *  viewport comes from the state cache, without asking
+ *  OpenGL.
+ ***********************************************************/
+void HiZBuffer::Build(const glm::mat4& viewProjection)
+{
+	if (IsSupported() == false)
+	{
+		return;
+	}
+
+	GLint viewport[4];
+	GLStateCache::GetViewport(viewport);
+	if ((viewport[2] <= 0) || (viewport[3] <= 0))
+	{
+		return;
+	}
+	if ((viewport[2] != m_width) || (viewport[3] != m_height))
+	{
+		CreateTextures(viewport[2], viewport[3]);
+	}
+
+	// the read framebuffer is the one the frame was drawn into,
+	// the offscreen target or the window
+	GLStateCache::EditTexture(ShaderUniforms::HIZ_BUFFER_UNIT, GL_TEXTURE_2D, m_depthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, viewport[0], viewport[1], m_width, m_height);
+
+	// the scene program is put back in use after the dispatches
+	GLuint sceneProgram = GLStateCache::GetProgram();
+	GLStateCache::UseProgram(m_program);
+
+	int levelWidth = m_width;
+	int levelHeight = m_height;
+	for (int level = 0; level < m_levelCount; level++)
+	{
+		// the first level is a copy of the depth, every other
+		// one is reduced from the level before it
+		GLStateCache::BindTexture(
+			ShaderUniforms::HIZ_BUFFER_UNIT,
+			GL_TEXTURE_2D,
+			(level == 0) ? m_depthTexture : m_pyramidTexture);
+		glUniform1i(m_sourceLevelLocation, (level == 0) ? 0 : (level - 1));
+		glBindImageTexture(g_DestinationImageBinding, m_pyramidTexture, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+		glDispatchCompute(
+			(levelWidth + g_ReduceGroupSize - 1) / g_ReduceGroupSize,
+			(levelHeight + g_ReduceGroupSize - 1) / g_ReduceGroupSize,
+			1);
+
+		// the next level and the cull shader fetch this one
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		levelWidth = (levelWidth > 1) ? (levelWidth / 2) : 1;
+		levelHeight = (levelHeight > 1) ? (levelHeight / 2) : 1;
+	}
+
+	GLStateCache::UseProgram(sceneProgram);
+
+	m_viewProjection = viewProjection;
+	m_bReady = true;
+
+	// a readback that was never collected is dropped, so that
+	// the pixel buffer it was going into can be used again
+	int slot = m_nextReadback;
+	if (m_readbackFences[slot] != 0)
+	{
+		glDeleteSync(m_readbackFences[slot]);
+		m_readbackFences[slot] = 0;
+	}
+
+	glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+	GLStateCache::EditTexture(ShaderUniforms::HIZ_BUFFER_UNIT, GL_TEXTURE_2D, m_pyramidTexture);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[slot]);
+	glGetTexImage(GL_TEXTURE_2D, m_readbackLevel, GL_RED, GL_FLOAT, (void*)0);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	m_readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	m_readbackViewProjections[slot] = viewProjection;
+	m_nextReadback = (slot + 1) % READBACK_BUFFERS;
+}
+
+/***********************************************************
+ *  Invalidate()
+ *
+ *  This method is used for dropping the pyramid and the
+ *  readbacks in flight, so that depths drawn before, say,
+ *  culling was turned back on are never tested.  The next
+ *  Build() makes a valid pyramid again.
+ ***********************************************************/
+void HiZBuffer::Invalidate()
+{
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		if (m_readbackFences[i] != 0)
+		{
+			glDeleteSync(m_readbackFences[i]);
+			m_readbackFences[i] = 0;
+		}
+	}
+	m_bReady = false;
+}
+
+/***********************************************************
+ *  IsReady()
+ *
+ *  This method is used for checking whether a pyramid has
+ *  been built that boxes can be tested against.
+ ***********************************************************/
+bool HiZBuffer::IsReady() const
+{
+	return(m_bReady);
+}
+
+/***********************************************************
+ *  GetViewProjection()
+ *
+ *  This method is used for getting the view and projection
+ *  the depths of the pyramid were drawn with, which the
+ *  boxes are projected with to be tested.
+ ***********************************************************/
+const glm::mat4& HiZBuffer::GetViewProjection() const
+{
+	return(m_viewProjection);
+}
+
+/***********************************************************
+ *  GetLevelCount()
+ *
+ *  This method is used for getting the number of levels of
+ *  the pyramid.
+ ***********************************************************/
+int HiZBuffer::GetLevelCount() const
+{
+	return(m_levelCount);
+}
+
+/***********************************************************
+ *  CollectReadback()
+ *
+ *  This method is used for copying the latest readback the
+ *  GPU has finished into a pyramid on the CPU, and reducing
+ *  its coarser levels there.  The fences are only polled,
+ *  never waited on; readbacks older than the one copied
+ *  are dropped.  The vectors of the pyramid keep their
+ *  memory, so once a pyramid of the size exists, no more
+ *  is allocated.  False is returned when no readback
+ *  arrived since the last call, which leaves the pyramid
+ *  as it was.
+ ***********************************************************/
+bool HiZBuffer::CollectReadback(DEPTH_PYRAMID& pyramid)
+{
+	if (m_readbackBuffers[0] == 0)
+	{
+		return(false);
+	}
+
+	// the readbacks finish in the order they were made, from
+	// the one the next readback would replace onwards
+	int latest = -1;
+	for (int i = 0; i < READBACK_BUFFERS; i++)
+	{
+		int slot = (m_nextReadback + i) % READBACK_BUFFERS;
+		if (m_readbackFences[slot] == 0)
+		{
+			continue;
+		}
+
+		GLenum result = glClientWaitSync(m_readbackFences[slot], 0, 0);
+		if ((result != GL_ALREADY_SIGNALED) && (result != GL_CONDITION_SATISFIED))
+		{
+			break;
+		}
+		glDeleteSync(m_readbackFences[slot]);
+		m_readbackFences[slot] = 0;
+		latest = slot;
+	}
+	if (latest < 0)
+	{
+		return(false);
+	}
+
+	GetLevelSizes(m_width, m_height, pyramid.levelSizes);
+	pyramid.firstLevel = m_readbackLevel;
+	pyramid.levelOffsets.assign(m_levelCount, -1);
+	int depthCount = 0;
+	for (int level = m_readbackLevel; level < m_levelCount; level++)
+	{
+		pyramid.levelOffsets[level] = depthCount;
+		depthCount += pyramid.levelSizes[level].x * pyramid.levelSizes[level].y;
+	}
+	pyramid.depths.resize(depthCount);
+
+	glm::ivec2 readbackSize = pyramid.levelSizes[m_readbackLevel];
+	GLsizeiptr readbackBytes = readbackSize.x * readbackSize.y * sizeof(float);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, m_readbackBuffers[latest]);
+	const void* mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, readbackBytes, GL_MAP_READ_BIT);
+	if (mapped != NULL)
+	{
+		memcpy(pyramid.depths.data(), mapped, readbackBytes);
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	if (mapped == NULL)
+	{
+		pyramid.bValid = false;
+		return(false);
+	}
+
+	for (int level = m_readbackLevel + 1; level < m_levelCount; level++)
+	{
+		ReduceLevel(
+			pyramid.depths.data() + pyramid.levelOffsets[level - 1],
+			pyramid.levelSizes[level - 1],
+			pyramid.depths.data() + pyramid.levelOffsets[level],
+			pyramid.levelSizes[level]);
+	}
+
+	pyramid.viewProjection = m_readbackViewProjections[latest];
+	pyramid.bValid = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsBoxOccluded()
+ *
+ *  This method is used for testing a box against the depths
+ *  of a pyramid, the same way as the cull shader does.  The
+ *  corners are projected with the view of the pyramid into
+ *  a rectangle of pixels and their nearest depth.  The
+ *  level is chosen where the rectangle covers no more than
+ *  2 by 2 texels, at least the first level held, and the
+ *  pixels are followed down to the texels covering them.
+ *  The box is hidden when its nearest depth is behind the
+ *  farthest depth of those texels.  Boxes reaching behind
+ *  the eye are never hidden.
+ ***********************************************************/
+bool HiZBuffer::IsBoxOccluded(
+	const DEPTH_PYRAMID& pyramid,
+	const BoundingVolumes::BOUNDING_BOX& box)
+{
+	if (pyramid.bValid == false)
+	{
+		return(false);
+	}
+
+	glm::vec2 rectMin(1.0e30f);
+	glm::vec2 rectMax(-1.0e30f);
+	float nearestDepth = 1.0f;
+	for (int c = 0; c < 8; c++)
+	{
+		glm::vec4 corner(
+			(c & 1) ? box.maxPoint.x : box.minPoint.x,
+			(c & 2) ? box.maxPoint.y : box.minPoint.y,
+			(c & 4) ? box.maxPoint.z : box.minPoint.z,
+			1.0f);
+		glm::vec4 clip = pyramid.viewProjection * corner;
+		if (clip.w <= g_MinClipDepth)
+		{
+			return(false);
+		}
+
+		glm::vec3 ndc = glm::vec3(clip) / clip.w;
+		rectMin = glm::min(rectMin, glm::vec2(ndc));
+		rectMax = glm::max(rectMax, glm::vec2(ndc));
+		nearestDepth = glm::min(nearestDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	// the rectangle in pixels of the full resolution, clamped
+	// to the screen
+	glm::ivec2 fullSize = pyramid.levelSizes[0];
+	glm::vec2 pixelMin = (rectMin * 0.5f + 0.5f) * glm::vec2(fullSize);
+	glm::vec2 pixelMax = (rectMax * 0.5f + 0.5f) * glm::vec2(fullSize);
+	glm::ivec2 first = glm::clamp(glm::ivec2(glm::floor(pixelMin)), glm::ivec2(0), fullSize - 1);
+	glm::ivec2 last = glm::clamp(glm::ivec2(glm::floor(pixelMax)), glm::ivec2(0), fullSize - 1);
+
+	int span = glm::max(last.x - first.x, last.y - first.y) + 1;
+	int level = 0;
+	while ((1 << level) < span)
+	{
+		level++;
+	}
+	int levelCount = (int)pyramid.levelSizes.size();
+	level = glm::clamp(level, pyramid.firstLevel, levelCount - 1);
+
+	for (int k = 1; k <= level; k++)
+	{
+		first = (first * pyramid.levelSizes[k]) / pyramid.levelSizes[k - 1];
+		last = (last * pyramid.levelSizes[k]) / pyramid.levelSizes[k - 1];
+	}
+
+	glm::ivec2 size = pyramid.levelSizes[level];
+	const float* depths = pyramid.depths.data() + pyramid.levelOffsets[level];
+	float farthestDepth = glm::max(
+		glm::max(depths[first.y * size.x + first.x], depths[first.y * size.x + last.x]),
+		glm::max(depths[last.y * size.x + first.x], depths[last.y * size.x + last.x]));
+
+	return(nearestDepth > farthestDepth);
+}
\ No newline at end of file
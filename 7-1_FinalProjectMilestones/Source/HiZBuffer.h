@@ -0,0 +1,141 @@
+///////////////////////////////////////////////////////////////////////////////
+// hizbuffer.h
+// ============
+// reduce the depth of the drawn frame into a pyramid for occlusion culling
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  HiZBuffer
+ *
+ *  This class contains the code for the hierarchical depth
+ *  buffer used for occlusion culling.  Once a frame has
+ *  been drawn, its depth is copied and reduced by a compute
+ *  shader into a pyramid of levels, each holding the
+ *  farthest depth of the texels below it.  A box of the
+ *  next frame is projected with the view of the pyramid,
+ *  and is hidden when its nearest depth lies behind the
+ *  farthest depth of the few texels of the level that
+ *  cover it.  The GPU renderer tests its objects against
+ *  the pyramid directly, and a coarse level is read back
+ *  without waiting, a frame or two late, so that the
+ *  objects of the render queue are tested on the CPU.  It
+ *  needs an OpenGL 4.3 context.
+ ***********************************************************/
+class HiZBuffer
+{
+public:
+	// constructor
+	HiZBuffer();
+	// destructor
+	~HiZBuffer();
+
+	// levels of a pyramid read back to the CPU, from the level
+	// read back down to a single texel
+	struct DEPTH_PYRAMID
+	{
+		// view and projection the depths were drawn with
+		glm::mat4 viewProjection;
+		// size of every level, from the full resolution down
+		// to a single texel
+		std::vector<glm::ivec2> levelSizes;
+		// first level held, and where the depths of every
+		// level from it start
+		int firstLevel;
+		std::vector<int> levelOffsets;
+		std::vector<float> depths;
+		// true once depths have been read back
+		bool bValid;
+	};
+
+private:
+	// readbacks that can be in flight at the same time
+	static const int READBACK_BUFFERS = 3;
+
+	// program reducing one level into the next
+	GLuint m_program;
+	// copy of the depth buffer, and the pyramid reduced from it
+	GLuint m_depthTexture;
+	GLuint m_pyramidTexture;
+	// size of the depth buffer and number of levels
+	int m_width;
+	int m_height;
+	int m_levelCount;
+	// view and projection of the depths in the pyramid
+	glm::mat4 m_viewProjection;
+	// true once a pyramid has been built
+	bool m_bReady;
+	// cached uniform location of the program
+	GLint m_sourceLevelLocation;
+	// level read back, and the pixel buffers it is read into
+	int m_readbackLevel;
+	GLuint m_readbackBuffers[READBACK_BUFFERS];
+	// fence and view of every readback in flight, and the
+	// buffer the next readback goes into
+	GLsync m_readbackFences[READBACK_BUFFERS];
+	glm::mat4 m_readbackViewProjections[READBACK_BUFFERS];
+	int m_nextReadback;
+	// compute shader file the program is built from
+	std::string m_shaderPath;
+
+	// build the program from the shader file, replacing the
+	// current one only on success
+	bool BuildProgram();
+	// make the textures and pixel buffers for a depth buffer size
+	void CreateTextures(int width, int height);
+	// free the textures, pixel buffers and fences
+	void DestroyTextures();
+	// free the program and everything else
+	void Destroy();
+
+	// size of the levels of a pyramid over a depth buffer size
+	static void GetLevelSizes(int width, int height, std::vector<glm::ivec2>& levelSizes);
+	// farthest depth of the texels of a level covered by every
+	// texel of the next level
+	static void ReduceLevel(
+		const float* source,
+		glm::ivec2 sourceSize,
+		float* destination,
+		glm::ivec2 destinationSize);
+
+public:
+	// build the program; false when the context cannot run it
+	bool Initialize(const char* shaderPath);
+	// true once the program has been built
+	bool IsSupported() const;
+	// build the program again after its file changed
+	bool ReloadShader();
+	// path of the reduction compute shader
+	const std::string& GetShaderPath() const;
+
+	// copy the depth of the drawn frame and reduce it into the
+	// pyramid; call once the scene is drawn, with its view
+	void Build(const glm::mat4& viewProjection);
+	// drop the pyramid and the readbacks in flight, so that no
+	// stale depths are tested
+	void Invalidate();
+	// true once a pyramid has been built
+	bool IsReady() const;
+	// view of the pyramid and its number of levels
+	const glm::mat4& GetViewProjection() const;
+	int GetLevelCount() const;
+
+	// copy the latest readback that arrived into a pyramid on
+	// the CPU; false when none arrived since the last call
+	bool CollectReadback(DEPTH_PYRAMID& pyramid);
+
+	// true when a box lies behind the depths of a pyramid
+	static bool IsBoxOccluded(
+		const DEPTH_PYRAMID& pyramid,
+		const BoundingVolumes::BOUNDING_BOX& box);
+};
\ No newline at end of file
@@ -0,0 +1,226 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.cpp
+// ============
+// split loops over many items into jobs run by work-stealing worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "JobSystem.h"
+
+/***********************************************************
+ *  JobSystem()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+JobSystem::JobSystem(int workerCount)
+{
+	m_queuedJobs = 0;
+	m_bStopping = false;
+
+	if (workerCount < 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 2;
+		if (workerCount < 0)
+		{
+			workerCount = 0;
+		}
+	}
+
+	// one queue for every worker and one for the calling thread
+	for (int i = 0; i <= workerCount; i++)
+	{
+		m_queues.push_back(new JOB_QUEUE());
+		m_queues.back()->first = 0;
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+/***********************************************************
+ *  ~JobSystem()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_bStopping = true;
+	}
+	m_wake.notify_all();
+
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	for (int i = 0; i < m_queues.size(); i++)
+	{
+		delete m_queues[i];
+	}
+	m_queues.clear();
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used by the worker threads for running
+ *  queued jobs, sleeping while there are none, until the
+ *  job system is stopped.
+ ***********************************************************/
+void JobSystem::WorkerLoop(int threadIndex)
+{
+	while (true)
+	{
+		if (RunNextJob(threadIndex) == true)
+		{
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_wakeMutex);
+		while ((m_bStopping == false) && (m_queuedJobs.load() == 0))
+		{
+			m_wake.wait(lock);
+		}
+		if (m_bStopping == true)
+		{
+			return;
+		}
+		lock.unlock();
+
+		// jobs may be counted a moment before they are queued
+		std::this_thread::yield();
+	}
+}
+
+/***********************************************************
+ *  RunNextJob()
+ *
+ *  This method is used for running one job.  The newest job
+ *  of the own queue is taken first, since its items were
+ *  queued last; otherwise the oldest job of another queue
+ *  is stolen, starting with the queue after the own one.
+ ***********************************************************/
+bool JobSystem::RunNextJob(int threadIndex)
+{
+	JOB job;
+	bool bFound = false;
+
+	int queueCount = (int)m_queues.size();
+	for (int i = 0; (i < queueCount) && (bFound == false); i++)
+	{
+		JOB_QUEUE* pQueue = m_queues[(threadIndex + i) % queueCount];
+		std::lock_guard<std::mutex> lock(pQueue->mutex);
+		if (pQueue->first >= pQueue->jobs.size())
+		{
+			continue;
+		}
+
+		if (i == 0)
+		{
+			job = pQueue->jobs.back();
+			pQueue->jobs.pop_back();
+		}
+		else
+		{
+			job = pQueue->jobs[pQueue->first++];
+		}
+		bFound = true;
+
+		// an emptied queue starts over at the front, keeping
+		// its memory for the next loop
+		if (pQueue->first >= pQueue->jobs.size())
+		{
+			pQueue->jobs.clear();
+			pQueue->first = 0;
+		}
+	}
+
+	if (bFound == false)
+	{
+		return(false);
+	}
+	m_queuedJobs--;
+
+	(*job.pFunction)(job.first, job.last, threadIndex);
+	(*job.pRemaining)--;
+
+	return(true);
+}
+
+/***********************************************************
+ *  ParallelFor()
+ *
+ *  This method is used for running a function over count
+ *  items on all threads.  The items are split into chunks
+ *  of the passed in size that are dealt out over the job
+ *  queues in turn, and the calling thread runs and steals
+ *  jobs until every chunk is done.  Loops that fit in one
+ *  chunk, or a job system without workers, run right on the
+ *  calling thread.
+ ***********************************************************/
+void JobSystem::ParallelFor(int count, int chunkSize, const RANGE_FUNCTION& function)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	int callerIndex = (int)m_workers.size();
+	if ((chunkSize <= 0) || (count <= chunkSize) || (m_workers.empty() == true))
+	{
+		function(0, count, callerIndex);
+		return;
+	}
+
+	int chunkCount = (count + chunkSize - 1) / chunkSize;
+	std::atomic<int> remaining(chunkCount);
+
+	// count the jobs before they are queued, so that a worker
+	// taking one never sees the counter below zero
+	{
+		std::lock_guard<std::mutex> lock(m_wakeMutex);
+		m_queuedJobs += chunkCount;
+	}
+
+	int queueCount = (int)m_queues.size();
+	for (int queue = 0; queue < queueCount; queue++)
+	{
+		std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+		for (int chunk = queue; chunk < chunkCount; chunk += queueCount)
+		{
+			JOB job;
+			job.pFunction = &function;
+			job.first = chunk * chunkSize;
+			job.last = (job.first + chunkSize < count) ? (job.first + chunkSize) : count;
+			job.pRemaining = &remaining;
+			m_queues[queue]->jobs.push_back(job);
+		}
+	}
+	m_wake.notify_all();
+
+	// the calling thread helps until the last job has finished
+	while (remaining.load() > 0)
+	{
+		if (RunNextJob(callerIndex) == false)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/***********************************************************
+ *  GetThreadCount()
+ *
+ *  This method is used for getting the number of threads
+ *  that run jobs, including the calling thread.  Thread
+ *  indices passed to the ranges are below this number.
+ ***********************************************************/
+int JobSystem::GetThreadCount() const
+{
+	return((int)m_queues.size());
+}
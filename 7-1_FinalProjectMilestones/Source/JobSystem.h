@@ -0,0 +1,91 @@
+///////////////////////////////////////////////////////////////////////////////
+// jobsystem.h
+// ============
+// split loops over many items into jobs run by work-stealing worker threads
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  JobSystem
+ *
+ *  This class contains the code for running a loop over
+ *  many items on several threads.  The items are split into
+ *  chunks, and every chunk becomes a job in the queue of
+ *  one of the threads.  A thread runs the jobs of its own
+ *  queue from the back and steals from the front of the
+ *  other queues once its own is empty, so uneven chunks
+ *  still keep every thread busy.  The calling thread runs
+ *  jobs as well until the whole loop is done.
+ ***********************************************************/
+class JobSystem
+{
+public:
+	// constructor; a worker count below 0 uses one worker for
+	// each hardware thread besides the GL and calling threads
+	JobSystem(int workerCount = -1);
+	// destructor
+	~JobSystem();
+
+	// function run for the items from first up to last, with
+	// the index of the thread running it
+	typedef std::function<void(int first, int last, int threadIndex)> RANGE_FUNCTION;
+
+private:
+	// one chunk of the items of a loop
+	struct JOB
+	{
+		const RANGE_FUNCTION* pFunction;
+		int first;
+		int last;
+		// jobs of the loop that have not finished yet
+		std::atomic<int>* pRemaining;
+	};
+
+	// jobs of one thread, which other threads steal from; the
+	// jobs from the first one on are still queued, and the
+	// vector keeps its memory from loop to loop
+	struct JOB_QUEUE
+	{
+		std::vector<JOB> jobs;
+		size_t first;
+		std::mutex mutex;
+	};
+
+	// worker threads running the queued jobs
+	std::vector<std::thread> m_workers;
+	// job queues of the workers, followed by the queue of the
+	// calling thread
+	std::vector<JOB_QUEUE*> m_queues;
+	// number of jobs queued and not taken yet
+	std::atomic<int> m_queuedJobs;
+	// idle workers wait here for new jobs
+	std::mutex m_wakeMutex;
+	std::condition_variable m_wake;
+	// true when the workers have to exit
+	bool m_bStopping;
+
+	// run jobs until the job system is stopped
+	void WorkerLoop(int threadIndex);
+	// run one job of the own queue or stolen from another one;
+	// false is returned when there was no job to run
+	bool RunNextJob(int threadIndex);
+
+public:
+	// run a function over count items split into chunks of
+	// the passed in size, and return when all chunks are done;
+	// only one loop runs at a time, started from one thread
+	void ParallelFor(int count, int chunkSize, const RANGE_FUNCTION& function);
+
+	// number of threads running jobs, including the caller,
+	// which is the range of the thread indices
+	int GetThreadCount() const;
+};
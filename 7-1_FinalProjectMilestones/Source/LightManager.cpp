@@ -0,0 +1,294 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.cpp
+// ============
+// manage the light sources of a 3D scene and their uniform buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "LightManager.h"
+
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  LightManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+LightManager::LightManager()
+{
+	m_lightUBO = 0;
+	m_binding = 0;
+	m_dirtyFirst = -1;
+	m_dirtyLast = -1;
+	m_bCountDirty = true;
+	m_uploads = 0;
+}
+
+/***********************************************************
+ *  ~LightManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+LightManager::~LightManager()
+{
+	if (m_lightUBO != 0)
+	{
+		glDeleteBuffers(1, &m_lightUBO);
+		m_lightUBO = 0;
+	}
+	m_lights.clear();
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the uniform buffer of
+ *  the LightBlock and binding it to the passed in uniform
+ *  block binding point.
+ ***********************************************************/
+void LightManager::Initialize(GLuint binding)
+{
+	m_binding = binding;
+
+	if (m_lightUBO == 0)
+	{
+		glGenBuffers(1, &m_lightUBO);
+		glBindBuffer(GL_UNIFORM_BUFFER, m_lightUBO);
+		glBufferData(
+			GL_UNIFORM_BUFFER,
+			sizeof(LIGHT_BLOCK_HEADER) + MAX_LIGHTS * sizeof(LIGHT_DATA),
+			NULL,
+			GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	}
+	glBindBufferBase(GL_UNIFORM_BUFFER, m_binding, m_lightUBO);
+
+	// everything defined so far still has to be uploaded
+	m_bCountDirty = true;
+	if (m_lights.size() > 0)
+	{
+		m_dirtyFirst = 0;
+		m_dirtyLast = (int)m_lights.size() - 1;
+	}
+}
+
+/***********************************************************
+ *  MarkDirty()
+ *
+ *  This method is used for growing the dirty range so that
+ *  it includes the light at the passed in index.
+ ***********************************************************/
+void LightManager::MarkDirty(int index)
+{
+	if ((m_dirtyFirst < 0) || (index < m_dirtyFirst))
+	{
+		m_dirtyFirst = index;
+	}
+	if (index > m_dirtyLast)
+	{
+		m_dirtyLast = index;
+	}
+}
+
+/***********************************************************
+ *  PackLight()
+ *
+ *  This method is used for converting a light source into
+ *  the std140 layout of the LightBlock.
+ ***********************************************************/
+LightManager::LIGHT_DATA LightManager::PackLight(const LIGHT_SOURCE& light)
+{
+	LIGHT_DATA data = LIGHT_DATA();
+
+	data.position = light.position;
+	data.ambientColor = light.ambientColor;
+	data.diffuseColor = light.diffuseColor;
+	data.specularColor = light.specularColor;
+	data.focalStrength = light.focalStrength;
+	data.specularIntensity = light.specularIntensity;
+	data.range = light.range;
+
+	return(data);
+}
+
+/***********************************************************
+ *  AddLight()
+ *
+ *  This method is used for adding a light source.  The
+ *  index of the new light is returned, or -1 when the light
+ *  block is full.
+ ***********************************************************/
+int LightManager::AddLight(const LIGHT_SOURCE& light)
+{
+	if (m_lights.size() >= MAX_LIGHTS)
+	{
+		std::cout << "Only " << MAX_LIGHTS << " light sources can be defined" << std::endl;
+		return(-1);
+	}
+
+	m_lights.push_back(light);
+
+	int index = (int)m_lights.size() - 1;
+	MarkDirty(index);
+	m_bCountDirty = true;
+
+	return(index);
+}
+
+/***********************************************************
+ *  SetLight()
+ *
+ *  This method is used for changing all the values of a
+ *  light source.  The light is only marked dirty when a
+ *  value actually changed, and true is returned then.
+ ***********************************************************/
+bool LightManager::SetLight(int index, const LIGHT_SOURCE& light)
+{
+	if ((index < 0) || (index >= m_lights.size()))
+	{
+		return(false);
+	}
+
+	LIGHT_SOURCE& current = m_lights[index];
+
+	if ((current.position == light.position) &&
+		(current.ambientColor == light.ambientColor) &&
+		(current.diffuseColor == light.diffuseColor) &&
+		(current.specularColor == light.specularColor) &&
+		(current.focalStrength == light.focalStrength) &&
+		(current.specularIntensity == light.specularIntensity))
+	{
+		return(false);
+	}
+
+	current = light;
+	MarkDirty(index);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetLightPosition()
+ *
+ *  This method is used for moving a light source.
+ ***********************************************************/
+bool LightManager::SetLightPosition(int index, const glm::vec3& position)
+{
+	if ((index < 0) || (index >= m_lights.size()))
+	{
+		return(false);
+	}
+
+	LIGHT_SOURCE light = m_lights[index];
+	light.position = position;
+
+	return(SetLight(index, light));
+}
+
+/***********************************************************
+ *  RemoveAllLights()
+ *
+ *  This method is used for removing every light source.
+ ***********************************************************/
+void LightManager::RemoveAllLights()
+{
+	m_lights.clear();
+	m_dirtyFirst = -1;
+	m_dirtyLast = -1;
+	m_bCountDirty = true;
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of defined
+ *  light sources.
+ ***********************************************************/
+int LightManager::GetLightCount() const
+{
+	return((int)m_lights.size());
+}
+
+/***********************************************************
+ *  GetLight()
+ *
+ *  This method is used for getting a defined light source.
+ ***********************************************************/
+const LightManager::LIGHT_SOURCE& LightManager::GetLight(int index) const
+{
+	return(m_lights[index]);
+}
+
+/***********************************************************
+ *  UploadChanges()
+ *
+ *  This method is used for uploading the lights changed
+ *  since the last upload into the uniform buffer.  Nothing
+ *  is sent to OpenGL when no light changed.  The changed
+ *  lights are packed in memory taken from the frame arena.
+ ***********************************************************/
+bool LightManager::UploadChanges(FrameArena& arena)
+{
+	if ((m_lightUBO == 0) ||
+		((m_bCountDirty == false) && (m_dirtyFirst < 0)))
+	{
+		return(false);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, m_lightUBO);
+
+	if (m_bCountDirty == true)
+	{
+		LIGHT_BLOCK_HEADER header = LIGHT_BLOCK_HEADER();
+		header.lightCount = (int)m_lights.size();
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LIGHT_BLOCK_HEADER), &header);
+		m_bCountDirty = false;
+	}
+
+	if (m_dirtyFirst >= 0)
+	{
+		// the dirty range is packed into one contiguous upload
+		int count = m_dirtyLast - m_dirtyFirst + 1;
+		LIGHT_DATA* packed = arena.AllocateArray<LIGHT_DATA>(count);
+		for (int i = 0; i < count; i++)
+		{
+			packed[i] = PackLight(m_lights[m_dirtyFirst + i]);
+		}
+
+		glBufferSubData(
+			GL_UNIFORM_BUFFER,
+			sizeof(LIGHT_BLOCK_HEADER) + m_dirtyFirst * sizeof(LIGHT_DATA),
+			count * sizeof(LIGHT_DATA),
+			packed);
+
+		m_dirtyFirst = -1;
+		m_dirtyLast = -1;
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_uploads++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetUploads()
+ *
+ *  This method is used for getting the number of uploads
+ *  made since the counter was last reset.
+ ***********************************************************/
+int LightManager::GetUploads() const
+{
+	return(m_uploads);
+}
+
+/***********************************************************
+ *  ResetUploads()
+ *
+ *  This method is used for resetting the upload counter.
+ ***********************************************************/
+void LightManager::ResetUploads()
+{
+	m_uploads = 0;
+}
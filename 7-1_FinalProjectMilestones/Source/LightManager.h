@@ -0,0 +1,113 @@
+///////////////////////////////////////////////////////////////////////////////
+// lightmanager.h
+// ============
+// manage the light sources of a 3D scene and their uniform buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "FrameArena.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  LightManager
+ *
+ *  This class keeps the light sources of the scene and the
+ *  uniform buffer behind the LightBlock of the shaders.
+ *  Changed lights are tracked as a dirty range, so the
+ *  buffer is only uploaded when a light was added or
+ *  changed, and only for the lights that changed.
+ ***********************************************************/
+class LightManager
+{
+public:
+	// constructor
+	LightManager();
+	// destructor
+	~LightManager();
+
+	// size of the light array declared in the LightBlock
+	static const int MAX_LIGHTS = 128;
+
+	struct LIGHT_SOURCE
+	{
+		glm::vec3 position;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+		// distance at which the light has faded out completely,
+		// or 0 for a light that reaches the whole scene
+		float range;
+	};
+
+private:
+	// std140 layout of one LightSource in the LightBlock
+	struct LIGHT_DATA
+	{
+		glm::vec3 position;
+		float padding0;
+		glm::vec3 ambientColor;
+		float padding1;
+		glm::vec3 diffuseColor;
+		float padding2;
+		glm::vec3 specularColor;
+		float focalStrength;
+		float specularIntensity;
+		float range;
+		float padding3[2];
+	};
+
+	// std140 layout of the header in front of the light array
+	struct LIGHT_BLOCK_HEADER
+	{
+		int lightCount;
+		int padding[3];
+	};
+
+	// defined light sources
+	std::vector<LIGHT_SOURCE> m_lights;
+	// uniform buffer object for the LightBlock
+	GLuint m_lightUBO;
+	// uniform block binding point of the LightBlock
+	GLuint m_binding;
+	// range of lights changed since the last upload
+	int m_dirtyFirst;
+	int m_dirtyLast;
+	// true when the number of lights changed
+	bool m_bCountDirty;
+	// number of uploads made since the counter was reset
+	int m_uploads;
+
+	// add a light to the dirty range
+	void MarkDirty(int index);
+	// convert a light into its std140 layout
+	static LIGHT_DATA PackLight(const LIGHT_SOURCE& light);
+
+public:
+	// create the uniform buffer on the passed in binding point
+	void Initialize(GLuint binding);
+
+	// define and change light sources
+	int AddLight(const LIGHT_SOURCE& light);
+	bool SetLight(int index, const LIGHT_SOURCE& light);
+	bool SetLightPosition(int index, const glm::vec3& position);
+	void RemoveAllLights();
+
+	// access the defined light sources
+	int GetLightCount() const;
+	const LIGHT_SOURCE& GetLight(int index) const;
+
+	// upload the changed lights; returns true when anything was uploaded
+	bool UploadChanges(FrameArena& arena);
+
+	// number of uploads made since the last reset
+	int GetUploads() const;
+	void ResetUploads();
+};
@@ -1,178 +1,1180 @@
-#include <iostream>         // error handling and output
-#include <cstdlib>          // EXIT_FAILURE
-
-#include <GL/glew.h>        // GLEW library
-#include "GLFW/glfw3.h"     // GLFW library
-
-// GLM Math Header inclusions
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-
-#include "SceneManager.h"
-#include "ViewManager.h"
-#include "ShapeMeshes.h"
-#include "ShaderManager.h"
-
-// Namespace for declaring global variables
-namespace
-{
-	// Macro for window title
-	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones - Kevin Romero"; 
-
-	// Main GLFW window
-	GLFWwindow* g_Window = nullptr;
-
-	// scene manager object for managing the 3D scene prepare and render
-	SceneManager* g_SceneManager = nullptr;
-	// shader manager object for dynamic interaction with the shader code
-	ShaderManager* g_ShaderManager = nullptr;
-	// view manager object for managing the 3D view setup and projection to 2D
-	ViewManager* g_ViewManager = nullptr;
-}
-
-// Function declarations - all functions that are called manually
-// need to be pre-declared at the beginning of the source code.
-bool InitializeGLFW();
-bool InitializeGLEW();
-
-
-/***********************************************************
- *  main(int, char*)
- *
- *  This function gets called after the application has been
- *  launched.
- ***********************************************************/
-int main(int argc, char* argv[])
-{
-	// if GLFW fails initialization, then terminate the application
-	if (InitializeGLFW() == false)
-	{
-		return(EXIT_FAILURE);
-	}
-
-	// try to create a new shader manager object
-	g_ShaderManager = new ShaderManager();
-	// try to create a new view manager object
-	g_ViewManager = new ViewManager(
-		g_ShaderManager);
-
-	// try to create the main display window
-	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
-
-	// if GLEW fails initialization, then terminate the application
-	if (InitializeGLEW() == false)
-	{
-		return(EXIT_FAILURE);
-	}
-
-	// load the shader code from the external GLSL files
-	g_ShaderManager->LoadShaders(
-		"../../Utilities/shaders/vertexShader.glsl",
-		"../../Utilities/shaders/fragmentShader.glsl");
-	g_ShaderManager->use();
-
-	// try to create a new scene manager object and prepare the 3D scene
-	g_SceneManager = new SceneManager(g_ShaderManager);
-	g_SceneManager->PrepareScene();
-	g_SceneManager->LoadSceneTextures();
-
-	// loop will keep running until the application is closed 
-	// or until an error has occurred
-	while (!glfwWindowShouldClose(g_Window))
-	{
-		// Enable z-depth
-		glEnable(GL_DEPTH_TEST);
-
-		// Clear the frame and z buffers
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-		// convert from 3D object space to 2D view
-		g_ViewManager->PrepareSceneView();
-
-		// refresh the 3D scene
-		g_SceneManager->RenderScene();
-
-
-		// Flips the the back buffer with the front buffer every frame.
-		glfwSwapBuffers(g_Window);
-
-		// query the latest GLFW events
-		glfwPollEvents();
-	}
-
-	// clear the allocated manager objects from memory
-	if (NULL != g_SceneManager)
-	{
-		delete g_SceneManager;
-		g_SceneManager = NULL;
-	}
-	if (NULL != g_ViewManager)
-	{
-		delete g_ViewManager;
-		g_ViewManager = NULL;
-	}
-	if (NULL != g_ShaderManager)
-	{
-		delete g_ShaderManager;
-		g_ShaderManager = NULL;
-	}
-
-	// Terminates the program successfully
-	exit(EXIT_SUCCESS); 
-}
-
-/***********************************************************
- *	InitializeGLFW()
- * 
- *  This function is used to initialize the GLFW library.   
- ***********************************************************/
-bool InitializeGLFW()
-{
-	// GLFW: initialize and configure library
-	// --------------------------------------
-	glfwInit();
-
-#ifdef __APPLE__
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#else
-	// set the version of OpenGL and profile to use
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-#endif
-	// GLFW: end -------------------------------
-
-	return(true);
-}
-
-/***********************************************************
- *	InitializeGLEW()
- *
- *  This function is used to initialize the GLEW library.
- ***********************************************************/
-bool InitializeGLEW()
-{
-	// GLEW: initialize
-	// -----------------------------------------
-	GLenum GLEWInitResult = GLEW_OK;
-
-	// try to initialize the GLEW library
-	GLEWInitResult = glewInit();
-	if (GLEW_OK != GLEWInitResult)
-	{
-		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
-		return false;
-	}
-	// GLEW: end -------------------------------
-
-	// Displays a successful OpenGL initialization message
-	std::cout << "INFO: OpenGL Successfully Initialized\n";
-	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
-
-	return(true);
+#include <iostream>         // error handling and output
+#include <cstdlib>          // EXIT_FAILURE
+#include <cstring>          // command line parsing
+#include <string>
+#include <vector>
+#include <fstream>          // camera path and benchmark results
+#include <sstream>
+#include <algorithm>        // frame time percentiles
+#include <cmath>
+
+#include <GL/glew.h>        // GLEW library
+#include "GLFW/glfw3.h"     // GLFW library
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "SceneManager.h"
+#include "ViewManager.h"
+#include "ShapeMeshes.h"
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "GLStateCache.h"
+#include "FrameProfiler.h"
+#include "FramePipeline.h"
+#include "FramePacer.h"
+#include "RenderTarget.h"
+#include "FrameCapture.h"
+#include "AllocationCounters.h"
+#include "TransformKernels.h"
+
+// Namespace for declaring global variables
+namespace
+{
+	// Macro for window title
+	const char* const WINDOW_TITLE = "7-1 FinalProject and Milestones - Kevin Romero"; 
+
+	// Main GLFW window
+	GLFWwindow* g_Window = nullptr;
+
+	// scene manager object for managing the 3D scene prepare and render
+	SceneManager* g_SceneManager = nullptr;
+	// shader manager object for dynamic interaction with the shader code
+	ShaderManager* g_ShaderManager = nullptr;
+	// cached shader uniform locations and uniform blocks
+	ShaderUniforms* g_ShaderUniforms = nullptr;
+	// view manager object for managing the 3D view setup and projection to 2D
+	ViewManager* g_ViewManager = nullptr;
+	// frame timing and per-pass GPU timer queries
+	FrameProfiler* g_FrameProfiler = nullptr;
+	// update thread building the next frame while one is drawn
+	FramePipeline* g_FramePipeline = nullptr;
+	// swap interval and frame limiter of the main loop
+	FramePacer* g_FramePacer = nullptr;
+	// offscreen framebuffer the frames are drawn into at a scale
+	// of the window size
+	RenderTarget* g_RenderTarget = nullptr;
+	// readback of the shown frames into an image sequence
+	FrameCapture* g_FrameCapture = nullptr;
+
+	// options of the benchmark mode, set from the command line
+	struct BENCHMARK_OPTIONS
+	{
+		bool bEnabled;
+		int frames;
+		int warmupFrames;
+		int replicas;
+		float spacing;
+		std::string pathFile;
+		std::string outputFile;
+		// cull and draw on the GPU, also outside the benchmark
+		bool bGpuDriven;
+		// scene file to load instead of the default one
+		std::string sceneFile;
+		// build every frame on the GL thread, without the update thread
+		bool bSingleThreaded;
+		// shade with the lights of each view cluster only, and draw
+		// the depth first; both can also be switched while running
+		bool bClustered;
+		bool bDepthPrepass;
+		// skip the objects hidden behind the depth of the last
+		// frames, which can also be switched while running
+		bool bOcclusion;
+		// point lights with a range added over the scene objects
+		int pointLights;
+		// size and number of cascades of the key light's shadow
+		// maps; 0 cascades draws no shadows
+		int shadowResolution;
+		int shadowCascades;
+		// pacing of the frames, uncapped in the benchmark and
+		// vertical sync otherwise unless one is chosen, and the
+		// rate of the frame limiter, 0 for the display rate
+		bool bPacingChosen;
+		FramePacer::PACING_MODE pacing;
+		double targetRate;
+		// fail the run when a measured frame allocated on the heap
+		bool bAssertNoAllocations;
+		// instruction set of the transform and culling kernels,
+		// the widest one supported unless one is chosen
+		bool bKernelsChosen;
+		TransformKernels::KERNEL_PATH kernels;
+		// scale of the window size the frames are drawn at, and
+		// the GPU time in milliseconds the scale is lowered to
+		// hold the frames to, 0 for a fixed scale
+		float renderScale;
+		double gpuBudgetMs;
+		// directory the shown frames are recorded into, the
+		// measured ones in the benchmark
+		std::string captureDirectory;
+	};
+
+	// one point of the camera path
+	struct CAMERA_KEY
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	// longest wait for the background textures before measuring
+	const double g_TextureWaitSeconds = 30.0;
+	// times the transform and culling kernels are run after
+	// the measured frames, for timing them on their own
+	const int g_KernelRepeats = 20;
+	// directory F10 records into when none was chosen
+	const char* g_DefaultCaptureDirectory = "captures";
+
+	// shader files of the scene program
+	const char* g_VertexShaderFile = "shaders/vertexShader.glsl";
+	const char* g_FragmentShaderFile = "shaders/fragmentShader.glsl";
+
+	// true while the keys switching the lighting modes are held
+	bool g_bClusterKeyDown = false;
+	bool g_bPrepassKeyDown = false;
+	bool g_bOcclusionKeyDown = false;
+	// true after F8 was pressed, until occlusion culling is
+	// switched while the update thread waits
+	bool g_bOcclusionToggleRequested = false;
+	// true while the keys switching dynamic resolution and the
+	// frame recording are held
+	bool g_bResolutionKeyDown = false;
+	bool g_bCaptureKeyDown = false;
+}
+
+// Function declarations - all functions that are called manually
+// need to be pre-declared at the beginning of the source code.
+bool InitializeGLFW();
+bool InitializeGLEW();
+bool ParseBenchmarkOptions(int argc, char* argv[], BENCHMARK_OPTIONS& options);
+bool LoadCameraPath(const std::string& filename, std::vector<CAMERA_KEY>& path);
+CAMERA_KEY GetCameraKey(const std::vector<CAMERA_KEY>& path, int frame, int frameCount);
+void RenderFrame();
+void ProcessLightingKeys();
+void ProcessOutputKeys();
+int RunBenchmark(const BENCHMARK_OPTIONS& options);
+
+
+/***********************************************************
+ *  main(int, char*)
+ *
+ *  This function gets called after the application has been
+ *  launched.
+ ***********************************************************/
+int main(int argc, char* argv[])
+{
+	// if GLFW fails initialization, then terminate the application
+	if (InitializeGLFW() == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// --benchmark renders a scripted run in a hidden window
+	BENCHMARK_OPTIONS benchmark;
+	if (ParseBenchmarkOptions(argc, argv, benchmark) == false)
+	{
+		return(EXIT_FAILURE);
+	}
+	if (benchmark.bEnabled == true)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
+
+	// try to create a new shader manager object
+	g_ShaderManager = new ShaderManager();
+	g_ShaderUniforms = new ShaderUniforms();
+	// try to create a new view manager object
+	g_ViewManager = new ViewManager(
+		g_ShaderManager,
+		g_ShaderUniforms);
+
+	// try to create the main display window
+	g_Window = g_ViewManager->CreateDisplayWindow(WINDOW_TITLE);
+
+	// if GLEW fails initialization, then terminate the application
+	if (InitializeGLEW() == false)
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// load the shader code from the project GLSL files, which
+	// add instanced drawing to the lighting shaders
+	g_ShaderManager->LoadShaders(
+		g_VertexShaderFile,
+		g_FragmentShaderFile);
+	g_ShaderManager->use();
+	// the shader manager made its program current behind the
+	// back of the state cache
+	GLStateCache::InvalidateProgram();
+
+	// look up the shader uniform locations and uniform blocks once,
+	// right after the shaders have been loaded
+	g_ShaderUniforms->ResolveCurrentProgram();
+
+	// the depth test and the clear color never change, so they
+	// are set once instead of every frame
+	GLStateCache::SetCapability(GL_DEPTH_TEST, true);
+	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+	// the benchmark measures throughput, so its frames are not
+	// held back unless another pacing is asked for; F7 cycles
+	// through the pacing modes while running
+	g_FramePacer = new FramePacer(g_Window);
+	FramePacer::PACING_MODE pacing = benchmark.pacing;
+	if (benchmark.bPacingChosen == false)
+	{
+		pacing = (benchmark.bEnabled == true) ? FramePacer::PACING_UNCAPPED : FramePacer::PACING_VSYNC;
+	}
+	g_FramePacer->SetMode(pacing, benchmark.targetRate);
+
+	// the frames are drawn offscreen at a scale of the window
+	// size, which follows the GPU time with a budget; F9 turns
+	// that on and off while running
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+	g_RenderTarget = new RenderTarget();
+	if (g_RenderTarget->Initialize(framebufferWidth, framebufferHeight) == false)
+	{
+		std::cout << "Offscreen rendering is not supported, drawing into the window" << std::endl;
+	}
+	g_RenderTarget->SetScale(benchmark.renderScale);
+	if (benchmark.gpuBudgetMs > 0.0)
+	{
+		g_RenderTarget->SetDynamicScaling(true, benchmark.gpuBudgetMs);
+	}
+
+	// the shown frames can be recorded into an image sequence,
+	// from the start or with F10; the benchmark records the
+	// measured frames only
+	g_FrameCapture = new FrameCapture();
+	if ((benchmark.bEnabled == false) && (benchmark.captureDirectory.empty() == false))
+	{
+		g_FrameCapture->StartRecording(benchmark.captureDirectory.c_str(), framebufferWidth, framebufferHeight);
+	}
+
+	// the kernels are chosen before any scene object exists
+	if ((benchmark.bKernelsChosen == true) &&
+		(TransformKernels::SetPath(benchmark.kernels) == false))
+	{
+		std::cout << "The " << TransformKernels::GetPathName(benchmark.kernels)
+			<< " kernels are not supported, using "
+			<< TransformKernels::GetPathName(TransformKernels::GetPath()) << std::endl;
+	}
+
+	// try to create a new scene manager object and prepare the 3D scene
+	g_SceneManager = new SceneManager(
+		g_ShaderManager,
+		g_ShaderUniforms);
+	if (benchmark.sceneFile.empty() == false)
+	{
+		g_SceneManager->SetSceneFile(benchmark.sceneFile);
+	}
+	g_SceneManager->SetShadowSettings(benchmark.shadowResolution, benchmark.shadowCascades);
+	g_SceneManager->PrepareScene();
+	if (benchmark.replicas > 1)
+	{
+		// the original set counts as the first replica
+		g_SceneManager->ReplicateSceneObjects(benchmark.replicas - 1, benchmark.spacing);
+	}
+	g_SceneManager->LoadSceneTextures();
+	if ((benchmark.bGpuDriven == true) &&
+		(g_SceneManager->SetGpuDriven(true) == false))
+	{
+		std::cout << "GPU driven rendering is not supported, using the render queue" << std::endl;
+	}
+	if (benchmark.pointLights > 0)
+	{
+		g_SceneManager->AddPointLights(benchmark.pointLights);
+	}
+	if ((benchmark.bClustered == true) &&
+		(g_SceneManager->SetClusteredLighting(true) == false))
+	{
+		std::cout << "Clustered lighting is not supported, shading with every light" << std::endl;
+	}
+	g_SceneManager->SetDepthPrepass(benchmark.bDepthPrepass);
+	if ((benchmark.bOcclusion == true) &&
+		(g_SceneManager->SetOcclusionCulling(true) == false))
+	{
+		std::cout << "Occlusion culling is not supported, culling against the view only" << std::endl;
+	}
+
+	// edited shaders, textures and scene files are picked up
+	// while running; the benchmark measures a fixed scene
+	if (benchmark.bEnabled == false)
+	{
+		g_SceneManager->EnableHotReload(g_VertexShaderFile, g_FragmentShaderFile);
+	}
+
+	// time every frame; F3 shows the timings in the window
+	// title and F4 dumps them to a CSV file
+	g_FrameProfiler = new FrameProfiler(g_Window, WINDOW_TITLE);
+
+	// the camera and the frame packets are updated on their own
+	// thread once the scene is complete
+	g_FramePipeline = new FramePipeline(
+		g_ViewManager,
+		g_SceneManager,
+		benchmark.bSingleThreaded == false);
+
+	int exitCode = EXIT_SUCCESS;
+	if (benchmark.bEnabled == true)
+	{
+		exitCode = RunBenchmark(benchmark);
+	}
+	else
+	{
+		// loop will keep running until the application is closed 
+		// or until an error has occurred
+		while (!glfwWindowShouldClose(g_Window))
+		{
+			RenderFrame();
+			g_FrameProfiler->ProcessKeyboardEvents();
+			g_FramePacer->ProcessKeyboardEvents();
+			ProcessLightingKeys();
+			ProcessOutputKeys();
+		}
+	}
+
+	// clear the allocated manager objects from memory; the
+	// update thread stops before the managers it uses, and the
+	// recorded frames are written out before the capture goes
+	if (NULL != g_FramePipeline)
+	{
+		delete g_FramePipeline;
+		g_FramePipeline = NULL;
+	}
+	if (NULL != g_FrameCapture)
+	{
+		delete g_FrameCapture;
+		g_FrameCapture = NULL;
+	}
+	if (NULL != g_RenderTarget)
+	{
+		delete g_RenderTarget;
+		g_RenderTarget = NULL;
+	}
+	if (NULL != g_FrameProfiler)
+	{
+		delete g_FrameProfiler;
+		g_FrameProfiler = NULL;
+	}
+	if (NULL != g_FramePacer)
+	{
+		delete g_FramePacer;
+		g_FramePacer = NULL;
+	}
+	if (NULL != g_SceneManager)
+	{
+		delete g_SceneManager;
+		g_SceneManager = NULL;
+	}
+	if (NULL != g_ViewManager)
+	{
+		delete g_ViewManager;
+		g_ViewManager = NULL;
+	}
+	if (NULL != g_ShaderUniforms)
+	{
+		delete g_ShaderUniforms;
+		g_ShaderUniforms = NULL;
+	}
+	if (NULL != g_ShaderManager)
+	{
+		delete g_ShaderManager;
+		g_ShaderManager = NULL;
+	}
+
+	// Terminates the program
+	exit(exitCode); 
+}
+
+/***********************************************************
+ *	RenderFrame()
+ *
+ *  This function is used to render and present one frame,
+ *  timing each pass with the frame profiler.  The frame
+ *  drawn is the one the update thread built from the input
+ *  of the last frame, while the update thread goes on to
+ *  build the next one from the input captured here.  The
+ *  frame pacer holds the frame back before the input is
+ *  captured, outside of the profiled frame time.  The frame
+ *  is drawn offscreen, at a scale that follows a window
+ *  resize and the GPU time of the last frames, and is then
+ *  stretched over the window and, while recording, read
+ *  back for the image sequence.
+ ***********************************************************/
+void RenderFrame()
+{
+	g_FramePacer->WaitForFrame();
+	// everything the last frame took from the arena is dropped
+	g_SceneManager->GetFrameArena()->Reset();
+	g_FrameProfiler->BeginFrame();
+
+	// hand the input since the last frame to the update thread
+	ViewManager::INPUT_STATE input;
+	g_ViewManager->CaptureInput(input);
+	g_FramePipeline->SubmitInput(input);
+
+	// follow the window framebuffer size, and pick the scale of
+	// the frame from the GPU time of the latest timed frame
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+	g_RenderTarget->Resize(framebufferWidth, framebufferHeight);
+	g_RenderTarget->UpdateScale(g_FrameProfiler->GetLatestGpuFrameTime());
+
+	g_FrameProfiler->BeginPass(FrameProfiler::PASS_CLEAR);
+	// Clear the frame and z buffers of the offscreen target, which
+	// stays bound until the scene is drawn
+	g_RenderTarget->Begin();
+	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	g_FrameProfiler->EndPass(FrameProfiler::PASS_CLEAR);
+
+	// wait for the built frame; until the update thread resumes,
+	// the files edited since the last frame and the textures
+	// loaded in the background can change the scene, the
+	// depth read back for occlusion culling is taken in, and
+	// occlusion culling is switched after a press of F8
+	g_FrameProfiler->BeginPass(FrameProfiler::PASS_VIEW);
+	const FramePipeline::FRAME& frame = g_FramePipeline->AcquireFrame();
+	g_SceneManager->ReloadChangedFiles();
+	g_SceneManager->UploadLoadedTextures();
+	g_SceneManager->CollectOcclusionBuffer();
+	if (g_bOcclusionToggleRequested == true)
+	{
+		// the update thread reads the setting while it builds a
+		// frame packet, so it is only switched here
+		bool bOcclusion = !g_SceneManager->IsOcclusionCulling();
+		if (g_SceneManager->SetOcclusionCulling(bOcclusion) == false)
+		{
+			std::cout << "Occlusion culling is not supported" << std::endl;
+		}
+		else
+		{
+			std::cout << "Occlusion culling " << (bOcclusion ? "on" : "off") << std::endl;
+		}
+		g_bOcclusionToggleRequested = false;
+	}
+	g_FramePipeline->ResumeUpdate();
+
+	// convert from 3D object space to 2D view
+	g_ViewManager->ApplyView(frame.view);
+	g_FrameProfiler->EndPass(FrameProfiler::PASS_VIEW);
+
+	// report the scene object under the mouse after a click
+	if (frame.pickedObject >= 0)
+	{
+		std::cout << "Picked scene object " << frame.pickedObject << std::endl;
+	}
+
+	// draw the shadow maps that are out of date
+	g_FrameProfiler->BeginPass(FrameProfiler::PASS_SHADOW);
+	g_SceneManager->RenderShadows(frame.scene);
+	g_FrameProfiler->EndPass(FrameProfiler::PASS_SHADOW);
+
+	// refresh the 3D scene
+	g_FrameProfiler->BeginPass(FrameProfiler::PASS_SCENE);
+	g_SceneManager->RenderScene(frame.scene);
+	g_FrameProfiler->EndPass(FrameProfiler::PASS_SCENE);
+
+	// stretch the frame over the window, read it back into a
+	// pixel buffer while recording, and flip the back buffer
+	// with the front buffer every frame.
+	g_FrameProfiler->BeginPass(FrameProfiler::PASS_SWAP);
+	g_RenderTarget->Present();
+	g_FrameCapture->Capture(framebufferWidth, framebufferHeight);
+	glfwSwapBuffers(g_Window);
+	g_FrameProfiler->EndPass(FrameProfiler::PASS_SWAP);
+
+	// query the latest GLFW events
+	glfwPollEvents();
+
+	// record the counters of the frame and start the next
+	// frame with fresh counters
+	g_FrameProfiler->EndFrame(
+		g_SceneManager->GetRenderStats().drawCalls,
+		g_ShaderUniforms->GetUniformSets(),
+		g_ShaderUniforms->GetBlockUploads() + g_SceneManager->GetLightManager()->GetUploads(),
+		g_SceneManager->GetRenderStats().shadowMapsRendered,
+		GLStateCache::GetRedundantCalls() + g_ShaderUniforms->GetRedundantUniformSets());
+	g_ShaderUniforms->ResetUniformSets();
+	GLStateCache::ResetCounters();
+	g_ShaderUniforms->ResetBlockUploads();
+	g_SceneManager->GetLightManager()->ResetUploads();
+}
+
+/***********************************************************
+ *	ProcessLightingKeys()
+ *
+ *  This function is used to switch between the lighting
+ *  and culling modes while running, so that they can be
+ *  compared on the same view: F5 toggles clustered
+ *  lighting, F6 the depth pre-pass and F8 occlusion
+ *  culling, which RenderFrame() switches once the update
+ *  thread waits.
+ ***********************************************************/
+void ProcessLightingKeys()
+{
+	bool bClusterKey = (glfwGetKey(g_Window, GLFW_KEY_F5) == GLFW_PRESS);
+	if ((bClusterKey == true) && (g_bClusterKeyDown == false))
+	{
+		bool bClustered = !g_SceneManager->IsClusteredLighting();
+		if (g_SceneManager->SetClusteredLighting(bClustered) == false)
+		{
+			std::cout << "Clustered lighting is not supported" << std::endl;
+		}
+		else
+		{
+			std::cout << "Clustered lighting " << (bClustered ? "on" : "off") << std::endl;
+		}
+	}
+	g_bClusterKeyDown = bClusterKey;
+
+	bool bPrepassKey = (glfwGetKey(g_Window, GLFW_KEY_F6) == GLFW_PRESS);
+	if ((bPrepassKey == true) && (g_bPrepassKeyDown == false))
+	{
+		g_SceneManager->SetDepthPrepass(!g_SceneManager->IsDepthPrepass());
+		std::cout << "Depth pre-pass " << (g_SceneManager->IsDepthPrepass() ? "on" : "off") << std::endl;
+	}
+	g_bPrepassKeyDown = bPrepassKey;
+
+	bool bOcclusionKey = (glfwGetKey(g_Window, GLFW_KEY_F8) == GLFW_PRESS);
+	if ((bOcclusionKey == true) && (g_bOcclusionKeyDown == false))
+	{
+		// the switch waits for the next frame, when no frame
+		// packet is being built
+		g_bOcclusionToggleRequested = !g_bOcclusionToggleRequested;
+	}
+	g_bOcclusionKeyDown = bOcclusionKey;
+}
+
+/***********************************************************
+ *	ProcessOutputKeys()
+ *
+ *  This function is used to change how the frames are put
+ *  out while running: F9 toggles dynamic resolution and
+ *  F10 starts and stops recording the shown frames.
+ ***********************************************************/
+void ProcessOutputKeys()
+{
+	bool bResolutionKey = (glfwGetKey(g_Window, GLFW_KEY_F9) == GLFW_PRESS);
+	if ((bResolutionKey == true) && (g_bResolutionKeyDown == false))
+	{
+		bool bDynamic = !g_RenderTarget->IsDynamicScaling();
+		g_RenderTarget->SetDynamicScaling(bDynamic, 0.0);
+		std::cout << "Dynamic resolution " << (bDynamic ? "on" : "off")
+			<< ", GPU budget " << g_RenderTarget->GetGpuBudget() << " ms" << std::endl;
+	}
+	g_bResolutionKeyDown = bResolutionKey;
+
+	bool bCaptureKey = (glfwGetKey(g_Window, GLFW_KEY_F10) == GLFW_PRESS);
+	if ((bCaptureKey == true) && (g_bCaptureKeyDown == false))
+	{
+		if (g_FrameCapture->IsRecording() == true)
+		{
+			g_FrameCapture->StopRecording();
+			std::cout << "Stopped recording frames, " << g_FrameCapture->GetCapturedFrames()
+				<< " captured and " << g_FrameCapture->GetDroppedFrames() << " dropped" << std::endl;
+		}
+		else
+		{
+			// the last directory is recorded into again, and the
+			// numbers of the frames go on from the last recording
+			std::string directory = g_FrameCapture->GetDirectory();
+			if (directory.empty() == true)
+			{
+				directory = g_DefaultCaptureDirectory;
+			}
+			int framebufferWidth = 0;
+			int framebufferHeight = 0;
+			g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+			if (g_FrameCapture->StartRecording(directory.c_str(), framebufferWidth, framebufferHeight) == true)
+			{
+				std::cout << "Recording frames into " << directory << std::endl;
+			}
+		}
+	}
+	g_bCaptureKeyDown = bCaptureKey;
+}
+
+/***********************************************************
+ *	ParseBenchmarkOptions()
+ *
+ *  This function is used to read the benchmark options from
+ *  the command line:
+ *    --benchmark           run the benchmark in a hidden window
+ *    --frames N            measured frames (default 1000)
+ *    --warmup N            frames rendered before measuring (default 60)
+ *    --replicas N          copies of the scene objects (default 1)
+ *    --spacing D           distance between the copies (default 12)
+ *    --path FILE           camera path, one "px py pz tx ty tz" per line
+ *    --output FILE         JSON results file (default standard output)
+ *    --gpu-driven          cull and draw the pooled meshes on the GPU
+ *    --scene FILE          scene file (default scenes/default.scene)
+ *    --single-thread       build every frame on the GL thread
+ *    --clustered           shade with the lights of each cluster only
+ *    --depth-prepass       draw the scene depth before shading it
+ *    --occlusion           skip objects hidden behind the depth of
+ *                          the last frames
+ *    --lights N            point lights added over the scene (default 0)
+ *    --shadow-resolution N size of the shadow maps (default 2048)
+ *    --shadow-cascades N   shadow cascades of the key light (default 3)
+ *    --no-shadows          draw no shadows
+ *    --pacing MODE         vsync, adaptive, limit or uncapped frames
+ *                          (default uncapped, vsync outside the benchmark)
+ *    --fps N               frame rate of the limiter, which it turns on
+ *                          (default the display refresh rate)
+ *    --assert-no-allocations fail when a measured frame
+ *                          allocates on the heap
+ *    --kernels PATH        scalar, sse or avx2 transform and culling
+ *                          kernels (default the widest supported)
+ *    --render-scale S      scale of the window size the frames are
+ *                          drawn at, from 0.25 to 1 (default 1)
+ *    --gpu-budget MS       lower the scale while the GPU time of a
+ *                          frame is over MS milliseconds
+ *    --capture DIR         record the shown frames into DIR as PPM
+ *                          files, the measured ones in the benchmark
+ ***********************************************************/
+bool ParseBenchmarkOptions(int argc, char* argv[], BENCHMARK_OPTIONS& options)
+{
+	options.bEnabled = false;
+	options.frames = 1000;
+	options.warmupFrames = 60;
+	options.replicas = 1;
+	options.spacing = 12.0f;
+	options.pathFile.clear();
+	options.outputFile.clear();
+	options.bGpuDriven = false;
+	options.sceneFile.clear();
+	options.bSingleThreaded = false;
+	options.bClustered = false;
+	options.bDepthPrepass = false;
+	options.bOcclusion = false;
+	options.pointLights = 0;
+	options.shadowResolution = 2048;
+	options.shadowCascades = 3;
+	options.bPacingChosen = false;
+	options.pacing = FramePacer::PACING_VSYNC;
+	options.targetRate = 0.0;
+	options.bAssertNoAllocations = false;
+	options.bKernelsChosen = false;
+	options.kernels = TransformKernels::PATH_SCALAR;
+	options.renderScale = 1.0f;
+	options.gpuBudgetMs = 0.0;
+	options.captureDirectory.clear();
+
+	for (int i = 1; i < argc; i++)
+	{
+		bool bHasValue = (i + 1 < argc);
+
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			options.bEnabled = true;
+		}
+		else if ((strcmp(argv[i], "--frames") == 0) && bHasValue)
+		{
+			options.frames = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--warmup") == 0) && bHasValue)
+		{
+			options.warmupFrames = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--replicas") == 0) && bHasValue)
+		{
+			options.replicas = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--spacing") == 0) && bHasValue)
+		{
+			options.spacing = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--path") == 0) && bHasValue)
+		{
+			options.pathFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--output") == 0) && bHasValue)
+		{
+			options.outputFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--gpu-driven") == 0)
+		{
+			options.bGpuDriven = true;
+		}
+		else if ((strcmp(argv[i], "--scene") == 0) && bHasValue)
+		{
+			options.sceneFile = argv[++i];
+		}
+		else if (strcmp(argv[i], "--single-thread") == 0)
+		{
+			options.bSingleThreaded = true;
+		}
+		else if (strcmp(argv[i], "--clustered") == 0)
+		{
+			options.bClustered = true;
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			options.bDepthPrepass = true;
+		}
+		else if (strcmp(argv[i], "--occlusion") == 0)
+		{
+			options.bOcclusion = true;
+		}
+		else if ((strcmp(argv[i], "--lights") == 0) && bHasValue)
+		{
+			options.pointLights = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--shadow-resolution") == 0) && bHasValue)
+		{
+			options.shadowResolution = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--shadow-cascades") == 0) && bHasValue)
+		{
+			options.shadowCascades = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--no-shadows") == 0)
+		{
+			options.shadowCascades = 0;
+		}
+		else if ((strcmp(argv[i], "--pacing") == 0) && bHasValue)
+		{
+			if (FramePacer::FindMode(argv[++i], options.pacing) == false)
+			{
+				std::cerr << "Unknown frame pacing: " << argv[i] << std::endl;
+				return(false);
+			}
+			options.bPacingChosen = true;
+		}
+		else if ((strcmp(argv[i], "--fps") == 0) && bHasValue)
+		{
+			options.targetRate = atof(argv[++i]);
+			options.pacing = FramePacer::PACING_LIMITED;
+			options.bPacingChosen = true;
+		}
+		else if (strcmp(argv[i], "--assert-no-allocations") == 0)
+		{
+			options.bAssertNoAllocations = true;
+		}
+		else if ((strcmp(argv[i], "--kernels") == 0) && bHasValue)
+		{
+			if (TransformKernels::FindPath(argv[++i], options.kernels) == false)
+			{
+				std::cerr << "Unknown kernels: " << argv[i] << std::endl;
+				return(false);
+			}
+			options.bKernelsChosen = true;
+		}
+		else if ((strcmp(argv[i], "--render-scale") == 0) && bHasValue)
+		{
+			options.renderScale = (float)atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--gpu-budget") == 0) && bHasValue)
+		{
+			options.gpuBudgetMs = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "--capture") == 0) && bHasValue)
+		{
+			options.captureDirectory = argv[++i];
+		}
+		else
+		{
+			std::cerr << "Unknown or incomplete option: " << argv[i] << std::endl;
+			return(false);
+		}
+	}
+
+	if ((options.frames <= 0) || (options.warmupFrames < 0) || (options.replicas < 1))
+	{
+		std::cerr << "Benchmark frames and replicas have to be positive" << std::endl;
+		return(false);
+	}
+	if (options.pointLights < 0)
+	{
+		std::cerr << "The number of point lights cannot be negative" << std::endl;
+		return(false);
+	}
+	if ((options.shadowResolution <= 0) || (options.shadowCascades < 0) || (options.shadowCascades > ShadowMaps::MAX_CASCADES))
+	{
+		std::cerr << "Shadow maps need a positive size and 0 to " << ShadowMaps::MAX_CASCADES << " cascades" << std::endl;
+		return(false);
+	}
+	if (options.targetRate < 0.0)
+	{
+		std::cerr << "The frame rate of the limiter cannot be negative" << std::endl;
+		return(false);
+	}
+	if ((options.renderScale < 0.25f) || (options.renderScale > 1.0f))
+	{
+		std::cerr << "The render scale has to be from 0.25 to 1" << std::endl;
+		return(false);
+	}
+	if (options.gpuBudgetMs < 0.0)
+	{
+		std::cerr << "The GPU budget cannot be negative" << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	LoadCameraPath()
+ *
+ *  This function is used to read a recorded camera path.
+ *  Every line holds a camera position and the point it looks
+ *  at; empty lines and lines starting with # are skipped.
+ ***********************************************************/
+bool LoadCameraPath(const std::string& filename, std::vector<CAMERA_KEY>& path)
+{
+	std::ifstream file(filename.c_str());
+	if (!file)
+	{
+		std::cerr << "Could not open camera path: " << filename << std::endl;
+		return(false);
+	}
+
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if ((line.empty() == true) || (line[0] == '#'))
+		{
+			continue;
+		}
+
+		std::istringstream values(line);
+		CAMERA_KEY key;
+		if (values >> key.position.x >> key.position.y >> key.position.z
+			>> key.target.x >> key.target.y >> key.target.z)
+		{
+			path.push_back(key);
+		}
+	}
+
+	if (path.size() == 0)
+	{
+		std::cerr << "Camera path has no points: " << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *	GetCameraKey()
+ *
+ *  This function is used to get the camera pose of a frame.
+ *  A recorded path is interpolated linearly over the frames;
+ *  without one the camera orbits the table once.  The pose
+ *  only depends on the frame number, never on the clock, so
+ *  every run renders the same frames.
+ ***********************************************************/
+CAMERA_KEY GetCameraKey(const std::vector<CAMERA_KEY>& path, int frame, int frameCount)
+{
+	float t = 0.0f;
+	if (frameCount > 1)
+	{
+		t = (float)frame / (float)(frameCount - 1);
+	}
+
+	if (path.size() == 0)
+	{
+		CAMERA_KEY key;
+		float angle = t * 2.0f * 3.14159265f;
+		key.position = glm::vec3(14.0f * sin(angle), 6.0f + 2.0f * sin(angle * 2.0f), 14.0f * cos(angle));
+		key.target = glm::vec3(0.0f, 1.0f, 0.0f);
+		return(key);
+	}
+
+	if (path.size() == 1)
+	{
+		return(path[0]);
+	}
+
+	float position = t * (path.size() - 1);
+	int index = (int)position;
+	if (index >= (int)path.size() - 1)
+	{
+		return(path.back());
+	}
+	float blend = position - index;
+
+	CAMERA_KEY key;
+	key.position = glm::mix(path[index].position, path[index + 1].position, blend);
+	key.target = glm::mix(path[index].target, path[index + 1].target, blend);
+
+	return(key);
+}
+
+/***********************************************************
+ *	RunBenchmark()
+ *
+ *  This function is used to render a fixed number of frames
+ *  along the camera path and report the throughput and the
+ *  frame time percentiles as JSON.  The run starts once the
+ *  background textures have arrived and a few warm-up frames
+ *  have been rendered.  The frames are uncapped unless
+ *  another pacing was chosen, so that the display refresh
+ *  does not cap the results.  The heap allocations of the
+ *  measured frames are counted on every thread, and can be
+ *  asserted to be none.  With a capture directory the
+ *  measured frames are recorded, numbered from 0, for
+ *  comparing the images of two runs.  Afterwards the
+ *  transform and culling kernels are timed on their own,
+ *  on the chosen path and on the scalar path for
+ *  comparison.
+ ***********************************************************/
+int RunBenchmark(const BENCHMARK_OPTIONS& options)
+{
+	std::vector<CAMERA_KEY> path;
+	if ((options.pathFile.empty() == false) && (LoadCameraPath(options.pathFile, path) == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	// wait for the textures so that every run measures the same scene
+	double waitStart = glfwGetTime();
+	while ((g_SceneManager->GetPendingTextureCount() > 0) &&
+		(glfwGetTime() - waitStart < g_TextureWaitSeconds))
+	{
+		RenderFrame();
+	}
+
+	for (int i = 0; i < options.warmupFrames; i++)
+	{
+		CAMERA_KEY key = GetCameraKey(path, i, options.warmupFrames);
+		g_ViewManager->SetCameraPose(key.position, key.target);
+		RenderFrame();
+	}
+	glFinish();
+
+	std::vector<double> frameTimes;
+	frameTimes.reserve(options.frames);
+	long long drawCalls = 0;
+	long long culledObjects = 0;
+	long long occludedObjects = 0;
+	long long reducedDetailObjects = 0;
+	long long shadowDrawCalls = 0;
+	long long shadowMapsRendered = 0;
+	long long redundantCalls = 0;
+	double scaleTotal = 0.0;
+	float minScale = g_RenderTarget->GetScale();
+	float maxScale = minScale;
+
+	// the capture is sized before the measured frames, which
+	// then record without allocating
+	int framebufferWidth = 0;
+	int framebufferHeight = 0;
+	g_ViewManager->GetFramebufferSize(framebufferWidth, framebufferHeight);
+	if ((options.captureDirectory.empty() == false) &&
+		(g_FrameCapture->StartRecording(options.captureDirectory.c_str(), framebufferWidth, framebufferHeight) == false))
+	{
+		return(EXIT_FAILURE);
+	}
+
+	long long allocationsStart = AllocationCounters::GetAllocations();
+	long long allocatedBytesStart = AllocationCounters::GetAllocatedBytes();
+	double runStart = glfwGetTime();
+	double frameStart = runStart;
+	for (int i = 0; i < options.frames; i++)
+	{
+		CAMERA_KEY key = GetCameraKey(path, i, options.frames);
+		g_ViewManager->SetCameraPose(key.position, key.target);
+		RenderFrame();
+		drawCalls += g_SceneManager->GetRenderStats().drawCalls;
+		culledObjects += g_SceneManager->GetRenderStats().culledObjects;
+		occludedObjects += g_SceneManager->GetRenderStats().occludedObjects;
+		reducedDetailObjects += g_SceneManager->GetRenderStats().reducedDetailObjects;
+		shadowDrawCalls += g_SceneManager->GetRenderStats().shadowDrawCalls;
+		shadowMapsRendered += g_SceneManager->GetRenderStats().shadowMapsRendered;
+		redundantCalls += g_FrameProfiler->GetLastSample().redundantCalls;
+		float scale = g_RenderTarget->GetScale();
+		scaleTotal += scale;
+		minScale = (scale < minScale) ? scale : minScale;
+		maxScale = (scale > maxScale) ? scale : maxScale;
+
+		double frameEnd = glfwGetTime();
+		frameTimes.push_back((frameEnd - frameStart) * 1000.0);
+		frameStart = frameEnd;
+	}
+	// the run is done once the GPU has finished every frame
+	glFinish();
+	double totalSeconds = glfwGetTime() - runStart;
+	long long heapAllocations = AllocationCounters::GetAllocations() - allocationsStart;
+	long long heapBytes = AllocationCounters::GetAllocatedBytes() - allocatedBytesStart;
+	// the last readbacks are waited for only once the run is timed
+	g_FrameCapture->StopRecording();
+
+	// the kernels are timed while the update thread waits, so
+	// that no frame packet is built at the same time
+	double composeMs = 0.0;
+	double cullMs = 0.0;
+	double scalarComposeMs = 0.0;
+	double scalarCullMs = 0.0;
+	TransformKernels::KERNEL_PATH kernels = TransformKernels::GetPath();
+	g_FramePipeline->AcquireFrame();
+	g_SceneManager->MeasureTransformKernels(g_KernelRepeats, composeMs, cullMs);
+	TransformKernels::SetPath(TransformKernels::PATH_SCALAR);
+	g_SceneManager->MeasureTransformKernels(g_KernelRepeats, scalarComposeMs, scalarCullMs);
+	TransformKernels::SetPath(kernels);
+	g_FramePipeline->ResumeUpdate();
+
+	double meanMs = 0.0;
+	for (int i = 0; i < frameTimes.size(); i++)
+	{
+		meanMs += frameTimes[i];
+	}
+	meanMs /= frameTimes.size();
+
+	std::vector<double> sorted = frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+	const double percentiles[] = { 50.0, 90.0, 99.0 };
+	double percentileMs[3];
+	for (int i = 0; i < 3; i++)
+	{
+		size_t index = (size_t)(percentiles[i] / 100.0 * (sorted.size() - 1) + 0.5);
+		percentileMs[i] = sorted[index];
+	}
+
+	std::ostringstream json;
+	json << "{\n";
+	json << "  \"frames\": " << options.frames << ",\n";
+	json << "  \"warmup_frames\": " << options.warmupFrames << ",\n";
+	json << "  \"replicas\": " << options.replicas << ",\n";
+	json << "  \"scene_objects\": " << g_SceneManager->GetSceneObjectCount() << ",\n";
+	json << "  \"gpu_driven\": " << (g_SceneManager->IsGpuDriven() ? "true" : "false") << ",\n";
+	json << "  \"threaded\": " << (g_FramePipeline->IsThreaded() ? "true" : "false") << ",\n";
+	json << "  \"lights\": " << g_SceneManager->GetLightManager()->GetLightCount() << ",\n";
+	json << "  \"clustered_lighting\": " << (g_SceneManager->IsClusteredLighting() ? "true" : "false") << ",\n";
+	json << "  \"depth_prepass\": " << (g_SceneManager->IsDepthPrepass() ? "true" : "false") << ",\n";
+	json << "  \"occlusion_culling\": " << (g_SceneManager->IsOcclusionCulling() ? "true" : "false") << ",\n";
+	json << "  \"shadow_cascades\": " << g_SceneManager->GetShadowCascadeCount() << ",\n";
+	json << "  \"shadow_resolution\": " << g_SceneManager->GetShadowResolution() << ",\n";
+	json << "  \"pacing\": \"" << FramePacer::GetModeName(g_FramePacer->GetMode()) << "\",\n";
+	if (g_FramePacer->GetMode() == FramePacer::PACING_LIMITED)
+	{
+		json << "  \"target_fps\": " << g_FramePacer->GetTargetRate() << ",\n";
+		json << "  \"pacing_wait_ms\": " << g_FramePacer->GetAverageWait() * 1000.0 << ",\n";
+	}
+	json << "  \"render_scale\": { \"mean\": " << scaleTotal / options.frames
+		<< ", \"min\": " << minScale
+		<< ", \"max\": " << maxScale << " },\n";
+	json << "  \"dynamic_resolution\": " << (g_RenderTarget->IsDynamicScaling() ? "true" : "false") << ",\n";
+	if (g_RenderTarget->IsDynamicScaling() == true)
+	{
+		json << "  \"gpu_budget_ms\": " << g_RenderTarget->GetGpuBudget() << ",\n";
+	}
+	if (options.captureDirectory.empty() == false)
+	{
+		json << "  \"captured_frames\": " << g_FrameCapture->GetCapturedFrames() << ",\n";
+		json << "  \"dropped_captures\": " << g_FrameCapture->GetDroppedFrames() << ",\n";
+	}
+	json << "  \"camera_path\": \"" << (path.size() > 0 ? "recorded" : "orbit") << "\",\n";
+	json << "  \"total_seconds\": " << totalSeconds << ",\n";
+	json << "  \"frames_per_second\": " << (options.frames / totalSeconds) << ",\n";
+	json << "  \"frame_ms\": { \"mean\": " << meanMs
+		<< ", \"min\": " << sorted.front()
+		<< ", \"p50\": " << percentileMs[0]
+		<< ", \"p90\": " << percentileMs[1]
+		<< ", \"p99\": " << percentileMs[2]
+		<< ", \"max\": " << sorted.back() << " },\n";
+	json << "  \"gpu_ms\": { \"clear\": " << g_FrameProfiler->GetAverageGpuTime(FrameProfiler::PASS_CLEAR)
+		<< ", \"view\": " << g_FrameProfiler->GetAverageGpuTime(FrameProfiler::PASS_VIEW)
+		<< ", \"shadow\": " << g_FrameProfiler->GetAverageGpuTime(FrameProfiler::PASS_SHADOW)
+		<< ", \"scene\": " << g_FrameProfiler->GetAverageGpuTime(FrameProfiler::PASS_SCENE)
+		<< ", \"swap\": " << g_FrameProfiler->GetAverageGpuTime(FrameProfiler::PASS_SWAP) << " },\n";
+	json << "  \"draw_calls_per_frame\": " << (double)drawCalls / options.frames << ",\n";
+	json << "  \"culled_objects_per_frame\": " << (double)culledObjects / options.frames << ",\n";
+	json << "  \"occluded_objects_per_frame\": " << (double)occludedObjects / options.frames << ",\n";
+	json << "  \"reduced_detail_objects_per_frame\": " << (double)reducedDetailObjects / options.frames << ",\n";
+	json << "  \"shadow_maps_per_frame\": " << (double)shadowMapsRendered / options.frames << ",\n";
+	json << "  \"shadow_draw_calls_per_frame\": " << (double)shadowDrawCalls / options.frames << ",\n";
+	json << "  \"redundant_calls_per_frame\": " << (double)redundantCalls / options.frames << ",\n";
+	json << "  \"kernels\": \"" << TransformKernels::GetPathName(kernels) << "\",\n";
+	json << "  \"kernel_ms\": { \"compose\": " << composeMs
+		<< ", \"cull\": " << cullMs
+		<< ", \"scalar_compose\": " << scalarComposeMs
+		<< ", \"scalar_cull\": " << scalarCullMs << " },\n";
+	json << "  \"heap_allocations\": " << heapAllocations << ",\n";
+	json << "  \"heap_allocations_per_frame\": " << (double)heapAllocations / options.frames << ",\n";
+	json << "  \"heap_bytes_per_frame\": " << (double)heapBytes / options.frames << ",\n";
+	json << "  \"frame_arena_peak_bytes\": " << g_SceneManager->GetFrameArena()->GetPeakBytes() << "\n";
+	json << "}\n";
+
+	if (options.outputFile.empty() == true)
+	{
+		std::cout << json.str();
+	}
+	else
+	{
+		std::ofstream file(options.outputFile.c_str());
+		if (!file)
+		{
+			std::cerr << "Could not write benchmark results: " << options.outputFile << std::endl;
+			return(EXIT_FAILURE);
+		}
+		file << json.str();
+		std::cout << "Wrote benchmark results: " << options.outputFile << std::endl;
+	}
+
+	if ((options.bAssertNoAllocations == true) && (heapAllocations > 0))
+	{
+		std::cerr << "The measured frames made " << heapAllocations << " heap allocations" << std::endl;
+		return(EXIT_FAILURE);
+	}
+
+	return(EXIT_SUCCESS);
+}
+
+/***********************************************************
+ *	InitializeGLFW()
+ * 
+ *  This function is used to initialize the GLFW library.   
+ ***********************************************************/
+bool InitializeGLFW()
+{
+	// GLFW: initialize and configure library
+	// --------------------------------------
+	glfwInit();
+
+#ifdef __APPLE__
+	// set the version of OpenGL and profile to use
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#else
+	// set the version of OpenGL and profile to use
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#endif
+	// GLFW: end -------------------------------
+
+	return(true);
+}
+
+/***********************************************************
+ *	InitializeGLEW()
+ *
+ *  This function is used to initialize the GLEW library.
+ ***********************************************************/
+bool InitializeGLEW()
+{
+	// GLEW: initialize
+	// -----------------------------------------
+	GLenum GLEWInitResult = GLEW_OK;
+
+	// try to initialize the GLEW library
+	GLEWInitResult = glewInit();
+	if (GLEW_OK != GLEWInitResult)
+	{
+		std::cerr << glewGetErrorString(GLEWInitResult) << std::endl;
+		return false;
+	}
+	// GLEW: end -------------------------------
+
+	// Displays a successful OpenGL initialization message
+	std::cout << "INFO: OpenGL Successfully Initialized\n";
+	std::cout << "INFO: OpenGL Version: " << glGetString(GL_VERSION) << "\n" << std::endl;
+
+	return(true);
 }
\ No newline at end of file
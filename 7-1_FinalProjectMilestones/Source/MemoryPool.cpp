@@ -0,0 +1,155 @@
+///////////////////////////////////////////////////////////////////////////////
+// memorypool.cpp
+// ============
+// keep fixed size blocks for long-lived objects and reuse them once freed
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "MemoryPool.h"
+
+// declaration of global variables
+namespace
+{
+	// alignment of every block, enough for any plain type
+	const size_t g_BlockAlignment = alignof(std::max_align_t);
+}
+
+/***********************************************************
+ *  MemoryPool()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+MemoryPool::MemoryPool(size_t blockSize, int blocksPerChunk)
+{
+	// every block has to hold the free list link, and starts
+	// at an alignment that suits any type
+	if (blockSize < sizeof(FREE_BLOCK))
+	{
+		blockSize = sizeof(FREE_BLOCK);
+	}
+	m_blockSize = (blockSize + g_BlockAlignment - 1) & ~(g_BlockAlignment - 1);
+	m_blocksPerChunk = (blocksPerChunk > 0) ? blocksPerChunk : 1;
+	m_pFreeList = NULL;
+	m_blocksInUse = 0;
+}
+
+/***********************************************************
+ *  ~MemoryPool()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+MemoryPool::~MemoryPool()
+{
+	for (int i = 0; i < m_chunks.size(); i++)
+	{
+		delete[] m_chunks[i];
+	}
+	m_chunks.clear();
+	m_pFreeList = NULL;
+}
+
+/***********************************************************
+ *  AddChunk()
+ *
+ *  This method is used for taking a new chunk from the heap
+ *  and putting all its blocks on the free list, in order,
+ *  so that blocks handed out one after another are next to
+ *  each other in memory.
+ ***********************************************************/
+void MemoryPool::AddChunk()
+{
+	unsigned char* pChunk = new unsigned char[m_blockSize * m_blocksPerChunk];
+	m_chunks.push_back(pChunk);
+
+	for (int i = m_blocksPerChunk - 1; i >= 0; i--)
+	{
+		FREE_BLOCK* pBlock = (FREE_BLOCK*)(pChunk + i * m_blockSize);
+		pBlock->pNext = m_pFreeList;
+		m_pFreeList = pBlock;
+	}
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for handing out memory for size
+ *  bytes.  A free block is taken when the size fits one,
+ *  and a new chunk is only added when no block is free.
+ ***********************************************************/
+void* MemoryPool::Allocate(size_t size)
+{
+	if (size > m_blockSize)
+	{
+		return(::operator new(size));
+	}
+
+	if (m_pFreeList == NULL)
+	{
+		AddChunk();
+	}
+
+	FREE_BLOCK* pBlock = m_pFreeList;
+	m_pFreeList = pBlock->pNext;
+	m_blocksInUse++;
+
+	return(pBlock);
+}
+
+/***********************************************************
+ *  Free()
+ *
+ *  This method is used for giving memory back.  The size
+ *  has to be the one it was allocated with, which tells a
+ *  block of the pool from memory of the heap.
+ ***********************************************************/
+void MemoryPool::Free(void* pMemory, size_t size)
+{
+	if (pMemory == NULL)
+	{
+		return;
+	}
+
+	if (size > m_blockSize)
+	{
+		::operator delete(pMemory);
+		return;
+	}
+
+	FREE_BLOCK* pBlock = (FREE_BLOCK*)pMemory;
+	pBlock->pNext = m_pFreeList;
+	m_pFreeList = pBlock;
+	m_blocksInUse--;
+}
+
+/***********************************************************
+ *  GetBlockSize()
+ *
+ *  This method is used for getting the size of every block,
+ *  after rounding up to the block alignment.
+ ***********************************************************/
+size_t MemoryPool::GetBlockSize() const
+{
+	return(m_blockSize);
+}
+
+/***********************************************************
+ *  GetChunkCount()
+ *
+ *  This method is used for getting the number of chunks
+ *  that were taken from the heap so far.
+ ***********************************************************/
+int MemoryPool::GetChunkCount() const
+{
+	return((int)m_chunks.size());
+}
+
+/***********************************************************
+ *  GetBlocksInUse()
+ *
+ *  This method is used for getting the number of blocks
+ *  handed out and not freed yet.
+ ***********************************************************/
+int MemoryPool::GetBlocksInUse() const
+{
+	return(m_blocksInUse);
+}
\ No newline at end of file
@@ -0,0 +1,145 @@
+///////////////////////////////////////////////////////////////////////////////
+// memorypool.h
+// ============
+// keep fixed size blocks for long-lived objects and reuse them once freed
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+/***********************************************************
+ *  MemoryPool
+ *
+ *  This class contains the code for a pool of fixed size
+ *  blocks.  Blocks are carved out of chunks that hold many
+ *  of them, and a freed block goes onto a free list that
+ *  the next allocation takes from, so objects that are
+ *  created and destroyed again, such as when a scene is
+ *  reloaded, reuse the same memory instead of going to the
+ *  heap.  Allocations larger than a block are passed on to
+ *  the heap.  A pool belongs to one thread.
+ ***********************************************************/
+class MemoryPool
+{
+public:
+	// constructor
+	MemoryPool(size_t blockSize, int blocksPerChunk);
+	// destructor
+	~MemoryPool();
+
+private:
+	// a free block holds the link to the next free block
+	struct FREE_BLOCK
+	{
+		FREE_BLOCK* pNext;
+	};
+
+	// size of every block, and the number of blocks in a chunk
+	size_t m_blockSize;
+	int m_blocksPerChunk;
+	// chunks the blocks are carved out of
+	std::vector<unsigned char*> m_chunks;
+	// blocks ready to be handed out
+	FREE_BLOCK* m_pFreeList;
+	// blocks handed out and not freed yet
+	int m_blocksInUse;
+
+	// carve a new chunk into free blocks
+	void AddChunk();
+
+public:
+	// memory for size bytes, from the pool when it fits a block
+	void* Allocate(size_t size);
+	// give memory back, with the size it was allocated with
+	void Free(void* pMemory, size_t size);
+
+	// size of every block
+	size_t GetBlockSize() const;
+	// number of chunks taken from the heap so far
+	int GetChunkCount() const;
+	// number of blocks handed out and not freed yet
+	int GetBlocksInUse() const;
+};
+
+/***********************************************************
+ *  PoolAllocator
+ *
+ *  This class template is used for letting standard
+ *  containers that allocate one node at a time, such as
+ *  std::unordered_map, take their nodes from a MemoryPool.
+ *  Arrays, such as the buckets of a map, and allocators
+ *  without a pool use the heap.  Containers sharing a pool
+ *  compare equal, and the pool follows the container when
+ *  it is assigned or swapped.
+ ***********************************************************/
+template <typename T>
+class PoolAllocator
+{
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	// constructors; without a pool the heap is used
+	PoolAllocator()
+	{
+		m_pPool = NULL;
+	}
+	PoolAllocator(MemoryPool* pPool)
+	{
+		m_pPool = pPool;
+	}
+	template <typename U>
+	PoolAllocator(const PoolAllocator<U>& other)
+	{
+		m_pPool = other.GetPool();
+	}
+
+	// memory for count objects, from the pool for single ones
+	T* allocate(size_t count)
+	{
+		if ((count == 1) && (m_pPool != NULL))
+		{
+			return((T*)m_pPool->Allocate(sizeof(T)));
+		}
+		return((T*)::operator new(count * sizeof(T)));
+	}
+	// give memory back the way it was allocated
+	void deallocate(T* pMemory, size_t count)
+	{
+		if ((count == 1) && (m_pPool != NULL))
+		{
+			m_pPool->Free(pMemory, sizeof(T));
+			return;
+		}
+		::operator delete(pMemory);
+	}
+
+	// pool the memory comes from, or NULL for the heap
+	MemoryPool* GetPool() const
+	{
+		return(m_pPool);
+	}
+
+private:
+	MemoryPool* m_pPool;
+};
+
+// allocators that share a pool can free each other's memory
+template <typename T, typename U>
+bool operator==(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+	return(a.GetPool() == b.GetPool());
+}
+
+template <typename T, typename U>
+bool operator!=(const PoolAllocator<T>& a, const PoolAllocator<U>& b)
+{
+	return(a.GetPool() != b.GetPool());
+}
\ No newline at end of file
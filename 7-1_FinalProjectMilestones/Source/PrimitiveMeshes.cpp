@@ -0,0 +1,1048 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.cpp
+// ============
+// basic shape meshes that support instanced drawing
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "PrimitiveMeshes.h"
+#include "GLStateCache.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// declaration of global variables and defines
+namespace
+{
+	// vertex attribute locations used by the vertex shader
+	const GLuint g_PositionLocation = 0;
+	const GLuint g_NormalLocation = 1;
+	const GLuint g_TextureLocation = 2;
+	const GLuint g_InstanceModelLocation = 3;     // uses locations 3 to 6
+	const GLuint g_InstanceMaterialLocation = 7;
+	// instances the ring buffer holds per frame at first; it
+	// grows when a frame needs more
+	const int g_InitialStreamInstances = 4096;
+
+	// number of floats per vertex: position, normal, texture coordinate
+	const int g_FloatsPerVertex = 8;
+
+	// number of slices around the round meshes for each level
+	// of detail; the spheres use half as many stacks
+	const int g_RoundSlices[PrimitiveMeshes::LOD_LEVELS] = { 36, 16, 8 };
+
+	const float g_Pi = 3.14159265358979f;
+
+	/***********************************************************
+	 *  FloatToHalf()
+	 *
+	 *  Convert a float into a 16 bit half float.  The values
+	 *  converted here are normals, so values too small for a
+	 *  half float are flushed to zero and large values are
+	 *  clamped to the largest half float.
+	 ***********************************************************/
+	GLhalf FloatToHalf(float value)
+	{
+		uint32_t bits = 0;
+		memcpy(&bits, &value, sizeof(bits));
+
+		uint32_t sign = (bits >> 16) & 0x8000;
+		int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+		uint32_t mantissa = bits & 0x007FFFFF;
+
+		if (exponent <= 0)
+		{
+			return((GLhalf)sign);
+		}
+		if (exponent >= 31)
+		{
+			return((GLhalf)(sign | 0x7BFF));
+		}
+
+		// round the mantissa to the nearest half float
+		uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+		if ((mantissa & 0x00001000) != 0)
+		{
+			half++;
+		}
+
+		return((GLhalf)half);
+	}
+
+	/***********************************************************
+	 *  FloatToUnorm16()
+	 *
+	 *  Convert a texture coordinate between 0 and 1 into a
+	 *  normalized 16 bit integer.
+	 ***********************************************************/
+	GLushort FloatToUnorm16(float value)
+	{
+		if (value <= 0.0f)
+		{
+			return(0);
+		}
+		if (value >= 1.0f)
+		{
+			return(0xFFFF);
+		}
+
+		return((GLushort)(value * 65535.0f + 0.5f));
+	}
+
+	/***********************************************************
+	 *  AddVertex()
+	 *
+	 *  Append one interleaved vertex to the vertex list.
+	 ***********************************************************/
+	void AddVertex(
+		std::vector<GLfloat>& vertices,
+		float x, float y, float z,
+		float nx, float ny, float nz,
+		float u, float v)
+	{
+		vertices.push_back(x);
+		vertices.push_back(y);
+		vertices.push_back(z);
+		vertices.push_back(nx);
+		vertices.push_back(ny);
+		vertices.push_back(nz);
+		vertices.push_back(u);
+		vertices.push_back(v);
+	}
+
+	/***********************************************************
+	 *  BuildPlaneGeometry()
+	 *
+	 *  Generate a 2x2 plane on the origin facing up, with the
+	 *  texture stretched once across it.
+	 ***********************************************************/
+	void BuildPlaneGeometry(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices)
+	{
+		AddVertex(vertices, -1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f);
+		AddVertex(vertices, 1.0f, 0.0f, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 1.0f);
+		AddVertex(vertices, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f);
+		AddVertex(vertices, -1.0f, 0.0f, 1.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f);
+
+		indices.push_back(0);
+		indices.push_back(2);
+		indices.push_back(1);
+		indices.push_back(0);
+		indices.push_back(3);
+		indices.push_back(2);
+	}
+
+	/***********************************************************
+	 *  BuildBoxGeometry()
+	 *
+	 *  Generate a 1x1x1 box centered on the origin, with its
+	 *  own vertices per face so each face has a flat normal.
+	 ***********************************************************/
+	void BuildBoxGeometry(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices)
+	{
+		// normal, then the two axes spanning the face
+		const float faces[6][9] =
+		{
+			{ 0.0f, 0.0f, 1.0f,   1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f },   // front
+			{ 0.0f, 0.0f,-1.0f,  -1.0f, 0.0f, 0.0f,   0.0f, 1.0f, 0.0f },   // back
+			{ 1.0f, 0.0f, 0.0f,   0.0f, 0.0f,-1.0f,   0.0f, 1.0f, 0.0f },   // right
+			{-1.0f, 0.0f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 1.0f, 0.0f },   // left
+			{ 0.0f, 1.0f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 0.0f,-1.0f },   // top
+			{ 0.0f,-1.0f, 0.0f,   1.0f, 0.0f, 0.0f,   0.0f, 0.0f, 1.0f }    // bottom
+		};
+		const float corners[4][2] =
+		{
+			{ -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f }
+		};
+
+		for (int face = 0; face < 6; face++)
+		{
+			const float* f = faces[face];
+			GLuint firstVertex = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+			for (int corner = 0; corner < 4; corner++)
+			{
+				float a = corners[corner][0];
+				float b = corners[corner][1];
+
+				AddVertex(
+					vertices,
+					f[0] * 0.5f + f[3] * a + f[6] * b,
+					f[1] * 0.5f + f[4] * a + f[7] * b,
+					f[2] * 0.5f + f[5] * a + f[8] * b,
+					f[0], f[1], f[2],
+					a + 0.5f, b + 0.5f);
+			}
+
+			indices.push_back(firstVertex + 0);
+			indices.push_back(firstVertex + 1);
+			indices.push_back(firstVertex + 2);
+			indices.push_back(firstVertex + 0);
+			indices.push_back(firstVertex + 2);
+			indices.push_back(firstVertex + 3);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildCylinderGeometry()
+	 *
+	 *  Generate a cylinder with a radius of 1 whose bottom
+	 *  cap sits on the origin and whose top cap is at a
+	 *  height of 1.
+	 ***********************************************************/
+	void BuildCylinderGeometry(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int slices)
+	{
+		// the sides, with a duplicated seam column for the texture wrap
+		GLuint sideStart = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / (float)slices;
+			float angle = u * 2.0f * g_Pi;
+			float x = cosf(angle);
+			float z = sinf(angle);
+
+			AddVertex(vertices, x, 0.0f, z, x, 0.0f, z, u, 0.0f);
+			AddVertex(vertices, x, 1.0f, z, x, 0.0f, z, u, 1.0f);
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom = sideStart + i * 2;
+			indices.push_back(bottom);
+			indices.push_back(bottom + 1);
+			indices.push_back(bottom + 3);
+			indices.push_back(bottom);
+			indices.push_back(bottom + 3);
+			indices.push_back(bottom + 2);
+		}
+
+		// the top and bottom caps as triangle fans around a center vertex
+		for (int cap = 0; cap < 2; cap++)
+		{
+			float y = (cap == 0) ? 1.0f : 0.0f;
+			float ny = (cap == 0) ? 1.0f : -1.0f;
+			GLuint center = (GLuint)(vertices.size() / g_FloatsPerVertex);
+
+			AddVertex(vertices, 0.0f, y, 0.0f, 0.0f, ny, 0.0f, 0.5f, 0.5f);
+			for (int i = 0; i <= slices; i++)
+			{
+				float angle = ((float)i / (float)slices) * 2.0f * g_Pi;
+				float x = cosf(angle);
+				float z = sinf(angle);
+				AddVertex(vertices, x, y, z, 0.0f, ny, 0.0f, 0.5f + 0.5f * x, 0.5f + 0.5f * z);
+			}
+			for (int i = 0; i < slices; i++)
+			{
+				indices.push_back(center);
+				if (cap == 0)
+				{
+					indices.push_back(center + 2 + i);
+					indices.push_back(center + 1 + i);
+				}
+				else
+				{
+					indices.push_back(center + 1 + i);
+					indices.push_back(center + 2 + i);
+				}
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  BuildConeGeometry()
+	 *
+	 *  Generate a cone with a radius of 1 whose base sits on
+	 *  the origin and whose tip is at a height of 1.  Each
+	 *  slice has its own tip vertex so the side normals stay
+	 *  smooth around the cone.
+	 ***********************************************************/
+	void BuildConeGeometry(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int slices)
+	{
+		// with equal radius and height the side normals lean
+		// 45 degrees up from the base
+		const float normalScale = 1.0f / sqrtf(2.0f);
+
+		GLuint sideStart = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		for (int i = 0; i <= slices; i++)
+		{
+			float u = (float)i / (float)slices;
+			float angle = u * 2.0f * g_Pi;
+			float x = cosf(angle);
+			float z = sinf(angle);
+
+			AddVertex(vertices, x, 0.0f, z, x * normalScale, normalScale, z * normalScale, u, 0.0f);
+			AddVertex(vertices, 0.0f, 1.0f, 0.0f, x * normalScale, normalScale, z * normalScale, u, 1.0f);
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			GLuint bottom = sideStart + i * 2;
+			indices.push_back(bottom);
+			indices.push_back(bottom + 1);
+			indices.push_back(bottom + 2);
+		}
+
+		// the base as a triangle fan around a center vertex
+		GLuint center = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		AddVertex(vertices, 0.0f, 0.0f, 0.0f, 0.0f, -1.0f, 0.0f, 0.5f, 0.5f);
+		for (int i = 0; i <= slices; i++)
+		{
+			float angle = ((float)i / (float)slices) * 2.0f * g_Pi;
+			float x = cosf(angle);
+			float z = sinf(angle);
+			AddVertex(vertices, x, 0.0f, z, 0.0f, -1.0f, 0.0f, 0.5f + 0.5f * x, 0.5f + 0.5f * z);
+		}
+		for (int i = 0; i < slices; i++)
+		{
+			indices.push_back(center);
+			indices.push_back(center + 1 + i);
+			indices.push_back(center + 2 + i);
+		}
+	}
+
+	/***********************************************************
+	 *  BuildSphereGeometry()
+	 *
+	 *  Generate a sphere with a radius of 1 centered on the
+	 *  origin, from stacks running from the bottom pole to the
+	 *  top pole and slices around the vertical axis.
+	 ***********************************************************/
+	void BuildSphereGeometry(
+		std::vector<GLfloat>& vertices,
+		std::vector<GLuint>& indices,
+		int slices,
+		int stacks)
+	{
+		GLuint firstVertex = (GLuint)(vertices.size() / g_FloatsPerVertex);
+		for (int stack = 0; stack <= stacks; stack++)
+		{
+			float v = (float)stack / (float)stacks;
+			float polarAngle = g_Pi * (v - 0.5f);
+			float y = sinf(polarAngle);
+			float ringRadius = cosf(polarAngle);
+
+			for (int i = 0; i <= slices; i++)
+			{
+				float u = (float)i / (float)slices;
+				float angle = u * 2.0f * g_Pi;
+				float x = ringRadius * cosf(angle);
+				float z = ringRadius * sinf(angle);
+
+				AddVertex(vertices, x, y, z, x, y, z, u, v);
+			}
+		}
+
+		GLuint ringVertices = (GLuint)(slices + 1);
+		for (int stack = 0; stack < stacks; stack++)
+		{
+			for (int i = 0; i < slices; i++)
+			{
+				GLuint bottom = firstVertex + stack * ringVertices + i;
+				GLuint top = bottom + ringVertices;
+				indices.push_back(bottom);
+				indices.push_back(top);
+				indices.push_back(top + 1);
+				indices.push_back(bottom);
+				indices.push_back(top + 1);
+				indices.push_back(bottom + 1);
+			}
+		}
+	}
+}
+
+/***********************************************************
+ *  PrimitiveMeshes()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+PrimitiveMeshes::PrimitiveMeshes()
+{
+	m_planeMesh = MESH_RANGE();
+	m_boxMesh = MESH_RANGE();
+	for (int level = 0; level < LOD_LEVELS; level++)
+	{
+		m_cylinderMeshes[level] = MESH_RANGE();
+		m_coneMeshes[level] = MESH_RANGE();
+		m_sphereMeshes[level] = MESH_RANGE();
+	}
+	m_poolVAO = 0;
+	m_indirectVAO = 0;
+	m_poolVBO = 0;
+	m_poolIBO = 0;
+	m_bPoolDirty = false;
+	m_instanceVBO = 0;
+	m_instanceCapacity = 0;
+	m_instanceStream = new StreamBuffer();
+	m_bStreamChecked = false;
+	m_instanceAttributeBuffer = 0;
+	m_pAllocatedInstances = NULL;
+	m_allocatedBaseInstance = 0;
+}
+
+/***********************************************************
+ *  ~PrimitiveMeshes()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+PrimitiveMeshes::~PrimitiveMeshes()
+{
+	if (m_indirectVAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_indirectVAO);
+		m_indirectVAO = 0;
+	}
+	if (m_poolVAO != 0)
+	{
+		glDeleteVertexArrays(1, &m_poolVAO);
+		glDeleteBuffers(1, &m_poolVBO);
+		glDeleteBuffers(1, &m_poolIBO);
+		m_poolVAO = 0;
+		m_poolVBO = 0;
+		m_poolIBO = 0;
+	}
+	GLStateCache::InvalidateVertexArray();
+	m_poolVertices.clear();
+	m_poolIndices.clear();
+
+	if (m_instanceVBO != 0)
+	{
+		glDeleteBuffers(1, &m_instanceVBO);
+		m_instanceVBO = 0;
+	}
+	delete m_instanceStream;
+	m_instanceStream = NULL;
+}
+
+/***********************************************************
+ *  CreateMesh()
+ *
+ *  This method is used for quantizing generated geometry
+ *  and appending it to the pool.  The indices stay relative
+ *  to the first vertex of the mesh, which lets them fit 16
+ *  bits; the draws add the base vertex back.  The pool is
+ *  uploaded by the next draw.
+ ***********************************************************/
+void PrimitiveMeshes::CreateMesh(
+	MESH_RANGE& mesh,
+	const std::vector<GLfloat>& vertices,
+	const std::vector<GLuint>& indices)
+{
+	int vertexCount = (int)(vertices.size() / g_FloatsPerVertex);
+	if ((vertexCount == 0) || (vertexCount > 0xFFFF))
+	{
+		mesh = MESH_RANGE();
+		return;
+	}
+
+	mesh.baseVertex = (GLint)m_poolVertices.size();
+	mesh.firstIndex = (GLuint)m_poolIndices.size();
+	mesh.nIndices = (GLsizei)indices.size();
+
+	for (int i = 0; i < vertexCount; i++)
+	{
+		const GLfloat* source = &vertices[i * g_FloatsPerVertex];
+		POOL_VERTEX vertex;
+
+		vertex.position[0] = source[0];
+		vertex.position[1] = source[1];
+		vertex.position[2] = source[2];
+		vertex.normal[0] = FloatToHalf(source[3]);
+		vertex.normal[1] = FloatToHalf(source[4]);
+		vertex.normal[2] = FloatToHalf(source[5]);
+		vertex.normal[3] = 0;
+		vertex.texCoord[0] = FloatToUnorm16(source[6]);
+		vertex.texCoord[1] = FloatToUnorm16(source[7]);
+
+		m_poolVertices.push_back(vertex);
+	}
+	for (int i = 0; i < indices.size(); i++)
+	{
+		m_poolIndices.push_back((GLushort)indices[i]);
+	}
+
+	m_bPoolDirty = true;
+}
+
+/***********************************************************
+ *  UploadPool()
+ *
+ *  This method is used for creating the shared vertex array
+ *  on first use, and for uploading the pooled vertices and
+ *  indices whenever meshes have been added.  The shared
+ *  instance buffer is attached to the same vertex array as
+ *  per-instance attributes.
+ ***********************************************************/
+void PrimitiveMeshes::UploadPool()
+{
+	if (m_poolVAO == 0)
+	{
+		glGenVertexArrays(1, &m_poolVAO);
+		glGenBuffers(1, &m_poolVBO);
+		glGenBuffers(1, &m_poolIBO);
+		glGenBuffers(1, &m_instanceVBO);
+
+		GLStateCache::BindVertexArray(m_poolVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_poolVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_poolIBO);
+
+		// quantized attributes are widened to floats by the driver,
+		// so the vertex shader reads them unchanged
+		GLint stride = sizeof(POOL_VERTEX);
+		glVertexAttribPointer(g_PositionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(POOL_VERTEX, position));
+		glEnableVertexAttribArray(g_PositionLocation);
+		glVertexAttribPointer(g_NormalLocation, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(POOL_VERTEX, normal));
+		glEnableVertexAttribArray(g_NormalLocation);
+		glVertexAttribPointer(g_TextureLocation, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(POOL_VERTEX, texCoord));
+		glEnableVertexAttribArray(g_TextureLocation);
+
+		BindInstanceAttributes(m_instanceVBO);
+	}
+	else
+	{
+		GLStateCache::BindVertexArray(m_poolVAO);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, m_poolVBO);
+	glBufferData(GL_ARRAY_BUFFER, m_poolVertices.size() * sizeof(POOL_VERTEX), m_poolVertices.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, m_poolIndices.size() * sizeof(GLushort), m_poolIndices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_bPoolDirty = false;
+}
+
+/***********************************************************
+ *  BindPool()
+ *
+ *  This method is used for binding the shared vertex array
+ *  before drawing.  The state cache binds nothing while the
+ *  array is still bound from an earlier draw, so a whole
+ *  frame of instanced draws binds it only once.
+ ***********************************************************/
+void PrimitiveMeshes::BindPool()
+{
+	if ((m_poolVAO == 0) || (m_bPoolDirty == true))
+	{
+		UploadPool();
+		return;
+	}
+
+	GLStateCache::BindVertexArray(m_poolVAO);
+}
+
+/***********************************************************
+ *  ReleasePool()
+ *
+ *  This method is used for noting that a different vertex
+ *  array may have been bound, such as by a mesh of the
+ *  ShapeMeshes library, so that the next draw binds the
+ *  shared vertex array again.
+ ***********************************************************/
+void PrimitiveMeshes::ReleasePool()
+{
+	GLStateCache::InvalidateVertexArray();
+}
+
+/***********************************************************
+ *  BindIndirectPool()
+ *
+ *  This method is used for binding a second vertex array
+ *  over the shared buffers that only has the per-vertex
+ *  attributes.  Indirect draws pass the object index as the
+ *  base instance, which must not move the per-instance
+ *  attributes of the instanced draws past their buffer.
+ ***********************************************************/
+void PrimitiveMeshes::BindIndirectPool()
+{
+	if ((m_poolVAO == 0) || (m_bPoolDirty == true))
+	{
+		UploadPool();
+	}
+
+	if (m_indirectVAO == 0)
+	{
+		glGenVertexArrays(1, &m_indirectVAO);
+		GLStateCache::BindVertexArray(m_indirectVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, m_poolVBO);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_poolIBO);
+
+		GLint stride = sizeof(POOL_VERTEX);
+		glVertexAttribPointer(g_PositionLocation, 3, GL_FLOAT, GL_FALSE, stride, (void*)offsetof(POOL_VERTEX, position));
+		glEnableVertexAttribArray(g_PositionLocation);
+		glVertexAttribPointer(g_NormalLocation, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(POOL_VERTEX, normal));
+		glEnableVertexAttribArray(g_NormalLocation);
+		glVertexAttribPointer(g_TextureLocation, 2, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)offsetof(POOL_VERTEX, texCoord));
+		glEnableVertexAttribArray(g_TextureLocation);
+
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	else
+	{
+		GLStateCache::BindVertexArray(m_indirectVAO);
+	}
+}
+
+/***********************************************************
+ *  GetPoolVertexBytes()
+ *
+ *  This method is used for getting the size of the vertex
+ *  data of all loaded meshes.
+ ***********************************************************/
+size_t PrimitiveMeshes::GetPoolVertexBytes() const
+{
+	return(m_poolVertices.size() * sizeof(POOL_VERTEX));
+}
+
+/***********************************************************
+ *  BindInstanceAttributes()
+ *
+ *  This method is used for pointing the per-instance
+ *  attributes of the shared vertex array at the instance
+ *  buffer or at the ring buffer.  Nothing is changed when
+ *  they already read from the passed in buffer.
+ ***********************************************************/
+void PrimitiveMeshes::BindInstanceAttributes(GLuint buffer)
+{
+	if (buffer == m_instanceAttributeBuffer)
+	{
+		return;
+	}
+
+	// the model matrix takes four attribute locations, one per
+	// column, and all per-instance attributes advance once per instance
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	for (GLuint column = 0; column < 4; column++)
+	{
+		GLuint location = g_InstanceModelLocation + column;
+		glVertexAttribPointer(
+			location, 4, GL_FLOAT, GL_FALSE,
+			sizeof(INSTANCE_DATA),
+			(void*)(offsetof(INSTANCE_DATA, model) + sizeof(glm::vec4) * column));
+		glEnableVertexAttribArray(location);
+		glVertexAttribDivisor(location, 1);
+	}
+	glVertexAttribIPointer(
+		g_InstanceMaterialLocation, 1, GL_INT,
+		sizeof(INSTANCE_DATA),
+		(void*)offsetof(INSTANCE_DATA, materialIndex));
+	glEnableVertexAttribArray(g_InstanceMaterialLocation);
+	glVertexAttribDivisor(g_InstanceMaterialLocation, 1);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	m_instanceAttributeBuffer = buffer;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for starting the instanced draws of
+ *  a frame.  The ring buffer is created on the first frame
+ *  when the context can map buffers persistently and draw
+ *  from a base instance; otherwise the instances keep going
+ *  through the orphaned instance buffer.
+ ***********************************************************/
+void PrimitiveMeshes::BeginFrame()
+{
+	if (m_bStreamChecked == false)
+	{
+		m_bStreamChecked = true;
+		if ((GLEW_VERSION_4_2 == GL_TRUE) || (GLEW_ARB_base_instance == GL_TRUE))
+		{
+			m_instanceStream->Initialize(g_InitialStreamInstances * sizeof(INSTANCE_DATA));
+		}
+	}
+
+	// a grown ring buffer may reuse the name of the old one,
+	// so the attributes are always pointed at it again
+	if (m_instanceStream->BeginFrame() == true)
+	{
+		m_instanceAttributeBuffer = 0;
+	}
+	m_pAllocatedInstances = NULL;
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for ending the instanced draws of a
+ *  frame, fencing the ring buffer region they read from.
+ ***********************************************************/
+void PrimitiveMeshes::EndFrame()
+{
+	m_instanceStream->EndFrame();
+	m_pAllocatedInstances = NULL;
+}
+
+/***********************************************************
+ *  AllocateInstances()
+ *
+ *  This method is used for getting room for the instances
+ *  of the next instanced draw.  The room is in the ring
+ *  buffer when possible, so the instances written into it
+ *  reach the GPU without any copy; otherwise it is staging
+ *  memory that is uploaded when the instances are drawn.
+ ***********************************************************/
+PrimitiveMeshes::INSTANCE_DATA* PrimitiveMeshes::AllocateInstances(int instanceCount)
+{
+	m_pAllocatedInstances = NULL;
+	if (instanceCount <= 0)
+	{
+		return(NULL);
+	}
+
+	size_t offset = 0;
+	void* pWrite = m_instanceStream->Allocate(
+		instanceCount * sizeof(INSTANCE_DATA),
+		sizeof(INSTANCE_DATA),
+		offset);
+	if (pWrite != NULL)
+	{
+		m_pAllocatedInstances = (INSTANCE_DATA*)pWrite;
+		m_allocatedBaseInstance = (GLuint)(offset / sizeof(INSTANCE_DATA));
+		return(m_pAllocatedInstances);
+	}
+
+	if (m_instanceStaging.size() < instanceCount)
+	{
+		m_instanceStaging.resize(instanceCount);
+	}
+	return(m_instanceStaging.data());
+}
+
+/***********************************************************
+ *  UploadInstances()
+ *
+ *  This method is used for making the per-instance data of
+ *  the next draw readable by the GPU.  Instances written in
+ *  place into the ring buffer need nothing but their base
+ *  instance, and other instances are copied into the ring
+ *  buffer.  Without it, the instances are copied into the
+ *  instance buffer, whose storage is orphaned on every
+ *  upload so the driver does not have to wait for draws
+ *  still reading the old data.
+ ***********************************************************/
+GLuint PrimitiveMeshes::UploadInstances(
+	const INSTANCE_DATA* instances,
+	int instanceCount)
+{
+	if (m_instanceStream->IsInitialized() == true)
+	{
+		bool bInPlace = (instances == m_pAllocatedInstances);
+		if (bInPlace == false)
+		{
+			size_t offset = 0;
+			void* pWrite = m_instanceStream->Allocate(
+				instanceCount * sizeof(INSTANCE_DATA),
+				sizeof(INSTANCE_DATA),
+				offset);
+			if (pWrite != NULL)
+			{
+				memcpy(pWrite, instances, instanceCount * sizeof(INSTANCE_DATA));
+				m_pAllocatedInstances = (INSTANCE_DATA*)pWrite;
+				m_allocatedBaseInstance = (GLuint)(offset / sizeof(INSTANCE_DATA));
+				bInPlace = true;
+			}
+		}
+
+		if (bInPlace == true)
+		{
+			BindInstanceAttributes(m_instanceStream->GetBuffer());
+			m_pAllocatedInstances = NULL;
+			return(m_allocatedBaseInstance);
+		}
+	}
+
+	// the ring buffer is full this frame or not supported
+	BindInstanceAttributes(m_instanceVBO);
+	glBindBuffer(GL_ARRAY_BUFFER, m_instanceVBO);
+
+	// grow the instance buffer by doubling when it is too small
+	if (instanceCount > m_instanceCapacity)
+	{
+		while (m_instanceCapacity < instanceCount)
+		{
+			m_instanceCapacity = (m_instanceCapacity == 0) ? 64 : m_instanceCapacity * 2;
+		}
+	}
+	glBufferData(GL_ARRAY_BUFFER, m_instanceCapacity * sizeof(INSTANCE_DATA), NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, instanceCount * sizeof(INSTANCE_DATA), instances);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	return(0);
+}
+
+/***********************************************************
+ *  DrawMeshInstanced()
+ *
+ *  This method is used for drawing a loaded mesh once for
+ *  each of the passed in instances, as a range of the
+ *  shared buffers.
+ ***********************************************************/
+void PrimitiveMeshes::DrawMeshInstanced(
+	const MESH_RANGE& mesh,
+	const INSTANCE_DATA* instances,
+	int instanceCount)
+{
+	if ((mesh.nIndices == 0) || (instanceCount <= 0))
+	{
+		return;
+	}
+
+	BindPool();
+	GLuint baseInstance = UploadInstances(instances, instanceCount);
+
+	if (baseInstance == 0)
+	{
+		glDrawElementsInstancedBaseVertex(
+			GL_TRIANGLES,
+			mesh.nIndices,
+			GL_UNSIGNED_SHORT,
+			(void*)(mesh.firstIndex * sizeof(GLushort)),
+			instanceCount,
+			mesh.baseVertex);
+	}
+	else
+	{
+		glDrawElementsInstancedBaseVertexBaseInstance(
+			GL_TRIANGLES,
+			mesh.nIndices,
+			GL_UNSIGNED_SHORT,
+			(void*)(mesh.firstIndex * sizeof(GLushort)),
+			instanceCount,
+			mesh.baseVertex,
+			baseInstance);
+	}
+}
+
+/***********************************************************
+ *  LoadPlaneMesh()
+ *
+ *  This method is used for loading the instanceable plane.
+ ***********************************************************/
+void PrimitiveMeshes::LoadPlaneMesh()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	BuildPlaneGeometry(vertices, indices);
+	CreateMesh(m_planeMesh, vertices, indices);
+}
+
+/***********************************************************
+ *  LoadBoxMesh()
+ *
+ *  This method is used for loading the instanceable box.
+ ***********************************************************/
+void PrimitiveMeshes::LoadBoxMesh()
+{
+	std::vector<GLfloat> vertices;
+	std::vector<GLuint> indices;
+
+	BuildBoxGeometry(vertices, indices);
+	CreateMesh(m_boxMesh, vertices, indices);
+}
+
+/***********************************************************
+ *  LoadCylinderMesh()
+ *
+ *  This method is used for loading the instanceable
+ *  cylinder at every level of detail.
+ ***********************************************************/
+void PrimitiveMeshes::LoadCylinderMesh()
+{
+	for (int level = 0; level < LOD_LEVELS; level++)
+	{
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+
+		BuildCylinderGeometry(vertices, indices, g_RoundSlices[level]);
+		CreateMesh(m_cylinderMeshes[level], vertices, indices);
+	}
+}
+
+/***********************************************************
+ *  LoadConeMesh()
+ *
+ *  This method is used for loading the instanceable cone
+ *  at every level of detail.
+ ***********************************************************/
+void PrimitiveMeshes::LoadConeMesh()
+{
+	for (int level = 0; level < LOD_LEVELS; level++)
+	{
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+
+		BuildConeGeometry(vertices, indices, g_RoundSlices[level]);
+		CreateMesh(m_coneMeshes[level], vertices, indices);
+	}
+}
+
+/***********************************************************
+ *  LoadSphereMesh()
+ *
+ *  This method is used for loading the instanceable sphere
+ *  at every level of detail.
+ ***********************************************************/
+void PrimitiveMeshes::LoadSphereMesh()
+{
+	for (int level = 0; level < LOD_LEVELS; level++)
+	{
+		std::vector<GLfloat> vertices;
+		std::vector<GLuint> indices;
+
+		BuildSphereGeometry(vertices, indices, g_RoundSlices[level], g_RoundSlices[level] / 2);
+		CreateMesh(m_sphereMeshes[level], vertices, indices);
+	}
+}
+
+/***********************************************************
+ *  DrawPlaneMeshInstanced()
+ *
+ *  This method is used for drawing the plane once for each
+ *  of the passed in instances.
+ ***********************************************************/
+void PrimitiveMeshes::DrawPlaneMeshInstanced(
+	const INSTANCE_DATA* instances,
+	int instanceCount)
+{
+	DrawMeshInstanced(m_planeMesh, instances, instanceCount);
+}
+
+/***********************************************************
+ *  DrawBoxMeshInstanced()
+ *
+ *  This method is used for drawing the box once for each
+ *  of the passed in instances.
+ ***********************************************************/
+void PrimitiveMeshes::DrawBoxMeshInstanced(
+	const INSTANCE_DATA* instances,
+	int instanceCount)
+{
+	DrawMeshInstanced(m_boxMesh, instances, instanceCount);
+}
+
+/***********************************************************
+ *  DrawCylinderMeshInstanced()
+ *
+ *  This method is used for drawing the cylinder at the
+ *  passed in level of detail once for each of the passed
+ *  in instances.
+ ***********************************************************/
+void PrimitiveMeshes::DrawCylinderMeshInstanced(
+	const INSTANCE_DATA* instances,
+	int instanceCount,
+	int lodLevel)
+{
+	if ((lodLevel < 0) || (lodLevel >= LOD_LEVELS))
+	{
+		return;
+	}
+
+	DrawMeshInstanced(m_cylinderMeshes[lodLevel], instances, instanceCount);
+}
+
+/***********************************************************
+ *  DrawConeMeshInstanced()
+ *
+ *  This method is used for drawing the cone at the passed
+ *  in level of detail once for each of the passed in
+ *  instances.
+ ***********************************************************/
+void PrimitiveMeshes::DrawConeMeshInstanced(
+	const INSTANCE_DATA* instances,
+	int instanceCount,
+	int lodLevel)
+{
+	if ((lodLevel < 0) || (lodLevel >= LOD_LEVELS))
+	{
+		return;
+	}
+
+	DrawMeshInstanced(m_coneMeshes[lodLevel], instances, instanceCount);
+}
+
+/***********************************************************
+ *  DrawSphereMeshInstanced()
+ *
+ *  This method is used for drawing the sphere at the passed
+ *  in level of detail once for each of the passed in
+ *  instances.
+ ***********************************************************/
+void PrimitiveMeshes::DrawSphereMeshInstanced(
+	const INSTANCE_DATA* instances,
+	int instanceCount,
+	int lodLevel)
+{
+	if ((lodLevel < 0) || (lodLevel >= LOD_LEVELS))
+	{
+		return;
+	}
+
+	DrawMeshInstanced(m_sphereMeshes[lodLevel], instances, instanceCount);
+}
+
+
+/***********************************************************
+ *  GetPlaneRange()
+ *
+ *  This method is used for getting the range of the plane
+ *  in the shared buffers.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_RANGE& PrimitiveMeshes::GetPlaneRange() const
+{
+	return(m_planeMesh);
+}
+
+/***********************************************************
+ *  GetBoxRange()
+ *
+ *  This method is used for getting the range of the box in
+ *  the shared buffers.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_RANGE& PrimitiveMeshes::GetBoxRange() const
+{
+	return(m_boxMesh);
+}
+
+/***********************************************************
+ *  GetCylinderRange()
+ *
+ *  This method is used for getting the range of the
+ *  cylinder at a level of detail in the shared buffers.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_RANGE& PrimitiveMeshes::GetCylinderRange(int lodLevel) const
+{
+	return(m_cylinderMeshes[glm::clamp(lodLevel, 0, LOD_LEVELS - 1)]);
+}
+
+/***********************************************************
+ *  GetConeRange()
+ *
+ *  This method is used for getting the range of the cone
+ *  at a level of detail in the shared buffers.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_RANGE& PrimitiveMeshes::GetConeRange(int lodLevel) const
+{
+	return(m_coneMeshes[glm::clamp(lodLevel, 0, LOD_LEVELS - 1)]);
+}
+
+/***********************************************************
+ *  GetSphereRange()
+ *
+ *  This method is used for getting the range of the sphere
+ *  at a level of detail in the shared buffers.
+ ***********************************************************/
+const PrimitiveMeshes::MESH_RANGE& PrimitiveMeshes::GetSphereRange(int lodLevel) const
+{
+	return(m_sphereMeshes[glm::clamp(lodLevel, 0, LOD_LEVELS - 1)]);
+}
\ No newline at end of file
@@ -0,0 +1,180 @@
+///////////////////////////////////////////////////////////////////////////////
+// primitivemeshes.h
+// ============
+// basic shape meshes that support instanced drawing
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "StreamBuffer.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  PrimitiveMeshes
+ *
+ *  This class contains the code for loading basic shape
+ *  meshes with the same dimensions as the ShapeMeshes
+ *  library, and for drawing many copies of one of them
+ *  with a single instanced draw call.  The per-instance
+ *  model matrices and material indices are streamed into
+ *  an instance buffer.  The round meshes are loaded at
+ *  several levels of detail, so that objects covering only
+ *  a few pixels can be drawn with far fewer vertices.
+ *  Where the context allows it, the instance data is
+ *  written straight into a persistently mapped ring buffer
+ *  and every draw starts at its own base instance.
+ *
+ *  All meshes share one vertex buffer, one index buffer
+ *  and one vertex array, and each mesh is a range in those
+ *  buffers, so switching meshes never rebinds any state.
+ *  The vertices are quantized to 24 bytes: float positions,
+ *  half float normals and 16 bit texture coordinates.
+ ***********************************************************/
+class PrimitiveMeshes
+{
+public:
+	// constructor
+	PrimitiveMeshes();
+	// destructor
+	~PrimitiveMeshes();
+
+	// number of tessellation levels of the round meshes, where
+	// level zero has the same tessellation as ShapeMeshes
+	static const int LOD_LEVELS = 3;
+
+	// per-instance data read by the vertex shader
+	struct INSTANCE_DATA
+	{
+		glm::mat4 model;
+		int materialIndex;
+		int padding[3];
+	};
+
+	// range of one mesh in the shared vertex and index buffers
+	struct MESH_RANGE
+	{
+		GLint baseVertex;    // first vertex of the mesh in the pool
+		GLuint firstIndex;   // first index of the mesh in the pool
+		GLsizei nIndices;    // number of indices of the mesh
+	};
+
+	// quantized vertex layout of the shared vertex buffer
+	struct POOL_VERTEX
+	{
+		GLfloat position[3];
+		GLhalf normal[4];
+		GLushort texCoord[2];
+	};
+
+private:
+
+	// loaded instanceable meshes, with one mesh per level of
+	// detail for the round meshes
+	MESH_RANGE m_planeMesh;
+	MESH_RANGE m_boxMesh;
+	MESH_RANGE m_cylinderMeshes[LOD_LEVELS];
+	MESH_RANGE m_coneMeshes[LOD_LEVELS];
+	MESH_RANGE m_sphereMeshes[LOD_LEVELS];
+
+	// vertices and indices of all loaded meshes, kept so that
+	// the pool can be uploaded again when a mesh is added
+	std::vector<POOL_VERTEX> m_poolVertices;
+	std::vector<GLushort> m_poolIndices;
+	// handles of the shared vertex array and buffers
+	GLuint m_poolVAO;
+	// vertex array over the pool without the per-instance
+	// attributes, used by indirect draws
+	GLuint m_indirectVAO;
+	GLuint m_poolVBO;
+	GLuint m_poolIBO;
+	// true when meshes were added since the last upload
+	bool m_bPoolDirty;
+
+	// buffer holding the per-instance data of the current draw
+	// when the instances are not streamed
+	GLuint m_instanceVBO;
+	// number of instances the instance buffer can hold
+	int m_instanceCapacity;
+	// pointer to the ring buffer the instances are streamed
+	// through, and true once creating it has been tried
+	StreamBuffer* m_instanceStream;
+	bool m_bStreamChecked;
+	// buffer the per-instance attributes currently read from
+	GLuint m_instanceAttributeBuffer;
+	// instances last handed out by AllocateInstances(), with
+	// their first instance in the ring buffer
+	INSTANCE_DATA* m_pAllocatedInstances;
+	GLuint m_allocatedBaseInstance;
+	// instances written while they cannot be streamed
+	std::vector<INSTANCE_DATA> m_instanceStaging;
+
+	// quantize generated geometry and append it to the pool
+	void CreateMesh(
+		MESH_RANGE& mesh,
+		const std::vector<GLfloat>& vertices,
+		const std::vector<GLuint>& indices);
+	// create the shared vertex array and upload the pool
+	void UploadPool();
+	// point the per-instance attributes of the shared vertex
+	// array at a buffer; the array has to be bound
+	void BindInstanceAttributes(GLuint buffer);
+	// make the per-instance data of the next draw readable,
+	// returning the first instance it starts at
+	GLuint UploadInstances(const INSTANCE_DATA* instances, int instanceCount);
+	// draw a mesh once for each of the passed in instances
+	void DrawMeshInstanced(
+		const MESH_RANGE& mesh,
+		const INSTANCE_DATA* instances,
+		int instanceCount);
+
+public:
+	// load the instanceable meshes
+	void LoadPlaneMesh();
+	void LoadBoxMesh();
+	void LoadCylinderMesh();
+	void LoadConeMesh();
+	void LoadSphereMesh();
+
+	// bind the shared vertex array, which stays bound across
+	// draws until another vertex array may have been bound
+	void BindPool();
+	// note that another vertex array may have been bound, so
+	// that the next draw binds the shared one again
+	void ReleasePool();
+
+	// bind the vertex array without the per-instance attributes,
+	// for draws that read the per-object data from a buffer
+	void BindIndirectPool();
+
+	// number of bytes of vertex data in the pool
+	size_t GetPoolVertexBytes() const;
+
+	// start and end the instanced draws of a frame, so that the
+	// ring buffer region of the frame can be reused once the
+	// GPU is done with it
+	void BeginFrame();
+	void EndFrame();
+	// get room for the instances of the next instanced draw,
+	// which is drawn without a copy when it is passed back
+	INSTANCE_DATA* AllocateInstances(int instanceCount);
+
+	// ranges of the loaded meshes in the shared buffers
+	const MESH_RANGE& GetPlaneRange() const;
+	const MESH_RANGE& GetBoxRange() const;
+	const MESH_RANGE& GetCylinderRange(int lodLevel) const;
+	const MESH_RANGE& GetConeRange(int lodLevel) const;
+	const MESH_RANGE& GetSphereRange(int lodLevel) const;
+
+	// draw the meshes once for each passed in instance, the
+	// round meshes at the passed in level of detail
+	void DrawPlaneMeshInstanced(const INSTANCE_DATA* instances, int instanceCount);
+	void DrawBoxMeshInstanced(const INSTANCE_DATA* instances, int instanceCount);
+	void DrawCylinderMeshInstanced(const INSTANCE_DATA* instances, int instanceCount, int lodLevel = 0);
+	void DrawConeMeshInstanced(const INSTANCE_DATA* instances, int instanceCount, int lodLevel = 0);
+	void DrawSphereMeshInstanced(const INSTANCE_DATA* instances, int instanceCount, int lodLevel = 0);
+};
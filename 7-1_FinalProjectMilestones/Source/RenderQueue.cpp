@@ -0,0 +1,176 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.cpp
+// ============
+// collect and sort the draw records of a 3D scene by render state
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderQueue.h"
+
+#include <algorithm>
+
+// declaration of global variables
+namespace
+{
+	// bit layout of the sort key, from most to least significant:
+	// mesh (8 bits), material (16 bits), texture (16 bits), object (24 bits)
+	const int g_MeshKeyShift = 56;
+	const int g_MaterialKeyShift = 40;
+	const int g_TextureKeyShift = 24;
+	const uint64_t g_MeshKeyMask = 0xFF;
+	const uint64_t g_StateKeyMask = 0xFFFF;
+	const uint64_t g_ObjectKeyMask = 0xFFFFFF;
+}
+
+/***********************************************************
+ *  RenderQueue()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderQueue::RenderQueue()
+{
+	Clear();
+}
+
+/***********************************************************
+ *  ~RenderQueue()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderQueue::~RenderQueue()
+{
+	m_drawRecords.clear();
+}
+
+/***********************************************************
+ *  BuildSortKey()
+ *
+ *  This method is used for packing the render state of a
+ *  draw record into a single integer.  Unassigned material
+ *  and texture handles (-1) sort after all valid ones, and
+ *  the object index keeps the sort stable for equal state.
+ ***********************************************************/
+uint64_t RenderQueue::BuildSortKey(
+	int mesh,
+	int materialIndex,
+	int textureSlot,
+	int objectIndex)
+{
+	uint64_t key = 0;
+
+	key |= ((uint64_t)mesh & g_MeshKeyMask) << g_MeshKeyShift;
+	key |= ((uint64_t)materialIndex & g_StateKeyMask) << g_MaterialKeyShift;
+	key |= ((uint64_t)textureSlot & g_StateKeyMask) << g_TextureKeyShift;
+	key |= ((uint64_t)objectIndex & g_ObjectKeyMask);
+
+	return(key);
+}
+
+/***********************************************************
+ *  Clear()
+ *
+ *  This method is used for removing all the draw records
+ *  and resetting the state change counters for a new frame.
+ ***********************************************************/
+void RenderQueue::Clear()
+{
+	// the capacity is kept so that refilling the queue
+	// every frame does not allocate memory
+	m_drawRecords.clear();
+
+	m_stats.drawCalls = 0;
+	m_stats.meshChanges = 0;
+	m_stats.meshChangesElided = 0;
+	m_stats.materialChanges = 0;
+	m_stats.materialChangesElided = 0;
+	m_stats.textureChanges = 0;
+	m_stats.textureChangesElided = 0;
+	m_stats.uvScaleChanges = 0;
+	m_stats.uvScaleChangesElided = 0;
+	m_stats.instancedBatches = 0;
+	m_stats.instancedObjects = 0;
+	m_stats.culledObjects = 0;
+	m_stats.occludedObjects = 0;
+	m_stats.reducedDetailObjects = 0;
+	m_stats.gpuDrivenObjects = 0;
+	m_stats.shadowDrawCalls = 0;
+	m_stats.shadowMapsRendered = 0;
+}
+
+/***********************************************************
+ *  Submit()
+ *
+ *  This method is used for adding a draw record for the
+ *  scene object with the passed in render state.
+ ***********************************************************/
+void RenderQueue::Submit(
+	int objectIndex,
+	int mesh,
+	int materialIndex,
+	int textureSlot)
+{
+	DRAW_RECORD record;
+
+	record.sortKey = BuildSortKey(mesh, materialIndex, textureSlot, objectIndex);
+	record.objectIndex = objectIndex;
+	record.mesh = mesh;
+	record.materialIndex = materialIndex;
+	record.textureSlot = textureSlot;
+
+	m_drawRecords.push_back(record);
+}
+
+/***********************************************************
+ *  Sort()
+ *
+ *  This method is used for ordering the draw records by
+ *  mesh, then material, then texture.
+ ***********************************************************/
+void RenderQueue::Sort()
+{
+	std::sort(
+		m_drawRecords.begin(),
+		m_drawRecords.end(),
+		[](const DRAW_RECORD& a, const DRAW_RECORD& b)
+		{
+			return(a.sortKey < b.sortKey);
+		});
+}
+
+/***********************************************************
+ *  GetRecordCount()
+ *
+ *  This method is used for getting the number of draw
+ *  records in the queue.
+ ***********************************************************/
+int RenderQueue::GetRecordCount() const
+{
+	return((int)m_drawRecords.size());
+}
+
+/***********************************************************
+ *  GetRecord()
+ *
+ *  This method is used for getting the draw record at the
+ *  passed in position of the sorted queue.
+ ***********************************************************/
+const RenderQueue::DRAW_RECORD& RenderQueue::GetRecord(int index) const
+{
+	return(m_drawRecords[index]);
+}
+
+/***********************************************************
+ *  GetStats()
+ *
+ *  This method is used for getting the state change
+ *  counters of the current frame.
+ ***********************************************************/
+RenderQueue::RENDER_STATS& RenderQueue::GetStats()
+{
+	return(m_stats);
+}
+
+const RenderQueue::RENDER_STATS& RenderQueue::GetStats() const
+{
+	return(m_stats);
+}
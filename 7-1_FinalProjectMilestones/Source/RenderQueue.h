@@ -0,0 +1,95 @@
+///////////////////////////////////////////////////////////////////////////////
+// renderqueue.h
+// ============
+// collect and sort the draw records of a 3D scene by render state
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+/***********************************************************
+ *  RenderQueue
+ *
+ *  This class collects the draw records that are submitted
+ *  for a frame and sorts them by mesh, material and texture
+ *  so that consecutive draws share as much state as
+ *  possible.  It also keeps the per-frame counters of the
+ *  state changes that were issued and elided.
+ ***********************************************************/
+class RenderQueue
+{
+public:
+	// constructor
+	RenderQueue();
+	// destructor
+	~RenderQueue();
+
+	struct DRAW_RECORD
+	{
+		uint64_t sortKey;
+		int objectIndex;
+		int mesh;
+		int materialIndex;
+		int textureSlot;
+	};
+
+	struct RENDER_STATS
+	{
+		int drawCalls;
+		int meshChanges;
+		int meshChangesElided;
+		int materialChanges;
+		int materialChangesElided;
+		int textureChanges;
+		int textureChangesElided;
+		int uvScaleChanges;
+		int uvScaleChangesElided;
+		int instancedBatches;
+		int instancedObjects;
+		int culledObjects;
+		// objects inside the view hidden behind the depth of an
+		// earlier frame
+		int occludedObjects;
+		int reducedDetailObjects;
+		int gpuDrivenObjects;
+		// draws into the shadow maps, and the cascades drawn
+		int shadowDrawCalls;
+		int shadowMapsRendered;
+	};
+
+private:
+	// draw records submitted for the current frame
+	std::vector<DRAW_RECORD> m_drawRecords;
+	// state change counters for the current frame
+	RENDER_STATS m_stats;
+
+	// build the sort key for the passed in render state
+	static uint64_t BuildSortKey(
+		int mesh,
+		int materialIndex,
+		int textureSlot,
+		int objectIndex);
+
+public:
+	// remove all draw records and reset the frame counters
+	void Clear();
+	// add a draw record for a scene object
+	void Submit(
+		int objectIndex,
+		int mesh,
+		int materialIndex,
+		int textureSlot);
+	// sort the draw records by mesh, material and texture
+	void Sort();
+
+	// access the sorted draw records
+	int GetRecordCount() const;
+	const DRAW_RECORD& GetRecord(int index) const;
+
+	// per-frame counters of issued and elided state changes
+	RENDER_STATS& GetStats();
+	const RENDER_STATS& GetStats() const;
+};
@@ -0,0 +1,446 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertarget.cpp
+// ============
+// draw the frames offscreen at a scaled resolution and show them in the window
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "RenderTarget.h"
+#include "GLStateCache.h"
+
+#include <cmath>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// lowest scale that can be chosen, and the lowest scale
+	// dynamic scaling goes down to
+	const float g_MinScale = 0.25f;
+	const float g_MinDynamicScale = 0.5f;
+	// steps the dynamic scale moves in, and the most it is
+	// lowered at once
+	const float g_ScaleStep = 0.05f;
+	const float g_MaxScaleDrop = 0.15f;
+	// frames after a change whose GPU times still measure the
+	// old scale, since the timer queries are read late, and
+	// frames averaged at the new scale before the next change
+	const int g_SettleFrames = 8;
+	const int g_AverageFrames = 16;
+	// weight of the latest GPU time in the average
+	const double g_GpuTimeBlend = 0.1;
+	// share of the budget the GPU time has to stay under for
+	// the scale to be raised again, so that it does not swing
+	// back and forth around the budget
+	const double g_RaiseHeadroom = 0.8;
+	// budget used when none is given, leaving room within a
+	// 60 Hz refresh
+	const double g_DefaultGpuBudgetMs = 14.0;
+}
+
+/***********************************************************
+ *  RenderTarget()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+RenderTarget::RenderTarget()
+{
+	m_framebuffer = 0;
+	m_colorBuffer = 0;
+	m_depthBuffer = 0;
+	m_outputWidth = 0;
+	m_outputHeight = 0;
+	m_width = 0;
+	m_height = 0;
+	m_scale = 1.0f;
+	m_baseScale = 1.0f;
+	m_bDynamic = false;
+	m_gpuBudgetMs = g_DefaultGpuBudgetMs;
+	m_framesSinceChange = 0;
+	m_averageGpuMs = 0.0;
+}
+
+/***********************************************************
+ *  ~RenderTarget()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+RenderTarget::~RenderTarget()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the framebuffer and its
+ *  attachments.
+ ***********************************************************/
+void RenderTarget::Destroy()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_colorBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_colorBuffer);
+		m_colorBuffer = 0;
+	}
+	if (m_depthBuffer != 0)
+	{
+		glDeleteRenderbuffers(1, &m_depthBuffer);
+		m_depthBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  CreateAttachments()
+ *
+ *  This method is used for making the framebuffer with a
+ *  color and a depth attachment of a window framebuffer
+ *  size.  The framebuffer bound before is bound again, and
+ *  a size over the renderbuffer limit leaves no framebuffer,
+ *  so that the window is drawn into instead.
+ ***********************************************************/
+bool RenderTarget::CreateAttachments(int width, int height)
+{
+	Destroy();
+
+	glGenRenderbuffers(1, &m_colorBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_colorBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &m_depthBuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, m_depthBuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	GLuint previousFramebuffer = GLStateCache::GetDrawFramebuffer();
+	glGenFramebuffers(1, &m_framebuffer);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colorBuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_depthBuffer);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Render target framebuffer is incomplete:" << status << std::endl;
+		Destroy();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for making the framebuffer for the
+ *  size of the window framebuffer.  When it cannot be made
+ *  the frames are drawn into the window as before.
+ ***********************************************************/
+bool RenderTarget::Initialize(int outputWidth, int outputHeight)
+{
+	m_outputWidth = (outputWidth > 0) ? outputWidth : 1;
+	m_outputHeight = (outputHeight > 0) ? outputHeight : 1;
+	UpdateSize();
+
+	return(CreateAttachments(m_outputWidth, m_outputHeight));
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the framebuffer
+ *  has been made.
+ ***********************************************************/
+bool RenderTarget::IsSupported() const
+{
+	return(m_framebuffer != 0);
+}
+
+/***********************************************************
+ *  Resize()
+ *
+ *  This method is used for following a resize of the window
+ *  framebuffer.  The attachments are only made again when
+ *  the size really changed, and a minimized window, whose
+ *  framebuffer has no size, keeps them as they are.
+ ***********************************************************/
+void RenderTarget::Resize(int outputWidth, int outputHeight)
+{
+	if ((outputWidth <= 0) || (outputHeight <= 0))
+	{
+		return;
+	}
+	if ((outputWidth == m_outputWidth) && (outputHeight == m_outputHeight))
+	{
+		return;
+	}
+
+	m_outputWidth = outputWidth;
+	m_outputHeight = outputHeight;
+	UpdateSize();
+
+	// without a framebuffer the window is drawn into directly,
+	// which only needs the new viewport
+	if (IsSupported() == true)
+	{
+		CreateAttachments(m_outputWidth, m_outputHeight);
+	}
+}
+
+/***********************************************************
+ *  UpdateSize()
+ *
+ *  This method is used for working out the size the frames
+ *  are drawn at from the window size and the scale.
+ ***********************************************************/
+void RenderTarget::UpdateSize()
+{
+	m_width = (int)(m_outputWidth * m_scale + 0.5f);
+	m_height = (int)(m_outputHeight * m_scale + 0.5f);
+	if (m_width < 1)
+	{
+		m_width = 1;
+	}
+	if (m_height < 1)
+	{
+		m_height = 1;
+	}
+	if (m_width > m_outputWidth)
+	{
+		m_width = m_outputWidth;
+	}
+	if (m_height > m_outputHeight)
+	{
+		m_height = m_outputHeight;
+	}
+}
+
+/***********************************************************
+ *  SetScale()
+ *
+ *  This method is used for setting the scale of the window
+ *  size the frames are drawn at, from 0.25 to 1.  With
+ *  dynamic scaling it is the highest scale used.
+ ***********************************************************/
+void RenderTarget::SetScale(float scale)
+{
+	if (scale < g_MinScale)
+	{
+		scale = g_MinScale;
+	}
+	if (scale > 1.0f)
+	{
+		scale = 1.0f;
+	}
+
+	m_baseScale = scale;
+	m_scale = scale;
+	m_framesSinceChange = 0;
+	UpdateSize();
+}
+
+/***********************************************************
+ *  GetScale()
+ *
+ *  This method is used for getting the scale the frames are
+ *  drawn at right now.
+ ***********************************************************/
+float RenderTarget::GetScale() const
+{
+	return(m_scale);
+}
+
+/***********************************************************
+ *  SetDynamicScaling()
+ *
+ *  This method is used for turning dynamic scaling on or
+ *  off.  A budget of 0 keeps the budget set before.  The
+ *  scale starts from the chosen one either way.
+ ***********************************************************/
+void RenderTarget::SetDynamicScaling(bool bDynamic, double gpuBudgetMs)
+{
+	m_bDynamic = bDynamic;
+	if (gpuBudgetMs > 0.0)
+	{
+		m_gpuBudgetMs = gpuBudgetMs;
+	}
+
+	m_scale = m_baseScale;
+	m_framesSinceChange = 0;
+	UpdateSize();
+}
+
+/***********************************************************
+ *  IsDynamicScaling()
+ *
+ *  This method is used for checking whether the scale
+ *  follows the GPU time.
+ ***********************************************************/
+bool RenderTarget::IsDynamicScaling() const
+{
+	return(m_bDynamic);
+}
+
+/***********************************************************
+ *  GetGpuBudget()
+ *
+ *  This method is used for getting the GPU time in
+ *  milliseconds dynamic scaling holds the frames to.
+ ***********************************************************/
+double RenderTarget::GetGpuBudget() const
+{
+	return(m_gpuBudgetMs);
+}
+
+/***********************************************************
+ *  UpdateScale()
+ *
+ *  This method is used for adjusting the scale to the GPU
+ *  time of a recent frame.  Once the GPU times of the
+ *  current scale have arrived and been averaged, a frame
+ *  over the budget lowers the scale to the one expected to
+ *  fit, since most of the GPU time grows with the number of
+ *  pixels, and frames well within the budget raise it again
+ *  by a single step.
+ ***********************************************************/
+void RenderTarget::UpdateScale(double gpuFrameMs)
+{
+	if ((m_bDynamic == false) || (gpuFrameMs <= 0.0))
+	{
+		return;
+	}
+
+	m_framesSinceChange++;
+	if (m_framesSinceChange <= g_SettleFrames)
+	{
+		return;
+	}
+	if (m_framesSinceChange == g_SettleFrames + 1)
+	{
+		m_averageGpuMs = gpuFrameMs;
+	}
+	else
+	{
+		m_averageGpuMs += (gpuFrameMs - m_averageGpuMs) * g_GpuTimeBlend;
+	}
+	if (m_framesSinceChange < g_SettleFrames + g_AverageFrames)
+	{
+		return;
+	}
+
+	float minScale = (m_baseScale < g_MinDynamicScale) ? m_baseScale : g_MinDynamicScale;
+	float scale = m_scale;
+	if (m_averageGpuMs > m_gpuBudgetMs)
+	{
+		float fit = m_scale * (float)sqrt(m_gpuBudgetMs / m_averageGpuMs);
+		scale = floorf(fit / g_ScaleStep) * g_ScaleStep;
+		if (scale > m_scale - g_ScaleStep)
+		{
+			scale = m_scale - g_ScaleStep;
+		}
+		if (scale < m_scale - g_MaxScaleDrop)
+		{
+			scale = m_scale - g_MaxScaleDrop;
+		}
+	}
+	else if (m_averageGpuMs < m_gpuBudgetMs * g_RaiseHeadroom)
+	{
+		scale = m_scale + g_ScaleStep;
+	}
+
+	if (scale < minScale)
+	{
+		scale = minScale;
+	}
+	if (scale > m_baseScale)
+	{
+		scale = m_baseScale;
+	}
+	if (scale != m_scale)
+	{
+		m_scale = scale;
+		m_framesSinceChange = 0;
+		UpdateSize();
+	}
+}
+
+/***********************************************************
+ *  GetWidth()
+ *
+ *  This method is used for getting the width the frames
+ *  are drawn at.
+ ***********************************************************/
+int RenderTarget::GetWidth() const
+{
+	return(m_width);
+}
+
+/***********************************************************
+ *  GetHeight()
+ *
+ *  This method is used for getting the height the frames
+ *  are drawn at.
+ ***********************************************************/
+int RenderTarget::GetHeight() const
+{
+	return(m_height);
+}
+
+/***********************************************************
+ *  Begin()
+ *
+ *  This method is used for binding the framebuffer for
+ *  drawing a frame, with the viewport over the scaled
+ *  corner of it.  The depth of the frame stays readable
+ *  from the framebuffer until Present() is called.  When
+ *  there is no framebuffer the window is drawn into.
+ ***********************************************************/
+void RenderTarget::Begin()
+{
+	if (IsSupported() == false)
+	{
+		GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLStateCache::SetViewport(0, 0, m_outputWidth, m_outputHeight);
+		return;
+	}
+
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	GLStateCache::SetViewport(0, 0, m_width, m_height);
+}
+
+/***********************************************************
+ *  Present()
+ *
+ *  This method is used for stretching the drawn corner of
+ *  the framebuffer over the window framebuffer, which is
+ *  then left bound for reading and drawing.  The whole
+ *  framebuffer is cleared every frame, so the filtering at
+ *  the edge of a smaller corner blends with the clear color
+ *  and not an older frame.
+ ***********************************************************/
+void RenderTarget::Present()
+{
+	if (IsSupported() == false)
+	{
+		return;
+	}
+
+	GLenum filter = GL_LINEAR;
+	if ((m_width == m_outputWidth) && (m_height == m_outputHeight))
+	{
+		filter = GL_NEAREST;
+	}
+
+	GLStateCache::BindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+	GLStateCache::BindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+	glBlitFramebuffer(
+		0, 0, m_width, m_height,
+		0, 0, m_outputWidth, m_outputHeight,
+		GL_COLOR_BUFFER_BIT,
+		filter);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, 0);
+}
\ No newline at end of file
@@ -0,0 +1,96 @@
+///////////////////////////////////////////////////////////////////////////////
+// rendertarget.h
+// ============
+// draw the frames offscreen at a scaled resolution and show them in the window
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+/***********************************************************
+ *  RenderTarget
+ *
+ *  This class contains the code for drawing the frames into
+ *  an offscreen framebuffer instead of the window.  A frame
+ *  is drawn at a scale of the window framebuffer size and
+ *  then stretched over the window with a blit.  The
+ *  attachments are made at the full size, and a smaller
+ *  scale only draws into a corner of them, so that a change
+ *  of the scale needs no new attachments.  With dynamic
+ *  scaling the scale is lowered while the GPU time of the
+ *  frames is over a budget, and raised again step by step
+ *  once there is room, waiting after every change for the
+ *  GPU times of the new scale to arrive.
+ ***********************************************************/
+class RenderTarget
+{
+public:
+	// constructor
+	RenderTarget();
+	// destructor
+	~RenderTarget();
+
+private:
+	// framebuffer the frames are drawn into, and its color and
+	// depth attachments
+	GLuint m_framebuffer;
+	GLuint m_colorBuffer;
+	GLuint m_depthBuffer;
+	// size of the window framebuffer the frames are shown in,
+	// which the attachments are made for
+	int m_outputWidth;
+	int m_outputHeight;
+	// size the frames are drawn at
+	int m_width;
+	int m_height;
+	// current scale, and the scale chosen, which dynamic
+	// scaling never goes above
+	float m_scale;
+	float m_baseScale;
+	// true when the scale follows the GPU time, and the GPU time
+	// in milliseconds a frame should take
+	bool m_bDynamic;
+	double m_gpuBudgetMs;
+	// frames since the scale last changed, and the average GPU
+	// time measured at the current scale
+	int m_framesSinceChange;
+	double m_averageGpuMs;
+
+	// make the attachments for a window framebuffer size
+	bool CreateAttachments(int width, int height);
+	// free the framebuffer and its attachments
+	void Destroy();
+	// work out the drawn size from the scale
+	void UpdateSize();
+
+public:
+	// make the framebuffer for the size of the window framebuffer
+	bool Initialize(int outputWidth, int outputHeight);
+	// true once the framebuffer has been made
+	bool IsSupported() const;
+	// follow a resize of the window framebuffer
+	void Resize(int outputWidth, int outputHeight);
+
+	// set the scale of the window size the frames are drawn at
+	void SetScale(float scale);
+	float GetScale() const;
+	// scale the frames to hold the GPU time within a budget
+	void SetDynamicScaling(bool bDynamic, double gpuBudgetMs);
+	bool IsDynamicScaling() const;
+	double GetGpuBudget() const;
+	// adjust the scale to the GPU time of a recent frame; call
+	// once per frame before it is drawn
+	void UpdateScale(double gpuFrameMs);
+
+	// size the frames are drawn at
+	int GetWidth() const;
+	int GetHeight() const;
+
+	// bind the framebuffer and the viewport for drawing a frame
+	void Begin();
+	// stretch the drawn frame over the window framebuffer,
+	// which is left bound
+	void Present();
+};
\ No newline at end of file
@@ -0,0 +1,620 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.cpp
+// ============
+// bounding volume hierarchy over the bounds of the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneBVH.h"
+
+#include <cfloat>
+
+// declaration of the global variables and defines
+namespace
+{
+	// number of bins the object centers are sorted into
+	// when searching for the best split of a node
+	const int g_SplitBins = 12;
+	// leaves are never split below this number of objects
+	const int g_MinLeafObjects = 2;
+	// deepest tree that is built; the traversal stacks hold
+	// one entry per level plus the root
+	const int g_MaxTreeDepth = 64;
+	// the tree is built again once refitting has made its
+	// surface area cost this much worse than after building
+	const float g_RebuildCostRatio = 1.5f;
+
+	// bounds of the objects falling into one split bin
+	struct SPLIT_BIN
+	{
+		BoundingVolumes::BOUNDING_BOX bounds;
+		int objectCount;
+	};
+
+	// box that is grown by merging, holding nothing yet
+	BoundingVolumes::BOUNDING_BOX EmptyBox()
+	{
+		BoundingVolumes::BOUNDING_BOX box;
+		box.minPoint = glm::vec3(FLT_MAX);
+		box.maxPoint = glm::vec3(-FLT_MAX);
+		return(box);
+	}
+
+	// bounds of a node as a box
+	BoundingVolumes::BOUNDING_BOX NodeBox(const SceneBVH::BVH_NODE& node)
+	{
+		BoundingVolumes::BOUNDING_BOX box;
+		box.minPoint = node.minPoint;
+		box.maxPoint = node.maxPoint;
+		return(box);
+	}
+}
+
+/***********************************************************
+ *  SceneBVH()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneBVH::SceneBVH()
+{
+	m_buildCost = 0.0f;
+	m_currentCost = 0.0f;
+}
+
+/***********************************************************
+ *  ~SceneBVH()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneBVH::~SceneBVH()
+{
+	m_nodes.clear();
+	m_objectIndices.clear();
+	m_objectBounds.clear();
+	m_objectCenters.clear();
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for building the tree over the
+ *  passed in world bounds of the scene objects, replacing
+ *  any tree that was built before.  Nodes are split from
+ *  the root down, and a tree over n objects never needs
+ *  more than 2n - 1 nodes, so the node array is reserved
+ *  once up front.
+ ***********************************************************/
+void SceneBVH::Build(const std::vector<BoundingVolumes::BOUNDING_BOX>& objectBounds)
+{
+	int objectCount = (int)objectBounds.size();
+
+	m_nodes.clear();
+	m_objectIndices.resize(objectCount);
+	m_objectBounds = objectBounds;
+	m_objectCenters.resize(objectCount);
+	m_buildCost = 0.0f;
+	m_currentCost = 0.0f;
+
+	if (objectCount == 0)
+	{
+		return;
+	}
+
+	for (int i = 0; i < objectCount; i++)
+	{
+		m_objectIndices[i] = i;
+		m_objectCenters[i] = (objectBounds[i].minPoint + objectBounds[i].maxPoint) * 0.5f;
+	}
+
+	m_nodes.reserve(objectCount * 2 - 1);
+
+	BVH_NODE root;
+	root.leftOrFirst = 0;
+	root.objectCount = objectCount;
+	m_nodes.push_back(root);
+	UpdateLeafBounds(0);
+
+	// split the nodes from the root down; children are always
+	// appended behind their parent, so a refit can walk the
+	// node array backwards
+	std::vector<int> pendingNodes;
+	std::vector<int> pendingDepths;
+	pendingNodes.push_back(0);
+	pendingDepths.push_back(0);
+	while (pendingNodes.empty() == false)
+	{
+		int nodeIndex = pendingNodes.back();
+		int depth = pendingDepths.back();
+		pendingNodes.pop_back();
+		pendingDepths.pop_back();
+
+		if (depth >= g_MaxTreeDepth - 1)
+		{
+			continue;
+		}
+
+		SubdivideNode(nodeIndex);
+		if (m_nodes[nodeIndex].objectCount == 0)
+		{
+			pendingNodes.push_back(m_nodes[nodeIndex].leftOrFirst);
+			pendingNodes.push_back(m_nodes[nodeIndex].leftOrFirst + 1);
+			pendingDepths.push_back(depth + 1);
+			pendingDepths.push_back(depth + 1);
+		}
+	}
+
+	// the cost of the fresh tree is measured by a refit, which
+	// leaves the bounds as they are
+	Refit(objectBounds);
+	m_buildCost = m_currentCost;
+}
+
+/***********************************************************
+ *  UpdateLeafBounds()
+ *
+ *  This method is used for growing the bounds of a node
+ *  around the objects in its range.
+ ***********************************************************/
+void SceneBVH::UpdateLeafBounds(int nodeIndex)
+{
+	BVH_NODE& node = m_nodes[nodeIndex];
+	BoundingVolumes::BOUNDING_BOX bounds = EmptyBox();
+
+	for (int i = 0; i < node.objectCount; i++)
+	{
+		bounds = BoundingVolumes::MergeBoxes(
+			bounds,
+			m_objectBounds[m_objectIndices[node.leftOrFirst + i]]);
+	}
+
+	node.minPoint = bounds.minPoint;
+	node.maxPoint = bounds.maxPoint;
+}
+
+/***********************************************************
+ *  SubdivideNode()
+ *
+ *  This method is used for splitting a node into two
+ *  children with the surface area heuristic.  The object
+ *  centers are sorted into bins along each axis, and the
+ *  bin boundary with the lowest sum of area times object
+ *  count for both sides is chosen.  The node stays a leaf
+ *  when no split is cheaper than keeping all of its
+ *  objects together.
+ ***********************************************************/
+void SceneBVH::SubdivideNode(int nodeIndex)
+{
+	int first = m_nodes[nodeIndex].leftOrFirst;
+	int count = m_nodes[nodeIndex].objectCount;
+
+	if (count <= g_MinLeafObjects)
+	{
+		return;
+	}
+
+	// the bins span the bounds of the object centers, which
+	// can be much smaller than the bounds of the node
+	glm::vec3 centerMin(FLT_MAX);
+	glm::vec3 centerMax(-FLT_MAX);
+	for (int i = 0; i < count; i++)
+	{
+		const glm::vec3& center = m_objectCenters[m_objectIndices[first + i]];
+		centerMin = glm::min(centerMin, center);
+		centerMax = glm::max(centerMax, center);
+	}
+
+	float bestCost = count * BoundingVolumes::GetSurfaceArea(NodeBox(m_nodes[nodeIndex]));
+	int bestAxis = -1;
+	int bestSplit = 0;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		float extent = centerMax[axis] - centerMin[axis];
+		if (extent <= 0.0f)
+		{
+			continue;
+		}
+
+		SPLIT_BIN bins[g_SplitBins];
+		for (int b = 0; b < g_SplitBins; b++)
+		{
+			bins[b].bounds = EmptyBox();
+			bins[b].objectCount = 0;
+		}
+
+		float binScale = g_SplitBins / extent;
+		for (int i = 0; i < count; i++)
+		{
+			int objectIndex = m_objectIndices[first + i];
+			int b = (int)((m_objectCenters[objectIndex][axis] - centerMin[axis]) * binScale);
+			if (b >= g_SplitBins)
+			{
+				b = g_SplitBins - 1;
+			}
+			bins[b].bounds = BoundingVolumes::MergeBoxes(bins[b].bounds, m_objectBounds[objectIndex]);
+			bins[b].objectCount++;
+		}
+
+		// sweep from both ends, so every split is priced in
+		// one pass; split s puts bins 0..s on the left
+		float leftArea[g_SplitBins - 1];
+		int leftCount[g_SplitBins - 1];
+		float rightArea[g_SplitBins - 1];
+		int rightCount[g_SplitBins - 1];
+
+		BoundingVolumes::BOUNDING_BOX leftBox = EmptyBox();
+		BoundingVolumes::BOUNDING_BOX rightBox = EmptyBox();
+		int leftSum = 0;
+		int rightSum = 0;
+		for (int s = 0; s < g_SplitBins - 1; s++)
+		{
+			leftSum += bins[s].objectCount;
+			leftBox = BoundingVolumes::MergeBoxes(leftBox, bins[s].bounds);
+			leftCount[s] = leftSum;
+			leftArea[s] = BoundingVolumes::GetSurfaceArea(leftBox);
+
+			int r = g_SplitBins - 1 - s;
+			rightSum += bins[r].objectCount;
+			rightBox = BoundingVolumes::MergeBoxes(rightBox, bins[r].bounds);
+			rightCount[r - 1] = rightSum;
+			rightArea[r - 1] = BoundingVolumes::GetSurfaceArea(rightBox);
+		}
+
+		for (int s = 0; s < g_SplitBins - 1; s++)
+		{
+			if ((leftCount[s] == 0) || (rightCount[s] == 0))
+			{
+				continue;
+			}
+
+			float cost = leftCount[s] * leftArea[s] + rightCount[s] * rightArea[s];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestSplit = s;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+	{
+		return;
+	}
+
+	// partition the object range so that the objects in the
+	// bins left of the split come first
+	float binScale = g_SplitBins / (centerMax[bestAxis] - centerMin[bestAxis]);
+	int i = first;
+	int j = first + count - 1;
+	while (i <= j)
+	{
+		int b = (int)((m_objectCenters[m_objectIndices[i]][bestAxis] - centerMin[bestAxis]) * binScale);
+		if (b <= bestSplit)
+		{
+			i++;
+		}
+		else
+		{
+			int swapped = m_objectIndices[i];
+			m_objectIndices[i] = m_objectIndices[j];
+			m_objectIndices[j] = swapped;
+			j--;
+		}
+	}
+
+	int leftObjects = i - first;
+	if ((leftObjects == 0) || (leftObjects == count))
+	{
+		return;
+	}
+
+	int leftIndex = (int)m_nodes.size();
+
+	BVH_NODE leftNode;
+	leftNode.leftOrFirst = first;
+	leftNode.objectCount = leftObjects;
+	m_nodes.push_back(leftNode);
+
+	BVH_NODE rightNode;
+	rightNode.leftOrFirst = i;
+	rightNode.objectCount = count - leftObjects;
+	m_nodes.push_back(rightNode);
+
+	m_nodes[nodeIndex].leftOrFirst = leftIndex;
+	m_nodes[nodeIndex].objectCount = 0;
+
+	UpdateLeafBounds(leftIndex);
+	UpdateLeafBounds(leftIndex + 1);
+}
+
+/***********************************************************
+ *  Refit()
+ *
+ *  This method is used for updating the node bounds after
+ *  objects have moved, keeping the structure of the tree.
+ *  Children are always stored behind their parent, so
+ *  walking the nodes backwards updates every child before
+ *  its parent.  The surface area cost of the refitted tree
+ *  is summed up on the way.
+ ***********************************************************/
+void SceneBVH::Refit(const std::vector<BoundingVolumes::BOUNDING_BOX>& objectBounds)
+{
+	if (objectBounds.size() != m_objectBounds.size())
+	{
+		return;
+	}
+
+	m_objectBounds = objectBounds;
+	UpdateLeafStreams();
+	m_currentCost = 0.0f;
+
+	for (int nodeIndex = (int)m_nodes.size() - 1; nodeIndex >= 0; nodeIndex--)
+	{
+		BVH_NODE& node = m_nodes[nodeIndex];
+		if (node.objectCount > 0)
+		{
+			UpdateLeafBounds(nodeIndex);
+			m_currentCost += node.objectCount * BoundingVolumes::GetSurfaceArea(NodeBox(node));
+		}
+		else
+		{
+			BoundingVolumes::BOUNDING_BOX bounds = BoundingVolumes::MergeBoxes(
+				NodeBox(m_nodes[node.leftOrFirst]),
+				NodeBox(m_nodes[node.leftOrFirst + 1]));
+			node.minPoint = bounds.minPoint;
+			node.maxPoint = bounds.maxPoint;
+			m_currentCost += BoundingVolumes::GetSurfaceArea(bounds);
+		}
+	}
+}
+
+/***********************************************************
+ *  UpdateLeafStreams()
+ *
+ *  This method is used for copying the object bounds into
+ *  streams in the order of the object indices, where the
+ *  objects of every leaf are next to each other.
+ ***********************************************************/
+void SceneBVH::UpdateLeafStreams()
+{
+	TransformKernels::ResizeBoxes(m_leafBounds, (int)m_objectIndices.size());
+	for (int i = 0; i < m_objectIndices.size(); i++)
+	{
+		TransformKernels::SetBox(m_leafBounds, i, m_objectBounds[m_objectIndices[i]]);
+	}
+}
+
+/***********************************************************
+ *  NeedsRebuild()
+ *
+ *  This method is used for checking whether refitting has
+ *  made the tree so much worse than a fresh build that it
+ *  should be built again.
+ ***********************************************************/
+bool SceneBVH::NeedsRebuild() const
+{
+	return(m_currentCost > m_buildCost * g_RebuildCostRatio);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects
+ *  the tree was built over.
+ ***********************************************************/
+int SceneBVH::GetObjectCount() const
+{
+	return((int)m_objectBounds.size());
+}
+
+/***********************************************************
+ *  GetNodeCount()
+ *
+ *  This method is used for getting the number of nodes in
+ *  the tree.
+ ***********************************************************/
+int SceneBVH::GetNodeCount() const
+{
+	return((int)m_nodes.size());
+}
+
+/***********************************************************
+ *  QueryFrustum()
+ *
+ *  This method is used for gathering the objects whose
+ *  bounds are at least partly inside the frustum.  Nodes
+ *  outside the frustum are skipped with all of their
+ *  objects, and the objects of a leaf are tested together
+ *  by the culling kernels.  The gathered objects are not in
+ *  draw order.
+ ***********************************************************/
+void SceneBVH::QueryFrustum(
+	const BoundingVolumes::FRUSTUM& frustum,
+	std::vector<int>& objects) const
+{
+	objects.clear();
+	if (m_nodes.empty() == true)
+	{
+		return;
+	}
+
+	int stack[g_MaxTreeDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--stackSize]];
+		if (BoundingVolumes::IsBoxVisible(frustum, NodeBox(node)) == false)
+		{
+			continue;
+		}
+
+		if (node.objectCount == 1)
+		{
+			// the bounds of the node are the bounds of the object
+			objects.push_back(m_objectIndices[node.leftOrFirst]);
+		}
+		else if (node.objectCount > 0)
+		{
+			TransformKernels::CullBoxes(
+				frustum,
+				m_leafBounds,
+				node.leftOrFirst,
+				node.leftOrFirst + node.objectCount,
+				m_objectIndices.data(),
+				objects);
+		}
+		else
+		{
+			stack[stackSize++] = node.leftOrFirst;
+			stack[stackSize++] = node.leftOrFirst + 1;
+		}
+	}
+}
+
+/***********************************************************
+ *  Raycast()
+ *
+ *  This method is used for finding the object whose bounds
+ *  are hit first by a ray.  The nearer child is visited
+ *  first, and nodes entered beyond the closest hit so far
+ *  are skipped.  The index of the object is returned, or
+ *  -1 when the ray misses all of them.
+ ***********************************************************/
+int SceneBVH::Raycast(
+	const glm::vec3& origin,
+	const glm::vec3& direction,
+	float& hitDistance) const
+{
+	int hitObject = -1;
+	hitDistance = FLT_MAX;
+
+	if (m_nodes.empty() == true)
+	{
+		return(hitObject);
+	}
+
+	glm::vec3 inverseDirection(
+		1.0f / direction.x,
+		1.0f / direction.y,
+		1.0f / direction.z);
+
+	int stack[g_MaxTreeDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--stackSize]];
+
+		float nodeDistance = 0.0f;
+		if (BoundingVolumes::IntersectRay(NodeBox(node), origin, inverseDirection, hitDistance, nodeDistance) == false)
+		{
+			continue;
+		}
+
+		if (node.objectCount > 0)
+		{
+			for (int i = 0; i < node.objectCount; i++)
+			{
+				int objectIndex = m_objectIndices[node.leftOrFirst + i];
+				float objectDistance = 0.0f;
+				if ((BoundingVolumes::IntersectRay(m_objectBounds[objectIndex], origin, inverseDirection, hitDistance, objectDistance) == true) &&
+					(objectDistance < hitDistance))
+				{
+					hitDistance = objectDistance;
+					hitObject = objectIndex;
+				}
+			}
+		}
+		else
+		{
+			int nearChild = node.leftOrFirst;
+			int farChild = node.leftOrFirst + 1;
+
+			float nearDistance = FLT_MAX;
+			float farDistance = FLT_MAX;
+			BoundingVolumes::IntersectRay(NodeBox(m_nodes[nearChild]), origin, inverseDirection, hitDistance, nearDistance);
+			BoundingVolumes::IntersectRay(NodeBox(m_nodes[farChild]), origin, inverseDirection, hitDistance, farDistance);
+			if (farDistance < nearDistance)
+			{
+				int swapped = nearChild;
+				nearChild = farChild;
+				farChild = swapped;
+			}
+
+			// the near child is popped first
+			stack[stackSize++] = farChild;
+			stack[stackSize++] = nearChild;
+		}
+	}
+
+	return(hitObject);
+}
+
+/***********************************************************
+ *  FindNearest()
+ *
+ *  This method is used for finding the object whose bounds
+ *  are nearest to a point.  Nodes further away than the
+ *  nearest object found so far are skipped.  The index of
+ *  the object is returned, or -1 when the tree is empty.
+ ***********************************************************/
+int SceneBVH::FindNearest(
+	const glm::vec3& point,
+	float& nearestDistance) const
+{
+	int nearestObject = -1;
+	nearestDistance = FLT_MAX;
+
+	if (m_nodes.empty() == true)
+	{
+		return(nearestObject);
+	}
+
+	int stack[g_MaxTreeDepth + 1];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0)
+	{
+		const BVH_NODE& node = m_nodes[stack[--stackSize]];
+		if (BoundingVolumes::GetDistance(NodeBox(node), point) >= nearestDistance)
+		{
+			continue;
+		}
+
+		if (node.objectCount > 0)
+		{
+			for (int i = 0; i < node.objectCount; i++)
+			{
+				int objectIndex = m_objectIndices[node.leftOrFirst + i];
+				float distance = BoundingVolumes::GetDistance(m_objectBounds[objectIndex], point);
+				if (distance < nearestDistance)
+				{
+					nearestDistance = distance;
+					nearestObject = objectIndex;
+				}
+			}
+		}
+		else
+		{
+			int nearChild = node.leftOrFirst;
+			int farChild = node.leftOrFirst + 1;
+			if (BoundingVolumes::GetDistance(NodeBox(m_nodes[farChild]), point) <
+				BoundingVolumes::GetDistance(NodeBox(m_nodes[nearChild]), point))
+			{
+				int swapped = nearChild;
+				nearChild = farChild;
+				farChild = swapped;
+			}
+
+			stack[stackSize++] = farChild;
+			stack[stackSize++] = nearChild;
+		}
+	}
+
+	return(nearestObject);
+}
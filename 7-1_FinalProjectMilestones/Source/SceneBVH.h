@@ -0,0 +1,102 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenebvh.h
+// ============
+// bounding volume hierarchy over the bounds of the scene objects
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+#include "TransformKernels.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  SceneBVH
+ *
+ *  This class contains a bounding volume hierarchy over the
+ *  world bounds of the scene objects, used for culling the
+ *  scene against the view frustum, picking objects with a
+ *  ray and finding the object nearest to a point.  The tree
+ *  is built with the surface area heuristic and stored as a
+ *  flat array of nodes, where the two children of a node
+ *  are always next to each other.  Moving objects only
+ *  refit the node bounds; the tree is built again once
+ *  refitting has made it noticeably worse.
+ ***********************************************************/
+class SceneBVH
+{
+public:
+	// constructor
+	SceneBVH();
+	// destructor
+	~SceneBVH();
+
+	// one node of the tree, 32 bytes so that two nodes share
+	// a cache line; leaves have a non-zero object count
+	struct BVH_NODE
+	{
+		glm::vec3 minPoint;
+		// first child for inner nodes, first object for leaves
+		int leftOrFirst;
+		glm::vec3 maxPoint;
+		// number of objects in a leaf, zero for inner nodes
+		int objectCount;
+	};
+
+private:
+	// flat array of nodes, with the root at index zero
+	std::vector<BVH_NODE> m_nodes;
+	// object indices ordered so that each leaf is a range
+	std::vector<int> m_objectIndices;
+	// world bounds of the objects, indexed by object
+	std::vector<BoundingVolumes::BOUNDING_BOX> m_objectBounds;
+	// the same bounds in the order of the object indices, so
+	// that the objects of a leaf are culled together
+	TransformKernels::BOX_STREAMS m_leafBounds;
+	// centers of the object bounds, used while building
+	std::vector<glm::vec3> m_objectCenters;
+	// surface area cost of the tree when it was last built
+	float m_buildCost;
+	// surface area cost of the tree after the last refit
+	float m_currentCost;
+
+	// split a node into two children, or leave it as a leaf
+	void SubdivideNode(int nodeIndex);
+	// grow the bounds of a node around its objects
+	void UpdateLeafBounds(int nodeIndex);
+	// copy the object bounds into the order of the leaves
+	void UpdateLeafStreams();
+
+public:
+	// build the tree over the passed in object bounds
+	void Build(const std::vector<BoundingVolumes::BOUNDING_BOX>& objectBounds);
+	// update the node bounds for moved objects
+	void Refit(const std::vector<BoundingVolumes::BOUNDING_BOX>& objectBounds);
+	// true when refitting has made the tree worse enough
+	// that it should be built again
+	bool NeedsRebuild() const;
+	// number of objects the tree was built over
+	int GetObjectCount() const;
+	// number of nodes in the tree
+	int GetNodeCount() const;
+
+	// gather the objects whose bounds are in the frustum
+	void QueryFrustum(
+		const BoundingVolumes::FRUSTUM& frustum,
+		std::vector<int>& objects) const;
+
+	// find the nearest object whose bounds are hit by a ray
+	int Raycast(
+		const glm::vec3& origin,
+		const glm::vec3& direction,
+		float& hitDistance) const;
+
+	// find the object whose bounds are nearest to a point
+	int FindNearest(
+		const glm::vec3& point,
+		float& nearestDistance) const;
+};
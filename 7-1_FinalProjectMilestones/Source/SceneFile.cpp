@@ -0,0 +1,743 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.cpp
+// ============
+// read scene descriptions and load their compiled form by memory mapping
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneFile.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+// declaration of global variables
+namespace
+{
+	// file identifier and layout version of compiled scenes;
+	// a compiled file of another version is compiled again
+	const char g_SceneMagic[4] = { 'S', 'C', 'N', 'B' };
+	const uint32_t g_SceneVersion = 2;
+
+	// names of the basic meshes in SceneManager::MESH_KIND order
+	const char* g_MeshNames[] =
+	{
+		"plane",
+		"box",
+		"cylinder",
+		"cone",
+		"prism",
+		"sphere",
+		"pyramid4"
+	};
+	const int g_MeshCount = sizeof(g_MeshNames) / sizeof(g_MeshNames[0]);
+
+	// texture name of objects that are drawn without a texture
+	const char* g_NoTexture = "-";
+
+	/*******************************************************
+	 *  FileTime()
+	 *
+	 *  Modification time of a file, or -1 when it is missing.
+	 *******************************************************/
+	long long FileTime(const std::string& filename)
+	{
+		struct stat fileInfo;
+		if (stat(filename.c_str(), &fileInfo) != 0)
+		{
+			return(-1);
+		}
+		return((long long)fileInfo.st_mtime);
+	}
+
+	/*******************************************************
+	 *  ReadFloats()
+	 *
+	 *  Read a number of values from a line of the source.
+	 *******************************************************/
+	bool ReadFloats(std::istringstream& line, float* values, int count)
+	{
+		for (int i = 0; i < count; i++)
+		{
+			if (!(line >> values[i]))
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+
+	/*******************************************************
+	 *  CopyName()
+	 *
+	 *  Copy a tag or path into a fixed size record field,
+	 *  failing when it does not fit.
+	 *******************************************************/
+	bool CopyName(const std::string& name, char* field, int fieldLength)
+	{
+		if (name.size() >= (size_t)fieldLength)
+		{
+			return(false);
+		}
+		memset(field, 0, fieldLength);
+		memcpy(field, name.c_str(), name.size());
+		return(true);
+	}
+
+	/*******************************************************
+	 *  IsTableInside()
+	 *
+	 *  Check that a record table lies inside the scene data.
+	 *******************************************************/
+	bool IsTableInside(uint32_t offset, uint32_t count, size_t recordSize, size_t dataSize)
+	{
+		if ((offset % 4) != 0)
+		{
+			return(false);
+		}
+		unsigned long long end = (unsigned long long)offset + (unsigned long long)count * recordSize;
+		return(end <= (unsigned long long)dataSize);
+	}
+}
+
+/***********************************************************
+ *  SceneFile()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneFile::SceneFile()
+{
+	m_pData = NULL;
+	m_dataSize = 0;
+	m_pMapping = NULL;
+#ifdef _WIN32
+	m_fileHandle = NULL;
+	m_mappingHandle = NULL;
+#endif
+}
+
+/***********************************************************
+ *  ~SceneFile()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneFile::~SceneFile()
+{
+	Close();
+}
+
+/***********************************************************
+ *  Load()
+ *
+ *  This method is used for opening a scene by its source
+ *  file.  The compiled file is mapped when it is newer than
+ *  the source; otherwise the source is parsed and
+ *  compiled, so that the next run can skip the parsing.  A
+ *  compiled file without its source is loaded as well.
+ ***********************************************************/
+bool SceneFile::Load(const std::string& sourcePath, const std::string& binaryPath)
+{
+	long long sourceTime = FileTime(sourcePath);
+	long long binaryTime = FileTime(binaryPath);
+
+	// file times have a resolution of a second, so a compiled
+	// file from the same second as the source is not trusted
+	if ((binaryTime >= 0) && (binaryTime > sourceTime))
+	{
+		if (Open(binaryPath) == true)
+		{
+			return(true);
+		}
+	}
+
+	if (Parse(sourcePath) == false)
+	{
+		return(false);
+	}
+
+	if (Compile(binaryPath) == false)
+	{
+		std::cout << "Could not write compiled scene file:" << binaryPath << std::endl;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Open()
+ *
+ *  This method is used for mapping a compiled scene file
+ *  into memory.  The records are read in place from the
+ *  mapping, so opening a scene only costs the check of its
+ *  header and tables.
+ ***********************************************************/
+bool SceneFile::Open(const std::string& binaryPath)
+{
+	Close();
+
+	size_t fileSize = 0;
+	void* pMapping = NULL;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(
+		binaryPath.c_str(),
+		GENERIC_READ,
+		FILE_SHARE_READ,
+		NULL,
+		OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL,
+		NULL);
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return(false);
+	}
+
+	LARGE_INTEGER size;
+	if ((GetFileSizeEx(file, &size) == FALSE) ||
+		(size.QuadPart < (LONGLONG)sizeof(FILE_HEADER)))
+	{
+		CloseHandle(file);
+		return(false);
+	}
+	fileSize = (size_t)size.QuadPart;
+
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		CloseHandle(file);
+		return(false);
+	}
+
+	pMapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if (pMapping == NULL)
+	{
+		CloseHandle(mapping);
+		CloseHandle(file);
+		return(false);
+	}
+
+	m_fileHandle = file;
+	m_mappingHandle = mapping;
+#else
+	int file = open(binaryPath.c_str(), O_RDONLY);
+	if (file < 0)
+	{
+		return(false);
+	}
+
+	struct stat fileInfo;
+	if ((fstat(file, &fileInfo) != 0) ||
+		(fileInfo.st_size < (off_t)sizeof(FILE_HEADER)))
+	{
+		close(file);
+		return(false);
+	}
+	fileSize = (size_t)fileInfo.st_size;
+
+	pMapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, file, 0);
+	// the mapping stays valid after the file is closed
+	close(file);
+	if (pMapping == MAP_FAILED)
+	{
+		return(false);
+	}
+#endif
+
+	m_pMapping = pMapping;
+	m_pData = (const char*)pMapping;
+	m_dataSize = fileSize;
+
+	if (Validate(m_pData, m_dataSize, binaryPath) == false)
+	{
+		Close();
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  Parse()
+ *
+ *  This method is used for reading a scene source file.
+ *  Every line holds one texture, material, light or object,
+ *  and objects refer to the textures and materials defined
+ *  above them by tag.  The records are laid out exactly
+ *  like a compiled file, so that Compile() can write them
+ *  out as they are.
+ ***********************************************************/
+bool SceneFile::Parse(const std::string& sourcePath)
+{
+	Close();
+
+	std::ifstream file(sourcePath.c_str());
+	if (!file)
+	{
+		std::cout << "Could not open scene file:" << sourcePath << std::endl;
+		return(false);
+	}
+
+	std::vector<TEXTURE_RECORD> textures;
+	std::vector<MATERIAL_RECORD> materials;
+	std::vector<LIGHT_RECORD> lights;
+	std::vector<OBJECT_RECORD> objects;
+	std::unordered_map<std::string, int> textureLookup;
+	std::unordered_map<std::string, int> materialLookup;
+
+	std::string text;
+	int lineNumber = 0;
+	while (std::getline(file, text))
+	{
+		lineNumber++;
+
+		// comments run to the end of the line
+		size_t comment = text.find('#');
+		if (comment != std::string::npos)
+		{
+			text.erase(comment);
+		}
+
+		std::istringstream line(text);
+		std::string keyword;
+		if (!(line >> keyword))
+		{
+			continue;
+		}
+
+		bool bValid = true;
+		std::string error = "malformed line";
+		if (keyword == "texture")
+		{
+			std::string tag, path;
+			TEXTURE_RECORD texture;
+			bValid = (line >> tag >> path) &&
+				(CopyName(tag, texture.tag, MAX_TAG_LENGTH) == true) &&
+				(CopyName(path, texture.path, MAX_PATH_LENGTH) == true);
+			if ((bValid == true) && (textureLookup.count(tag) > 0))
+			{
+				bValid = false;
+				error = "texture defined twice: " + tag;
+			}
+			if (bValid == true)
+			{
+				textureLookup[tag] = (int)textures.size();
+				textures.push_back(texture);
+			}
+		}
+		else if (keyword == "material")
+		{
+			std::string tag;
+			MATERIAL_RECORD material;
+			bValid = (line >> tag) &&
+				(CopyName(tag, material.tag, MAX_TAG_LENGTH) == true) &&
+				(ReadFloats(line, material.ambientColor, 3) == true) &&
+				(ReadFloats(line, &material.ambientStrength, 1) == true) &&
+				(ReadFloats(line, material.diffuseColor, 3) == true) &&
+				(ReadFloats(line, material.specularColor, 3) == true) &&
+				(ReadFloats(line, &material.shininess, 1) == true);
+			if ((bValid == true) && (materialLookup.count(tag) > 0))
+			{
+				bValid = false;
+				error = "material defined twice: " + tag;
+			}
+			if (bValid == true)
+			{
+				materialLookup[tag] = (int)materials.size();
+				materials.push_back(material);
+			}
+		}
+		else if (keyword == "light")
+		{
+			LIGHT_RECORD light;
+			bValid =
+				(ReadFloats(line, light.position, 3) == true) &&
+				(ReadFloats(line, light.ambientColor, 3) == true) &&
+				(ReadFloats(line, light.diffuseColor, 3) == true) &&
+				(ReadFloats(line, light.specularColor, 3) == true) &&
+				(ReadFloats(line, &light.focalStrength, 1) == true) &&
+				(ReadFloats(line, &light.specularIntensity, 1) == true);
+
+			// the range is optional; lights without one reach the
+			// whole scene
+			light.range = 0.0f;
+			if ((bValid == true) && ((line >> std::ws).eof() == false))
+			{
+				bValid = ReadFloats(line, &light.range, 1);
+			}
+			if (bValid == true)
+			{
+				lights.push_back(light);
+			}
+		}
+		else if (keyword == "object")
+		{
+			std::string meshName, materialTag, textureTag;
+			OBJECT_RECORD object;
+			bValid = (line >> meshName) &&
+				(ReadFloats(line, object.scaleXYZ, 3) == true) &&
+				(ReadFloats(line, object.rotationDegrees, 3) == true) &&
+				(ReadFloats(line, object.positionXYZ, 3) == true) &&
+				(line >> materialTag >> textureTag) &&
+				(ReadFloats(line, object.UVscale, 2) == true);
+
+			if (bValid == true)
+			{
+				object.mesh = -1;
+				for (int i = 0; i < g_MeshCount; i++)
+				{
+					if (meshName == g_MeshNames[i])
+					{
+						object.mesh = i;
+					}
+				}
+
+				object.materialIndex = -1;
+				std::unordered_map<std::string, int>::const_iterator material = materialLookup.find(materialTag);
+				if (material != materialLookup.end())
+				{
+					object.materialIndex = material->second;
+				}
+
+				object.textureIndex = -1;
+				std::unordered_map<std::string, int>::const_iterator texture = textureLookup.find(textureTag);
+				if (texture != textureLookup.end())
+				{
+					object.textureIndex = texture->second;
+				}
+
+				if (object.mesh < 0)
+				{
+					bValid = false;
+					error = "unknown mesh: " + meshName;
+				}
+				else if (object.materialIndex < 0)
+				{
+					bValid = false;
+					error = "undefined material: " + materialTag;
+				}
+				else if ((object.textureIndex < 0) && (textureTag != g_NoTexture))
+				{
+					bValid = false;
+					error = "undefined texture: " + textureTag;
+				}
+			}
+
+			if (bValid == true)
+			{
+				objects.push_back(object);
+			}
+		}
+		else
+		{
+			bValid = false;
+			error = "unknown keyword: " + keyword;
+		}
+
+		// nothing may follow the values of a line
+		std::string extra;
+		if ((bValid == true) && (line >> extra))
+		{
+			bValid = false;
+		}
+
+		if (bValid == false)
+		{
+			std::cout << sourcePath << "(" << lineNumber << "): " << error << std::endl;
+			return(false);
+		}
+	}
+
+	// lay the records out like a compiled file
+	FILE_HEADER header;
+	memcpy(header.magic, g_SceneMagic, sizeof(header.magic));
+	header.version = g_SceneVersion;
+	header.textureCount = (uint32_t)textures.size();
+	header.materialCount = (uint32_t)materials.size();
+	header.lightCount = (uint32_t)lights.size();
+	header.objectCount = (uint32_t)objects.size();
+	header.textureOffset = sizeof(FILE_HEADER);
+	header.materialOffset = header.textureOffset + header.textureCount * sizeof(TEXTURE_RECORD);
+	header.lightOffset = header.materialOffset + header.materialCount * sizeof(MATERIAL_RECORD);
+	header.objectOffset = header.lightOffset + header.lightCount * sizeof(LIGHT_RECORD);
+
+	m_image.resize(header.objectOffset + header.objectCount * sizeof(OBJECT_RECORD));
+	memcpy(&m_image[0], &header, sizeof(header));
+	if (textures.empty() == false)
+	{
+		memcpy(&m_image[header.textureOffset], &textures[0], textures.size() * sizeof(TEXTURE_RECORD));
+	}
+	if (materials.empty() == false)
+	{
+		memcpy(&m_image[header.materialOffset], &materials[0], materials.size() * sizeof(MATERIAL_RECORD));
+	}
+	if (lights.empty() == false)
+	{
+		memcpy(&m_image[header.lightOffset], &lights[0], lights.size() * sizeof(LIGHT_RECORD));
+	}
+	if (objects.empty() == false)
+	{
+		memcpy(&m_image[header.objectOffset], &objects[0], objects.size() * sizeof(OBJECT_RECORD));
+	}
+
+	m_pData = &m_image[0];
+	m_dataSize = m_image.size();
+
+	return(true);
+}
+
+/***********************************************************
+ *  Compile()
+ *
+ *  This method is used for writing the open scene to a
+ *  compiled scene file.  The file is written under a
+ *  temporary name first, so that a run that is stopped
+ *  halfway never leaves a truncated scene behind.
+ ***********************************************************/
+bool SceneFile::Compile(const std::string& binaryPath) const
+{
+	if (m_pData == NULL)
+	{
+		return(false);
+	}
+
+	std::string tempName = binaryPath + ".tmp";
+	{
+		std::ofstream file(tempName.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return(false);
+		}
+		file.write(m_pData, m_dataSize);
+		if (!file)
+		{
+			return(false);
+		}
+	}
+
+	remove(binaryPath.c_str());
+	return(rename(tempName.c_str(), binaryPath.c_str()) == 0);
+}
+
+/***********************************************************
+ *  Close()
+ *
+ *  This method is used for releasing the open scene and
+ *  its mapping.
+ ***********************************************************/
+void SceneFile::Close()
+{
+	if (m_pMapping != NULL)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(m_pMapping);
+		CloseHandle((HANDLE)m_mappingHandle);
+		CloseHandle((HANDLE)m_fileHandle);
+		m_mappingHandle = NULL;
+		m_fileHandle = NULL;
+#else
+		munmap(m_pMapping, m_dataSize);
+#endif
+		m_pMapping = NULL;
+	}
+
+	m_image.clear();
+	m_pData = NULL;
+	m_dataSize = 0;
+}
+
+/***********************************************************
+ *  Validate()
+ *
+ *  This method is used for checking a compiled scene before
+ *  it is read in place: the header has to match, every
+ *  table has to lie inside the data, the tags have to be
+ *  terminated, and the objects may only refer to meshes and
+ *  records that exist.
+ ***********************************************************/
+bool SceneFile::Validate(const char* pData, size_t dataSize, const std::string& filename)
+{
+	const FILE_HEADER* header = (const FILE_HEADER*)pData;
+	if ((memcmp(header->magic, g_SceneMagic, sizeof(g_SceneMagic)) != 0) ||
+		(header->version != g_SceneVersion))
+	{
+		// an older layout is compiled again from the source
+		return(false);
+	}
+
+	if ((IsTableInside(header->textureOffset, header->textureCount, sizeof(TEXTURE_RECORD), dataSize) == false) ||
+		(IsTableInside(header->materialOffset, header->materialCount, sizeof(MATERIAL_RECORD), dataSize) == false) ||
+		(IsTableInside(header->lightOffset, header->lightCount, sizeof(LIGHT_RECORD), dataSize) == false) ||
+		(IsTableInside(header->objectOffset, header->objectCount, sizeof(OBJECT_RECORD), dataSize) == false))
+	{
+		std::cout << "Truncated scene file:" << filename << std::endl;
+		return(false);
+	}
+
+	const TEXTURE_RECORD* textures = (const TEXTURE_RECORD*)(pData + header->textureOffset);
+	for (uint32_t i = 0; i < header->textureCount; i++)
+	{
+		if ((textures[i].tag[MAX_TAG_LENGTH - 1] != 0) ||
+			(textures[i].path[MAX_PATH_LENGTH - 1] != 0))
+		{
+			std::cout << "Corrupt texture in scene file:" << filename << std::endl;
+			return(false);
+		}
+	}
+
+	const MATERIAL_RECORD* materials = (const MATERIAL_RECORD*)(pData + header->materialOffset);
+	for (uint32_t i = 0; i < header->materialCount; i++)
+	{
+		if (materials[i].tag[MAX_TAG_LENGTH - 1] != 0)
+		{
+			std::cout << "Corrupt material in scene file:" << filename << std::endl;
+			return(false);
+		}
+	}
+
+	const OBJECT_RECORD* objects = (const OBJECT_RECORD*)(pData + header->objectOffset);
+	for (uint32_t i = 0; i < header->objectCount; i++)
+	{
+		if ((objects[i].mesh < 0) || (objects[i].mesh >= g_MeshCount) ||
+			(objects[i].materialIndex < -1) || (objects[i].materialIndex >= (int32_t)header->materialCount) ||
+			(objects[i].textureIndex < -1) || (objects[i].textureIndex >= (int32_t)header->textureCount))
+		{
+			std::cout << "Corrupt object in scene file:" << filename << std::endl;
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetTable()
+ *
+ *  This method is used for finding a record table of the
+ *  open scene by its offset in the header.
+ ***********************************************************/
+const char* SceneFile::GetTable(uint32_t offset) const
+{
+	return(m_pData + offset);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures
+ *  of the open scene.
+ ***********************************************************/
+int SceneFile::GetTextureCount() const
+{
+	if (m_pData == NULL)
+	{
+		return(0);
+	}
+	return((int)((const FILE_HEADER*)m_pData)->textureCount);
+}
+
+/***********************************************************
+ *  GetTextureRecord()
+ *
+ *  This method is used for getting a texture of the open
+ *  scene.
+ ***********************************************************/
+const SceneFile::TEXTURE_RECORD& SceneFile::GetTextureRecord(int index) const
+{
+	const FILE_HEADER* header = (const FILE_HEADER*)m_pData;
+	return(((const TEXTURE_RECORD*)GetTable(header->textureOffset))[index]);
+}
+
+/***********************************************************
+ *  GetMaterialCount()
+ *
+ *  This method is used for getting the number of materials
+ *  of the open scene.
+ ***********************************************************/
+int SceneFile::GetMaterialCount() const
+{
+	if (m_pData == NULL)
+	{
+		return(0);
+	}
+	return((int)((const FILE_HEADER*)m_pData)->materialCount);
+}
+
+/***********************************************************
+ *  GetMaterialRecord()
+ *
+ *  This method is used for getting a material of the open
+ *  scene.
+ ***********************************************************/
+const SceneFile::MATERIAL_RECORD& SceneFile::GetMaterialRecord(int index) const
+{
+	const FILE_HEADER* header = (const FILE_HEADER*)m_pData;
+	return(((const MATERIAL_RECORD*)GetTable(header->materialOffset))[index]);
+}
+
+/***********************************************************
+ *  GetLightCount()
+ *
+ *  This method is used for getting the number of lights of
+ *  the open scene.
+ ***********************************************************/
+int SceneFile::GetLightCount() const
+{
+	if (m_pData == NULL)
+	{
+		return(0);
+	}
+	return((int)((const FILE_HEADER*)m_pData)->lightCount);
+}
+
+/***********************************************************
+ *  GetLightRecord()
+ *
+ *  This method is used for getting a light of the open
+ *  scene.
+ ***********************************************************/
+const SceneFile::LIGHT_RECORD& SceneFile::GetLightRecord(int index) const
+{
+	const FILE_HEADER* header = (const FILE_HEADER*)m_pData;
+	return(((const LIGHT_RECORD*)GetTable(header->lightOffset))[index]);
+}
+
+/***********************************************************
+ *  GetObjectCount()
+ *
+ *  This method is used for getting the number of objects
+ *  of the open scene.
+ ***********************************************************/
+int SceneFile::GetObjectCount() const
+{
+	if (m_pData == NULL)
+	{
+		return(0);
+	}
+	return((int)((const FILE_HEADER*)m_pData)->objectCount);
+}
+
+/***********************************************************
+ *  GetObjectRecord()
+ *
+ *  This method is used for getting an object of the open
+ *  scene.
+ ***********************************************************/
+const SceneFile::OBJECT_RECORD& SceneFile::GetObjectRecord(int index) const
+{
+	const FILE_HEADER* header = (const FILE_HEADER*)m_pData;
+	return(((const OBJECT_RECORD*)GetTable(header->objectOffset))[index]);
+}
\ No newline at end of file
@@ -0,0 +1,140 @@
+///////////////////////////////////////////////////////////////////////////////
+// scenefile.h
+// ============
+// read scene descriptions and load their compiled form by memory mapping
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  SceneFile
+ *
+ *  This class contains the code for scene description
+ *  files.  The source form is a text file with one texture,
+ *  material, light or object per line.  It is compiled into
+ *  a binary file of fixed size records, which later runs
+ *  map into memory and read in place without any parsing.
+ *  A parsed source file is held in the same binary layout,
+ *  so both forms are read through the same accessors.
+ ***********************************************************/
+class SceneFile
+{
+public:
+	// constructor
+	SceneFile();
+	// destructor
+	~SceneFile();
+
+	// maximum lengths of the tags and paths, including the
+	// terminating zero
+	static const int MAX_TAG_LENGTH = 32;
+	static const int MAX_PATH_LENGTH = 256;
+
+	// layout of the compiled file; the record tables follow
+	// the header at the recorded offsets
+	struct FILE_HEADER
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t textureCount;
+		uint32_t materialCount;
+		uint32_t lightCount;
+		uint32_t objectCount;
+		uint32_t textureOffset;
+		uint32_t materialOffset;
+		uint32_t lightOffset;
+		uint32_t objectOffset;
+	};
+
+	// image file a texture is loaded from
+	struct TEXTURE_RECORD
+	{
+		char tag[MAX_TAG_LENGTH];
+		char path[MAX_PATH_LENGTH];
+	};
+
+	// values of one OBJECT_MATERIAL
+	struct MATERIAL_RECORD
+	{
+		char tag[MAX_TAG_LENGTH];
+		float ambientColor[3];
+		float ambientStrength;
+		float diffuseColor[3];
+		float specularColor[3];
+		float shininess;
+	};
+
+	// values of one light source
+	struct LIGHT_RECORD
+	{
+		float position[3];
+		float ambientColor[3];
+		float diffuseColor[3];
+		float specularColor[3];
+		float focalStrength;
+		float specularIntensity;
+		// 0 when the line leaves the optional range out
+		float range;
+	};
+
+	// placement of one scene object; the material and texture
+	// are indices into the tables of this file, or -1
+	struct OBJECT_RECORD
+	{
+		int32_t mesh;
+		int32_t materialIndex;
+		int32_t textureIndex;
+		float scaleXYZ[3];
+		float rotationDegrees[3];
+		float positionXYZ[3];
+		float UVscale[2];
+	};
+
+private:
+	// start and size of the compiled scene, either mapped
+	// from a file or held in m_image
+	const char* m_pData;
+	size_t m_dataSize;
+	// compiled scene built from a parsed source file
+	std::vector<char> m_image;
+	// mapping of the compiled file, when one is open
+	void* m_pMapping;
+#ifdef _WIN32
+	void* m_fileHandle;
+	void* m_mappingHandle;
+#endif
+
+	// check the header and record tables of the scene data
+	bool Validate(const char* pData, size_t dataSize, const std::string& filename);
+	// record table of the scene data at a header offset
+	const char* GetTable(uint32_t offset) const;
+
+public:
+	// open a scene by its source file, loading the compiled
+	// file when it is newer and compiling it otherwise
+	bool Load(const std::string& sourcePath, const std::string& binaryPath);
+	// map a compiled scene file into memory
+	bool Open(const std::string& binaryPath);
+	// read a scene source file into the compiled layout
+	bool Parse(const std::string& sourcePath);
+	// write the open scene to a compiled scene file
+	bool Compile(const std::string& binaryPath) const;
+	// release the open scene
+	void Close();
+
+	// records of the open scene
+	int GetTextureCount() const;
+	const TEXTURE_RECORD& GetTextureRecord(int index) const;
+	int GetMaterialCount() const;
+	const MATERIAL_RECORD& GetMaterialRecord(int index) const;
+	int GetLightCount() const;
+	const LIGHT_RECORD& GetLightRecord(int index) const;
+	int GetObjectCount() const;
+	const OBJECT_RECORD& GetObjectRecord(int index) const;
+};
\ No newline at end of file
@@ -1,821 +1,2859 @@
-///////////////////////////////////////////////////////////////////////////////
-// shadermanager.cpp
-// ============
-// manage the loading and rendering of 3D scenes
-//
-///////////////////////////////////////////////////////////////////////////////
-
-#include "SceneManager.h"
-
-#ifndef STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
-#endif
-
-#include <glm/gtx/transform.hpp>
-
-// declaration of global variables
-namespace
-{
-	const char* g_ModelName = "model";
-	const char* g_ColorValueName = "objectColor";
-	const char* g_TextureValueName = "objectTexture";
-	const char* g_UseTextureName = "bUseTexture";
-	const char* g_UseLightingName = "bUseLighting";
-}
-
-/***********************************************************
- *  SceneManager()
- *
- *  The constructor for the class
- ***********************************************************/
-SceneManager::SceneManager(ShaderManager *pShaderManager)
-{
-	m_pShaderManager = pShaderManager;
-	m_basicMeshes = new ShapeMeshes();
-
-	m_loadedTextures = 0;
-}
-
-/***********************************************************
- *  ~SceneManager()
- *
- *  The destructor for the class
- ***********************************************************/
-SceneManager::~SceneManager()
-{
-	m_pShaderManager = NULL;
-	delete m_basicMeshes;
-	m_basicMeshes = NULL;
-}
-
-/***********************************************************
- *  CreateGLTexture()
- *
- *  This method is used for loading textures from image files,
- *  configuring the texture mapping parameters in OpenGL,
- *  generating the mipmaps, and loading the read texture into
- *  the next available texture slot in memory.
- ***********************************************************/
-bool SceneManager::CreateGLTexture(const char* filename, std::string tag)
-{
-	int width = 0;
-	int height = 0;
-	int colorChannels = 0;
-	GLuint textureID = 0;
-
-	// indicate to always flip images vertically when loaded
-	stbi_set_flip_vertically_on_load(true);
-
-	// try to parse the image data from the specified image file
-	unsigned char* image = stbi_load(
-		filename,
-		&width,
-		&height,
-		&colorChannels,
-		0);
-
-	// if the image was successfully read from the image file
-	if (image)
-	{
-		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
-
-		glGenTextures(1, &textureID);
-		glBindTexture(GL_TEXTURE_2D, textureID);
-
-		// set the texture wrapping parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		// set texture filtering parameters
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-		// if the loaded image is in RGB format
-		if (colorChannels == 3)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, image);
-		// if the loaded image is in RGBA format - it supports transparency
-		else if (colorChannels == 4)
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image);
-		else
-		{
-			std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
-			return false;
-		}
-
-		// generate the texture mipmaps for mapping textures to lower resolutions
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		// free the image data from local memory
-		stbi_image_free(image);
-		glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
-
-		// register the loaded texture and associate it with the special tag string
-		m_textureIDs[m_loadedTextures].ID = textureID;
-		m_textureIDs[m_loadedTextures].tag = tag;
-		m_loadedTextures++;
-
-		return true;
-	}
-
-	std::cout << "Could not load image:" << filename << std::endl;
-
-	// Error loading the image
-	return false;
-}
-
-/***********************************************************
- *  BindGLTextures()
- *
- *  This method is used for binding the loaded textures to
- *  OpenGL texture memory slots.  There are up to 16 slots.
- ***********************************************************/
-void SceneManager::BindGLTextures()
-{
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		// bind textures on corresponding texture units
-		glActiveTexture(GL_TEXTURE0 + i);
-		glBindTexture(GL_TEXTURE_2D, m_textureIDs[i].ID);
-	}
-}
-
-/***********************************************************
- *  DestroyGLTextures()
- *
- *  This method is used for freeing the memory in all the
- *  used texture memory slots.
- ***********************************************************/
-void SceneManager::DestroyGLTextures()
-{
-	for (int i = 0; i < m_loadedTextures; i++)
-	{
-		glGenTextures(1, &m_textureIDs[i].ID);
-	}
-}
-
-/***********************************************************
- *  FindTextureID()
- *
- *  This method is used for getting an ID for the previously
- *  loaded texture bitmap associated with the passed in tag.
- ***********************************************************/
-int SceneManager::FindTextureID(std::string tag)
-{
-	int textureID = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
-	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureID = m_textureIDs[index].ID;
-			bFound = true;
-		}
-		else
-			index++;
-	}
-
-	return(textureID);
-}
-
-/***********************************************************
- *  FindTextureSlot()
- *
- *  This method is used for getting a slot index for the previously
- *  loaded texture bitmap associated with the passed in tag.
- ***********************************************************/
-int SceneManager::FindTextureSlot(std::string tag)
-{
-	int textureSlot = -1;
-	int index = 0;
-	bool bFound = false;
-
-	while ((index < m_loadedTextures) && (bFound == false))
-	{
-		if (m_textureIDs[index].tag.compare(tag) == 0)
-		{
-			textureSlot = index;
-			bFound = true;
-		}
-		else
-			index++;
-	}
-
-	return(textureSlot);
-}
-
-/***********************************************************
- *  FindMaterial()
- *
- *  This method is used for getting a material from the previously
- *  defined materials list that is associated with the passed in tag.
- ***********************************************************/
-bool SceneManager::FindMaterial(std::string tag, OBJECT_MATERIAL& material)
-{
-	if (m_objectMaterials.size() == 0)
-	{
-		return(false);
-	}
-
-	int index = 0;
-	bool bFound = false;
-	while ((index < m_objectMaterials.size()) && (bFound == false))
-	{
-		if (m_objectMaterials[index].tag.compare(tag) == 0)
-		{
-			bFound = true;
-			material.ambientColor = m_objectMaterials[index].ambientColor;
-			material.ambientStrength = m_objectMaterials[index].ambientStrength;
-			material.diffuseColor = m_objectMaterials[index].diffuseColor;
-			material.specularColor = m_objectMaterials[index].specularColor;
-			material.shininess = m_objectMaterials[index].shininess;
-		}
-		else
-		{
-			index++;
-		}
-	}
-
-	return(true);
-}
-
-/***********************************************************
- *  SetTransformations()
- *
- *  This method is used for setting the transform buffer
- *  using the passed in transformation values.
- ***********************************************************/
-void SceneManager::SetTransformations(
-	glm::vec3 scaleXYZ,
-	float XrotationDegrees,
-	float YrotationDegrees,
-	float ZrotationDegrees,
-	glm::vec3 positionXYZ)
-{
-	// variables for this method
-	glm::mat4 modelView;
-	glm::mat4 scale;
-	glm::mat4 rotationX;
-	glm::mat4 rotationY;
-	glm::mat4 rotationZ;
-	glm::mat4 translation;
-
-	// set the scale value in the transform buffer
-	scale = glm::scale(scaleXYZ);
-	// set the rotation values in the transform buffer
-	rotationX = glm::rotate(glm::radians(XrotationDegrees), glm::vec3(1.0f, 0.0f, 0.0f));
-	rotationY = glm::rotate(glm::radians(YrotationDegrees), glm::vec3(0.0f, 1.0f, 0.0f));
-	rotationZ = glm::rotate(glm::radians(ZrotationDegrees), glm::vec3(0.0f, 0.0f, 1.0f));
-	// set the translation value in the transform buffer
-	translation = glm::translate(positionXYZ);
-
-	modelView = translation * rotationX * rotationY * rotationZ * scale;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setMat4Value(g_ModelName, modelView);
-	}
-}
-
-/***********************************************************
- *  SetShaderColor()
- *
- *  This method is used for setting the passed in color
- *  into the shader for the next draw command
- ***********************************************************/
-void SceneManager::SetShaderColor(
-	float redColorValue,
-	float greenColorValue,
-	float blueColorValue,
-	float alphaValue)
-{
-	// variables for this method
-	glm::vec4 currentColor;
-
-	currentColor.r = redColorValue;
-	currentColor.g = greenColorValue;
-	currentColor.b = blueColorValue;
-	currentColor.a = alphaValue;
-
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, false);
-		m_pShaderManager->setVec4Value(g_ColorValueName, currentColor);
-	}
-}
-
-/***********************************************************
- *  SetShaderTexture()
- *
- *  This method is used for setting the texture data
- *  associated with the passed in ID into the shader.
- ***********************************************************/
-void SceneManager::SetShaderTexture(
-	std::string textureTag)
-{
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setIntValue(g_UseTextureName, true);
-
-		int textureID = -1;
-		textureID = FindTextureSlot(textureTag);
-		m_pShaderManager->setSampler2DValue(g_TextureValueName, textureID);
-	}
-}
-
-/***********************************************************
- *  SetTextureUVScale()
- *
- *  This method is used for setting the texture UV scale
- *  values into the shader.
- ***********************************************************/
-void SceneManager::SetTextureUVScale(float u, float v)
-{
-	if (NULL != m_pShaderManager)
-	{
-		m_pShaderManager->setVec2Value("UVscale", glm::vec2(u, v));
-	}
-}
-
-/***********************************************************
- *  SetShaderMaterial()
- *
- *  This method is used for passing the material values
- *  into the shader.
- ***********************************************************/
-void SceneManager::SetShaderMaterial(
-	std::string materialTag)
-{
-	if (m_objectMaterials.size() > 0)
-	{
-		OBJECT_MATERIAL material;
-		bool bReturn = false;
-
-		bReturn = FindMaterial(materialTag, material);
-		if (bReturn == true)
-		{
-			m_pShaderManager->setVec3Value("material.ambientColor", material.ambientColor);
-			m_pShaderManager->setFloatValue("material.ambientStrength", material.ambientStrength);
-			m_pShaderManager->setVec3Value("material.diffuseColor", material.diffuseColor);
-			m_pShaderManager->setVec3Value("material.specularColor", material.specularColor);
-			m_pShaderManager->setFloatValue("material.shininess", material.shininess);
-		}
-	}
-}
-
-/**************************************************************/
-/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
-/*** preparing and rendering their own 3D replicated scenes.***/
-/*** Please refer to the code in the OpenGL sample project  ***/
-/*** for assistance.                                        ***/
-/**************************************************************/
-
-/***********************************************************
-  *  LoadSceneTextures()
-  *
-  *  This method is used for preparing the 3D scene by loading
-  *  the shapes, textures in memory to support the 3D scene
-  *  rendering
-  ***********************************************************/
-void SceneManager::LoadSceneTextures()
-{
-	bool bReturn = CreateGLTexture(
-		"../../Utilities/textures/WoodTable.jpg",
-		"planeTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load plane texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/greenmetal.jpg",
-		"phoneTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load phone texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/camera.jpg",
-		"cameraTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load camera texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/stainless.jpg",
-		"silverTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load silver ring texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/gold-seamless-texture.jpg",
-		"conductorTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load camera texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/trav.jpg",
-		"pyramidTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load phone texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/plastic.jpg",
-		"plasticTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load phone texture." << std::endl;
-	}
-
-	bReturn = CreateGLTexture(
-		"../../Utilities/textures/sphere.jpg",
-		"sphereTexture");
-	if (!bReturn) {
-		std::cout << "Failed to load phone texture." << std::endl;
-	}
-
-	BindGLTextures();
-}
-
-/***********************************************************
- *  PrepareScene()
- *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
- ***********************************************************/
-void SceneManager::PrepareScene()
-{
-	// only one instance of a particular mesh needs to be
-	// loaded in memory no matter how many times it is drawn
-	// in the rendered 3D scene
-
-	m_basicMeshes->LoadPlaneMesh();
-	m_basicMeshes->LoadCylinderMesh();
-	m_basicMeshes->LoadBoxMesh();
-	m_basicMeshes->LoadConeMesh();
-	m_basicMeshes->LoadPrismMesh();
-	m_basicMeshes->LoadSphereMesh();
-	m_basicMeshes->LoadPyramid4Mesh();
-
-	// -------------------------------------------------------
-	// Define materials for plane, phone, etc.
-	// -------------------------------------------------------
-	{
-		OBJECT_MATERIAL planeMat;
-		planeMat.tag = "planeMaterial";
-		// A bit reflective
-		planeMat.ambientColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		planeMat.ambientStrength = 0.2f;
-		planeMat.diffuseColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		planeMat.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		planeMat.shininess = 32.0f;
-		m_objectMaterials.push_back(planeMat);
-	}
-
-	{
-		OBJECT_MATERIAL phoneMat;
-		phoneMat.tag = "phoneMaterial";
-		phoneMat.ambientColor = glm::vec3(0.7f, 0.7f, 0.7f);
-		phoneMat.ambientStrength = 0.2f;
-		phoneMat.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
-		phoneMat.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-		phoneMat.shininess = 0.0f;
-		m_objectMaterials.push_back(phoneMat);
-	}
-
-	{
-		OBJECT_MATERIAL silverMat;
-		silverMat.tag = "silverMaterial";
-		silverMat.ambientColor = glm::vec3(0.7f, 0.7f, 0.7f);
-		silverMat.ambientStrength = 0.1f;
-		silverMat.diffuseColor = glm::vec3(0.7f, 0.7f, 0.7f);
-		silverMat.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		silverMat.shininess = 64.0f;
-		m_objectMaterials.push_back(silverMat);
-	}
-
-	{
-		OBJECT_MATERIAL cameraMat;
-		cameraMat.tag = "cameraMaterial";
-		cameraMat.ambientColor = glm::vec3(0.5f, 0.5f, 0.5f);
-		cameraMat.ambientStrength = 0.2f;
-		cameraMat.diffuseColor = glm::vec3(0.5f, 0.5f, 0.5f);
-		cameraMat.specularColor = glm::vec3(0.0f, 0.0f, 0.0f);
-		cameraMat.shininess = 0.0f;
-		m_objectMaterials.push_back(cameraMat);
-	}
-
-	{
-		OBJECT_MATERIAL pyramidMat;
-		pyramidMat.tag = "pyramidMaterial";
-		pyramidMat.ambientColor = glm::vec3(0.5f, 0.5f, 0.2f);
-		pyramidMat.ambientStrength = 0.2f;
-		pyramidMat.diffuseColor = glm::vec3(0.5f, 0.5f, 0.2f);
-		pyramidMat.specularColor = glm::vec3(0.8f, 0.8f, 0.5f);
-		pyramidMat.shininess = 60.0f;
-		m_objectMaterials.push_back(pyramidMat);
-	}
-
-	{
-		OBJECT_MATERIAL sphereMat;
-		sphereMat.tag = "sphereMaterial";
-		sphereMat.ambientColor = glm::vec3(0.8f, 0.3f, 0.3f);
-		sphereMat.ambientStrength = 0.3f;
-		sphereMat.diffuseColor = glm::vec3(0.8f, 0.3f, 0.3f);
-		sphereMat.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		sphereMat.shininess = 32.0f;
-		m_objectMaterials.push_back(sphereMat);
-	}
-
-	{
-		OBJECT_MATERIAL batteryMat;
-		batteryMat.tag = "batteryMaterial";
-		batteryMat.ambientColor = glm::vec3(0.2f, 0.2f, 0.2f);
-		batteryMat.ambientStrength = 0.2f;
-		batteryMat.diffuseColor = glm::vec3(0.2f, 0.2f, 0.2f);
-		batteryMat.specularColor = glm::vec3(0.5f, 0.5f, 0.5f);
-		batteryMat.shininess = 32.0f;
-		m_objectMaterials.push_back(batteryMat);
-	}
-
-	{
-		OBJECT_MATERIAL goldConductorMat;
-		goldConductorMat.tag = "goldConductorMaterial";
-		goldConductorMat.ambientColor = glm::vec3(1.0f, 0.84f, 0.0f);
-		goldConductorMat.ambientStrength = 0.3f;
-		goldConductorMat.diffuseColor = glm::vec3(1.0f, 0.84f, 0.0f);
-		goldConductorMat.specularColor = glm::vec3(1.0f, 1.0f, 1.0f);
-		goldConductorMat.shininess = 120.0f;
-		m_objectMaterials.push_back(goldConductorMat);
-	}
-}
-
-/***********************************************************
- *  RenderScene()
- *
- *  This method is used for rendering the 3D scene by 
- *  transforming and drawing the basic 3D shapes
- ***********************************************************/
-void SceneManager::RenderScene()
-{
-
-	//Enable lighting in the shader
-	if (m_pShaderManager != NULL)
-	{
-		// Enable Phong calculations
-		m_pShaderManager->setIntValue(g_UseLightingName, true);
-
-		// Set up a main light
-		m_pShaderManager->setVec3Value("lightSources[0].position", 1.0f, 15.0f, 0.0f);
-		m_pShaderManager->setVec3Value("lightSources[0].ambientColor", 0.01f, 0.01f, 0.01f);
-		m_pShaderManager->setVec3Value("lightSources[0].diffuseColor", 0.4f, 1.0f, 0.4f);
-		m_pShaderManager->setVec3Value("lightSources[0].specularColor", 0.5f, 0.5f, 0.5f);
-		m_pShaderManager->setFloatValue("lightSources[0].focalStrength", 25.0f);
-		m_pShaderManager->setFloatValue("lightSources[0].specularIntensity", 0.2f);
-
-		// LIGHT 1 (Slightly colored side light)
-		m_pShaderManager->setVec3Value("lightSources[1].position", -5.0f, 5.0f, 5.0f);
-		// Give it a dimmer ambient
-		m_pShaderManager->setVec3Value("lightSources[1].ambientColor", 0.0f, 0.0f, 0.05f);
-		m_pShaderManager->setVec3Value("lightSources[1].diffuseColor", 0.2f, 0.2f, 0.8f);
-		m_pShaderManager->setVec3Value("lightSources[1].specularColor", 0.4f, 0.4f, 0.9f);
-		m_pShaderManager->setFloatValue("lightSources[1].focalStrength", 32.0f);
-		m_pShaderManager->setFloatValue("lightSources[1].specularIntensity", 0.15f);
-	}
-
-	// declare the variables for the transformations
-	glm::vec3 scaleXYZ;
-	float XrotationDegrees = 0.0f;
-	float YrotationDegrees = 0.0f;
-	float ZrotationDegrees = 0.0f;
-	glm::vec3 positionXYZ;
-
-	/*** Set needed transformations before drawing the basic mesh.  ***/
-	/*** This same ordering of code should be used for transforming ***/
-	/*** and drawing all the basic 3D shapes.						***/
-	/******************************************************************/
-	// set the XYZ scale for the mesh
-	scaleXYZ = glm::vec3(20.0f, 1.0f, 10.0f);
-
-	// set the XYZ rotation for the mesh
-	XrotationDegrees = 0.0f;
-	YrotationDegrees = 0.0f;
-	ZrotationDegrees = 0.0f;
-
-	// set the XYZ position for the mesh
-	positionXYZ = glm::vec3(0.0f, 0.0f, 0.0f);
-
-	// set the transformations into memory to be used on the drawn meshes
-	SetTransformations(
-		scaleXYZ,
-		XrotationDegrees,
-		YrotationDegrees,
-		ZrotationDegrees,
-		positionXYZ);
-
-	SetShaderMaterial("planeMaterial");
-	//SetShaderColor(1, 1, 1, 1);
-	SetShaderTexture("planeTexture");
-	SetTextureUVScale(1.0f, 1.0f);
-
-	// draw the mesh with transformation values
-	m_basicMeshes->DrawPlaneMesh();
-
-	 // 2. Render the phone as a flatter box
-	glm::vec3 phoneScale = glm::vec3(2.0f, 0.05f, 4.0f);
-	float     phoneXRot = 0.0f;
-	float     phoneYRot = -5.0f;
-	float     phoneZRot = 0.0f;
-	glm::vec3 phonePosition = glm::vec3(0.0f, 0.03f, 0.0f);
-
-	SetTransformations(phoneScale, phoneXRot, phoneYRot, phoneZRot, phonePosition);
-
-	SetShaderMaterial("phoneMaterial");
-	//SetShaderColor(0.855f, 0.831f, 0.792f, 1.0f);
-	SetShaderTexture("phoneTexture");
-	SetTextureUVScale(1.0f, 1.0f);
-	m_basicMeshes->DrawBoxMesh();
-
-	//3. Render the three camera bumps plus its ring to give a real phone look
-	{
-		// Half the phones dimensions for positioning reference
-		float phoneHalfWidth = 0.5f * phoneScale.x;  // 1.0f
-		float phoneHalfHeight = 0.5f * phoneScale.z;  // 2.0f
-
-		// Base offset above phone
-		float cameraOffsetY = 0.02f;
-
-		// -- Shared scale values: ring vs. lens
-		// The ring is bigger in x,z, shorter in y
-		glm::vec3 ringScale = glm::vec3(0.145f, 0.06f, 0.145f);
-		// The lens is smaller in x,z, taller in y
-		glm::vec3 lensScale = glm::vec3(0.12f, 0.065f, 0.12f);
-
-		// Common rotations
-		float camXRot = 0.0f;
-		float camYRot = 0.0f;
-		float camZRot = 0.0f;
-
-		/****************************************************************
-		 * CAMERA #1
-		 ****************************************************************/
-		glm::vec3 cam1Pos(
-			-phoneHalfWidth + 0.32f,  // X offset
-			cameraOffsetY,           // Y offset from phone
-			phoneHalfHeight - 3.37f   // Z offset
-		);
-
-		// 1A) Draw the silver ring (lower + flatter)
-		SetTransformations(ringScale, camXRot, camYRot, camZRot, cam1Pos);
-		SetShaderMaterial("silverMaterial");
-		SetShaderTexture("silverTexture");//Texture
-		SetTextureUVScale(1.0f, 1.0f);//UV scaling
-		m_basicMeshes->DrawCylinderMesh();//Drawing
-
-		// 1B) Draw the lens (slightly higher in Y so it protrudes above ring)
-		glm::vec3 cam1LensPos = cam1Pos;
-		cam1LensPos.y += 0.01f; // Raise lens by 0.01 above ring
-		SetTransformations(lensScale, camXRot, camYRot, camZRot, cam1LensPos);
-		SetShaderMaterial("cameraMaterial");
-		SetShaderTexture("cameraTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawCylinderMesh();
-
-		/****************************************************************
-		 * CAMERA #2
-		 ****************************************************************/
-		glm::vec3 cam2Pos(
-			-phoneHalfWidth + 0.60f,
-			cameraOffsetY,
-			phoneHalfHeight - 3.52f
-		);
-
-		// 2A) Silver ring
-		SetTransformations(ringScale, camXRot, camYRot, camZRot, cam2Pos);
-		SetShaderMaterial("silverMaterial");
-		SetShaderTexture("silverTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawCylinderMesh();
-
-		// 2B) Lens
-		glm::vec3 cam2LensPos = cam2Pos;
-		cam2LensPos.y += 0.01f;
-		SetTransformations(lensScale, camXRot, camYRot, camZRot, cam2LensPos);
-		SetShaderMaterial("cameraMaterial");
-		SetShaderTexture("cameraTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawCylinderMesh();
-
-		/****************************************************************
-		 * CAMERA #3
-		 ****************************************************************/
-		glm::vec3 cam3Pos(
-			-phoneHalfWidth + 0.35f,
-			cameraOffsetY,
-			phoneHalfHeight - 3.74f
-		);
-
-		// 3A) Silver ring
-		SetTransformations(ringScale, camXRot, camYRot, camZRot, cam3Pos);
-		SetShaderMaterial("silverMaterial");
-		SetShaderTexture("silverTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawCylinderMesh();
-
-		// 3B) Lens
-		glm::vec3 cam3LensPos = cam3Pos;
-		cam3LensPos.y += 0.01f;
-		SetTransformations(lensScale, camXRot, camYRot, camZRot, cam3LensPos);
-		SetShaderMaterial("cameraMaterial");
-		SetShaderTexture("cameraTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawCylinderMesh();
-
-		/****************************************************************
-		 * PYRAMID MESH
-		 ****************************************************************/
-		glm::vec3 pyramidScale = glm::vec3(1.2f, 1.0f, 1.2f);
-		float     pyramidXRot = 0.0f;
-		float     pyramidYRot = 25.0f;
-		float     pyramidZRot = 0.0f;
-		glm::vec3 pyramidPosition = glm::vec3(-2.7f, 0.52f, 0.5f);
-
-		SetTransformations(pyramidScale, pyramidXRot, pyramidYRot, pyramidZRot, pyramidPosition);
-
-		SetShaderMaterial("pyramidMaterial");
-		SetShaderColor(2.855f, 0.831f, 0.792f, 1.0f);
-		SetShaderTexture("pyramidTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawPyramid4Mesh();
-
-		/****************************************************************
-		 * SPHERE MESH
-		 ****************************************************************/
-		glm::vec3 sphereScale = glm::vec3(0.40f, 0.45f, 0.40f);
-		float     sphereXRot = 0.0f;
-		float     sphereYRot = 25.0f;
-		float     sphereZRot = 0.0f;
-		glm::vec3 spherePosition = glm::vec3(-4.5f, 0.50f, 1.3f);
-
-		SetTransformations(sphereScale, sphereXRot, sphereYRot, sphereZRot, spherePosition);
-
-		SetShaderMaterial("sphereMaterial");
-		SetShaderColor(0.855f, 0.831f, 0.792f, 1.0f);
-		SetShaderTexture("sphereTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawSphereMesh();
-
-		/****************************************************************
-		 * BATTERY MESH
-		 ****************************************************************/
-		glm::vec3 batteryScale = glm::vec3(1.3f, 0.4f, 0.9f);
-		float     batteryXRot = 0.0f;
-		float     batteryYRot = 20.0f;
-		float     batteryZRot = 0.0f;
-		glm::vec3 batteryPosition = glm::vec3(-3.7f, 0.21f, -0.8f);
-
-		SetTransformations(batteryScale, batteryXRot, batteryYRot, batteryZRot, batteryPosition);
-
-		SetShaderMaterial("batteryMaterial");
-		//SetShaderColor(0.855f, 0.831f, 0.792f, 1.0f);
-		SetShaderTexture("plasticTexture");
-		SetTextureUVScale(1.0f, 1.0f);
-		m_basicMeshes->DrawBoxMesh();
-
-		/****************************************************************
-		 * GOLD CONDUCTORS
-		 ****************************************************************/
-		glm::vec3 conductorScale = glm::vec3(0.25f, 0.16f, 0.1f);
-		float     conductorXRot = 0.0f;
-		float     conductorYRot = 20.0f;
-		float     conductorZRot = 0.0f;
-
-		//first conductor
-		glm::vec3 conductorPosition1 = glm::vec3(-4.26f, 0.08f, -0.8f);
-		SetTransformations(conductorScale, conductorXRot, conductorYRot, conductorZRot, conductorPosition1);
-		SetShaderMaterial("goldConductorMaterial");
-		SetTextureUVScale(1.0f, 1.0f);
-		SetShaderTexture("conductorTexture");
-		m_basicMeshes->DrawBoxMesh();
-
-		//second conductor
-		glm::vec3 conductorPosition2 = glm::vec3(-4.188f, 0.08f, -0.6f);
-		SetTransformations(conductorScale, conductorXRot, conductorYRot, conductorZRot, conductorPosition2);
-		SetShaderMaterial("goldConductorMaterial");
-		SetTextureUVScale(1.0f, 1.0f);
-		SetShaderTexture("conductorTexture");
-		m_basicMeshes->DrawBoxMesh();
-
-		//third conductor
-		glm::vec3 conductorPosition3 = glm::vec3(-4.115f, 0.08f, -0.4f);
-		SetTransformations(conductorScale, conductorXRot, conductorYRot, conductorZRot, conductorPosition3);
-		SetShaderMaterial("goldConductorMaterial");
-		SetTextureUVScale(1.0f, 1.0f);
-		SetShaderTexture("conductorTexture");
-		m_basicMeshes->DrawBoxMesh();
-
-	}
-}
+///////////////////////////////////////////////////////////////////////////////
+// shadermanager.cpp
+// ============
+// manage the loading and rendering of 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "SceneManager.h"
+#include "GLStateCache.h"
+#include "ShaderLoader.h"
+
+#ifndef STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#endif
+
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cfloat>
+#include <chrono>
+
+// declaration of global variables
+namespace
+{
+	// size of the material array declared in the shader block
+	const int g_MaxShaderMaterials = ShaderUniforms::MAX_MATERIALS;
+	// fewest repeated draws that are combined into an instanced draw
+	const int g_MinInstanceBatch = 2;
+	// most textures loaded in the background uploaded in one frame
+	const int g_MaxTextureUploadsPerFrame = 4;
+	// scene objects handled by one job while a frame packet is
+	// built, large enough to outweigh the cost of a job
+	const int g_ObjectsPerJob = 1024;
+	// scene file read when no other one is chosen, and the suffix
+	// of its compiled form
+	const char* g_DefaultSceneFile = "scenes/default.scene";
+	const char* g_CompiledSceneSuffix = ".bin";
+
+	// projected sizes below which the round meshes switch to the
+	// next coarser level of detail, as a fraction of half the
+	// viewport height covered by the bounding sphere
+	const float g_LodScreenSizes[PrimitiveMeshes::LOD_LEVELS - 1] = { 0.25f, 0.08f };
+	// band around each switch size in which an object keeps its
+	// current level, so that it does not pop back and forth
+	const float g_LodHysteresis = 0.15f;
+	// shadow maps made unless other settings are chosen
+	const int g_DefaultShadowResolution = 2048;
+	const int g_DefaultShadowCascades = 3;
+	// shift of the level of detail in the mesh field of the
+	// draw records, so that levels are sorted and batched apart
+	const int g_LodMeshKeyShift = 4;
+	// nodes of the tag lookups, which hold a short tag, an
+	// index and the link and hash of the map, and how many of
+	// them a chunk of the pool holds
+	const size_t g_TagNodeSize = 64;
+	const int g_TagNodesPerChunk = 128;
+	// first size of the arena of a frame; it grows to the
+	// largest frame once, and keeps that size afterwards
+	const size_t g_FrameArenaSize = 64 * 1024;
+
+	// local bounds of the basic meshes, in MESH_KIND order; the
+	// prism and the pyramid use a unit cube around the origin,
+	// which is larger than the meshes but never too small
+	const BoundingVolumes::BOUNDING_BOX g_MeshBounds[] =
+	{
+		{ glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 0.0f, 1.0f) },     // plane
+		{ glm::vec3(-0.5f, -0.5f, -0.5f), glm::vec3(0.5f, 0.5f, 0.5f) },    // box
+		{ glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) },     // cylinder
+		{ glm::vec3(-1.0f, 0.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) },     // cone
+		{ glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) },    // prism
+		{ glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) },    // sphere
+		{ glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(1.0f, 1.0f, 1.0f) }     // pyramid
+	};
+}
+
+/***********************************************************
+ *  SceneManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+SceneManager::SceneManager(
+	ShaderManager *pShaderManager,
+	ShaderUniforms *pShaderUniforms)
+{
+	m_pShaderManager = pShaderManager;
+	m_pShaderUniforms = pShaderUniforms;
+	m_tagPool = new MemoryPool(g_TagNodeSize, g_TagNodesPerChunk);
+	m_textureSlotLookup = TAG_LOOKUP(0, std::hash<std::string>(), std::equal_to<std::string>(), PoolAllocator<TAG_LOOKUP::value_type>(m_tagPool));
+	m_materialLookup = TAG_LOOKUP(0, std::hash<std::string>(), std::equal_to<std::string>(), PoolAllocator<TAG_LOOKUP::value_type>(m_tagPool));
+	m_frameArena = new FrameArena(g_FrameArenaSize);
+	m_basicMeshes = new ShapeMeshes();
+	m_instancedMeshes = new PrimitiveMeshes();
+	m_lightManager = new LightManager();
+	m_textureArrays = new TextureArrays();
+	m_textureLoader = new TextureLoader();
+	// block compressed textures need about a sixth of the memory
+	// and come with their mip levels, so use them when possible
+	m_textureLoader->SetCompression(m_textureArrays->SupportsCompression());
+
+	m_spatialIndex = new SceneBVH();
+	m_bSpatialIndexDirty = false;
+	m_jobSystem = new JobSystem();
+
+	m_bHasViewFrustum = false;
+	m_bFrustumCulling = true;
+	m_cameraPosition = glm::vec3(0.0f);
+	m_projectionScale = 1.0f;
+	m_bOrthographicView = false;
+	m_bLevelOfDetail = true;
+	m_gpuRenderer = new GpuDrivenRenderer();
+	m_bGpuDriven = false;
+	m_bGpuObjectsDirty = true;
+	m_gpuObjectCount = 0;
+	m_clusteredLighting = new ClusteredLighting();
+	m_bDepthPrepass = false;
+	m_hiZBuffer = new HiZBuffer();
+	m_bOcclusionCulling = false;
+	m_occlusionPyramid.viewProjection = glm::mat4(1.0f);
+	m_occlusionPyramid.firstLevel = 0;
+	m_occlusionPyramid.bValid = false;
+	m_shadowMaps = new ShadowMaps();
+	m_shadowResolution = g_DefaultShadowResolution;
+	m_shadowCascades = g_DefaultShadowCascades;
+	m_shadowDrawCalls = 0;
+	m_shadowMapsRendered = 0;
+	m_viewMatrix = glm::mat4(1.0f);
+	m_projectionMatrix = glm::mat4(1.0f);
+	m_sceneBounds.minPoint = glm::vec3(0.0f);
+	m_sceneBounds.maxPoint = glm::vec3(0.0f);
+	m_casterRevision = 0;
+	m_frameStats = RenderQueue::RENDER_STATS();
+	m_sceneFilename = g_DefaultSceneFile;
+	m_sceneFile = new SceneFile();
+	m_replicaCopies = 0;
+	m_replicaSpacing = 0.0f;
+	m_pointLightCount = 0;
+	m_fileWatcher = new FileWatcher();
+	m_bHotReload = false;
+	m_vertexShaderWatch = -1;
+	m_fragmentShaderWatch = -1;
+	m_cullShaderWatch = -1;
+	m_clusterShaderWatch = -1;
+	m_hiZShaderWatch = -1;
+	m_sceneFileWatch = -1;
+	m_reloadedProgram = 0;
+}
+
+/***********************************************************
+ *  ~SceneManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+SceneManager::~SceneManager()
+{
+	m_pShaderManager = NULL;
+	m_pShaderUniforms = NULL;
+	delete m_basicMeshes;
+	m_basicMeshes = NULL;
+	delete m_instancedMeshes;
+	m_instancedMeshes = NULL;
+	delete m_lightManager;
+	m_lightManager = NULL;
+	delete m_spatialIndex;
+	m_spatialIndex = NULL;
+	delete m_jobSystem;
+	m_jobSystem = NULL;
+	delete m_gpuRenderer;
+	m_gpuRenderer = NULL;
+	delete m_clusteredLighting;
+	m_clusteredLighting = NULL;
+	delete m_hiZBuffer;
+	m_hiZBuffer = NULL;
+	delete m_shadowMaps;
+	m_shadowMaps = NULL;
+	delete m_sceneFile;
+	m_sceneFile = NULL;
+	delete m_fileWatcher;
+	m_fileWatcher = NULL;
+	delete m_frameArena;
+	m_frameArena = NULL;
+	// the lookups give their nodes back to the pool before it
+	// is freed, and are left with the heap for their own end
+	m_textureSlotLookup = TAG_LOOKUP();
+	m_materialLookup = TAG_LOOKUP();
+	delete m_tagPool;
+	m_tagPool = NULL;
+	if (m_reloadedProgram != 0)
+	{
+		glDeleteProgram(m_reloadedProgram);
+		m_reloadedProgram = 0;
+	}
+	// the loader uploads into the arrays, so it goes first
+	delete m_textureLoader;
+	m_textureLoader = NULL;
+	delete m_textureArrays;
+	m_textureArrays = NULL;
+}
+
+/***********************************************************
+ *  CreateGLTexture()
+ *
+ *  This method is used for loading textures from image files
+ *  and adding the read image to the texture arrays.  Images
+ *  of the same size and format share one array, and the
+ *  arrays are created in OpenGL by BindGLTextures().  Where
+ *  the driver supports BCn, the image is transcoded once
+ *  into the texture cache and loaded from there afterwards.
+ ***********************************************************/
+bool SceneManager::CreateGLTexture(const char* filename, const std::string& tag)
+{
+	int width = 0;
+	int height = 0;
+	int colorChannels = 0;
+
+	// indicate to always flip images vertically when loaded
+	stbi_set_flip_vertically_on_load(true);
+
+	// a DDS file or the cached transcode of the image is used
+	// without decoding the source at all
+	TextureCompression::COMPRESSED_IMAGE compressed;
+	bool bCompress = m_textureArrays->SupportsCompression();
+	if ((bCompress == true) && (TextureCompression::LoadCached(filename, compressed) == true))
+	{
+		int textureSlot = m_textureArrays->AddCompressedImage(compressed);
+		if (textureSlot < 0)
+		{
+			return false;
+		}
+
+		std::cout << "Successfully loaded compressed image:" << filename << ", width:" << compressed.width << ", height:" << compressed.height << ", levels:" << compressed.levels.size() << std::endl;
+		m_textureSlotLookup[tag] = textureSlot;
+
+		return true;
+	}
+
+	// try to parse the image data from the specified image file
+	unsigned char* image = stbi_load(
+		filename,
+		&width,
+		&height,
+		&colorChannels,
+		0);
+
+	// if the image was successfully read from the image file
+	if (image)
+	{
+		std::cout << "Successfully loaded image:" << filename << ", width:" << width << ", height:" << height << ", channels:" << colorChannels << std::endl;
+
+		int textureSlot = -1;
+		if ((bCompress == true) &&
+			(TextureCompression::CompressAndCache(filename, image, width, height, colorChannels, compressed) == true))
+		{
+			textureSlot = m_textureArrays->AddCompressedImage(compressed);
+		}
+		else
+		{
+			textureSlot = m_textureArrays->AddImage(image, width, height, colorChannels);
+		}
+
+		// free the image data from local memory
+		stbi_image_free(image);
+
+		if (textureSlot < 0)
+		{
+			return false;
+		}
+
+		// register the loaded texture and associate it with the special tag string
+		m_textureSlotLookup[tag] = textureSlot;
+
+		return true;
+	}
+
+	std::cout << "Could not load image:" << filename << std::endl;
+
+	// Error loading the image
+	return false;
+}
+
+/***********************************************************
+ *  RequestGLTexture()
+ *
+ *  This method is used for loading a texture in the
+ *  background.  A texture slot is reserved under the tag
+ *  right away and shows a placeholder until the image has
+ *  been decoded by a worker thread and uploaded by
+ *  UploadLoadedTextures().
+ ***********************************************************/
+bool SceneManager::RequestGLTexture(const char* filename, const std::string& tag)
+{
+	if ((filename == NULL) || (FindTextureSlot(tag) >= 0))
+	{
+		return false;
+	}
+
+	int textureSlot = m_textureArrays->ReserveSlot();
+	m_textureSlotLookup[tag] = textureSlot;
+	m_textureLoader->RequestTexture(filename, textureSlot);
+
+	// the file is kept so that the texture can be reloaded
+	if (m_textureFiles.size() <= textureSlot)
+	{
+		m_textureFiles.resize(textureSlot + 1);
+	}
+	m_textureFiles[textureSlot] = filename;
+	if (m_bHotReload == true)
+	{
+		m_fileWatcher->Watch(filename);
+	}
+
+	return true;
+}
+
+/***********************************************************
+ *  UploadLoadedTextures()
+ *
+ *  This method is used for uploading the textures decoded
+ *  in the background since the last frame.  The slots of
+ *  the scene objects stay the same, so nothing has to be
+ *  resolved again when a texture arrives.
+ ***********************************************************/
+void SceneManager::UploadLoadedTextures()
+{
+	if (m_textureLoader->GetPendingCount() > 0)
+	{
+		// the GPU renderer keeps the array and layer of every
+		// object, which changes once its texture has arrived
+		if (m_textureLoader->UploadDecoded(m_textureArrays, g_MaxTextureUploadsPerFrame) > 0)
+		{
+			m_bGpuObjectsDirty = true;
+		}
+	}
+}
+
+/***********************************************************
+ *  BindGLTextures()
+ *
+ *  This method is used for creating the texture arrays of
+ *  the loaded textures and binding each array to its own
+ *  texture unit, so that drawing never rebinds a texture;
+ *  the state cache skips the arrays already bound.
+ *  The number of textures is only limited by the layers of
+ *  the arrays, not by the texture units.
+ ***********************************************************/
+void SceneManager::BindGLTextures()
+{
+	m_textureArrays->Build();
+	m_textureArrays->Bind();
+}
+
+/***********************************************************
+ *  DestroyGLTextures()
+ *
+ *  This method is used for freeing the memory of all the
+ *  loaded textures.
+ ***********************************************************/
+void SceneManager::DestroyGLTextures()
+{
+	m_textureArrays->Destroy();
+	m_textureSlotLookup.clear();
+}
+
+/***********************************************************
+ *  FindTextureSlot()
+ *
+ *  This method is used for getting a slot index for the previously
+ *  loaded texture bitmap associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindTextureSlot(const std::string& tag)
+{
+	int textureSlot = -1;
+
+	TAG_LOOKUP::const_iterator found = m_textureSlotLookup.find(tag);
+	if (found != m_textureSlotLookup.end())
+	{
+		textureSlot = found->second;
+	}
+
+	return(textureSlot);
+}
+
+/***********************************************************
+ *  FindMaterial()
+ *
+ *  This method is used for getting a material from the previously
+ *  defined materials list that is associated with the passed in tag.
+ ***********************************************************/
+bool SceneManager::FindMaterial(const std::string& tag, OBJECT_MATERIAL& material)
+{
+	int materialIndex = FindMaterialIndex(tag);
+
+	if (materialIndex < 0)
+	{
+		return(false);
+	}
+
+	material = m_objectMaterials[materialIndex];
+
+	return(true);
+}
+
+/***********************************************************
+ *  FindMaterialIndex()
+ *
+ *  This method is used for getting the index of a material
+ *  in the previously defined materials list that is
+ *  associated with the passed in tag.
+ ***********************************************************/
+int SceneManager::FindMaterialIndex(const std::string& tag)
+{
+	int materialIndex = -1;
+
+	TAG_LOOKUP::const_iterator found = m_materialLookup.find(tag);
+	if (found != m_materialLookup.end())
+	{
+		materialIndex = found->second;
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  AddMaterial()
+ *
+ *  This method is used for adding a material to the defined
+ *  materials list and indexing it by its tag.  A material
+ *  with a tag that is already defined replaces the earlier
+ *  definition.  The index of the material is returned.
+ ***********************************************************/
+int SceneManager::AddMaterial(const OBJECT_MATERIAL& material)
+{
+	int materialIndex = FindMaterialIndex(material.tag);
+
+	if (materialIndex >= 0)
+	{
+		m_objectMaterials[materialIndex] = material;
+	}
+	else
+	{
+		m_objectMaterials.push_back(material);
+		materialIndex = (int)m_objectMaterials.size() - 1;
+		m_materialLookup[material.tag] = materialIndex;
+	}
+
+	return(materialIndex);
+}
+
+/***********************************************************
+ *  BuildModelMatrix()
+ *
+ *  This method is used for composing the model matrix
+ *  from the passed in transformation values.  The result
+ *  equals translation * rotationX * rotationY * rotationZ
+ *  * scale, but the rotation is built directly from the
+ *  Euler angles instead of multiplying five matrices.
+ ***********************************************************/
+glm::mat4 SceneManager::BuildModelMatrix(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	glm::mat4 modelView(1.0f);
+
+	// most scene objects are not rotated at all, so the
+	// trigonometry can be skipped for them
+	if ((XrotationDegrees == 0.0f) &&
+		(YrotationDegrees == 0.0f) &&
+		(ZrotationDegrees == 0.0f))
+	{
+		modelView[0][0] = scaleXYZ.x;
+		modelView[1][1] = scaleXYZ.y;
+		modelView[2][2] = scaleXYZ.z;
+	}
+	else
+	{
+		float sinX = sinf(glm::radians(XrotationDegrees));
+		float cosX = cosf(glm::radians(XrotationDegrees));
+		float sinY = sinf(glm::radians(YrotationDegrees));
+		float cosY = cosf(glm::radians(YrotationDegrees));
+		float sinZ = sinf(glm::radians(ZrotationDegrees));
+		float cosZ = cosf(glm::radians(ZrotationDegrees));
+
+		// each column is a column of rotationX * rotationY *
+		// rotationZ multiplied by the matching scale value
+		modelView[0][0] = (cosY * cosZ) * scaleXYZ.x;
+		modelView[0][1] = (sinX * sinY * cosZ + cosX * sinZ) * scaleXYZ.x;
+		modelView[0][2] = (sinX * sinZ - cosX * sinY * cosZ) * scaleXYZ.x;
+
+		modelView[1][0] = (-cosY * sinZ) * scaleXYZ.y;
+		modelView[1][1] = (cosX * cosZ - sinX * sinY * sinZ) * scaleXYZ.y;
+		modelView[1][2] = (cosX * sinY * sinZ + sinX * cosZ) * scaleXYZ.y;
+
+		modelView[2][0] = (sinY) * scaleXYZ.z;
+		modelView[2][1] = (-sinX * cosY) * scaleXYZ.z;
+		modelView[2][2] = (cosX * cosY) * scaleXYZ.z;
+	}
+
+	// set the translation value in the transform buffer
+	modelView[3][0] = positionXYZ.x;
+	modelView[3][1] = positionXYZ.y;
+	modelView[3][2] = positionXYZ.z;
+
+	return(modelView);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the passed in transformation values.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	// variables for this method
+	glm::mat4 modelView;
+
+	modelView = BuildModelMatrix(
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ);
+
+	if (NULL != m_pShaderUniforms)
+	{
+		m_pShaderUniforms->SetMat4Value(ShaderUniforms::UNIFORM_MODEL, modelView);
+	}
+}
+
+/***********************************************************
+ *  GetModelMatrix()
+ *
+ *  This method is used for getting the cached model matrix
+ *  of the scene object at the passed in index.  The matrix
+ *  and the world bounds are only composed again when the
+ *  object has been marked dirty.
+ ***********************************************************/
+const glm::mat4& SceneManager::GetModelMatrix(
+	int objectIndex)
+{
+	if (m_transforms.dirty[objectIndex] != 0)
+	{
+		TransformKernels::ComposeDirty(
+			m_transforms,
+			objectIndex,
+			objectIndex + 1,
+			m_modelMatrices.data(),
+			m_objectBounds.data());
+	}
+
+	return(m_modelMatrices[objectIndex]);
+}
+
+/***********************************************************
+ *  SetTransformations()
+ *
+ *  This method is used for setting the transform buffer
+ *  using the cached model matrix of the scene object at
+ *  the passed in index.
+ ***********************************************************/
+void SceneManager::SetTransformations(
+	int objectIndex)
+{
+	if ((objectIndex < 0) || (objectIndex >= m_sceneObjects.size()))
+	{
+		return;
+	}
+
+	const glm::mat4& modelView = GetModelMatrix(objectIndex);
+
+	if (NULL != m_pShaderUniforms)
+	{
+		m_pShaderUniforms->SetMat4Value(ShaderUniforms::UNIFORM_MODEL, modelView);
+	}
+}
+
+/***********************************************************
+ *  UpdateObjectTransform()
+ *
+ *  This method is used for changing the transformation
+ *  values of the scene object at the passed in index.  The
+ *  cached model matrix is only marked dirty when one of the
+ *  values actually changed, and true is returned then.
+ ***********************************************************/
+bool SceneManager::UpdateObjectTransform(
+	int objectIndex,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	if ((objectIndex < 0) || (objectIndex >= m_sceneObjects.size()))
+	{
+		return(false);
+	}
+
+	if (TransformKernels::SetTransform(
+		m_transforms,
+		objectIndex,
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ) == false)
+	{
+		return(false);
+	}
+
+	m_bSpatialIndexDirty = true;
+	m_bGpuObjectsDirty = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  SetShaderColor()
+ *
+ *  This method is used for setting the passed in color
+ *  into the shader for the next draw command
+ ***********************************************************/
+void SceneManager::SetShaderColor(
+	float redColorValue,
+	float greenColorValue,
+	float blueColorValue,
+	float alphaValue)
+{
+	// variables for this method
+	glm::vec4 currentColor;
+
+	currentColor.r = redColorValue;
+	currentColor.g = greenColorValue;
+	currentColor.b = blueColorValue;
+	currentColor.a = alphaValue;
+
+	if (NULL != m_pShaderUniforms)
+	{
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_TEXTURE, false);
+		m_pShaderUniforms->SetVec4Value(ShaderUniforms::UNIFORM_OBJECT_COLOR, currentColor);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for setting the texture data
+ *  associated with the passed in ID into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	const std::string& textureTag)
+{
+	SetShaderTexture(FindTextureSlot(textureTag));
+}
+
+/***********************************************************
+ *  SetTextureUVScale()
+ *
+ *  This method is used for setting the texture UV scale
+ *  values into the shader.
+ ***********************************************************/
+void SceneManager::SetTextureUVScale(float u, float v)
+{
+	if (NULL != m_pShaderUniforms)
+	{
+		m_pShaderUniforms->SetVec2Value(ShaderUniforms::UNIFORM_UV_SCALE, glm::vec2(u, v));
+	}
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for passing the material values
+ *  into the shader.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	const std::string& materialTag)
+{
+	int materialIndex = FindMaterialIndex(materialTag);
+
+	if (materialIndex >= 0)
+	{
+		SetShaderMaterial(materialIndex);
+	}
+}
+
+/***********************************************************
+ *  SetShaderTexture()
+ *
+ *  This method is used for selecting the texture in the
+ *  passed in slot in the shader, by its texture array and
+ *  layer.  An unknown slot turns texturing off.
+ ***********************************************************/
+void SceneManager::SetShaderTexture(
+	int textureSlot)
+{
+	if (NULL == m_pShaderUniforms)
+	{
+		return;
+	}
+
+	if ((textureSlot < 0) || (textureSlot >= m_textureArrays->GetTextureCount()))
+	{
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_TEXTURE, false);
+		return;
+	}
+
+	const TextureArrays::TEXTURE_LOCATION& location = m_textureArrays->GetLocation(textureSlot);
+
+	m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_TEXTURE, true);
+	if (m_textureArrays->IsBindless() == true)
+	{
+		m_pShaderUniforms->SetTextureHandle(
+			ShaderUniforms::UNIFORM_OBJECT_TEXTURE,
+			m_textureArrays->GetArrayHandle(location.arrayIndex));
+	}
+	else
+	{
+		// each array is bound to the unit matching its index
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_OBJECT_TEXTURE, location.arrayIndex);
+	}
+	m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_TEXTURE_LAYER, location.layer);
+}
+
+/***********************************************************
+ *  SetShaderMaterial()
+ *
+ *  This method is used for selecting the defined material
+ *  at the passed in index in the shader.  The material
+ *  values themselves are already in the material block.
+ ***********************************************************/
+void SceneManager::SetShaderMaterial(
+	int materialIndex)
+{
+	if ((NULL != m_pShaderUniforms) &&
+		(materialIndex >= 0) &&
+		(materialIndex < m_objectMaterials.size()) &&
+		(materialIndex < g_MaxShaderMaterials))
+	{
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_MATERIAL_INDEX, materialIndex);
+	}
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object to the retained
+ *  scene.  The material is resolved to its index right away,
+ *  while the texture slot is resolved once the scene
+ *  textures have been loaded.  The index of the new object
+ *  is returned.
+ ***********************************************************/
+int SceneManager::AddSceneObject(
+	MESH_KIND mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	const std::string& materialTag,
+	const std::string& textureTag,
+	float u, float v)
+{
+	int materialIndex = FindMaterialIndex(materialTag);
+	if (materialIndex < 0)
+	{
+		std::cout << "Scene object uses undefined material:" << materialTag << std::endl;
+	}
+
+	return(AddSceneObject(
+		mesh,
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ,
+		materialIndex,
+		textureTag,
+		u, v));
+}
+
+/***********************************************************
+ *  AddSceneObject()
+ *
+ *  This method is used for adding an object whose material
+ *  index has already been resolved, which saves the lookup
+ *  by tag when a large scene file is loaded.
+ ***********************************************************/
+int SceneManager::AddSceneObject(
+	MESH_KIND mesh,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	int materialIndex,
+	const std::string& textureTag,
+	float u, float v)
+{
+	SCENE_OBJECT object;
+
+	object.lodLevel = 0;
+	object.mesh = mesh;
+	object.materialIndex = materialIndex;
+	object.textureTag = textureTag;
+	object.textureSlot = FindTextureSlot(textureTag);
+	object.UVscale = glm::vec2(u, v);
+
+	m_sceneObjects.push_back(object);
+	TransformKernels::AddTransform(
+		m_transforms,
+		scaleXYZ,
+		XrotationDegrees,
+		YrotationDegrees,
+		ZrotationDegrees,
+		positionXYZ,
+		GetMeshBounds(mesh));
+	m_modelMatrices.push_back(glm::mat4(1.0f));
+	m_objectBounds.push_back(GetMeshBounds(mesh));
+	m_bGpuObjectsDirty = true;
+
+	return((int)m_sceneObjects.size() - 1);
+}
+
+/***********************************************************
+ *  ResolveSceneTextures()
+ *
+ *  This method is used for looking up the texture slot of
+ *  every scene object once, after the scene textures have
+ *  been loaded, so that no tag lookups happen while the
+ *  scene is being rendered.
+ ***********************************************************/
+void SceneManager::ResolveSceneTextures()
+{
+	for (SCENE_OBJECT& object : m_sceneObjects)
+	{
+		object.textureSlot = FindTextureSlot(object.textureTag);
+		if ((object.textureSlot < 0) && (object.textureTag.empty() == false))
+		{
+			std::cout << "Scene object uses unloaded texture:" << object.textureTag << std::endl;
+		}
+	}
+	m_bGpuObjectsDirty = true;
+}
+
+/***********************************************************
+ *  DrawSceneMesh()
+ *
+ *  This method is used for drawing the basic mesh that is
+ *  referenced by a scene object.
+ ***********************************************************/
+void SceneManager::DrawSceneMesh(MESH_KIND mesh)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_basicMeshes->DrawPlaneMesh();
+		break;
+	case MESH_BOX:
+		m_basicMeshes->DrawBoxMesh();
+		break;
+	case MESH_CYLINDER:
+		m_basicMeshes->DrawCylinderMesh();
+		break;
+	case MESH_CONE:
+		m_basicMeshes->DrawConeMesh();
+		break;
+	case MESH_PRISM:
+		m_basicMeshes->DrawPrismMesh();
+		break;
+	case MESH_SPHERE:
+		m_basicMeshes->DrawSphereMesh();
+		break;
+	case MESH_PYRAMID4:
+		m_basicMeshes->DrawPyramid4Mesh();
+		break;
+	}
+}
+
+/***********************************************************
+ *  SupportsInstancing()
+ *
+ *  This method is used for checking whether the passed in
+ *  basic mesh has an instanceable version loaded.
+ ***********************************************************/
+bool SceneManager::SupportsInstancing(MESH_KIND mesh)
+{
+	return((mesh == MESH_PLANE) || (mesh == MESH_BOX) || (SupportsLevelOfDetail(mesh) == true));
+}
+
+/***********************************************************
+ *  SupportsLevelOfDetail()
+ *
+ *  This method is used for checking whether the passed in
+ *  basic mesh has been loaded at several levels of detail.
+ ***********************************************************/
+bool SceneManager::SupportsLevelOfDetail(MESH_KIND mesh)
+{
+	return((mesh == MESH_CYLINDER) || (mesh == MESH_CONE) || (mesh == MESH_SPHERE));
+}
+
+/***********************************************************
+ *  SelectLevelOfDetail()
+ *
+ *  This method is used for choosing the level of detail of
+ *  a scene object from the size its bounding sphere covers
+ *  on screen.  A level is only left once the size has moved
+ *  past the switch size by the hysteresis band, so objects
+ *  near a switch size keep their mesh instead of popping.
+ ***********************************************************/
+int SceneManager::SelectLevelOfDetail(int objectIndex)
+{
+	SCENE_OBJECT& object = m_sceneObjects[objectIndex];
+
+	if ((m_bLevelOfDetail == false) ||
+		(m_bHasViewFrustum == false) ||
+		(SupportsLevelOfDetail(object.mesh) == false) ||
+		(object.materialIndex < 0) ||
+		(object.materialIndex >= g_MaxShaderMaterials))
+	{
+		object.lodLevel = 0;
+		return(object.lodLevel);
+	}
+
+	const BoundingVolumes::BOUNDING_BOX& bounds = m_objectBounds[objectIndex];
+	glm::vec3 center = (bounds.minPoint + bounds.maxPoint) * 0.5f;
+	float radius = glm::length(bounds.maxPoint - bounds.minPoint) * 0.5f;
+
+	// the projection scale already holds the camera zoom, and
+	// orthographic views do not shrink with the distance
+	float screenSize = radius * m_projectionScale;
+	if (m_bOrthographicView == false)
+	{
+		float distance = glm::length(center - m_cameraPosition);
+		screenSize = (distance > radius) ? (screenSize / distance) : FLT_MAX;
+	}
+
+	int level = object.lodLevel;
+	while ((level < PrimitiveMeshes::LOD_LEVELS - 1) &&
+		(screenSize < g_LodScreenSizes[level] * (1.0f - g_LodHysteresis)))
+	{
+		level++;
+	}
+	while ((level > 0) &&
+		(screenSize > g_LodScreenSizes[level - 1] * (1.0f + g_LodHysteresis)))
+	{
+		level--;
+	}
+
+	object.lodLevel = level;
+	return(object.lodLevel);
+}
+
+/***********************************************************
+ *  DrawSceneMeshInstanced()
+ *
+ *  This method is used for drawing the instanceable version
+ *  of a basic mesh once for each of the passed in instances,
+ *  at the passed in level of detail for the round meshes.
+ ***********************************************************/
+void SceneManager::DrawSceneMeshInstanced(
+	MESH_KIND mesh,
+	const PrimitiveMeshes::INSTANCE_DATA* instances,
+	int instanceCount,
+	int lodLevel)
+{
+	switch (mesh)
+	{
+	case MESH_PLANE:
+		m_instancedMeshes->DrawPlaneMeshInstanced(instances, instanceCount);
+		break;
+	case MESH_BOX:
+		m_instancedMeshes->DrawBoxMeshInstanced(instances, instanceCount);
+		break;
+	case MESH_CYLINDER:
+		m_instancedMeshes->DrawCylinderMeshInstanced(instances, instanceCount, lodLevel);
+		break;
+	case MESH_CONE:
+		m_instancedMeshes->DrawConeMeshInstanced(instances, instanceCount, lodLevel);
+		break;
+	case MESH_SPHERE:
+		m_instancedMeshes->DrawSphereMeshInstanced(instances, instanceCount, lodLevel);
+		break;
+	default:
+		break;
+	}
+}
+
+/***********************************************************
+ *  LoadShaderMaterials()
+ *
+ *  This method is used for setting all the defined
+ *  materials into the material block of the shader, which
+ *  draws select from by material index.  Only materials
+ *  whose values changed are uploaded again.
+ ***********************************************************/
+void SceneManager::LoadShaderMaterials()
+{
+	if (NULL == m_pShaderUniforms)
+	{
+		return;
+	}
+
+	if (m_objectMaterials.size() > g_MaxShaderMaterials)
+	{
+		std::cout << "Only the first " << g_MaxShaderMaterials << " materials can be used in the shader" << std::endl;
+	}
+
+	for (int i = 0; (i < m_objectMaterials.size()) && (i < g_MaxShaderMaterials); i++)
+	{
+		const OBJECT_MATERIAL& material = m_objectMaterials[i];
+		ShaderUniforms::MATERIAL_DATA materialData = {};
+
+		materialData.ambientColor = material.ambientColor;
+		materialData.ambientStrength = material.ambientStrength;
+		materialData.diffuseColor = material.diffuseColor;
+		materialData.specularColor = material.specularColor;
+		materialData.shininess = material.shininess;
+
+		m_pShaderUniforms->SetMaterial(i, materialData);
+	}
+}
+
+/***********************************************************
+ *  GetRenderStats()
+ *
+ *  This method is used for getting the counters of the
+ *  state changes that were issued and elided while the
+ *  last frame packet was drawn.
+ ***********************************************************/
+const RenderQueue::RENDER_STATS& SceneManager::GetRenderStats() const
+{
+	return(m_frameStats);
+}
+
+/***********************************************************
+ *  MeasureTransformKernels()
+ *
+ *  This method is used for timing the kernels of the chosen
+ *  path on the scene objects: composing every transform on
+ *  one thread, and culling the whole scene against the view
+ *  frustum.  The composed values are the ones already held,
+ *  so the scene is left as it was.  It must not run while a
+ *  frame packet is being built.
+ ***********************************************************/
+void SceneManager::MeasureTransformKernels(
+	int repeats,
+	double& composeMs,
+	double& cullMs)
+{
+	composeMs = 0.0;
+	cullMs = 0.0;
+	if ((repeats <= 0) || (m_sceneObjects.empty() == true))
+	{
+		return;
+	}
+
+	UpdateSpatialIndex();
+
+	for (int r = 0; r < repeats; r++)
+	{
+		TransformKernels::MarkAllDirty(m_transforms);
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		TransformKernels::ComposeDirty(
+			m_transforms,
+			0,
+			(int)m_sceneObjects.size(),
+			m_modelMatrices.data(),
+			m_objectBounds.data());
+		std::chrono::steady_clock::time_point composed = std::chrono::steady_clock::now();
+		m_spatialIndex->QueryFrustum(m_viewFrustum, m_visibleObjects);
+		std::chrono::steady_clock::time_point culled = std::chrono::steady_clock::now();
+
+		composeMs += std::chrono::duration<double, std::milli>(composed - start).count();
+		cullMs += std::chrono::duration<double, std::milli>(culled - composed).count();
+	}
+
+	composeMs /= repeats;
+	cullMs /= repeats;
+}
+
+/***********************************************************
+ *  GetLightManager()
+ *
+ *  This method is used for getting the light sources of the
+ *  scene, so that lights can be moved or added after the
+ *  scene has been prepared.
+ ***********************************************************/
+LightManager* SceneManager::GetLightManager()
+{
+	return(m_lightManager);
+}
+
+/***********************************************************
+ *  GetFrameArena()
+ *
+ *  This method is used for getting the arena the GL thread
+ *  takes the transient data of a frame from.  It has to be
+ *  reset at the top of every frame.
+ ***********************************************************/
+FrameArena* SceneManager::GetFrameArena()
+{
+	return(m_frameArena);
+}
+
+/***********************************************************
+ *  ReplicateSceneObjects()
+ *
+ *  This method is used for building a synthetic scene from
+ *  the defined one.  Every object except the table plane,
+ *  which is always the first, is copied the passed in number
+ *  of times onto a square grid of cells stretching to the
+ *  right of and behind the original, keeping its material,
+ *  texture and mesh.
+ ***********************************************************/
+void SceneManager::ReplicateSceneObjects(int copies, float spacing)
+{
+	if ((copies <= 0) || (m_sceneObjects.size() < 2))
+	{
+		return;
+	}
+
+	m_replicaCopies = copies;
+	m_replicaSpacing = spacing;
+
+	// the original set of objects takes the first grid cell
+	int gridSize = 1;
+	while (gridSize * gridSize < copies + 1)
+	{
+		gridSize++;
+	}
+
+	int objectCount = (int)m_sceneObjects.size();
+	int totalCount = objectCount + (objectCount - 1) * copies;
+	m_sceneObjects.reserve(totalCount);
+	TransformKernels::ReserveTransforms(m_transforms, totalCount);
+	m_modelMatrices.reserve(totalCount);
+	m_objectBounds.reserve(totalCount);
+
+	for (int c = 1; c <= copies; c++)
+	{
+		// cells are counted from the cell of the original set
+		glm::vec3 offset(
+			(c % gridSize) * spacing,
+			0.0f,
+			-(c / gridSize) * spacing);
+
+		for (int i = 1; i < objectCount; i++)
+		{
+			m_sceneObjects.push_back(m_sceneObjects[i]);
+			TransformKernels::CopyTransform(m_transforms, i, offset);
+			m_modelMatrices.push_back(m_modelMatrices[i]);
+			m_objectBounds.push_back(m_objectBounds[i]);
+		}
+	}
+	m_bGpuObjectsDirty = true;
+}
+
+/***********************************************************
+ *  AddPointLights()
+ *
+ *  This method is used for adding point lights on a grid
+ *  over the scene objects, just above the highest one.
+ *  Every light has a range of about two grid cells, so
+ *  each object is only reached by the lights around it.
+ *  The number of lights added is returned, which is less
+ *  than asked for once the light block is full.
+ ***********************************************************/
+int SceneManager::AddPointLights(int count)
+{
+	if ((count <= 0) || (m_sceneObjects.empty() == true))
+	{
+		return(0);
+	}
+
+	m_pointLightCount = count;
+
+	glm::vec3 boundsMin = TransformKernels::GetPosition(m_transforms, 0);
+	glm::vec3 boundsMax = boundsMin;
+	for (int i = 1; i < m_sceneObjects.size(); i++)
+	{
+		glm::vec3 position = TransformKernels::GetPosition(m_transforms, i);
+		boundsMin = glm::min(boundsMin, position);
+		boundsMax = glm::max(boundsMax, position);
+	}
+
+	int gridSize = 1;
+	while (gridSize * gridSize < count)
+	{
+		gridSize++;
+	}
+	float cellX = glm::max((boundsMax.x - boundsMin.x) / gridSize, 1.0f);
+	float cellZ = glm::max((boundsMax.z - boundsMin.z) / gridSize, 1.0f);
+
+	const glm::vec3 colors[] =
+	{
+		glm::vec3(1.0f, 0.6f, 0.3f),
+		glm::vec3(0.4f, 0.7f, 1.0f),
+		glm::vec3(0.6f, 1.0f, 0.5f),
+		glm::vec3(1.0f, 0.5f, 0.8f),
+		glm::vec3(1.0f, 1.0f, 0.6f),
+		glm::vec3(0.7f, 0.5f, 1.0f)
+	};
+	const int colorCount = sizeof(colors) / sizeof(colors[0]);
+
+	int added = 0;
+	for (int i = 0; i < count; i++)
+	{
+		LightManager::LIGHT_SOURCE light;
+		light.position = glm::vec3(
+			boundsMin.x + ((i % gridSize) + 0.5f) * cellX,
+			boundsMax.y + 1.0f,
+			boundsMin.z + ((i / gridSize) + 0.5f) * cellZ);
+		light.ambientColor = glm::vec3(0.0f);
+		light.diffuseColor = colors[i % colorCount] * 0.8f;
+		light.specularColor = colors[i % colorCount];
+		light.focalStrength = 32.0f;
+		light.specularIntensity = 0.3f;
+		light.range = 2.0f * glm::max(cellX, cellZ);
+		if (m_lightManager->AddLight(light) < 0)
+		{
+			break;
+		}
+		added++;
+	}
+
+	return(added);
+}
+
+/***********************************************************
+ *  GetMeshBounds()
+ *
+ *  This method is used for getting the local bounds of the
+ *  basic mesh used by a scene object.
+ ***********************************************************/
+const BoundingVolumes::BOUNDING_BOX& SceneManager::GetMeshBounds(MESH_KIND mesh)
+{
+	return(g_MeshBounds[mesh]);
+}
+
+/***********************************************************
+ *  UpdateSpatialIndex()
+ *
+ *  This method is used for bringing the spatial index up to
+ *  date with the scene objects.  The index is built again
+ *  when objects were added or when refitting has worn it
+ *  out, and only refitted when objects just moved.
+ ***********************************************************/
+void SceneManager::UpdateSpatialIndex()
+{
+	bool bRebuild = (m_spatialIndex->GetObjectCount() != (int)m_sceneObjects.size());
+	if ((bRebuild == false) && (m_bSpatialIndexDirty == false))
+	{
+		return;
+	}
+
+	// bring the world bounds up to date with the transforms;
+	// every object only touches its own entries, so chunks of
+	// objects are composed on all cores, and the dirty ones of
+	// each chunk go through the kernels together
+	m_jobSystem->ParallelFor((int)m_sceneObjects.size(), g_ObjectsPerJob,
+		[this](int first, int last, int threadIndex)
+		{
+			TransformKernels::ComposeDirty(
+				m_transforms,
+				first,
+				last,
+				m_modelMatrices.data(),
+				m_objectBounds.data());
+		});
+
+	if (bRebuild == false)
+	{
+		m_spatialIndex->Refit(m_objectBounds);
+		bRebuild = m_spatialIndex->NeedsRebuild();
+	}
+	if (bRebuild == true)
+	{
+		m_spatialIndex->Build(m_objectBounds);
+	}
+
+	// the shadow casters changed, so the cached shadow maps are
+	// drawn again around the new bounds of the scene
+	if (m_objectBounds.empty() == false)
+	{
+		m_sceneBounds = m_objectBounds[0];
+		for (int i = 1; i < m_objectBounds.size(); i++)
+		{
+			m_sceneBounds = BoundingVolumes::MergeBoxes(m_sceneBounds, m_objectBounds[i]);
+		}
+	}
+	m_casterRevision++;
+
+	m_bSpatialIndexDirty = false;
+}
+
+/***********************************************************
+ *  IsGpuDrawn()
+ *
+ *  This method is used for checking whether a scene object
+ *  is drawn by the GPU renderer, which needs a pooled mesh
+ *  and a material inside the material block.
+ ***********************************************************/
+bool SceneManager::IsGpuDrawn(const SCENE_OBJECT& object) const
+{
+	return((m_bGpuDriven == true) &&
+		(m_gpuMeshRanges[object.mesh] >= 0) &&
+		(object.materialIndex >= 0) &&
+		(object.materialIndex < g_MaxShaderMaterials));
+}
+
+/***********************************************************
+ *  InitializeGpuRenderer()
+ *
+ *  This method is used for building the GPU renderer from
+ *  the scene shaders and for uploading the table of pooled
+ *  mesh ranges.  Every pooled mesh takes one entry per level
+ *  of detail; meshes without levels take a single entry.
+ ***********************************************************/
+void SceneManager::InitializeGpuRenderer()
+{
+	m_gpuMeshRanges.assign(MESH_PYRAMID4 + 1, -1);
+
+	if (m_gpuRenderer->Initialize(
+		"shaders/vertexShader.glsl",
+		"shaders/fragmentShader.glsl",
+		"shaders/cullCompute.glsl") == false)
+	{
+		return;
+	}
+
+	std::vector<GpuDrivenRenderer::MESH_RANGE_DATA> meshRanges;
+	for (int mesh = 0; mesh <= MESH_PYRAMID4; mesh++)
+	{
+		if (SupportsInstancing((MESH_KIND)mesh) == false)
+		{
+			continue;
+		}
+
+		m_gpuMeshRanges[mesh] = (int)meshRanges.size();
+
+		int levels = (SupportsLevelOfDetail((MESH_KIND)mesh) == true) ? PrimitiveMeshes::LOD_LEVELS : 1;
+		for (int level = 0; level < levels; level++)
+		{
+			const PrimitiveMeshes::MESH_RANGE* pRange = NULL;
+			switch (mesh)
+			{
+			case MESH_PLANE:
+				pRange = &m_instancedMeshes->GetPlaneRange();
+				break;
+			case MESH_BOX:
+				pRange = &m_instancedMeshes->GetBoxRange();
+				break;
+			case MESH_CYLINDER:
+				pRange = &m_instancedMeshes->GetCylinderRange(level);
+				break;
+			case MESH_CONE:
+				pRange = &m_instancedMeshes->GetConeRange(level);
+				break;
+			case MESH_SPHERE:
+				pRange = &m_instancedMeshes->GetSphereRange(level);
+				break;
+			}
+
+			GpuDrivenRenderer::MESH_RANGE_DATA range;
+			range.indexCount = (GLuint)pRange->nIndices;
+			range.firstIndex = pRange->firstIndex;
+			range.baseVertex = pRange->baseVertex;
+			range.padding = 0;
+			meshRanges.push_back(range);
+		}
+	}
+
+	m_gpuRenderer->SetMeshRanges(meshRanges);
+}
+
+/***********************************************************
+ *  UpdateGpuObjects()
+ *
+ *  This method is used for rebuilding the object data of
+ *  the GPU renderer from the scene objects it draws.  This
+ *  only happens in frames where objects moved, were added
+ *  or got their texture, and the world bounds are expected
+ *  to be up to date with the spatial index.  The data is
+ *  handed to the GPU renderer with the frame packet.
+ ***********************************************************/
+void SceneManager::UpdateGpuObjects(
+	std::vector<GpuDrivenRenderer::OBJECT_DATA>& objects)
+{
+	objects.clear();
+
+	for (int i = 0; i < m_sceneObjects.size(); i++)
+	{
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		if (IsGpuDrawn(object) == false)
+		{
+			continue;
+		}
+
+		GpuDrivenRenderer::OBJECT_DATA data;
+		data.model = GetModelMatrix(i);
+		data.boundsMin = glm::vec4(m_objectBounds[i].minPoint, 1.0f);
+		data.boundsMax = glm::vec4(m_objectBounds[i].maxPoint, 1.0f);
+		data.materialIndex = object.materialIndex;
+		data.textureArray = -1;
+		data.textureLayer = 0;
+		if ((object.textureSlot >= 0) && (object.textureSlot < m_textureArrays->GetTextureCount()))
+		{
+			const TextureArrays::TEXTURE_LOCATION& location = m_textureArrays->GetLocation(object.textureSlot);
+			if (location.arrayIndex < GpuDrivenRenderer::MAX_TEXTURE_ARRAYS)
+			{
+				data.textureArray = location.arrayIndex;
+				data.textureLayer = location.layer;
+			}
+		}
+		data.meshRangeIndex = m_gpuMeshRanges[object.mesh];
+		data.UVscale = object.UVscale;
+		data.lodLevel = object.lodLevel;
+		data.lodCount = (SupportsLevelOfDetail(object.mesh) == true) ? PrimitiveMeshes::LOD_LEVELS : 1;
+		objects.push_back(data);
+	}
+
+	m_gpuObjectCount = (int)objects.size();
+	m_bGpuObjectsDirty = false;
+}
+
+/***********************************************************
+ *  PickSceneObject()
+ *
+ *  This method is used for finding the scene object whose
+ *  bounds are hit first by a ray, such as the ray through
+ *  the mouse position.  The index of the object is
+ *  returned, or -1 when the ray hits nothing.
+ ***********************************************************/
+int SceneManager::PickSceneObject(
+	const glm::vec3& origin,
+	const glm::vec3& direction)
+{
+	float hitDistance = 0.0f;
+
+	UpdateSpatialIndex();
+
+	return(m_spatialIndex->Raycast(origin, direction, hitDistance));
+}
+
+/***********************************************************
+ *  FindNearestSceneObject()
+ *
+ *  This method is used for finding the scene object whose
+ *  bounds are nearest to a point.  The index of the object
+ *  is returned, or -1 when the scene is empty.
+ ***********************************************************/
+int SceneManager::FindNearestSceneObject(const glm::vec3& point)
+{
+	float nearestDistance = 0.0f;
+
+	UpdateSpatialIndex();
+
+	return(m_spatialIndex->FindNearest(point, nearestDistance));
+}
+
+/***********************************************************
+ *  SetViewProjection()
+ *
+ *  This method is used for setting the view that the scene
+ *  objects are culled against in the next frame packet,
+ *  usually the matrices built by the view manager.  The
+ *  same view decides the level of detail of the objects
+ *  and where the shadow cascades are placed.
+ ***********************************************************/
+void SceneManager::SetViewProjection(
+	const glm::mat4& view,
+	const glm::mat4& projection)
+{
+	m_viewMatrix = view;
+	m_projectionMatrix = projection;
+	m_viewFrustum = BoundingVolumes::ExtractFrustum(projection * view);
+	m_bHasViewFrustum = true;
+
+	// the camera position and the projection scale are kept for
+	// choosing the level of detail from the projected size
+	m_cameraPosition = glm::vec3(glm::inverse(view)[3]);
+	m_projectionScale = projection[1][1];
+	m_bOrthographicView = (projection[3][3] == 1.0f);
+}
+
+/***********************************************************
+ *  SetLevelOfDetail()
+ *
+ *  This method is used for turning the automatic level of
+ *  detail of the round meshes on or off.
+ ***********************************************************/
+void SceneManager::SetLevelOfDetail(bool bLevelOfDetail)
+{
+	m_bLevelOfDetail = bLevelOfDetail;
+}
+
+/***********************************************************
+ *  SetGpuDriven()
+ *
+ *  This method is used for turning GPU driven rendering on
+ *  or off.  While it is on, the objects that use the pooled
+ *  meshes are culled and drawn by the GPU renderer with one
+ *  indirect draw call, and only the others go through the
+ *  render queue.  False is returned when the context cannot
+ *  support it, which leaves it off.
+ ***********************************************************/
+bool SceneManager::SetGpuDriven(bool bGpuDriven)
+{
+	if ((bGpuDriven == true) && (m_gpuRenderer->IsSupported() == false))
+	{
+		m_bGpuDriven = false;
+		return(false);
+	}
+
+	m_bGpuDriven = bGpuDriven;
+	m_bGpuObjectsDirty = true;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsGpuDriven()
+ *
+ *  This method is used for checking whether the pooled
+ *  meshes are culled and drawn by the GPU renderer.
+ ***********************************************************/
+bool SceneManager::IsGpuDriven() const
+{
+	return(m_bGpuDriven);
+}
+
+/***********************************************************
+ *  SetFrustumCulling()
+ *
+ *  This method is used for turning the culling of objects
+ *  outside the view frustum on or off.
+ ***********************************************************/
+void SceneManager::SetFrustumCulling(bool bCulling)
+{
+	m_bFrustumCulling = bCulling;
+}
+
+/***********************************************************
+ *  SetClusteredLighting()
+ *
+ *  This method is used for switching between shading every
+ *  fragment with every light and shading it with only the
+ *  lights binned into its cluster of the view.  The switch
+ *  takes effect with the next frame.  False is returned
+ *  when the context cannot support clustering, which
+ *  leaves every light in use.
+ ***********************************************************/
+bool SceneManager::SetClusteredLighting(bool bClustered)
+{
+	return(m_clusteredLighting->SetEnabled(bClustered));
+}
+
+/***********************************************************
+ *  IsClusteredLighting()
+ *
+ *  This method is used for checking whether the fragments
+ *  only visit the lights of their cluster.
+ ***********************************************************/
+bool SceneManager::IsClusteredLighting() const
+{
+	return(m_clusteredLighting->IsEnabled());
+}
+
+/***********************************************************
+ *  SetDepthPrepass()
+ *
+ *  This method is used for turning the depth pre-pass on
+ *  or off.  While it is on, the scene is drawn into the
+ *  depth buffer before it is shaded, so that overdraw no
+ *  longer costs any lighting.
+ ***********************************************************/
+void SceneManager::SetDepthPrepass(bool bDepthPrepass)
+{
+	m_bDepthPrepass = bDepthPrepass;
+}
+
+/***********************************************************
+ *  IsDepthPrepass()
+ *
+ *  This method is used for checking whether the depth
+ *  pre-pass is drawn before the scene is shaded.
+ ***********************************************************/
+bool SceneManager::IsDepthPrepass() const
+{
+	return(m_bDepthPrepass);
+}
+
+/***********************************************************
+ *  SetOcclusionCulling()
+ *
+ *  This method is used for turning occlusion culling on or
+ *  off.  While it is on, the depth of every drawn frame is
+ *  reduced into a pyramid, and the objects of the frames
+ *  after it that are hidden behind that depth are skipped:
+ *  by the cull shader for the GPU renderer, and while the
+ *  frame packet is built for the render queue.  Depths
+ *  held from before it was turned on are dropped.  False
+ *  is returned when the context cannot support it, which
+ *  leaves it off.  The frame packets read the setting, so
+ *  this has to be called on the GL thread while no frame
+ *  packet is being built.
+ ***********************************************************/
+bool SceneManager::SetOcclusionCulling(bool bOcclusion)
+{
+	if ((bOcclusion == true) && (m_hiZBuffer->IsSupported() == false))
+	{
+		m_bOcclusionCulling = false;
+		return(false);
+	}
+
+	if ((bOcclusion == true) && (m_bOcclusionCulling == false))
+	{
+		m_hiZBuffer->Invalidate();
+	}
+	m_bOcclusionCulling = bOcclusion;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsOcclusionCulling()
+ *
+ *  This method is used for checking whether objects hidden
+ *  behind the depth of the last frames are skipped.
+ ***********************************************************/
+bool SceneManager::IsOcclusionCulling() const
+{
+	return(m_bOcclusionCulling);
+}
+
+/***********************************************************
+ *  CollectOcclusionBuffer()
+ *
+ *  This method is used for taking in the latest depth
+ *  pyramid the GPU has finished reading back, which the
+ *  frame packets built after it test the objects of the
+ *  render queue against.  The readbacks are only polled,
+ *  so the pyramid held can be a few frames old.  With
+ *  occlusion culling off, the pyramid held is dropped.
+ *  This has to be called on the GL thread while no frame
+ *  packet is being built.
+ ***********************************************************/
+void SceneManager::CollectOcclusionBuffer()
+{
+	if (m_bOcclusionCulling == false)
+	{
+		m_occlusionPyramid.bValid = false;
+		return;
+	}
+
+	m_hiZBuffer->CollectReadback(m_occlusionPyramid);
+}
+
+/***********************************************************
+ *  SetShadowSettings()
+ *
+ *  This method is used for choosing the size of the shadow
+ *  map layers and the number of cascades the view is split
+ *  into.  The shadow maps are made by PrepareScene(), so
+ *  this has to be called before it; 0 cascades leaves the
+ *  scene without shadows.
+ ***********************************************************/
+void SceneManager::SetShadowSettings(int resolution, int cascadeCount)
+{
+	m_shadowResolution = resolution;
+	m_shadowCascades = cascadeCount;
+}
+
+/***********************************************************
+ *  GetShadowResolution()
+ *
+ *  This method is used for getting the size of the shadow
+ *  map layers in use.
+ ***********************************************************/
+int SceneManager::GetShadowResolution() const
+{
+	return(m_shadowMaps->GetResolution());
+}
+
+/***********************************************************
+ *  GetShadowCascadeCount()
+ *
+ *  This method is used for getting the number of shadow
+ *  cascades in use, which is 0 without shadows.
+ ***********************************************************/
+int SceneManager::GetShadowCascadeCount() const
+{
+	return(m_shadowMaps->GetCascadeCount());
+}
+
+/***********************************************************
+ *  GetSceneObjectCount()
+ *
+ *  This method is used for getting the number of retained
+ *  scene objects.
+ ***********************************************************/
+int SceneManager::GetSceneObjectCount() const
+{
+	return((int)m_sceneObjects.size());
+}
+
+/***********************************************************
+ *  GetPendingTextureCount()
+ *
+ *  This method is used for getting the number of textures
+ *  that are still loading in the background.
+ ***********************************************************/
+int SceneManager::GetPendingTextureCount() const
+{
+	return(m_textureLoader->GetPendingCount());
+}
+
+/**************************************************************/
+/*** STUDENTS CAN MODIFY the code in the methods BELOW for  ***/
+/*** preparing and rendering their own 3D replicated scenes.***/
+/*** Please refer to the code in the OpenGL sample project  ***/
+/*** for assistance.                                        ***/
+/**************************************************************/
+
+/***********************************************************
+  *  LoadSceneTextures()
+  *
+  *  This method is used for preparing the 3D scene by loading
+  *  the textures listed in the scene file into memory.  The
+  *  images are decoded in the background and the scene is
+  *  drawn with placeholders until they arrive.
+  ***********************************************************/
+void SceneManager::LoadSceneTextures()
+{
+	for (int i = 0; i < m_sceneFile->GetTextureCount(); i++)
+	{
+		const SceneFile::TEXTURE_RECORD& texture = m_sceneFile->GetTextureRecord(i);
+		if (RequestGLTexture(texture.path, texture.tag) == false)
+		{
+			std::cout << "Failed to load texture:" << texture.tag << std::endl;
+		}
+	}
+
+	BindGLTextures();
+
+	// the scene objects can look up their texture slots now
+	ResolveSceneTextures();
+
+	// everything has been copied out of the scene file
+	m_sceneFile->Close();
+}
+
+/***********************************************************
+ *  PrepareScene()
+ *
+ *  This method is used for preparing the 3D scene by loading
+ *  the shapes, textures in memory to support the 3D scene 
+ *  rendering
+ ***********************************************************/
+void SceneManager::PrepareScene()
+{
+	// only one instance of a particular mesh needs to be
+	// loaded in memory no matter how many times it is drawn
+	// in the rendered 3D scene
+
+	m_basicMeshes->LoadPlaneMesh();
+	m_basicMeshes->LoadCylinderMesh();
+	m_basicMeshes->LoadBoxMesh();
+	m_basicMeshes->LoadConeMesh();
+	m_basicMeshes->LoadPrismMesh();
+	m_basicMeshes->LoadSphereMesh();
+	m_basicMeshes->LoadPyramid4Mesh();
+
+	// the repeated meshes also get versions that can be
+	// drawn many times with one instanced draw call; they
+	// share one pooled vertex buffer and vertex array
+	m_instancedMeshes->LoadPlaneMesh();
+	m_instancedMeshes->LoadBoxMesh();
+	m_instancedMeshes->LoadCylinderMesh();
+	m_instancedMeshes->LoadConeMesh();
+	m_instancedMeshes->LoadSphereMesh();
+
+	// the pooled meshes can also be culled and drawn on the GPU
+	// where the context supports it
+	InitializeGpuRenderer();
+
+	// the depth of the drawn frames can be reduced for occlusion
+	// culling where the context supports it
+	m_hiZBuffer->Initialize("shaders/hizCompute.glsl");
+
+	// the textures, materials, lights and objects of the scene
+	// are described by the scene file, which stays open until
+	// LoadSceneTextures() has requested the textures
+	if (m_sceneFile->Load(m_sceneFilename, m_sceneFilename + g_CompiledSceneSuffix) == false)
+	{
+		std::cout << "Failed to load scene file:" << m_sceneFilename << std::endl;
+	}
+
+	DefineSceneMaterials();
+
+	// instanced draws look their materials up in the shader
+	LoadShaderMaterials();
+
+	// the lights of the scene do not change between frames,
+	// so they are defined and uploaded once here
+	DefineSceneLights();
+
+	// build the retained scene objects once the materials
+	// they reference have been defined
+	DefineSceneObjects();
+
+	// build the spatial index over the retained scene objects
+	UpdateSpatialIndex();
+}
+
+/***********************************************************
+ *  DefineSceneLights()
+ *
+ *  This method is used for defining the light sources of
+ *  the scene file and enabling lighting in the shader.  The
+ *  light buffer is only uploaded again when a light is
+ *  added or changed through the light manager.
+ ***********************************************************/
+void SceneManager::DefineSceneLights()
+{
+	if (m_pShaderUniforms == NULL)
+	{
+		return;
+	}
+
+	m_lightManager->Initialize(ShaderUniforms::LIGHT_BLOCK_BINDING);
+
+	// the scene shaders read the cluster and shadow blocks in
+	// either mode, so they are created even where clustering
+	// or shadows are not supported
+	m_clusteredLighting->Initialize("shaders/clusterCompute.glsl");
+	m_shadowMaps->Initialize(m_shadowResolution, m_shadowCascades);
+
+	// Enable Phong calculations
+	m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, true);
+	m_gpuRenderer->SetLighting(true);
+
+	AddSceneFileLights();
+
+	m_lightManager->UploadChanges(*m_frameArena);
+}
+
+
+/***********************************************************
+ *  AddSceneFileLights()
+ *
+ *  This method is used for adding the lights of the scene
+ *  file to the light manager.
+ ***********************************************************/
+void SceneManager::AddSceneFileLights()
+{
+	for (int i = 0; i < m_sceneFile->GetLightCount(); i++)
+	{
+		const SceneFile::LIGHT_RECORD& record = m_sceneFile->GetLightRecord(i);
+
+		LightManager::LIGHT_SOURCE light;
+		light.position = glm::make_vec3(record.position);
+		light.ambientColor = glm::make_vec3(record.ambientColor);
+		light.diffuseColor = glm::make_vec3(record.diffuseColor);
+		light.specularColor = glm::make_vec3(record.specularColor);
+		light.focalStrength = record.focalStrength;
+		light.specularIntensity = record.specularIntensity;
+		light.range = record.range;
+		m_lightManager->AddLight(light);
+	}
+}
+
+/***********************************************************
+ *  EnableHotReload()
+ *
+ *  This method is used for watching the files the scene is
+ *  built from: the scene shaders and the culling shader,
+ *  the scene file and every texture image.  Changes are
+ *  picked up by ReloadChangedFiles() between frames.
+ ***********************************************************/
+void SceneManager::EnableHotReload(
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath)
+{
+	m_bHotReload = true;
+	m_vertexShaderPath = vertexShaderPath;
+	m_fragmentShaderPath = fragmentShaderPath;
+
+	m_vertexShaderWatch = m_fileWatcher->Watch(m_vertexShaderPath);
+	m_fragmentShaderWatch = m_fileWatcher->Watch(m_fragmentShaderPath);
+	if (m_gpuRenderer->IsSupported() == true)
+	{
+		m_cullShaderWatch = m_fileWatcher->Watch(m_gpuRenderer->GetCullShaderPath());
+	}
+	if (m_clusteredLighting->IsSupported() == true)
+	{
+		m_clusterShaderWatch = m_fileWatcher->Watch(m_clusteredLighting->GetShaderPath());
+	}
+	if (m_hiZBuffer->IsSupported() == true)
+	{
+		m_hiZShaderWatch = m_fileWatcher->Watch(m_hiZBuffer->GetShaderPath());
+	}
+	m_sceneFileWatch = m_fileWatcher->Watch(m_sceneFilename);
+
+	for (int i = 0; i < m_textureFiles.size(); i++)
+	{
+		if (m_textureFiles[i].empty() == false)
+		{
+			m_fileWatcher->Watch(m_textureFiles[i]);
+		}
+	}
+}
+
+/***********************************************************
+ *  ReloadChangedFiles()
+ *
+ *  This method is used for reloading the watched files that
+ *  changed.  Shaders are built again and replace the
+ *  current programs only when they build, changed textures
+ *  are decoded again in the background into the slots they
+ *  already have, and a changed scene file is applied to the
+ *  retained scene.  This has to be called between frames on
+ *  the thread owning the GL context.
+ ***********************************************************/
+void SceneManager::ReloadChangedFiles()
+{
+	if (m_bHotReload == false)
+	{
+		return;
+	}
+
+	std::vector<int> changedFiles;
+	if (m_fileWatcher->Poll(changedFiles) == false)
+	{
+		return;
+	}
+
+	bool bSceneShaders = false;
+	bool bCullShader = false;
+	bool bClusterShader = false;
+	bool bHiZShader = false;
+	bool bSceneFile = false;
+	for (int i = 0; i < changedFiles.size(); i++)
+	{
+		int fileID = changedFiles[i];
+		if ((fileID == m_vertexShaderWatch) || (fileID == m_fragmentShaderWatch))
+		{
+			bSceneShaders = true;
+		}
+		else if (fileID == m_cullShaderWatch)
+		{
+			bCullShader = true;
+		}
+		else if (fileID == m_clusterShaderWatch)
+		{
+			bClusterShader = true;
+		}
+		else if (fileID == m_hiZShaderWatch)
+		{
+			bHiZShader = true;
+		}
+		else if (fileID == m_sceneFileWatch)
+		{
+			bSceneFile = true;
+		}
+		else
+		{
+			// several tags can share one image file
+			const std::string& filename = m_fileWatcher->GetFilename(fileID);
+			for (int slot = 0; slot < m_textureFiles.size(); slot++)
+			{
+				if (m_textureFiles[slot] == filename)
+				{
+					std::cout << "Reloading texture:" << filename << std::endl;
+					m_textureLoader->RequestTexture(filename.c_str(), slot);
+				}
+			}
+		}
+	}
+
+	if (bSceneShaders == true)
+	{
+		ReloadSceneShaders();
+	}
+
+	// the GPU renderer builds the scene shaders a second time
+	if (((bSceneShaders == true) || (bCullShader == true)) &&
+		(m_gpuRenderer->IsSupported() == true))
+	{
+		if (m_gpuRenderer->ReloadShaders() == false)
+		{
+			std::cout << "Keeping the previous GPU driven shaders" << std::endl;
+		}
+	}
+
+	if ((bClusterShader == true) &&
+		(m_clusteredLighting->ReloadShader() == false))
+	{
+		std::cout << "Keeping the previous cluster shader" << std::endl;
+	}
+
+	if ((bHiZShader == true) &&
+		(m_hiZBuffer->ReloadShader() == false))
+	{
+		std::cout << "Keeping the previous depth pyramid shader" << std::endl;
+	}
+
+	if (bSceneFile == true)
+	{
+		ReloadSceneFile();
+	}
+}
+
+/***********************************************************
+ *  ReloadSceneShaders()
+ *
+ *  This method is used for building the scene program again
+ *  from its shader files.  The new program is only put in
+ *  use when it compiles and links; otherwise the previous
+ *  one stays in use and the log is printed.  The uniform
+ *  locations and blocks are resolved again, and the
+ *  uniforms that are only set once are set on the new
+ *  program.
+ ***********************************************************/
+bool SceneManager::ReloadSceneShaders()
+{
+	if (m_pShaderUniforms == NULL)
+	{
+		return(false);
+	}
+
+	GLuint programID = ShaderLoader::BuildProgram(
+		m_vertexShaderPath.c_str(),
+		m_fragmentShaderPath.c_str(),
+		NULL);
+	if (programID == 0)
+	{
+		std::cout << "Keeping the previous scene shaders" << std::endl;
+		return(false);
+	}
+
+	GLStateCache::UseProgram(programID);
+	m_pShaderUniforms->Resolve(programID);
+	m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, true);
+
+	// the first program belongs to the shader manager, which
+	// frees it itself
+	if (m_reloadedProgram != 0)
+	{
+		glDeleteProgram(m_reloadedProgram);
+	}
+	m_reloadedProgram = programID;
+
+	std::cout << "Reloaded scene shaders" << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  ReloadSceneFile()
+ *
+ *  This method is used for applying a changed scene file.
+ *  Materials are replaced by tag and only the changed ones
+ *  are uploaded, the lights are defined again, new textures
+ *  are requested, textures whose file changed are loaded
+ *  again into their slots, and the objects are defined
+ *  again along with any copies.  A file that fails to parse
+ *  leaves the scene as it is.
+ ***********************************************************/
+bool SceneManager::ReloadSceneFile()
+{
+	// the source is known to be newer than the compiled file
+	if (m_sceneFile->Parse(m_sceneFilename) == false)
+	{
+		std::cout << "Keeping the previous scene" << std::endl;
+		return(false);
+	}
+	m_sceneFile->Compile(m_sceneFilename + g_CompiledSceneSuffix);
+
+	DefineSceneMaterials();
+	LoadShaderMaterials();
+
+	m_lightManager->RemoveAllLights();
+	AddSceneFileLights();
+
+	for (int i = 0; i < m_sceneFile->GetTextureCount(); i++)
+	{
+		const SceneFile::TEXTURE_RECORD& texture = m_sceneFile->GetTextureRecord(i);
+		int textureSlot = FindTextureSlot(texture.tag);
+		if (textureSlot < 0)
+		{
+			RequestGLTexture(texture.path, texture.tag);
+		}
+		else if (m_textureFiles[textureSlot] != texture.path)
+		{
+			m_textureFiles[textureSlot] = texture.path;
+			m_fileWatcher->Watch(texture.path);
+			m_textureLoader->RequestTexture(texture.path, textureSlot);
+		}
+	}
+
+	m_sceneObjects.clear();
+	TransformKernels::ClearTransforms(m_transforms);
+	m_modelMatrices.clear();
+	m_objectBounds.clear();
+	DefineSceneObjects();
+	ReplicateSceneObjects(m_replicaCopies, m_replicaSpacing);
+	AddPointLights(m_pointLightCount);
+	ResolveSceneTextures();
+	m_bSpatialIndexDirty = true;
+
+	m_sceneFile->Close();
+
+	std::cout << "Reloaded scene file:" << m_sceneFilename << std::endl;
+	return(true);
+}
+
+/***********************************************************
+ *  SetSceneFile()
+ *
+ *  This method is used for choosing the scene file that is
+ *  read by PrepareScene().  Its compiled form is kept next
+ *  to it and is used instead while it is up to date.
+ ***********************************************************/
+void SceneManager::SetSceneFile(const std::string& filename)
+{
+	m_sceneFilename = filename;
+}
+
+/***********************************************************
+ *  DefineSceneMaterials()
+ *
+ *  This method is used for defining the materials of the
+ *  scene file.
+ ***********************************************************/
+void SceneManager::DefineSceneMaterials()
+{
+	for (int i = 0; i < m_sceneFile->GetMaterialCount(); i++)
+	{
+		const SceneFile::MATERIAL_RECORD& record = m_sceneFile->GetMaterialRecord(i);
+
+		OBJECT_MATERIAL material;
+		material.tag = record.tag;
+		material.ambientColor = glm::make_vec3(record.ambientColor);
+		material.ambientStrength = record.ambientStrength;
+		material.diffuseColor = glm::make_vec3(record.diffuseColor);
+		material.specularColor = glm::make_vec3(record.specularColor);
+		material.shininess = record.shininess;
+		AddMaterial(material);
+	}
+}
+
+/***********************************************************
+ *  DefineSceneObjects()
+ *
+ *  This method is used for placing the objects of the scene
+ *  file.  Each object is recorded once with its
+ *  transformation values, material, texture and mesh so
+ *  that rendering a frame only walks the prepared records.
+ *  The tags of the file are resolved once up front rather
+ *  than for every object.
+ ***********************************************************/
+void SceneManager::DefineSceneObjects()
+{
+	std::vector<int> materialIndices(m_sceneFile->GetMaterialCount());
+	for (int i = 0; i < materialIndices.size(); i++)
+	{
+		materialIndices[i] = FindMaterialIndex(m_sceneFile->GetMaterialRecord(i).tag);
+	}
+
+	std::vector<std::string> textureTags(m_sceneFile->GetTextureCount());
+	for (int i = 0; i < textureTags.size(); i++)
+	{
+		textureTags[i] = m_sceneFile->GetTextureRecord(i).tag;
+	}
+	const std::string noTexture;
+
+	int objectCount = (int)m_sceneObjects.size() + m_sceneFile->GetObjectCount();
+	m_sceneObjects.reserve(objectCount);
+	TransformKernels::ReserveTransforms(m_transforms, objectCount);
+	m_modelMatrices.reserve(objectCount);
+	m_objectBounds.reserve(objectCount);
+	for (int i = 0; i < m_sceneFile->GetObjectCount(); i++)
+	{
+		const SceneFile::OBJECT_RECORD& record = m_sceneFile->GetObjectRecord(i);
+
+		AddSceneObject(
+			(MESH_KIND)record.mesh,
+			glm::make_vec3(record.scaleXYZ),
+			record.rotationDegrees[0],
+			record.rotationDegrees[1],
+			record.rotationDegrees[2],
+			glm::make_vec3(record.positionXYZ),
+			(record.materialIndex >= 0) ? materialIndices[record.materialIndex] : -1,
+			(record.textureIndex >= 0) ? textureTags[record.textureIndex] : noTexture,
+			record.UVscale[0], record.UVscale[1]);
+	}
+}
+
+/***********************************************************
+ *  BuildFramePacket()
+ *
+ *  This method is used for collecting everything needed to
+ *  draw the next frame into a frame packet.  The scene
+ *  objects are culled against the view and, with occlusion
+ *  culling on, against the depth pyramid of an earlier
+ *  frame, given their level of detail and sorted by render
+ *  state, and the draw state
+ *  of every visible object is copied into the packet.  No
+ *  OpenGL calls are made, so the packet can be built on an
+ *  update thread while the GL thread draws the previous one;
+ *  the scene must not be changed while a packet is built.
+ ***********************************************************/
+void SceneManager::BuildFramePacket(FRAME_PACKET& packet)
+{
+	// collect the draw records of the scene objects and sort
+	// them so that objects sharing render state are adjacent
+	packet.queue.Clear();
+	packet.objects.clear();
+	UpdateSpatialIndex();
+
+	// the objects with pooled meshes are culled and drawn on the
+	// GPU, which only needs their data again after a change
+	packet.bGpuDriven = m_bGpuDriven;
+	packet.bGpuObjectsChanged = false;
+	int gpuObjectCount = 0;
+	if (m_bGpuDriven == true)
+	{
+		if (m_bGpuObjectsDirty == true)
+		{
+			UpdateGpuObjects(packet.gpuObjects);
+			packet.bGpuObjectsChanged = true;
+		}
+
+		GpuDrivenRenderer::CULL_VIEW& view = packet.cullView;
+		view.frustum = m_viewFrustum;
+		view.cameraPosition = m_cameraPosition;
+		view.projectionScale = m_projectionScale;
+		view.bOrthographic = m_bOrthographicView;
+		view.bFrustumCulling = (m_bFrustumCulling == true) && (m_bHasViewFrustum == true);
+		view.bLevelOfDetail = (m_bLevelOfDetail == true) && (m_bHasViewFrustum == true);
+		view.bOcclusionCulling = (m_bOcclusionCulling == true) && (m_bHasViewFrustum == true);
+		for (int level = 0; level < PrimitiveMeshes::LOD_LEVELS - 1; level++)
+		{
+			view.lodScreenSizes[level] = g_LodScreenSizes[level];
+		}
+		view.lodHysteresis = g_LodHysteresis;
+
+		gpuObjectCount = m_gpuObjectCount;
+		packet.queue.GetStats().gpuDrivenObjects = gpuObjectCount;
+	}
+
+	if ((m_bFrustumCulling == true) && (m_bHasViewFrustum == true))
+	{
+		// objects outside the view are never submitted
+		m_spatialIndex->QueryFrustum(m_viewFrustum, m_visibleObjects);
+	}
+	else
+	{
+		m_visibleObjects.resize(m_sceneObjects.size());
+		for (int i = 0; i < m_sceneObjects.size(); i++)
+		{
+			m_visibleObjects[i] = i;
+		}
+	}
+
+	// objects hidden behind the depth of an earlier frame are
+	// never submitted either
+	int occludedObjects = 0;
+	if ((m_bOcclusionCulling == true) && (m_bHasViewFrustum == true))
+	{
+		occludedObjects = RemoveOccludedObjects();
+	}
+
+	GatherVisibleDraws(-1, packet.queue, packet.objects);
+	// objects culled on the GPU are not counted here
+	packet.queue.GetStats().occludedObjects = occludedObjects;
+	packet.queue.GetStats().culledObjects = (int)m_sceneObjects.size() - gpuObjectCount - occludedObjects - (int)packet.objects.size();
+	packet.queue.Sort();
+
+	// the casters of the key light are gathered the same way,
+	// for the cascades whose shadow maps have to be redrawn
+	BuildShadowPasses(packet);
+}
+
+/***********************************************************
+ *  GatherVisibleDraws()
+ *
+ *  This method is used for gathering the draws of the
+ *  visible objects into a queue and its draw objects.  The
+ *  objects are gathered in chunks on all cores; every chunk
+ *  fills its own results, which are merged in chunk order
+ *  so the queue does not depend on which thread ran which
+ *  chunk.  The records are left unsorted.
+ ***********************************************************/
+void SceneManager::GatherVisibleDraws(
+	int shadowLodLevel,
+	RenderQueue& queue,
+	std::vector<DRAW_OBJECT>& objects)
+{
+	int visibleCount = (int)m_visibleObjects.size();
+	int chunkCount = (visibleCount + g_ObjectsPerJob - 1) / g_ObjectsPerJob;
+	if (m_drawChunks.size() < chunkCount)
+	{
+		m_drawChunks.resize(chunkCount);
+	}
+	m_jobSystem->ParallelFor(visibleCount, g_ObjectsPerJob,
+		[this, shadowLodLevel](int first, int last, int threadIndex)
+		{
+			// chunks run inline cover the whole range at once
+			for (int chunkFirst = first; chunkFirst < last; chunkFirst += g_ObjectsPerJob)
+			{
+				int chunkLast = (chunkFirst + g_ObjectsPerJob < last) ? (chunkFirst + g_ObjectsPerJob) : last;
+				GatherDraws(chunkFirst, chunkLast, shadowLodLevel, m_drawChunks[chunkFirst / g_ObjectsPerJob]);
+			}
+		});
+
+	for (int c = 0; c < chunkCount; c++)
+	{
+		const DRAW_CHUNK& chunk = m_drawChunks[c];
+		int firstObject = (int)objects.size();
+		for (int r = 0; r < chunk.records.size(); r++)
+		{
+			const RenderQueue::DRAW_RECORD& record = chunk.records[r];
+			queue.Submit(
+				firstObject + record.objectIndex,
+				record.mesh,
+				record.materialIndex,
+				record.textureSlot);
+		}
+		objects.insert(objects.end(), chunk.objects.begin(), chunk.objects.end());
+		queue.GetStats().reducedDetailObjects += chunk.reducedDetailObjects;
+	}
+}
+
+/***********************************************************
+ *  RemoveOccludedObjects()
+ *
+ *  This method is used for dropping the visible objects
+ *  hidden behind the depth pyramid last read back.  The
+ *  objects are tested in chunks on all cores, and the list
+ *  is then compacted in order.  The objects of the GPU
+ *  renderer are kept, since the cull shader tests them
+ *  against the pyramid of the last frame itself.  Without
+ *  a pyramid nothing is dropped.
+ ***********************************************************/
+int SceneManager::RemoveOccludedObjects()
+{
+	if (m_occlusionPyramid.bValid == false)
+	{
+		return(0);
+	}
+
+	int visibleCount = (int)m_visibleObjects.size();
+	m_occludedFlags.resize(visibleCount);
+	m_jobSystem->ParallelFor(visibleCount, g_ObjectsPerJob,
+		[this](int first, int last, int threadIndex)
+		{
+			for (int v = first; v < last; v++)
+			{
+				int i = m_visibleObjects[v];
+				m_occludedFlags[v] =
+					(IsGpuDrawn(m_sceneObjects[i]) == false) &&
+					(HiZBuffer::IsBoxOccluded(m_occlusionPyramid, m_objectBounds[i]) == true);
+			}
+		});
+
+	int keptCount = 0;
+	for (int v = 0; v < visibleCount; v++)
+	{
+		if (m_occludedFlags[v] == 0)
+		{
+			m_visibleObjects[keptCount++] = m_visibleObjects[v];
+		}
+	}
+	m_visibleObjects.resize(keptCount);
+
+	return(visibleCount - keptCount);
+}
+
+/***********************************************************
+ *  BuildShadowPasses()
+ *
+ *  This method is used for placing the shadow cascades of
+ *  the key light over the view of the packet and gathering
+ *  the casters of every stale cascade.  The key light is
+ *  treated as a directional light shining from its position
+ *  towards the middle of the scene.  The casters are found
+ *  by the spatial index, gathered by the same jobs as the
+ *  view and sorted by the same queue, and the GPU renderer
+ *  culls its objects against the light view as well.
+ *  Cascades that are not stale keep their shadow maps and
+ *  get no draws.
+ ***********************************************************/
+void SceneManager::BuildShadowPasses(FRAME_PACKET& packet)
+{
+	packet.shadowBlock = ShadowMaps::SHADOW_BLOCK();
+	if ((m_shadowMaps->IsSupported() == false) ||
+		(m_bHasViewFrustum == false) ||
+		(m_lightManager->GetLightCount() == 0))
+	{
+		packet.shadowPasses.clear();
+		return;
+	}
+
+	glm::vec3 sceneCenter = (m_sceneBounds.minPoint + m_sceneBounds.maxPoint) * 0.5f;
+	glm::vec3 lightDirection = sceneCenter - m_lightManager->GetLight(0).position;
+	if (glm::length(lightDirection) < 0.001f)
+	{
+		lightDirection = glm::vec3(0.0f, -1.0f, 0.0f);
+	}
+
+	ShadowMaps::CASCADE cascades[ShadowMaps::MAX_CASCADES];
+	m_shadowMaps->PlaceCascades(
+		m_viewMatrix,
+		m_projectionMatrix,
+		lightDirection,
+		m_sceneBounds,
+		m_casterRevision,
+		cascades,
+		packet.shadowBlock);
+
+	packet.shadowPasses.resize(m_shadowMaps->GetCascadeCount());
+	for (int c = 0; c < packet.shadowPasses.size(); c++)
+	{
+		SHADOW_PASS& pass = packet.shadowPasses[c];
+		pass.cascade = cascades[c];
+		pass.queue.Clear();
+		pass.objects.clear();
+		if (pass.cascade.bStale == false)
+		{
+			continue;
+		}
+
+		// casters outside the camera view still throw shadows
+		// into it, so they are only culled by the light view
+		m_spatialIndex->QueryFrustum(pass.cascade.frustum, m_visibleObjects);
+		GatherVisibleDraws(c, pass.queue, pass.objects);
+		pass.queue.Sort();
+
+		// the GPU renderer keeps the levels chosen for the view
+		GpuDrivenRenderer::CULL_VIEW& view = pass.cullView;
+		view.frustum = pass.cascade.frustum;
+		view.cameraPosition = glm::vec3(glm::inverse(pass.cascade.view)[3]);
+		view.projectionScale = 1.0f;
+		view.bOrthographic = true;
+		view.bFrustumCulling = true;
+		view.bLevelOfDetail = false;
+		// the pyramid holds the depth seen by the camera, which
+		// says nothing about what the light sees
+		view.bOcclusionCulling = false;
+		for (int level = 0; level < PrimitiveMeshes::LOD_LEVELS - 1; level++)
+		{
+			view.lodScreenSizes[level] = g_LodScreenSizes[level];
+		}
+		view.lodHysteresis = g_LodHysteresis;
+	}
+}
+
+/***********************************************************
+ *  GatherDraws()
+ *
+ *  This method is used for gathering the draws of a range
+ *  of the visible objects into a chunk, choosing the level
+ *  of detail and copying the draw state of every object
+ *  not drawn by the GPU renderer.  Jobs on several threads
+ *  run this at the same time for different ranges, so only
+ *  the objects in the range and the chunk are changed.
+ *  Shadow casters, gathered with a shadow level of detail
+ *  of 0 or more, only need their depth, so they all share
+ *  one material and no texture, which lets the most of
+ *  them go into the same instanced draws, and the round
+ *  meshes of farther cascades use coarser levels.
+ ***********************************************************/
+void SceneManager::GatherDraws(int firstVisible, int lastVisible, int shadowLodLevel, DRAW_CHUNK& chunk)
+{
+	chunk.objects.clear();
+	chunk.records.clear();
+	chunk.reducedDetailObjects = 0;
+
+	for (int v = firstVisible; v < lastVisible; v++)
+	{
+		int i = m_visibleObjects[v];
+		const SCENE_OBJECT& object = m_sceneObjects[i];
+		if (IsGpuDrawn(object) == true)
+		{
+			continue;
+		}
+
+		bool bShaderMaterial = (object.materialIndex >= 0) && (object.materialIndex < g_MaxShaderMaterials);
+
+		// each level of detail is a mesh of its own for sorting
+		// and batching
+		int lodLevel = 0;
+		if (shadowLodLevel < 0)
+		{
+			lodLevel = SelectLevelOfDetail(i);
+		}
+		else if ((SupportsLevelOfDetail(object.mesh) == true) && (bShaderMaterial == true))
+		{
+			lodLevel = (shadowLodLevel < PrimitiveMeshes::LOD_LEVELS - 1) ? shadowLodLevel : (PrimitiveMeshes::LOD_LEVELS - 1);
+		}
+		if (lodLevel > 0)
+		{
+			chunk.reducedDetailObjects++;
+		}
+
+		DRAW_OBJECT drawObject;
+		drawObject.modelMatrix = GetModelMatrix(i);
+		drawObject.UVscale = object.UVscale;
+		drawObject.mesh = object.mesh;
+		drawObject.lodLevel = lodLevel;
+
+		RenderQueue::DRAW_RECORD record;
+		record.sortKey = 0;
+		record.objectIndex = (int)chunk.objects.size();
+		record.mesh = object.mesh | (lodLevel << g_LodMeshKeyShift);
+		record.materialIndex = object.materialIndex;
+		record.textureSlot = object.textureSlot;
+		if (shadowLodLevel >= 0)
+		{
+			drawObject.UVscale = glm::vec2(1.0f, 1.0f);
+			record.materialIndex = (bShaderMaterial == true) ? 0 : object.materialIndex;
+			record.textureSlot = -1;
+		}
+
+		chunk.records.push_back(record);
+		chunk.objects.push_back(drawObject);
+	}
+}
+
+/***********************************************************
+ *  RenderScene()
+ *
+ *  This method is used for rendering the 3D scene by 
+ *  walking the sorted draw records of a frame packet and
+ *  drawing the basic 3D shapes.  Only the packet is read,
+ *  so the next packet can be built at the same time.  With
+ *  clustered lighting on, the lights are binned for the
+ *  view first, and with the depth pre-pass on, the packet
+ *  is drawn once into the depth buffer only, so that the
+ *  shading pass lights every pixel just once.  The shadow
+ *  maps are drawn before, by RenderShadows().  With
+ *  occlusion culling on, the depth of the drawn frame is
+ *  reduced into the depth pyramid afterwards, for culling
+ *  the frames after it.
+ ***********************************************************/
+void SceneManager::RenderScene(const FRAME_PACKET& packet)
+{
+
+	if (m_pShaderUniforms == NULL)
+	{
+		return;
+	}
+
+	// lights changed through the light manager since the
+	// last frame are uploaded here; nothing is sent otherwise
+	m_lightManager->UploadChanges(*m_frameArena);
+
+	// the lights are binned against the view set for this frame
+	m_clusteredLighting->Update(m_pShaderUniforms->GetFrameData().projection);
+
+	// the counters of the packet are completed while drawing
+	RenderQueue::RENDER_STATS& stats = m_frameStats;
+	stats = packet.queue.GetStats();
+	stats.shadowDrawCalls = m_shadowDrawCalls;
+	stats.shadowMapsRendered = m_shadowMapsRendered;
+	const GpuDrivenRenderer::CULL_VIEW* pGpuView = (packet.bGpuDriven == true) ? &packet.cullView : NULL;
+
+	// the instances of this frame go into the next region of
+	// the ring buffer, which is fenced after the last draw
+	m_instancedMeshes->BeginFrame();
+
+	if (m_bDepthPrepass == true)
+	{
+		// only the draw calls of the depth pass are counted, the
+		// state changes are the same as in the shading pass
+		RenderQueue::RENDER_STATS prepassStats = RenderQueue::RENDER_STATS();
+		GLStateCache::SetColorMask(false);
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, false);
+		m_gpuRenderer->SetLighting(false);
+		DrawPass(packet.queue, packet.objects, pGpuView, prepassStats);
+		stats.drawCalls += prepassStats.drawCalls;
+
+		// the shading pass uses the same programs and vertices,
+		// so its depths match the pre-pass exactly and only the
+		// nearest surface of every pixel passes
+		GLStateCache::SetColorMask(true);
+		GLStateCache::SetDepthMask(false);
+		GLStateCache::SetDepthFunc(GL_LEQUAL);
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, true);
+		m_gpuRenderer->SetLighting(true);
+	}
+
+	DrawPass(packet.queue, packet.objects, pGpuView, stats);
+
+	if (m_bDepthPrepass == true)
+	{
+		GLStateCache::SetDepthMask(true);
+		GLStateCache::SetDepthFunc(GL_LESS);
+	}
+
+	GLStateCache::BindVertexArray(0);
+	m_instancedMeshes->EndFrame();
+
+	if (m_bOcclusionCulling == true)
+	{
+		const ShaderUniforms::FRAME_BLOCK& frame = m_pShaderUniforms->GetFrameData();
+		m_hiZBuffer->Build(frame.projection * frame.view);
+	}
+}
+
+/***********************************************************
+ *  RenderShadows()
+ *
+ *  This method is used for drawing the depth of the shadow
+ *  casters into the cascades of a frame packet that are
+ *  stale; the others keep the shadow maps drawn in an
+ *  earlier frame.  Every cascade is drawn like the view,
+ *  from its own queue and with the GPU renderer culling
+ *  against the light, with lighting off.  The object data
+ *  of the GPU renderer changed since the last packet is
+ *  handed over here, before the first pass that reads it.
+ ***********************************************************/
+void SceneManager::RenderShadows(const FRAME_PACKET& packet)
+{
+	m_shadowDrawCalls = 0;
+	m_shadowMapsRendered = 0;
+
+	if (m_pShaderUniforms == NULL)
+	{
+		return;
+	}
+
+	if ((packet.bGpuDriven == true) && (packet.bGpuObjectsChanged == true))
+	{
+		m_gpuRenderer->SetObjects(packet.gpuObjects);
+	}
+
+	m_shadowMaps->SetCascades(packet.shadowBlock);
+
+	RenderQueue::RENDER_STATS shadowStats = RenderQueue::RENDER_STATS();
+	for (int c = 0; c < packet.shadowPasses.size(); c++)
+	{
+		const SHADOW_PASS& pass = packet.shadowPasses[c];
+		if (pass.cascade.bStale == false)
+		{
+			continue;
+		}
+
+		if (m_shadowMapsRendered == 0)
+		{
+			// the casters stream their instances through a ring
+			// buffer region of their own
+			m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, false);
+			m_gpuRenderer->SetLighting(false);
+			m_instancedMeshes->BeginFrame();
+		}
+
+		m_shadowMaps->BeginCascade(c, pass.cascade);
+		DrawPass(pass.queue, pass.objects, (packet.bGpuDriven == true) ? &pass.cullView : NULL, shadowStats);
+		m_shadowMapsRendered++;
+	}
+
+	if (m_shadowMapsRendered > 0)
+	{
+		m_shadowMaps->EndCascades();
+		m_pShaderUniforms->BindFrameBlock();
+		GLStateCache::BindVertexArray(0);
+		m_instancedMeshes->EndFrame();
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_LIGHTING, true);
+		m_gpuRenderer->SetLighting(true);
+	}
+	m_shadowDrawCalls = shadowStats.drawCalls;
+}
+
+/***********************************************************
+ *  DrawPass()
+ *
+ *  This method is used for issuing the draws of one pass
+ *  over a queue: the GPU renderer's indirect draw, when a
+ *  view for it is passed in, and then the sorted draw
+ *  records, setting only the render state that differs
+ *  from the previous draw.  The counters of the passed in
+ *  stats are advanced for every draw.
+ ***********************************************************/
+void SceneManager::DrawPass(
+	const RenderQueue& queue,
+	const std::vector<DRAW_OBJECT>& objects,
+	const GpuDrivenRenderer::CULL_VIEW* pGpuView,
+	RenderQueue::RENDER_STATS& stats)
+{
+	// the objects with pooled meshes are culled and drawn on the
+	// GPU with a single indirect draw call
+	if (pGpuView != NULL)
+	{
+		m_gpuRenderer->Draw(*pGpuView, m_hiZBuffer, m_instancedMeshes, m_textureArrays);
+		m_instancedMeshes->ReleasePool();
+
+		if (m_gpuRenderer->GetObjectCount() > 0)
+		{
+			stats.drawCalls++;
+		}
+	}
+
+	// the render state that was last set into the shader,
+	// so that repeated state can be skipped
+	int currentMesh = -1;
+	int currentMaterial = -1;
+	int currentTexture = -1;
+	glm::vec2 currentUVscale;
+	bool bFirstDraw = true;
+	bool bInstancing = false;
+
+	int recordCount = queue.GetRecordCount();
+	int i = 0;
+	while (i < recordCount)
+	{
+		const RenderQueue::DRAW_RECORD& record = queue.GetRecord(i);
+		const DRAW_OBJECT& object = objects[record.objectIndex];
+
+		// find the run of following records that can share this
+		// draw, which the sort has placed right after it
+		int runEnd = i + 1;
+		bool bInstanceable =
+			(SupportsInstancing(object.mesh) == true) &&
+			(record.materialIndex >= 0) &&
+			(record.materialIndex < g_MaxShaderMaterials);
+		if (bInstanceable == true)
+		{
+			while (runEnd < recordCount)
+			{
+				const RenderQueue::DRAW_RECORD& next = queue.GetRecord(runEnd);
+				if ((next.mesh != record.mesh) ||
+					(next.materialIndex != record.materialIndex) ||
+					(next.textureSlot != record.textureSlot) ||
+					(objects[next.objectIndex].UVscale != object.UVscale))
+				{
+					break;
+				}
+				runEnd++;
+			}
+		}
+		int runLength = runEnd - i;
+
+		if ((bFirstDraw == true) || (record.materialIndex != currentMaterial))
+		{
+			SetShaderMaterial(record.materialIndex);
+			currentMaterial = record.materialIndex;
+			stats.materialChanges++;
+		}
+		else
+		{
+			stats.materialChangesElided++;
+		}
+
+		if ((bFirstDraw == true) || (record.textureSlot != currentTexture))
+		{
+			SetShaderTexture(record.textureSlot);
+			currentTexture = record.textureSlot;
+			stats.textureChanges++;
+		}
+		else
+		{
+			stats.textureChangesElided++;
+		}
+
+		if ((bFirstDraw == true) || (object.UVscale != currentUVscale))
+		{
+			SetTextureUVScale(object.UVscale.x, object.UVscale.y);
+			currentUVscale = object.UVscale;
+			stats.uvScaleChanges++;
+		}
+		else
+		{
+			stats.uvScaleChangesElided++;
+		}
+
+		// consecutive draws of the same mesh keep the same
+		// vertex array bound in the driver
+		if ((bFirstDraw == true) || (record.mesh != currentMesh))
+		{
+			currentMesh = record.mesh;
+			stats.meshChanges++;
+		}
+		else
+		{
+			stats.meshChangesElided++;
+		}
+
+		if (bInstanceable == true)
+		{
+			// meshes in the shared pool are always drawn instanced,
+			// even alone, so the pool vertex array stays bound;
+			// reduced levels of detail only exist there as well; the
+			// instances are written straight into the ring buffer
+			PrimitiveMeshes::INSTANCE_DATA* instances = m_instancedMeshes->AllocateInstances(runLength);
+			for (int j = i; j < runEnd; j++)
+			{
+				const RenderQueue::DRAW_RECORD& instanceRecord = queue.GetRecord(j);
+				PrimitiveMeshes::INSTANCE_DATA& instance = instances[j - i];
+				instance.model = objects[instanceRecord.objectIndex].modelMatrix;
+				instance.materialIndex = instanceRecord.materialIndex;
+				instance.padding[0] = instance.padding[1] = instance.padding[2] = 0;
+			}
+
+			if (bInstancing == false)
+			{
+				m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_INSTANCING, true);
+				bInstancing = true;
+			}
+			DrawSceneMeshInstanced(object.mesh, instances, runLength, object.lodLevel);
+
+			if (runLength >= g_MinInstanceBatch)
+			{
+				// the rest of the run did not need any state of its own
+				stats.materialChangesElided += runLength - 1;
+				stats.textureChangesElided += runLength - 1;
+				stats.uvScaleChangesElided += runLength - 1;
+				stats.meshChangesElided += runLength - 1;
+				stats.instancedBatches++;
+				stats.instancedObjects += runLength;
+			}
+		}
+		else
+		{
+			if (bInstancing == true)
+			{
+				m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_INSTANCING, false);
+				bInstancing = false;
+			}
+
+			// the model matrix was composed when the packet was built
+			m_pShaderUniforms->SetMat4Value(ShaderUniforms::UNIFORM_MODEL, object.modelMatrix);
+
+			// draw the mesh with transformation values; it binds a
+			// vertex array of its own
+			m_instancedMeshes->ReleasePool();
+			DrawSceneMesh(object.mesh);
+		}
+		stats.drawCalls++;
+
+		bFirstDraw = false;
+		i = runEnd;
+	}
+
+	if (bInstancing == true)
+	{
+		m_pShaderUniforms->SetIntValue(ShaderUniforms::UNIFORM_USE_INSTANCING, false);
+	}
+}
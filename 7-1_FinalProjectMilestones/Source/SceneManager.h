@@ -1,108 +1,561 @@
-///////////////////////////////////////////////////////////////////////////////
-// shadermanager.h
-// ============
-// manage the loading and rendering of 3D scenes
-//
-///////////////////////////////////////////////////////////////////////////////
-
-#pragma once
-
-#include "ShaderManager.h"
-#include "ShapeMeshes.h"
-
-#include <string>
-#include <vector>
-
-/***********************************************************
- *  SceneManager
- *
- *  This class contains the code for preparing and rendering
- *  3D scenes, including the shader settings.
- ***********************************************************/
-class SceneManager
-{
-public:
-	// constructor
-	SceneManager(ShaderManager *pShaderManager);
-	// destructor
-	~SceneManager();
-
-	struct TEXTURE_INFO
-	{
-		std::string tag;
-		uint32_t ID;
-	};
-
-	struct OBJECT_MATERIAL
-	{
-		float ambientStrength;
-		glm::vec3 ambientColor;
-		glm::vec3 diffuseColor;
-		glm::vec3 specularColor;
-		float shininess;
-		std::string tag;
-	};
-
-private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
-	// pointer to basic shapes object
-	ShapeMeshes* m_basicMeshes;
-	// total number of loaded textures
-	int m_loadedTextures;
-	// loaded textures info
-	TEXTURE_INFO m_textureIDs[16];
-	// defined object materials
-	std::vector<OBJECT_MATERIAL> m_objectMaterials;
-
-	// load texture images and convert to OpenGL texture data
-	bool CreateGLTexture(const char* filename, std::string tag);
-	// bind loaded OpenGL textures to slots in memory
-	void BindGLTextures();
-	// free the loaded OpenGL textures
-	void DestroyGLTextures();
-	// find a loaded texture by tag
-	int FindTextureID(std::string tag);
-	int FindTextureSlot(std::string tag);
-	// find a defined material by tag
-	bool FindMaterial(std::string tag, OBJECT_MATERIAL& material);
-
-	// set the transformation values 
-	// into the transform buffer
-	void SetTransformations(
-		glm::vec3 scaleXYZ,
-		float XrotationDegrees,
-		float YrotationDegrees,
-		float ZrotationDegrees,
-		glm::vec3 positionXYZ);
-
-	// set the color values into the shader
-	void SetShaderColor(
-		float redColorValue,
-		float greenColorValue,
-		float blueColorValue,
-		float alphaValue);
-
-	// set the texture data into the shader
-	void SetShaderTexture(
-		std::string textureTag);
-
-	// set the UV scale for the texture mapping
-	void SetTextureUVScale(
-		float u, float v);
-
-	// set the object material into the shader
-	void SetShaderMaterial(
-		std::string materialTag);
-
-public:
-
-	// The following methods are for the students to 
-	// customize for their own 3D scene
-	void PrepareScene();
-	void RenderScene();
-
-	// loads textures from image files
-	void LoadSceneTextures();
-
-};
+///////////////////////////////////////////////////////////////////////////////
+// shadermanager.h
+// ============
+// manage the loading and rendering of 3D scenes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "ShapeMeshes.h"
+#include "RenderQueue.h"
+#include "PrimitiveMeshes.h"
+#include "LightManager.h"
+#include "TextureArrays.h"
+#include "TextureLoader.h"
+#include "BoundingVolumes.h"
+#include "SceneBVH.h"
+#include "TransformKernels.h"
+#include "GpuDrivenRenderer.h"
+#include "ClusteredLighting.h"
+#include "HiZBuffer.h"
+#include "ShadowMaps.h"
+#include "SceneFile.h"
+#include "FileWatcher.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "MemoryPool.h"
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***********************************************************
+ *  SceneManager
+ *
+ *  This class contains the code for preparing and rendering
+ *  3D scenes, including the shader settings.
+ ***********************************************************/
+class SceneManager
+{
+public:
+	// constructor
+	SceneManager(
+		ShaderManager *pShaderManager,
+		ShaderUniforms *pShaderUniforms);
+	// destructor
+	~SceneManager();
+
+	struct OBJECT_MATERIAL
+	{
+		float ambientStrength;
+		glm::vec3 ambientColor;
+		glm::vec3 diffuseColor;
+		glm::vec3 specularColor;
+		float shininess;
+		std::string tag;
+	};
+
+	// basic shape meshes that a scene object can be drawn with
+	enum MESH_KIND
+	{
+		MESH_PLANE,
+		MESH_BOX,
+		MESH_CYLINDER,
+		MESH_CONE,
+		MESH_PRISM,
+		MESH_SPHERE,
+		MESH_PYRAMID4
+	};
+
+	// draw state of a retained scene object; its transform,
+	// model matrix and world bounds are kept in streams of
+	// their own at the same index
+	struct SCENE_OBJECT
+	{
+		// level of detail the object was last drawn at
+		int lodLevel;
+		// mesh, material and texture used for drawing
+		MESH_KIND mesh;
+		int materialIndex;
+		int textureSlot;
+		std::string textureTag;
+		glm::vec2 UVscale;
+	};
+
+	// draw state of one visible scene object, copied into the
+	// frame packet so that drawing never reads the scene objects
+	struct DRAW_OBJECT
+	{
+		glm::mat4 modelMatrix;
+		glm::vec2 UVscale;
+		MESH_KIND mesh;
+		int lodLevel;
+	};
+
+	// draws of the shadow casters of one cascade, gathered and
+	// culled the same way as the view, from the key light
+	struct SHADOW_PASS
+	{
+		ShadowMaps::CASCADE cascade;
+		// only filled in while the cascade is stale
+		RenderQueue queue;
+		std::vector<DRAW_OBJECT> objects;
+		// light view the GPU renderer culls the casters against
+		GpuDrivenRenderer::CULL_VIEW cullView;
+	};
+
+	// everything needed to draw one frame, built by
+	// BuildFramePacket() and left unchanged while it is drawn
+	struct FRAME_PACKET
+	{
+		// sorted draw records; their object indices point into
+		// the objects of the packet, not into the scene objects
+		RenderQueue queue;
+		std::vector<DRAW_OBJECT> objects;
+		// true when the pooled objects are drawn by the GPU
+		// renderer, and the view it culls them against
+		bool bGpuDriven;
+		GpuDrivenRenderer::CULL_VIEW cullView;
+		// object data for the GPU renderer, only filled in when
+		// the objects changed since the last packet
+		bool bGpuObjectsChanged;
+		std::vector<GpuDrivenRenderer::OBJECT_DATA> gpuObjects;
+		// cascades of the key light, and the block the scene
+		// shaders read them through
+		std::vector<SHADOW_PASS> shadowPasses;
+		ShadowMaps::SHADOW_BLOCK shadowBlock;
+	};
+
+private:
+	// draws gathered by one job from a chunk of the visible
+	// objects; the object indices of the records are local to
+	// the chunk until they are merged into the frame packet
+	struct DRAW_CHUNK
+	{
+		std::vector<DRAW_OBJECT> objects;
+		std::vector<RenderQueue::DRAW_RECORD> records;
+		int reducedDetailObjects;
+	};
+
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the cached shader uniforms and uniform blocks
+	ShaderUniforms* m_pShaderUniforms;
+	// pointer to basic shapes object
+	ShapeMeshes* m_basicMeshes;
+	// state change counters of the last drawn frame packet
+	RenderQueue::RENDER_STATS m_frameStats;
+	// pointer to the meshes that support instanced drawing
+	PrimitiveMeshes* m_instancedMeshes;
+	// pointer to the light sources of the scene
+	LightManager* m_lightManager;
+	// pointer to the texture arrays holding the loaded textures
+	TextureArrays* m_textureArrays;
+	// pointer to the loader decoding textures in the background
+	TextureLoader* m_textureLoader;
+	// lookup of slots and indices by tag, whose nodes come
+	// from a pool of their own
+	typedef std::unordered_map<
+		std::string,
+		int,
+		std::hash<std::string>,
+		std::equal_to<std::string>,
+		PoolAllocator<std::pair<const std::string, int> > > TAG_LOOKUP;
+	// pointer to the pool of the tag lookup nodes
+	MemoryPool* m_tagPool;
+	// loaded texture slots indexed by tag
+	TAG_LOOKUP m_textureSlotLookup;
+	// defined object materials
+	std::vector<OBJECT_MATERIAL> m_objectMaterials;
+	// defined material indices indexed by tag
+	TAG_LOOKUP m_materialLookup;
+	// pointer to the arena of the transient data of a frame
+	// on the GL thread
+	FrameArena* m_frameArena;
+	// retained scene objects in draw order
+	std::vector<SCENE_OBJECT> m_sceneObjects;
+	// transformation values and local bounds of the scene
+	// objects, one stream per component, which the kernels
+	// compose many objects at a time
+	TransformKernels::TRANSFORM_STREAMS m_transforms;
+	// model matrices composed from the transforms
+	std::vector<glm::mat4> m_modelMatrices;
+	// view frustum the scene objects are culled against
+	BoundingVolumes::FRUSTUM m_viewFrustum;
+	// true once a view frustum has been set
+	bool m_bHasViewFrustum;
+	// true when objects outside the view frustum are skipped
+	bool m_bFrustumCulling;
+	// pointer to the spatial index over the scene objects
+	SceneBVH* m_spatialIndex;
+	// true when objects moved since the index was refitted
+	bool m_bSpatialIndexDirty;
+	// world bounds of the scene objects, composed with the
+	// model matrices and handed to the index
+	std::vector<BoundingVolumes::BOUNDING_BOX> m_objectBounds;
+	// scene objects found inside the view frustum this frame
+	std::vector<int> m_visibleObjects;
+	// pointer to the job system splitting the frame packet
+	// work over the cores
+	JobSystem* m_jobSystem;
+	// draws gathered from the chunks of the visible objects
+	std::vector<DRAW_CHUNK> m_drawChunks;
+	// camera position and projection of the view, used for
+	// the projected size of the scene objects
+	glm::vec3 m_cameraPosition;
+	float m_projectionScale;
+	bool m_bOrthographicView;
+	// true when the round meshes are drawn with a level of
+	// detail chosen from their projected size
+	bool m_bLevelOfDetail;
+	// pointer to the renderer culling and drawing on the GPU
+	GpuDrivenRenderer* m_gpuRenderer;
+	// true when the pooled objects are drawn by the GPU renderer
+	bool m_bGpuDriven;
+	// true when the object buffer of the GPU renderer is stale
+	bool m_bGpuObjectsDirty;
+	// number of objects handed to the GPU renderer
+	int m_gpuObjectCount;
+	// first mesh range table entry of each basic mesh, or -1
+	// for meshes the GPU renderer cannot draw
+	std::vector<int> m_gpuMeshRanges;
+	// pointer to the binning of the lights into view clusters
+	ClusteredLighting* m_clusteredLighting;
+	// true when the depth of the scene is drawn before it is shaded
+	bool m_bDepthPrepass;
+	// pointer to the depth pyramid of the last drawn frame
+	HiZBuffer* m_hiZBuffer;
+	// true when objects hidden behind the depth pyramid are skipped
+	bool m_bOcclusionCulling;
+	// latest pyramid read back, which the objects of the render
+	// queue are tested against, and the objects of the visible
+	// list found hidden behind it
+	HiZBuffer::DEPTH_PYRAMID m_occlusionPyramid;
+	std::vector<unsigned char> m_occludedFlags;
+	// pointer to the cascaded shadow maps of the key light
+	ShadowMaps* m_shadowMaps;
+	// size and number of cascades the shadow maps are made with
+	int m_shadowResolution;
+	int m_shadowCascades;
+	// draws and cascades of the last shadow pass
+	int m_shadowDrawCalls;
+	int m_shadowMapsRendered;
+	// view and projection of the camera, which the cascades are
+	// fitted around
+	glm::mat4 m_viewMatrix;
+	glm::mat4 m_projectionMatrix;
+	// bounds of every scene object, and a count advanced every
+	// time the objects move, so that cached shadows are redrawn
+	BoundingVolumes::BOUNDING_BOX m_sceneBounds;
+	int m_casterRevision;
+	// source file describing the scene
+	std::string m_sceneFilename;
+	// pointer to the scene file, open while the scene is built
+	SceneFile* m_sceneFile;
+	// image file of every texture slot requested in the background
+	std::vector<std::string> m_textureFiles;
+	// copies made by ReplicateSceneObjects(), made again when
+	// the scene file is reloaded
+	int m_replicaCopies;
+	float m_replicaSpacing;
+	// lights added by AddPointLights(), added again when the
+	// scene file is reloaded
+	int m_pointLightCount;
+	// pointer to the watcher of the files reloaded while running
+	FileWatcher* m_fileWatcher;
+	// true when changed files are reloaded between frames
+	bool m_bHotReload;
+	// shader files of the scene program and their watch ids
+	std::string m_vertexShaderPath;
+	std::string m_fragmentShaderPath;
+	int m_vertexShaderWatch;
+	int m_fragmentShaderWatch;
+	int m_cullShaderWatch;
+	int m_clusterShaderWatch;
+	int m_hiZShaderWatch;
+	int m_sceneFileWatch;
+	// scene program built by the last shader reload, or 0 while
+	// the program of the shader manager is in use
+	GLuint m_reloadedProgram;
+
+	// load texture images and convert to OpenGL texture data
+	bool CreateGLTexture(const char* filename, const std::string& tag);
+	// load a texture image in the background into a reserved slot
+	bool RequestGLTexture(const char* filename, const std::string& tag);
+	// bind loaded OpenGL textures to slots in memory
+	void BindGLTextures();
+	// free the loaded OpenGL textures
+	void DestroyGLTextures();
+	// find a defined material by tag
+	bool FindMaterial(const std::string& tag, OBJECT_MATERIAL& material);
+	// add a material to the defined materials
+	int AddMaterial(const OBJECT_MATERIAL& material);
+
+	// compose the model matrix directly from the scale,
+	// Euler angles and position
+	glm::mat4 BuildModelMatrix(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// set the transformation values 
+	// into the transform buffer
+	void SetTransformations(
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// get the cached model matrix of a scene object,
+	// composing it again when the object is dirty
+	const glm::mat4& GetModelMatrix(
+		int objectIndex);
+
+	// set the cached model matrix of a scene object
+	// into the transform buffer
+	void SetTransformations(
+		int objectIndex);
+
+	// change the transformation values of a scene object,
+	// marking its cached model matrix dirty on a change
+	bool UpdateObjectTransform(
+		int objectIndex,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+
+	// set the color values into the shader
+	void SetShaderColor(
+		float redColorValue,
+		float greenColorValue,
+		float blueColorValue,
+		float alphaValue);
+
+	// set the texture data into the shader
+	void SetShaderTexture(
+		const std::string& textureTag);
+
+	// set the UV scale for the texture mapping
+	void SetTextureUVScale(
+		float u, float v);
+
+	// set the object material into the shader
+	void SetShaderMaterial(
+		const std::string& materialTag);
+
+	// add an object to the retained scene
+	int AddSceneObject(
+		MESH_KIND mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		const std::string& materialTag,
+		const std::string& textureTag,
+		float u, float v);
+	// add an object with an already resolved material
+	int AddSceneObject(
+		MESH_KIND mesh,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		int materialIndex,
+		const std::string& textureTag,
+		float u, float v);
+	// resolve the texture slots used by the scene objects
+	void ResolveSceneTextures();
+	// draw the basic mesh used by a scene object
+	void DrawSceneMesh(MESH_KIND mesh);
+	// local bounds of a basic mesh
+	static const BoundingVolumes::BOUNDING_BOX& GetMeshBounds(MESH_KIND mesh);
+	// build or refit the spatial index after objects changed
+	void UpdateSpatialIndex();
+	// check whether a scene object is drawn by the GPU renderer
+	bool IsGpuDrawn(const SCENE_OBJECT& object) const;
+	// build the GPU renderer and its table of mesh ranges
+	void InitializeGpuRenderer();
+	// rebuild the object data of the GPU renderer
+	void UpdateGpuObjects(
+		std::vector<GpuDrivenRenderer::OBJECT_DATA>& objects);
+	// check whether a basic mesh can be drawn instanced
+	bool SupportsInstancing(MESH_KIND mesh);
+	// check whether a basic mesh has several levels of detail
+	bool SupportsLevelOfDetail(MESH_KIND mesh);
+	// choose the level of detail of a scene object from its
+	// projected size
+	int SelectLevelOfDetail(int objectIndex);
+	// gather the draws of a range of the visible objects; a
+	// shadow level of detail of 0 or more gathers shadow casters
+	void GatherDraws(int firstVisible, int lastVisible, int shadowLodLevel, DRAW_CHUNK& chunk);
+	// gather the draws of all visible objects on the job system
+	void GatherVisibleDraws(
+		int shadowLodLevel,
+		RenderQueue& queue,
+		std::vector<DRAW_OBJECT>& objects);
+	// drop the visible objects of the render queue hidden behind
+	// the depth pyramid; returns the number dropped
+	int RemoveOccludedObjects();
+	// place the cascades and gather the casters of stale ones
+	void BuildShadowPasses(FRAME_PACKET& packet);
+	// issue the sorted draws of a pass, after the GPU renderer's
+	// draw when a view for it is passed, counting them in stats
+	void DrawPass(
+		const RenderQueue& queue,
+		const std::vector<DRAW_OBJECT>& objects,
+		const GpuDrivenRenderer::CULL_VIEW* pGpuView,
+		RenderQueue::RENDER_STATS& stats);
+	// draw the basic mesh once for each passed in instance
+	void DrawSceneMeshInstanced(
+		MESH_KIND mesh,
+		const PrimitiveMeshes::INSTANCE_DATA* instances,
+		int instanceCount,
+		int lodLevel);
+	// set the defined materials into the shader material block
+	void LoadShaderMaterials();
+	// add the lights of the scene file to the light manager
+	void AddSceneFileLights();
+	// build the scene program again from its shader files
+	bool ReloadSceneShaders();
+	// apply the changed scene file to the retained scene
+	bool ReloadSceneFile();
+
+public:
+
+	// The following methods are for the students to 
+	// customize for their own 3D scene
+	void PrepareScene();
+	void RenderScene(const FRAME_PACKET& packet);
+
+	// draw the stale shadow cascades of a frame packet; call
+	// before RenderScene() with the same packet
+	void RenderShadows(const FRAME_PACKET& packet);
+
+	// cull, sort and collect the scene objects for the view set
+	// by SetViewProjection(); this makes no OpenGL calls, so it
+	// can run on an update thread while a packet is drawn
+	void BuildFramePacket(FRAME_PACKET& packet);
+
+	// upload the textures that finished loading in the background;
+	// call on the GL thread while no frame packet is being built
+	void UploadLoadedTextures();
+
+	// take in the latest depth pyramid read back for occlusion
+	// culling; call on the GL thread while no frame packet is
+	// being built
+	void CollectOcclusionBuffer();
+
+	// choose the scene file read by PrepareScene()
+	void SetSceneFile(const std::string& filename);
+
+	// define the materials of the scene
+	void DefineSceneMaterials();
+
+	// define the objects placed in the retained scene
+	void DefineSceneObjects();
+
+	// define the light sources of the scene
+	void DefineSceneLights();
+
+	// loads textures from image files
+	void LoadSceneTextures();
+
+	// resolve tags into the integer handles used while
+	// rendering; these lookups are meant for scene building
+	// and tooling, not for every draw
+	int FindTextureSlot(const std::string& tag);
+	int FindMaterialIndex(const std::string& tag);
+
+	// set the texture in the passed in slot into the shader
+	void SetShaderTexture(
+		int textureSlot);
+
+	// set the defined material at the passed in index into the shader
+	void SetShaderMaterial(
+		int materialIndex);
+
+	// state change counters of the last rendered frame
+	const RenderQueue::RENDER_STATS& GetRenderStats() const;
+	// time composing every transform and culling the view on
+	// the chosen kernel path, in milliseconds per repeat
+	void MeasureTransformKernels(
+		int repeats,
+		double& composeMs,
+		double& cullMs);
+
+	// light sources of the scene, for moving or adding lights
+	LightManager* GetLightManager();
+	// arena of the transient data of a frame on the GL thread,
+	// reset at the top of every frame
+	FrameArena* GetFrameArena();
+
+	// add copies of every scene object except the table on a
+	// grid, so that the renderer can be measured as it scales
+	void ReplicateSceneObjects(int copies, float spacing);
+	// add point lights with a limited range on a grid over the
+	// scene objects, so that shading can be measured as the
+	// light count grows; returns the number of lights added
+	int AddPointLights(int count);
+	// number of retained scene objects
+	int GetSceneObjectCount() const;
+
+	// set the view the scene objects are culled against
+	void SetViewProjection(
+		const glm::mat4& view,
+		const glm::mat4& projection);
+	// turn culling of objects outside the view on or off
+	void SetFrustumCulling(bool bCulling);
+	// turn the level of detail of the round meshes on or off
+	void SetLevelOfDetail(bool bLevelOfDetail);
+	// turn GPU driven culling and drawing on or off; false is
+	// returned when the context cannot support it
+	bool SetGpuDriven(bool bGpuDriven);
+	bool IsGpuDriven() const;
+	// turn clustered lighting, which only visits the lights
+	// reaching each cluster of the view, on or off; false is
+	// returned when the context cannot support it
+	bool SetClusteredLighting(bool bClustered);
+	bool IsClusteredLighting() const;
+	// turn the depth pre-pass before shading on or off
+	void SetDepthPrepass(bool bDepthPrepass);
+	bool IsDepthPrepass() const;
+	// turn culling of objects hidden behind the depth of the
+	// last frames on or off; false is returned when the context
+	// cannot support it
+	bool SetOcclusionCulling(bool bOcclusion);
+	bool IsOcclusionCulling() const;
+	// choose the size and number of cascades of the shadow
+	// maps made by PrepareScene(); 0 cascades turns them off
+	void SetShadowSettings(int resolution, int cascadeCount);
+	// size and number of cascades of the shadow maps in use,
+	// 0 cascades while there are none
+	int GetShadowResolution() const;
+	int GetShadowCascadeCount() const;
+	// find the scene object first hit by a ray, or -1
+	int PickSceneObject(
+		const glm::vec3& origin,
+		const glm::vec3& direction);
+	// find the scene object nearest to a point, or -1
+	int FindNearestSceneObject(const glm::vec3& point);
+	// number of textures still loading in the background
+	int GetPendingTextureCount() const;
+
+	// watch the shader, texture and scene files and reload
+	// them between frames when they change
+	void EnableHotReload(
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath);
+	// reload the watched files that changed; call between frames
+	void ReloadChangedFiles();
+
+};
@@ -0,0 +1,165 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderloader.cpp
+// ============
+// read, compile and link shader programs, reporting the logs of failures
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderLoader.h"
+
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+/***********************************************************
+ *  LoadSource()
+ *
+ *  This method is used for reading a shader file.  When a
+ *  header is passed in, it replaces the version line, which
+ *  lets the scene shaders be built a second time with
+ *  another version and extra defines.
+ ***********************************************************/
+bool ShaderLoader::LoadSource(
+	const char* filePath,
+	const char* header,
+	std::string& source)
+{
+	std::ifstream file(filePath);
+	if (!file)
+	{
+		std::cout << "Could not open shader file:" << filePath << std::endl;
+		return(false);
+	}
+
+	std::stringstream contents;
+	contents << file.rdbuf();
+	source = contents.str();
+
+	if (header == NULL)
+	{
+		return(true);
+	}
+
+	size_t versionStart = source.find("#version");
+	if (versionStart == std::string::npos)
+	{
+		source = header + source;
+	}
+	else
+	{
+		size_t versionEnd = source.find('\n', versionStart);
+		if (versionEnd == std::string::npos)
+		{
+			versionEnd = source.size();
+		}
+		source.replace(versionStart, versionEnd - versionStart, header);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  CompileShader()
+ *
+ *  This method is used for compiling one shader stage.  The
+ *  compile log is printed when the stage fails, and 0 is
+ *  returned.
+ ***********************************************************/
+GLuint ShaderLoader::CompileShader(
+	GLenum stage,
+	const std::string& source,
+	const char* filePath)
+{
+	GLuint shader = glCreateShader(stage);
+	const char* sourceText = source.c_str();
+	glShaderSource(shader, 1, &sourceText, NULL);
+	glCompileShader(shader);
+
+	GLint compiled = GL_FALSE;
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+	if (compiled == GL_FALSE)
+	{
+		char infoLog[1024];
+		glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not compile shader:" << filePath << "\n" << infoLog << std::endl;
+		glDeleteShader(shader);
+		return(0);
+	}
+
+	return(shader);
+}
+
+/***********************************************************
+ *  LinkProgram()
+ *
+ *  This method is used for linking compiled shader stages
+ *  into a program.  The stages are released either way, and
+ *  0 is returned when linking fails.
+ ***********************************************************/
+GLuint ShaderLoader::LinkProgram(const GLuint* shaders, int shaderCount)
+{
+	GLuint program = glCreateProgram();
+	for (int i = 0; i < shaderCount; i++)
+	{
+		glAttachShader(program, shaders[i]);
+	}
+	glLinkProgram(program);
+	for (int i = 0; i < shaderCount; i++)
+	{
+		glDetachShader(program, shaders[i]);
+		glDeleteShader(shaders[i]);
+	}
+
+	GLint linked = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (linked == GL_FALSE)
+	{
+		char infoLog[1024];
+		glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
+		std::cout << "Could not link shader program:\n" << infoLog << std::endl;
+		glDeleteProgram(program);
+		return(0);
+	}
+
+	return(program);
+}
+
+/***********************************************************
+ *  BuildProgram()
+ *
+ *  This method is used for building a program from a vertex
+ *  and a fragment shader file, with the version line of
+ *  both replaced when a header is passed in.  0 is returned
+ *  when either stage fails to compile or the program fails
+ *  to link.
+ ***********************************************************/
+GLuint ShaderLoader::BuildProgram(
+	const char* vertexShaderPath,
+	const char* fragmentShaderPath,
+	const char* header)
+{
+	std::string vertexSource;
+	std::string fragmentSource;
+	if ((LoadSource(vertexShaderPath, header, vertexSource) == false) ||
+		(LoadSource(fragmentShaderPath, header, fragmentSource) == false))
+	{
+		return(0);
+	}
+
+	GLuint shaders[2];
+	shaders[0] = CompileShader(GL_VERTEX_SHADER, vertexSource, vertexShaderPath);
+	shaders[1] = CompileShader(GL_FRAGMENT_SHADER, fragmentSource, fragmentShaderPath);
+	if ((shaders[0] == 0) || (shaders[1] == 0))
+	{
+		for (int i = 0; i < 2; i++)
+		{
+			if (shaders[i] != 0)
+			{
+				glDeleteShader(shaders[i]);
+			}
+		}
+		return(0);
+	}
+
+	return(LinkProgram(shaders, 2));
+}
\ No newline at end of file
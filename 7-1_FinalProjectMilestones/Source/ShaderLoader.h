@@ -0,0 +1,41 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderloader.h
+// ============
+// read, compile and link shader programs, reporting the logs of failures
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+
+/***********************************************************
+ *  ShaderLoader
+ *
+ *  This class contains the code for building shader
+ *  programs from GLSL files.  Every step returns 0 or false
+ *  on failure after printing the log, and never touches a
+ *  program that is already in use, so a shader that fails
+ *  to build again can simply keep its previous program.
+ ***********************************************************/
+class ShaderLoader
+{
+public:
+	// read a shader file, replacing its version line with the
+	// passed in header when one is given
+	static bool LoadSource(
+		const char* filePath,
+		const char* header,
+		std::string& source);
+	// compile one shader stage
+	static GLuint CompileShader(GLenum stage, const std::string& source, const char* filePath);
+	// link compiled shader stages into a program
+	static GLuint LinkProgram(const GLuint* shaders, int shaderCount);
+	// build a program from a vertex and a fragment shader file
+	static GLuint BuildProgram(
+		const char* vertexShaderPath,
+		const char* fragmentShaderPath,
+		const char* header);
+};
@@ -0,0 +1,468 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.cpp
+// ============
+// cached uniform locations and uniform buffer blocks of the scene shaders
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShaderUniforms.h"
+#include "GLStateCache.h"
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstring>
+#include <cstddef>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// names of the per-draw uniforms, in UNIFORM_ID order
+	const char* g_UniformNames[ShaderUniforms::UNIFORM_COUNT] =
+	{
+		"model",
+		"objectColor",
+		"objectTexture",
+		"bUseTexture",
+		"bUseLighting",
+		"bUseInstancing",
+		"UVscale",
+		"materialIndex",
+		"textureLayer"
+	};
+
+	// names of the uniform blocks declared in the shaders
+	const char* g_FrameBlockName = "FrameBlock";
+	const char* g_LightBlockName = "LightBlock";
+	const char* g_MaterialBlockName = "MaterialBlock";
+	const char* g_ClusterBlockName = "ClusterBlock";
+	const char* g_ShadowBlockName = "ShadowBlock";
+
+	// names of the samplers of the light cluster buffers and
+	// the shadow maps
+	const char* g_ClusterLightCountsName = "clusterLightCounts";
+	const char* g_ClusterLightIndicesName = "clusterLightIndices";
+	const char* g_ShadowMapName = "shadowMap";
+}
+
+/***********************************************************
+ *  ShaderUniforms()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShaderUniforms::ShaderUniforms()
+{
+	m_programID = 0;
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = -1;
+	}
+	m_frameUBO = 0;
+	m_materialUBO = 0;
+	m_frameBlock = FRAME_BLOCK();
+	m_materialBlock = MATERIAL_BLOCK();
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_bValueKnown[i] = false;
+	}
+	m_blockUploads = 0;
+	m_uniformSets = 0;
+	m_redundantUniformSets = 0;
+}
+
+/***********************************************************
+ *  ~ShaderUniforms()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShaderUniforms::~ShaderUniforms()
+{
+	DestroyBlockBuffers();
+}
+
+/***********************************************************
+ *  CreateBlockBuffer()
+ *
+ *  This method is used for creating a uniform buffer with
+ *  the passed in contents and binding it to a binding point.
+ ***********************************************************/
+GLuint ShaderUniforms::CreateBlockBuffer(
+	GLuint binding,
+	GLsizeiptr size,
+	const void* data)
+{
+	GLuint buffer = 0;
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+	glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, binding, buffer);
+
+	return(buffer);
+}
+
+/***********************************************************
+ *  BindProgramBlock()
+ *
+ *  This method is used for attaching a named uniform block
+ *  of the program to a binding point.  GLSL 3.30 cannot
+ *  declare the binding itself.
+ ***********************************************************/
+void ShaderUniforms::BindProgramBlock(const char* blockName, GLuint binding)
+{
+	GLuint blockIndex = glGetUniformBlockIndex(m_programID, blockName);
+
+	if (blockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(m_programID, blockIndex, binding);
+	}
+	else
+	{
+		std::cout << "Shader program does not declare uniform block:" << blockName << std::endl;
+	}
+}
+
+/***********************************************************
+ *  BindProgramSampler()
+ *
+ *  This method is used for pointing a named sampler of the
+ *  program at a fixed texture unit.  GLSL 3.30 cannot
+ *  declare the binding itself, and the program has to be
+ *  in use.
+ ***********************************************************/
+void ShaderUniforms::BindProgramSampler(const char* samplerName, GLint unit)
+{
+	GLint location = glGetUniformLocation(m_programID, samplerName);
+
+	if (location != -1)
+	{
+		glUniform1i(location, unit);
+	}
+}
+
+/***********************************************************
+ *  DestroyBlockBuffers()
+ *
+ *  This method is used for freeing the uniform buffers.
+ ***********************************************************/
+void ShaderUniforms::DestroyBlockBuffers()
+{
+	if (m_frameUBO != 0)
+	{
+		glDeleteBuffers(1, &m_frameUBO);
+		m_frameUBO = 0;
+	}
+	if (m_materialUBO != 0)
+	{
+		glDeleteBuffers(1, &m_materialUBO);
+		m_materialUBO = 0;
+	}
+}
+
+/***********************************************************
+ *  UpdateValue()
+ *
+ *  This method is used for keeping the new value of a
+ *  per-draw uniform.  False is returned when the uniform
+ *  already holds the value, so that setting it can be
+ *  skipped, and counted as redundant.
+ ***********************************************************/
+bool ShaderUniforms::UpdateValue(UNIFORM_ID uniform, const void* value, size_t size)
+{
+	if ((m_bValueKnown[uniform] == true) && (memcmp(m_values[uniform], value, size) == 0))
+	{
+		m_redundantUniformSets++;
+		return(false);
+	}
+
+	memcpy(m_values[uniform], value, size);
+	m_bValueKnown[uniform] = true;
+	m_uniformSets++;
+
+	return(true);
+}
+
+/***********************************************************
+ *  Resolve()
+ *
+ *  This method is used for looking up the locations of the
+ *  per-draw uniforms and the uniform blocks of a linked
+ *  shader program.  The uniform buffers are created the
+ *  first time and filled with the current block contents.
+ *  The program has to be in use.  A new program holds none
+ *  of the values set before, so they are all forgotten.
+ ***********************************************************/
+bool ShaderUniforms::Resolve(GLuint programID)
+{
+	if (programID == 0)
+	{
+		return(false);
+	}
+
+	m_programID = programID;
+
+	for (int i = 0; i < UNIFORM_COUNT; i++)
+	{
+		m_locations[i] = glGetUniformLocation(m_programID, g_UniformNames[i]);
+		m_bValueKnown[i] = false;
+	}
+
+	if (m_frameUBO == 0)
+	{
+		m_frameUBO = CreateBlockBuffer(FRAME_BLOCK_BINDING, sizeof(FRAME_BLOCK), &m_frameBlock);
+		m_materialUBO = CreateBlockBuffer(MATERIAL_BLOCK_BINDING, sizeof(MATERIAL_BLOCK), &m_materialBlock);
+	}
+
+	BindProgramBlock(g_FrameBlockName, FRAME_BLOCK_BINDING);
+	// the light buffer itself is created by the LightManager
+	BindProgramBlock(g_LightBlockName, LIGHT_BLOCK_BINDING);
+	BindProgramBlock(g_MaterialBlockName, MATERIAL_BLOCK_BINDING);
+	// the cluster buffers are created by the ClusteredLighting,
+	BindProgramBlock(g_ClusterBlockName, CLUSTER_BLOCK_BINDING);
+	BindProgramSampler(g_ClusterLightCountsName, CLUSTER_LIGHT_COUNT_UNIT);
+	BindProgramSampler(g_ClusterLightIndicesName, CLUSTER_LIGHT_INDEX_UNIT);
+	// and the shadow block by the ShadowMaps
+	BindProgramBlock(g_ShadowBlockName, SHADOW_BLOCK_BINDING);
+	BindProgramSampler(g_ShadowMapName, SHADOW_MAP_UNIT);
+
+	return(true);
+}
+
+/***********************************************************
+ *  ResolveCurrentProgram()
+ *
+ *  This method is used for resolving the shader program
+ *  that was last made current, which the state cache asks
+ *  OpenGL for when it was made current outside the cache.
+ ***********************************************************/
+bool ShaderUniforms::ResolveCurrentProgram()
+{
+	return(Resolve(GLStateCache::GetProgram()));
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for getting the cached location of
+ *  a per-draw uniform.
+ ***********************************************************/
+GLint ShaderUniforms::GetLocation(UNIFORM_ID uniform) const
+{
+	return(m_locations[uniform]);
+}
+
+/***********************************************************
+ *  SetIntValue()
+ *
+ *  This method is used for setting an integer or boolean
+ *  uniform through its cached location.
+ ***********************************************************/
+void ShaderUniforms::SetIntValue(UNIFORM_ID uniform, int value)
+{
+	if (UpdateValue(uniform, &value, sizeof(value)) == true)
+	{
+		glUniform1i(m_locations[uniform], value);
+	}
+}
+
+/***********************************************************
+ *  SetVec2Value()
+ *
+ *  This method is used for setting a vec2 uniform through
+ *  its cached location.
+ ***********************************************************/
+void ShaderUniforms::SetVec2Value(UNIFORM_ID uniform, const glm::vec2& value)
+{
+	if (UpdateValue(uniform, &value, sizeof(value)) == true)
+	{
+		glUniform2f(m_locations[uniform], value.x, value.y);
+	}
+}
+
+/***********************************************************
+ *  SetVec4Value()
+ *
+ *  This method is used for setting a vec4 uniform through
+ *  its cached location.
+ ***********************************************************/
+void ShaderUniforms::SetVec4Value(UNIFORM_ID uniform, const glm::vec4& value)
+{
+	if (UpdateValue(uniform, &value, sizeof(value)) == true)
+	{
+		glUniform4f(m_locations[uniform], value.x, value.y, value.z, value.w);
+	}
+}
+
+/***********************************************************
+ *  SetMat4Value()
+ *
+ *  This method is used for setting a mat4 uniform through
+ *  its cached location.
+ ***********************************************************/
+void ShaderUniforms::SetMat4Value(UNIFORM_ID uniform, const glm::mat4& value)
+{
+	if (UpdateValue(uniform, &value, sizeof(value)) == true)
+	{
+		glUniformMatrix4fv(m_locations[uniform], 1, GL_FALSE, glm::value_ptr(value));
+	}
+}
+
+/***********************************************************
+ *  SetTextureHandle()
+ *
+ *  This method is used for setting a bindless texture
+ *  handle into a sampler uniform through its cached
+ *  location.
+ ***********************************************************/
+void ShaderUniforms::SetTextureHandle(UNIFORM_ID uniform, GLuint64 handle)
+{
+	if (UpdateValue(uniform, &handle, sizeof(handle)) == true)
+	{
+		glUniformHandleui64ARB(m_locations[uniform], handle);
+	}
+}
+
+/***********************************************************
+ *  SetFrameData()
+ *
+ *  This method is used for updating the view, projection
+ *  and view position in the FrameBlock.  The block is only
+ *  uploaded when one of them changed since the last call.
+ ***********************************************************/
+void ShaderUniforms::SetFrameData(
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	const glm::vec3& viewPosition)
+{
+	FRAME_BLOCK frame = FRAME_BLOCK();
+
+	frame.view = view;
+	frame.projection = projection;
+	frame.viewPosition = glm::vec4(viewPosition, 1.0f);
+
+	if ((m_frameUBO == 0) || (memcmp(&frame, &m_frameBlock, sizeof(FRAME_BLOCK)) == 0))
+	{
+		return;
+	}
+
+	m_frameBlock = frame;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_frameUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FRAME_BLOCK), &m_frameBlock);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_blockUploads++;
+}
+
+/***********************************************************
+ *  SetMaterial()
+ *
+ *  This method is used for updating one material in the
+ *  MaterialBlock.  Only a material whose values changed is
+ *  uploaded.
+ ***********************************************************/
+void ShaderUniforms::SetMaterial(int index, const MATERIAL_DATA& material)
+{
+	if ((m_materialUBO == 0) || (index < 0) || (index >= MAX_MATERIALS))
+	{
+		return;
+	}
+
+	if (memcmp(&material, &m_materialBlock.materials[index], sizeof(MATERIAL_DATA)) == 0)
+	{
+		return;
+	}
+
+	m_materialBlock.materials[index] = material;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_materialUBO);
+	glBufferSubData(
+		GL_UNIFORM_BUFFER,
+		offsetof(MATERIAL_BLOCK, materials) + index * sizeof(MATERIAL_DATA),
+		sizeof(MATERIAL_DATA),
+		&m_materialBlock.materials[index]);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	m_blockUploads++;
+}
+
+/***********************************************************
+ *  GetFrameData()
+ *
+ *  This method is used for getting the view, projection
+ *  and view position last uploaded into the FrameBlock.
+ ***********************************************************/
+const ShaderUniforms::FRAME_BLOCK& ShaderUniforms::GetFrameData() const
+{
+	return(m_frameBlock);
+}
+
+/***********************************************************
+ *  BindFrameBlock()
+ *
+ *  This method is used for binding the FrameBlock buffer to
+ *  its binding point again, after a pass that draws from
+ *  another view bound its own buffer there.
+ ***********************************************************/
+void ShaderUniforms::BindFrameBlock()
+{
+	if (m_frameUBO != 0)
+	{
+		glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_BLOCK_BINDING, m_frameUBO);
+	}
+}
+
+/***********************************************************
+ *  GetBlockUploads()
+ *
+ *  This method is used for getting the number of uniform
+ *  block uploads made since the counter was last reset.
+ ***********************************************************/
+int ShaderUniforms::GetBlockUploads() const
+{
+	return(m_blockUploads);
+}
+
+/***********************************************************
+ *  ResetBlockUploads()
+ *
+ *  This method is used for resetting the block upload
+ *  counter, usually at the start of a frame.
+ ***********************************************************/
+void ShaderUniforms::ResetBlockUploads()
+{
+	m_blockUploads = 0;
+}
+
+
+/***********************************************************
+ *  GetUniformSets()
+ *
+ *  This method is used for getting the number of per-draw
+ *  uniforms set since the counter was last reset.
+ ***********************************************************/
+int ShaderUniforms::GetUniformSets() const
+{
+	return(m_uniformSets);
+}
+
+/***********************************************************
+ *  GetRedundantUniformSets()
+ *
+ *  This method is used for getting the number of per-draw
+ *  uniforms that were not set since the counter was last
+ *  reset, because they already held the value.
+ ***********************************************************/
+int ShaderUniforms::GetRedundantUniformSets() const
+{
+	return(m_redundantUniformSets);
+}
+
+/***********************************************************
+ *  ResetUniformSets()
+ *
+ *  This method is used for resetting the per-draw uniform
+ *  counters, usually at the start of a frame.
+ ***********************************************************/
+void ShaderUniforms::ResetUniformSets()
+{
+	m_uniformSets = 0;
+	m_redundantUniformSets = 0;
+}
\ No newline at end of file
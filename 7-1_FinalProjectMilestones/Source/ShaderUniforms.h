@@ -0,0 +1,172 @@
+///////////////////////////////////////////////////////////////////////////////
+// shaderuniforms.h
+// ============
+// cached uniform locations and uniform buffer blocks of the scene shaders
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShaderUniforms
+ *
+ *  This class resolves the locations of the per-draw
+ *  uniforms once, right after the shaders are loaded, so
+ *  that setting them does not look them up by name again.
+ *  The last value of every per-draw uniform is kept as
+ *  well, and setting the same value again is skipped.  The
+ *  per-frame view data, the lights and the materials are
+ *  kept in std140 uniform buffers that are only uploaded
+ *  when their contents change.
+ ***********************************************************/
+class ShaderUniforms
+{
+public:
+	// constructor
+	ShaderUniforms();
+	// destructor
+	~ShaderUniforms();
+
+	// size of the material array declared in the MaterialBlock;
+	// the LightBlock is owned by the LightManager
+	static const int MAX_MATERIALS = 64;
+
+	// per-draw uniforms with cached locations
+	enum UNIFORM_ID
+	{
+		UNIFORM_MODEL,
+		UNIFORM_OBJECT_COLOR,
+		UNIFORM_OBJECT_TEXTURE,
+		UNIFORM_USE_TEXTURE,
+		UNIFORM_USE_LIGHTING,
+		UNIFORM_USE_INSTANCING,
+		UNIFORM_UV_SCALE,
+		UNIFORM_MATERIAL_INDEX,
+		UNIFORM_TEXTURE_LAYER,
+		UNIFORM_COUNT
+	};
+
+	// binding points of the uniform blocks
+	enum BLOCK_BINDING
+	{
+		FRAME_BLOCK_BINDING = 0,
+		LIGHT_BLOCK_BINDING = 1,
+		MATERIAL_BLOCK_BINDING = 2,
+		CLUSTER_BLOCK_BINDING = 3,
+		SHADOW_BLOCK_BINDING = 4
+	};
+
+	// texture units of the light cluster buffers, the shadow
+	// maps and the depth pyramid; the texture arrays are bound
+	// to the units below the first of them, which is the most
+	// arrays TextureArrays adds without bindless handles, so
+	// that they never share a unit with a sampler of another
+	// type
+	enum TEXTURE_UNIT
+	{
+		CLUSTER_LIGHT_COUNT_UNIT = 16,
+		CLUSTER_LIGHT_INDEX_UNIT = 17,
+		SHADOW_MAP_UNIT = 18,
+		HIZ_BUFFER_UNIT = 19
+	};
+
+	// std140 layout of the FrameBlock uniform block
+	struct FRAME_BLOCK
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec4 viewPosition;
+	};
+
+	// std140 layout of one Material in the MaterialBlock
+	struct MATERIAL_DATA
+	{
+		glm::vec3 ambientColor;
+		float ambientStrength;
+		glm::vec3 diffuseColor;
+		float padding0;
+		glm::vec3 specularColor;
+		float shininess;
+	};
+
+	struct MATERIAL_BLOCK
+	{
+		MATERIAL_DATA materials[MAX_MATERIALS];
+	};
+
+private:
+	// the linked shader program the locations belong to
+	GLuint m_programID;
+	// cached uniform locations
+	GLint m_locations[UNIFORM_COUNT];
+	// uniform buffer objects for the blocks
+	GLuint m_frameUBO;
+	GLuint m_materialUBO;
+	// copies of the block contents last uploaded
+	FRAME_BLOCK m_frameBlock;
+	MATERIAL_BLOCK m_materialBlock;
+	// number of block uploads made since the counter was reset
+	int m_blockUploads;
+	// last value set into every per-draw uniform, large enough
+	// for a mat4, and true once a value was set into the program
+	unsigned char m_values[UNIFORM_COUNT][sizeof(glm::mat4)];
+	bool m_bValueKnown[UNIFORM_COUNT];
+	// number of per-draw uniforms set, and of those skipped for
+	// holding the same value already, since the counter was reset
+	int m_uniformSets;
+	int m_redundantUniformSets;
+
+	// create a uniform buffer bound to a binding point
+	GLuint CreateBlockBuffer(GLuint binding, GLsizeiptr size, const void* data);
+	// attach a named uniform block of the program to a binding point
+	void BindProgramBlock(const char* blockName, GLuint binding);
+	// point a named sampler of the program at a texture unit
+	void BindProgramSampler(const char* samplerName, GLint unit);
+	// free the uniform buffers
+	void DestroyBlockBuffers();
+	// keep a new value of a per-draw uniform; false when it
+	// already holds the value
+	bool UpdateValue(UNIFORM_ID uniform, const void* value, size_t size);
+
+public:
+	// resolve the locations and uniform blocks of a linked program
+	bool Resolve(GLuint programID);
+	// resolve the locations of the program currently in use
+	bool ResolveCurrentProgram();
+
+	// cached location of a per-draw uniform
+	GLint GetLocation(UNIFORM_ID uniform) const;
+
+	// set per-draw uniforms through their cached locations
+	void SetIntValue(UNIFORM_ID uniform, int value);
+	void SetVec2Value(UNIFORM_ID uniform, const glm::vec2& value);
+	void SetVec4Value(UNIFORM_ID uniform, const glm::vec4& value);
+	void SetMat4Value(UNIFORM_ID uniform, const glm::mat4& value);
+	void SetTextureHandle(UNIFORM_ID uniform, GLuint64 handle);
+
+	// update block contents, uploading only what changed
+	void SetFrameData(
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		const glm::vec3& viewPosition);
+	void SetMaterial(int index, const MATERIAL_DATA& material);
+
+	// contents of the FrameBlock last uploaded
+	const FRAME_BLOCK& GetFrameData() const;
+	// bind the FrameBlock buffer again after another buffer
+	// was bound in its place
+	void BindFrameBlock();
+
+	// number of block uploads made since the last reset
+	int GetBlockUploads() const;
+	void ResetBlockUploads();
+
+	// number of per-draw uniforms set, and of those skipped,
+	// since the last reset
+	int GetUniformSets() const;
+	int GetRedundantUniformSets() const;
+	void ResetUniformSets();
+};
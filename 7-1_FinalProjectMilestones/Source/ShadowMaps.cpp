@@ -0,0 +1,490 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.cpp
+// ============
+// cascaded shadow maps of the key light, drawn again only when they change
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ShadowMaps.h"
+#include "GLStateCache.h"
+#include "ShaderUniforms.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// smallest and largest size of the shadow map layers
+	const int g_MinResolution = 256;
+	const int g_MaxResolution = 8192;
+
+	// camera view depth beyond which nothing casts a shadow,
+	// so that the cascades keep a useful texel size when the
+	// far plane is far away
+	const float g_MaxShadowDistance = 60.0f;
+	// blend between logarithmic and uniform split depths; the
+	// logarithmic splits give every cascade the same texel
+	// size on screen but leave the first one very short
+	const float g_SplitBlend = 0.75f;
+
+	// part of the radius of a cascade added around it, which is
+	// also the size of the grid its center is snapped to, so
+	// the camera can move that far before it is drawn again
+	const float g_GuardBand = 0.25f;
+	// the radius is rounded up to this step, so that rounding
+	// noise of a turning camera does not change the cascade
+	const float g_RadiusStep = 1.0f / 16.0f;
+	// depth added in front of and behind the scene bounds
+	const float g_DepthMargin = 1.0f;
+
+	// slope scaled and constant depth bias of the shadow casters
+	const float g_PolygonOffsetFactor = 2.0f;
+	const float g_PolygonOffsetUnits = 4.0f;
+
+	// texture units the fragment shaders need next to those
+	// of the texture arrays
+	const GLint g_RequiredTextureUnits = ShaderUniforms::SHADOW_MAP_UNIT + 1;
+}
+
+/***********************************************************
+ *  ShadowMaps()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ShadowMaps::ShadowMaps()
+{
+	m_depthTexture = 0;
+	m_framebuffer = 0;
+	m_shadowUBO = 0;
+	m_cascadeFrameUBO = 0;
+	m_resolution = 0;
+	m_cascadeCount = 0;
+	m_block = SHADOW_BLOCK();
+	for (int c = 0; c < MAX_CASCADES; c++)
+	{
+		m_cascadeKeys[c] = CASCADE_KEY();
+	}
+	m_bKeysValid = false;
+	m_savedFramebuffer = 0;
+	memset(m_savedViewport, 0, sizeof(m_savedViewport));
+	m_bDrawingCascades = false;
+}
+
+/***********************************************************
+ *  ~ShadowMaps()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ShadowMaps::~ShadowMaps()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing the depth texture, the
+ *  framebuffer object and the uniform buffers.
+ ***********************************************************/
+void ShadowMaps::Destroy()
+{
+	if (m_framebuffer != 0)
+	{
+		glDeleteFramebuffers(1, &m_framebuffer);
+		m_framebuffer = 0;
+	}
+	if (m_depthTexture != 0)
+	{
+		glDeleteTextures(1, &m_depthTexture);
+		m_depthTexture = 0;
+		GLStateCache::Invalidate();
+	}
+	if (m_cascadeFrameUBO != 0)
+	{
+		glDeleteBuffers(1, &m_cascadeFrameUBO);
+		m_cascadeFrameUBO = 0;
+	}
+	if (m_shadowUBO != 0)
+	{
+		glDeleteBuffers(1, &m_shadowUBO);
+		m_shadowUBO = 0;
+	}
+	m_resolution = 0;
+	m_cascadeCount = 0;
+	m_bKeysValid = false;
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the uniform buffer of
+ *  the ShadowBlock, which the scene shaders always read,
+ *  and, unless shadows are turned off with 0 cascades, the
+ *  depth texture array and the framebuffer object its
+ *  layers are drawn through.  The resolution is kept
+ *  within what the context supports.  False is returned
+ *  when shadows stay off.
+ ***********************************************************/
+bool ShadowMaps::Initialize(int resolution, int cascadeCount)
+{
+	Destroy();
+
+	m_block = SHADOW_BLOCK();
+	glGenBuffers(1, &m_shadowUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(SHADOW_BLOCK), &m_block, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ShaderUniforms::SHADOW_BLOCK_BINDING, m_shadowUBO);
+
+	if (cascadeCount <= 0)
+	{
+		return(false);
+	}
+	if (cascadeCount > MAX_CASCADES)
+	{
+		cascadeCount = MAX_CASCADES;
+	}
+
+	GLint textureUnits = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_IMAGE_UNITS, &textureUnits);
+	if (textureUnits < g_RequiredTextureUnits)
+	{
+		std::cout << "Shadow maps need " << g_RequiredTextureUnits << " texture units" << std::endl;
+		return(false);
+	}
+
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	if (resolution > maxTextureSize)
+	{
+		resolution = maxTextureSize;
+	}
+	if (resolution > g_MaxResolution)
+	{
+		resolution = g_MaxResolution;
+	}
+	if (resolution < g_MinResolution)
+	{
+		resolution = g_MinResolution;
+	}
+
+	// the layers are compared against in the shader, and the
+	// border counts as lit so that nothing outside a cascade
+	// is darkened
+	const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glGenTextures(1, &m_depthTexture);
+	GLStateCache::EditTexture(ShaderUniforms::SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, m_depthTexture);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+	GLuint sceneFramebuffer = GLStateCache::GetDrawFramebuffer();
+	glGenFramebuffers(1, &m_framebuffer);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, 0);
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+	if (status != GL_FRAMEBUFFER_COMPLETE)
+	{
+		std::cout << "Shadow map framebuffer is incomplete:" << status << std::endl;
+		glDeleteFramebuffers(1, &m_framebuffer);
+		glDeleteTextures(1, &m_depthTexture);
+		m_framebuffer = 0;
+		m_depthTexture = 0;
+		GLStateCache::Invalidate();
+		return(false);
+	}
+
+	glGenBuffers(1, &m_cascadeFrameUBO);
+	glBindBuffer(GL_UNIFORM_BUFFER, m_cascadeFrameUBO);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(ShaderUniforms::FRAME_BLOCK), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	m_resolution = resolution;
+	m_cascadeCount = cascadeCount;
+	m_bKeysValid = false;
+
+	return(true);
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the shadow
+ *  maps have been created.
+ ***********************************************************/
+bool ShadowMaps::IsSupported() const
+{
+	return((m_depthTexture != 0) && (m_framebuffer != 0));
+}
+
+/***********************************************************
+ *  GetResolution()
+ *
+ *  This method is used for getting the size of the shadow
+ *  map layers in texels.
+ ***********************************************************/
+int ShadowMaps::GetResolution() const
+{
+	return(m_resolution);
+}
+
+/***********************************************************
+ *  GetCascadeCount()
+ *
+ *  This method is used for getting the number of cascades,
+ *  which is 0 while shadows are off.
+ ***********************************************************/
+int ShadowMaps::GetCascadeCount() const
+{
+	return(m_cascadeCount);
+}
+
+/***********************************************************
+ *  PlaceCascades()
+ *
+ *  This method is used for splitting the camera view into
+ *  the depth ranges of the cascades and fitting a light
+ *  view around each of them.  Every range is enclosed in a
+ *  sphere, so that the size of its cascade does not change
+ *  as the camera turns, and the center of the sphere is
+ *  snapped to a grid in light space with a guard band of
+ *  one grid step around it.  The depth range of the light
+ *  views covers the whole scene, so casters outside the
+ *  camera view still reach it.  A cascade is marked stale
+ *  when its placement differs from the one it was last
+ *  drawn with.  Only the cached placements are changed, so
+ *  this runs on the update thread.
+ ***********************************************************/
+void ShadowMaps::PlaceCascades(
+	const glm::mat4& cameraView,
+	const glm::mat4& cameraProjection,
+	const glm::vec3& lightDirection,
+	const BoundingVolumes::BOUNDING_BOX& sceneBounds,
+	int casterRevision,
+	CASCADE* pCascades,
+	SHADOW_BLOCK& shadowBlock)
+{
+	shadowBlock = SHADOW_BLOCK();
+	if ((IsSupported() == false) || (NULL == pCascades))
+	{
+		return;
+	}
+
+	float nearDepth = 0.0f;
+	float farDepth = 0.0f;
+	BoundingVolumes::GetDepthRange(cameraProjection, nearDepth, farDepth);
+	float shadowDepth = (farDepth < g_MaxShadowDistance) ? farDepth : g_MaxShadowDistance;
+	if (shadowDepth <= nearDepth)
+	{
+		return;
+	}
+
+	// light space without a translation; the cascades only
+	// differ in where they are centered on its grid
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = (fabsf(direction.y) > 0.99f) ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	glm::mat4 lightRotation = glm::lookAt(glm::vec3(0.0f), direction, up);
+
+	// depth range of the scene along the light
+	float minLightDepth = FLT_MAX;
+	float maxLightDepth = -FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 point(
+			((corner & 1) != 0) ? sceneBounds.maxPoint.x : sceneBounds.minPoint.x,
+			((corner & 2) != 0) ? sceneBounds.maxPoint.y : sceneBounds.minPoint.y,
+			((corner & 4) != 0) ? sceneBounds.maxPoint.z : sceneBounds.minPoint.z);
+		float depth = -glm::vec3(lightRotation * glm::vec4(point, 1.0f)).z;
+		minLightDepth = (depth < minLightDepth) ? depth : minLightDepth;
+		maxLightDepth = (depth > maxLightDepth) ? depth : maxLightDepth;
+	}
+	minLightDepth -= g_DepthMargin;
+	maxLightDepth += g_DepthMargin;
+
+	// view space edges of the camera frustum, which are cut at
+	// the split depths
+	glm::mat4 inverseProjection = glm::inverse(cameraProjection);
+	glm::mat4 inverseView = glm::inverse(cameraView);
+	glm::vec3 edgeNear[4];
+	glm::vec3 edgeFar[4];
+	for (int edge = 0; edge < 4; edge++)
+	{
+		glm::vec2 ndc(((edge & 1) != 0) ? 1.0f : -1.0f, ((edge & 2) != 0) ? 1.0f : -1.0f);
+		glm::vec4 nearPoint = inverseProjection * glm::vec4(ndc.x, ndc.y, -1.0f, 1.0f);
+		glm::vec4 farPoint = inverseProjection * glm::vec4(ndc.x, ndc.y, 1.0f, 1.0f);
+		edgeNear[edge] = glm::vec3(nearPoint) / nearPoint.w;
+		edgeFar[edge] = glm::vec3(farPoint) / farPoint.w;
+	}
+
+	// biases the light clip space into texture coordinates
+	glm::mat4 textureBias = glm::translate(glm::mat4(1.0f), glm::vec3(0.5f));
+	textureBias = glm::scale(textureBias, glm::vec3(0.5f));
+
+	float splitNear = nearDepth;
+	for (int c = 0; c < m_cascadeCount; c++)
+	{
+		float fraction = (float)(c + 1) / (float)m_cascadeCount;
+		float logSplit = nearDepth * powf(shadowDepth / nearDepth, fraction);
+		float uniformSplit = nearDepth + (shadowDepth - nearDepth) * fraction;
+		float splitFar = uniformSplit + (logSplit - uniformSplit) * g_SplitBlend;
+
+		// world space corners of the depth range and the sphere
+		// around them
+		glm::vec3 corners[8];
+		glm::vec3 center(0.0f);
+		for (int edge = 0; edge < 4; edge++)
+		{
+			float span = edgeFar[edge].z - edgeNear[edge].z;
+			glm::vec3 cutNear = edgeNear[edge] + (edgeFar[edge] - edgeNear[edge]) * ((-splitNear - edgeNear[edge].z) / span);
+			glm::vec3 cutFar = edgeNear[edge] + (edgeFar[edge] - edgeNear[edge]) * ((-splitFar - edgeNear[edge].z) / span);
+			corners[edge * 2] = glm::vec3(inverseView * glm::vec4(cutNear, 1.0f));
+			corners[edge * 2 + 1] = glm::vec3(inverseView * glm::vec4(cutFar, 1.0f));
+			center += corners[edge * 2] + corners[edge * 2 + 1];
+		}
+		center /= 8.0f;
+		float radius = 0.0f;
+		for (int corner = 0; corner < 8; corner++)
+		{
+			float distance = glm::length(corners[corner] - center);
+			radius = (distance > radius) ? distance : radius;
+		}
+		radius = ceilf(radius / g_RadiusStep) * g_RadiusStep;
+
+		// the grid step is a whole number of texels, so that a
+		// cascade drawn again lines up with the one it replaces
+		float extent = radius * (1.0f + g_GuardBand);
+		float texelSize = 2.0f * extent / (float)m_resolution;
+		float gridStep = floorf(radius * g_GuardBand / texelSize) * texelSize;
+		if (gridStep < texelSize)
+		{
+			gridStep = texelSize;
+		}
+		glm::vec3 lightCenter = glm::vec3(lightRotation * glm::vec4(center, 1.0f));
+		lightCenter.x = floorf(lightCenter.x / gridStep + 0.5f) * gridStep;
+		lightCenter.y = floorf(lightCenter.y / gridStep + 0.5f) * gridStep;
+		lightCenter.z = 0.0f;
+
+		CASCADE& cascade = pCascades[c];
+		cascade.view = glm::translate(glm::mat4(1.0f), -lightCenter) * lightRotation;
+		cascade.projection = glm::ortho(-extent, extent, -extent, extent, minLightDepth, maxLightDepth);
+		cascade.frustum = BoundingVolumes::ExtractFrustum(cascade.projection * cascade.view);
+		cascade.splitDepth = splitFar;
+
+		CASCADE_KEY key = CASCADE_KEY();
+		key.lightDirection = direction;
+		key.center = lightCenter;
+		key.extent = extent;
+		key.nearDepth = minLightDepth;
+		key.farDepth = maxLightDepth;
+		key.casterRevision = casterRevision;
+		cascade.bStale = (m_bKeysValid == false) || (memcmp(&key, &m_cascadeKeys[c], sizeof(CASCADE_KEY)) != 0);
+		m_cascadeKeys[c] = key;
+
+		shadowBlock.cascadeMatrices[c] = textureBias * cascade.projection * cascade.view;
+		shadowBlock.cascadeSplits[c] = splitFar;
+		shadowBlock.cascadeTexelSizes[c] = texelSize;
+
+		splitNear = splitFar;
+	}
+	shadowBlock.shadowParams.x = m_cascadeCount;
+	m_bKeysValid = true;
+}
+
+/***********************************************************
+ *  SetCascades()
+ *
+ *  This method is used for uploading the ShadowBlock of the
+ *  cascades drawn for this frame, when it differs from the
+ *  last upload.
+ ***********************************************************/
+void ShadowMaps::SetCascades(const SHADOW_BLOCK& shadowBlock)
+{
+	if ((m_shadowUBO == 0) || (memcmp(&shadowBlock, &m_block, sizeof(SHADOW_BLOCK)) == 0))
+	{
+		return;
+	}
+
+	m_block = shadowBlock;
+	glBindBuffer(GL_UNIFORM_BUFFER, m_shadowUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(SHADOW_BLOCK), &m_block);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+/***********************************************************
+ *  BeginCascade()
+ *
+ *  This method is used for setting up drawing the depth of
+ *  the casters into the layer of a cascade.  The light view
+ *  is bound in place of the FrameBlock, so the scene
+ *  programs draw from the light without any change, and
+ *  the shadow maps are taken off their texture unit so
+ *  that no program samples the layer being drawn.  The
+ *  framebuffer and viewport to go back to are taken from
+ *  the state cache, without asking OpenGL.
+ ***********************************************************/
+void ShadowMaps::BeginCascade(int cascadeIndex, const CASCADE& cascade)
+{
+	if ((IsSupported() == false) || (cascadeIndex < 0) || (cascadeIndex >= m_cascadeCount))
+	{
+		return;
+	}
+
+	if (m_bDrawingCascades == false)
+	{
+		m_savedFramebuffer = GLStateCache::GetDrawFramebuffer();
+		GLStateCache::GetViewport(m_savedViewport);
+		GLStateCache::BindTexture(ShaderUniforms::SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, 0);
+		GLStateCache::SetCapability(GL_POLYGON_OFFSET_FILL, true);
+		glPolygonOffset(g_PolygonOffsetFactor, g_PolygonOffsetUnits);
+		m_bDrawingCascades = true;
+	}
+
+	ShaderUniforms::FRAME_BLOCK frameBlock;
+	frameBlock.view = cascade.view;
+	frameBlock.projection = cascade.projection;
+	frameBlock.viewPosition = glm::inverse(cascade.view)[3];
+	glBindBuffer(GL_UNIFORM_BUFFER, m_cascadeFrameUBO);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShaderUniforms::FRAME_BLOCK), &frameBlock);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, ShaderUniforms::FRAME_BLOCK_BINDING, m_cascadeFrameUBO);
+
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+	glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_depthTexture, 0, cascadeIndex);
+	GLStateCache::SetViewport(0, 0, m_resolution, m_resolution);
+	glClear(GL_DEPTH_BUFFER_BIT);
+}
+
+/***********************************************************
+ *  EndCascades()
+ *
+ *  This method is used for going back to the framebuffer
+ *  and viewport in use before the cascades were drawn, and
+ *  binding the shadow maps to their texture unit for the
+ *  scene.
+ ***********************************************************/
+void ShadowMaps::EndCascades()
+{
+	if (m_bDrawingCascades == false)
+	{
+		return;
+	}
+
+	GLStateCache::BindFramebuffer(GL_FRAMEBUFFER, m_savedFramebuffer);
+	GLStateCache::SetViewport(m_savedViewport[0], m_savedViewport[1], m_savedViewport[2], m_savedViewport[3]);
+	GLStateCache::SetCapability(GL_POLYGON_OFFSET_FILL, false);
+	GLStateCache::BindTexture(ShaderUniforms::SHADOW_MAP_UNIT, GL_TEXTURE_2D_ARRAY, m_depthTexture);
+	m_bDrawingCascades = false;
+}
\ No newline at end of file
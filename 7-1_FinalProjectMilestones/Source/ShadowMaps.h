@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// shadowmaps.h
+// ============
+// cascaded shadow maps of the key light, drawn again only when they change
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+/***********************************************************
+ *  ShadowMaps
+ *
+ *  This class contains the code for the shadows of the key
+ *  light, the first light of the scene, which is treated as
+ *  a directional light shining from its position towards
+ *  the middle of the scene.  The view is split into depth
+ *  ranges, each covered by a cascade of its own in one
+ *  layer of a depth texture array.  The cascades are
+ *  placed on a grid of light space texels with a guard
+ *  band around the view, so that small camera moves keep
+ *  the same cascade, and a cascade is only drawn again
+ *  when its placement, the light or the shadow casters
+ *  change.  Placing the cascades makes no OpenGL calls, so
+ *  it runs on the update thread while a packet is built;
+ *  the rest runs on the GL thread.
+ ***********************************************************/
+class ShadowMaps
+{
+public:
+	// constructor
+	ShadowMaps();
+	// destructor
+	~ShadowMaps();
+
+	// size of the cascade arrays declared in the ShadowBlock
+	static const int MAX_CASCADES = 4;
+
+	// view of the key light covering one depth range of the camera
+	struct CASCADE
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		// frustum of the light view the casters are culled against
+		BoundingVolumes::FRUSTUM frustum;
+		// camera view depth at which the next cascade takes over
+		float splitDepth;
+		// true when the layer of the cascade has to be drawn again
+		bool bStale;
+	};
+
+	// std140 layout of the ShadowBlock uniform block
+	struct SHADOW_BLOCK
+	{
+		// world to shadow map matrices, already biased into
+		// texture coordinates
+		glm::mat4 cascadeMatrices[MAX_CASCADES];
+		// camera view depths at which each cascade ends
+		glm::vec4 cascadeSplits;
+		// world size of one shadow map texel of each cascade
+		glm::vec4 cascadeTexelSizes;
+		// number of cascades, 0 while shadows are off
+		glm::ivec4 shadowParams;
+	};
+
+private:
+	// placement of a cascade when its layer was last scheduled,
+	// compared to tell whether it has to be drawn again
+	struct CASCADE_KEY
+	{
+		glm::vec3 lightDirection;
+		glm::vec3 center;
+		float extent;
+		float nearDepth;
+		float farDepth;
+		int casterRevision;
+	};
+
+	// depth texture array with one layer for each cascade
+	GLuint m_depthTexture;
+	// framebuffer object the layers are attached to in turn
+	GLuint m_framebuffer;
+	// uniform buffer object for the ShadowBlock
+	GLuint m_shadowUBO;
+	// uniform buffer object the FrameBlock of a cascade is put
+	// into while its layer is drawn
+	GLuint m_cascadeFrameUBO;
+	// size of the layers in texels, and the number of cascades
+	int m_resolution;
+	int m_cascadeCount;
+	// copy of the block contents last uploaded
+	SHADOW_BLOCK m_block;
+	// placement of every cascade when it was last scheduled
+	CASCADE_KEY m_cascadeKeys[MAX_CASCADES];
+	// true once every cascade has been scheduled at least once
+	bool m_bKeysValid;
+	// framebuffer and viewport in use before the layers were
+	// drawn, and true while a layer is being drawn
+	GLuint m_savedFramebuffer;
+	GLint m_savedViewport[4];
+	bool m_bDrawingCascades;
+
+	// free the texture, framebuffer and buffers
+	void Destroy();
+
+public:
+	// create the ShadowBlock, and the shadow maps where the
+	// context supports them; 0 cascades leaves shadows off
+	bool Initialize(int resolution, int cascadeCount);
+	// true once the shadow maps exist
+	bool IsSupported() const;
+	// size of the layers in texels
+	int GetResolution() const;
+	// number of cascades, 0 while shadows are off
+	int GetCascadeCount() const;
+
+	// place the cascades over the camera view and mark those
+	// whose layer has to be drawn again; the caster revision
+	// changes whenever a shadow casting object moves, and the
+	// block of the placement is returned in shadowBlock
+	void PlaceCascades(
+		const glm::mat4& cameraView,
+		const glm::mat4& cameraProjection,
+		const glm::vec3& lightDirection,
+		const BoundingVolumes::BOUNDING_BOX& sceneBounds,
+		int casterRevision,
+		CASCADE* pCascades,
+		SHADOW_BLOCK& shadowBlock);
+	// upload the block of the cascades drawn this frame
+	void SetCascades(const SHADOW_BLOCK& shadowBlock);
+	// set up drawing the depth of a cascade into its layer;
+	// the FrameBlock binding holds the light view until
+	// EndCascades() is called
+	void BeginCascade(int cascadeIndex, const CASCADE& cascade);
+	// restore the framebuffer and viewport after the cascades
+	// were drawn, and bind the shadow maps for the scene again;
+	// the FrameBlock is bound again by the caller
+	void EndCascades();
+};
\ No newline at end of file
@@ -0,0 +1,306 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.cpp
+// ============
+// persistently mapped ring buffer for data written every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "StreamBuffer.h"
+
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// longest single wait for a fence, in nanoseconds, before
+	// waiting again
+	const GLuint64 g_FenceTimeout = 1000000000;
+	// flags of the immutable storage and of its mapping
+	const GLbitfield g_StorageFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+}
+
+/***********************************************************
+ *  StreamBuffer()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+StreamBuffer::StreamBuffer()
+{
+	m_buffer = 0;
+	m_pMapped = NULL;
+	m_regionSize = 0;
+	m_region = 0;
+	m_regionUsed = 0;
+	m_frameDemand = 0;
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		m_fences[i] = 0;
+	}
+	m_waits = 0;
+}
+
+/***********************************************************
+ *  ~StreamBuffer()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+StreamBuffer::~StreamBuffer()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  IsSupported()
+ *
+ *  This method is used for checking whether the context
+ *  supports immutable buffer storage that stays mapped.
+ ***********************************************************/
+bool StreamBuffer::IsSupported()
+{
+	return((GLEW_VERSION_4_4 == GL_TRUE) || (GLEW_ARB_buffer_storage == GL_TRUE));
+}
+
+/***********************************************************
+ *  Initialize()
+ *
+ *  This method is used for creating the buffer with the
+ *  passed in size for each region.  False is returned when
+ *  the context cannot map buffers persistently, and the
+ *  callers keep uploading through the driver then.
+ ***********************************************************/
+bool StreamBuffer::Initialize(size_t regionSize)
+{
+	if (IsSupported() == false)
+	{
+		return(false);
+	}
+
+	Destroy();
+
+	return(CreateBuffer(regionSize));
+}
+
+/***********************************************************
+ *  IsInitialized()
+ *
+ *  This method is used for checking whether the buffer has
+ *  been created and mapped.
+ ***********************************************************/
+bool StreamBuffer::IsInitialized() const
+{
+	return(m_pMapped != NULL);
+}
+
+/***********************************************************
+ *  CreateBuffer()
+ *
+ *  This method is used for creating the immutable storage
+ *  for all regions and mapping it for the lifetime of the
+ *  buffer.  The copy write target is used so that no other
+ *  buffer binding is disturbed.
+ ***********************************************************/
+bool StreamBuffer::CreateBuffer(size_t regionSize)
+{
+	GLsizeiptr size = (GLsizeiptr)(regionSize * REGION_COUNT);
+
+	glGenBuffers(1, &m_buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+	glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, g_StorageFlags);
+	m_pMapped = (char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, g_StorageFlags);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	if (m_pMapped == NULL)
+	{
+		std::cout << "Could not map the stream buffer of " << size << " bytes" << std::endl;
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+		return(false);
+	}
+
+	m_regionSize = regionSize;
+	m_region = 0;
+	m_regionUsed = 0;
+	m_frameDemand = 0;
+
+	return(true);
+}
+
+/***********************************************************
+ *  WaitForRegion()
+ *
+ *  This method is used for waiting until the GPU is done
+ *  with the frame that last wrote a region.  The commands
+ *  are flushed on the first wait so that the fence is sure
+ *  to be reached.
+ ***********************************************************/
+void StreamBuffer::WaitForRegion(int region)
+{
+	if (m_fences[region] == 0)
+	{
+		return;
+	}
+
+	GLbitfield flags = 0;
+	GLenum result = glClientWaitSync(m_fences[region], flags, 0);
+	if ((result == GL_TIMEOUT_EXPIRED) || (result == GL_WAIT_FAILED))
+	{
+		m_waits++;
+		flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+		do
+		{
+			result = glClientWaitSync(m_fences[region], flags, g_FenceTimeout);
+		} while (result == GL_TIMEOUT_EXPIRED);
+	}
+
+	glDeleteSync(m_fences[region]);
+	m_fences[region] = 0;
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for waiting until the GPU no longer
+ *  reads the buffer, and for unmapping and freeing it.
+ ***********************************************************/
+void StreamBuffer::Destroy()
+{
+	for (int i = 0; i < REGION_COUNT; i++)
+	{
+		WaitForRegion(i);
+	}
+
+	if (m_buffer != 0)
+	{
+		glBindBuffer(GL_COPY_WRITE_BUFFER, m_buffer);
+		glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		glDeleteBuffers(1, &m_buffer);
+		m_buffer = 0;
+	}
+	m_pMapped = NULL;
+	m_regionSize = 0;
+}
+
+/***********************************************************
+ *  BeginFrame()
+ *
+ *  This method is used for moving to the region of the
+ *  next frame.  When the last frame asked for more than a
+ *  region holds, the buffer is created again with twice
+ *  the size that was asked for, once the GPU is done with
+ *  all of it, so the next frames fit.  True is returned
+ *  then, since the buffer object has to be bound again even
+ *  when the new one got the same name.
+ ***********************************************************/
+bool StreamBuffer::BeginFrame()
+{
+	if (IsInitialized() == false)
+	{
+		return(false);
+	}
+
+	bool bGrown = false;
+	if (m_frameDemand > m_regionSize)
+	{
+		size_t regionSize = m_regionSize;
+		while (regionSize < m_frameDemand * 2)
+		{
+			regionSize *= 2;
+		}
+
+		Destroy();
+		if (CreateBuffer(regionSize) == false)
+		{
+			return(true);
+		}
+		bGrown = true;
+	}
+	else
+	{
+		m_region = (m_region + 1) % REGION_COUNT;
+		WaitForRegion(m_region);
+	}
+
+	m_regionUsed = 0;
+	m_frameDemand = 0;
+
+	return(bGrown);
+}
+
+/***********************************************************
+ *  EndFrame()
+ *
+ *  This method is used for fencing the region of the frame
+ *  after all the draws reading it have been sent.
+ ***********************************************************/
+void StreamBuffer::EndFrame()
+{
+	if ((IsInitialized() == false) || (m_regionUsed == 0))
+	{
+		return;
+	}
+
+	m_fences[m_region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+/***********************************************************
+ *  Allocate()
+ *
+ *  This method is used for reserving bytes in the region
+ *  of the frame.  The offset from the start of the buffer
+ *  is a multiple of the alignment, which does not have to
+ *  be a power of two, so that it can be a whole number of
+ *  vertices or instances.  NULL is returned when the bytes
+ *  do not fit; the request still counts toward the size of
+ *  the regions from the next frame on.
+ ***********************************************************/
+void* StreamBuffer::Allocate(size_t size, size_t alignment, size_t& offset)
+{
+	if (IsInitialized() == false)
+	{
+		return(NULL);
+	}
+	if (alignment == 0)
+	{
+		alignment = 1;
+	}
+
+	size_t regionStart = m_region * m_regionSize;
+	size_t start = regionStart + m_regionUsed;
+	start = ((start + alignment - 1) / alignment) * alignment;
+
+	m_frameDemand += size + alignment;
+	if (start + size > regionStart + m_regionSize)
+	{
+		return(NULL);
+	}
+
+	m_regionUsed = start + size - regionStart;
+	offset = start;
+
+	return(m_pMapped + start);
+}
+
+/***********************************************************
+ *  GetBuffer()
+ *
+ *  This method is used for getting the buffer object, to
+ *  bind it or to point vertex attributes at it.  It changes
+ *  when the buffer grows.
+ ***********************************************************/
+GLuint StreamBuffer::GetBuffer() const
+{
+	return(m_buffer);
+}
+
+/***********************************************************
+ *  GetWaits()
+ *
+ *  This method is used for getting the number of times a
+ *  region was still being read by the GPU at the start of
+ *  a frame, which means more regions would help.
+ ***********************************************************/
+int StreamBuffer::GetWaits() const
+{
+	return(m_waits);
+}
@@ -0,0 +1,85 @@
+///////////////////////////////////////////////////////////////////////////////
+// streambuffer.h
+// ============
+// persistently mapped ring buffer for data written every frame
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <cstddef>
+
+/***********************************************************
+ *  StreamBuffer
+ *
+ *  This class contains the code for streaming per-frame data
+ *  to the GPU without driver copies.  One buffer is created
+ *  with immutable storage and mapped once, persistently and
+ *  coherently, and is split into a region for each of the
+ *  last frames in flight.  Every frame writes into the next
+ *  region, which is fenced once the frame has been sent, so
+ *  the CPU only waits when the GPU is more than the region
+ *  count behind.  A frame asking for more than its region
+ *  grows the buffer at the start of the next frame.
+ ***********************************************************/
+class StreamBuffer
+{
+public:
+	// constructor
+	StreamBuffer();
+	// destructor
+	~StreamBuffer();
+
+	// number of regions, one for each frame in flight
+	static const int REGION_COUNT = 3;
+
+private:
+	// buffer object and its persistent mapping
+	GLuint m_buffer;
+	char* m_pMapped;
+	// size of each region
+	size_t m_regionSize;
+	// region written this frame, and the bytes used in it
+	int m_region;
+	size_t m_regionUsed;
+	// bytes asked for this frame, including the failed requests
+	size_t m_frameDemand;
+	// fence of the last frame that wrote each region, or 0
+	GLsync m_fences[REGION_COUNT];
+	// number of times a region was still in use by the GPU
+	int m_waits;
+
+	// create and map the buffer with regions of the passed in size
+	bool CreateBuffer(size_t regionSize);
+	// wait for a region and free its fence
+	void WaitForRegion(int region);
+	// unmap and free the buffer, waiting for the GPU first
+	void Destroy();
+
+public:
+	// true when the context supports persistently mapped buffers
+	static bool IsSupported();
+
+	// create the buffer; false when it is not supported
+	bool Initialize(size_t regionSize);
+	// true once the buffer has been created
+	bool IsInitialized() const;
+
+	// move to the region of the next frame, waiting for the GPU
+	// when it is still reading it, and grow the buffer when the
+	// last frame did not fit; true is returned when it grew
+	bool BeginFrame();
+	// fence the region of the frame once its draws are sent
+	void EndFrame();
+
+	// reserve bytes in the region of the frame, aligned from the
+	// start of the buffer; NULL is returned when they do not fit
+	void* Allocate(size_t size, size_t alignment, size_t& offset);
+
+	// buffer object, which changes when the buffer grows
+	GLuint GetBuffer() const;
+	// number of waits for the GPU since the buffer was created
+	int GetWaits() const;
+};
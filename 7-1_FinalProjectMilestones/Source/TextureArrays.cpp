@@ -0,0 +1,923 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.cpp
+// ============
+// pack the scene textures into 2D texture arrays grouped by size and format
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureArrays.h"
+#include "GLStateCache.h"
+
+#include <iostream>
+
+/***********************************************************
+ *  TextureArrays()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureArrays::TextureArrays()
+{
+	m_bBindless = false;
+	m_bBindlessChecked = false;
+	m_maxLayers = 0;
+	m_placeholderArray = -1;
+	m_bReportedArrayLimit = false;
+}
+
+/***********************************************************
+ *  ~TextureArrays()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureArrays::~TextureArrays()
+{
+	Destroy();
+}
+
+/***********************************************************
+ *  CheckBindless()
+ *
+ *  This method is used for deciding, before the first array
+ *  is created, whether bindless handles are used.
+ ***********************************************************/
+void TextureArrays::CheckBindless()
+{
+	if (m_bBindlessChecked == false)
+	{
+		m_bBindless = (GLEW_ARB_bindless_texture == GL_TRUE);
+		m_bBindlessChecked = true;
+
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &m_maxLayers);
+		if (m_maxLayers <= 0)
+		{
+			// the minimum required by OpenGL 3.3
+			m_maxLayers = 256;
+		}
+	}
+}
+
+/***********************************************************
+ *  AddArray()
+ *
+ *  This method is used for adding the description of an
+ *  array that has not been created in OpenGL yet.
+ ***********************************************************/
+int TextureArrays::AddArray(int width, int height, int colorChannels)
+{
+	TEXTURE_ARRAY textureArray;
+	textureArray.width = width;
+	textureArray.height = height;
+	textureArray.colorChannels = colorChannels;
+	textureArray.compressedFormat = 0;
+	textureArray.textureID = 0;
+	textureArray.handle = 0;
+	textureArray.layerCount = 0;
+	textureArray.capacity = 0;
+	textureArray.bBuilt = false;
+	textureArray.bStreaming = false;
+	m_arrays.push_back(textureArray);
+
+	return((int)m_arrays.size() - 1);
+}
+
+/***********************************************************
+ *  HasRoomForArray()
+ *
+ *  This method is used for checking whether another array
+ *  can be added.  Without bindless handles every array is
+ *  bound to the texture unit matching its index, which has
+ *  to stay below the units of the other samplers, and the
+ *  last unit is kept for the placeholder.  Running out is
+ *  reported once.
+ ***********************************************************/
+bool TextureArrays::HasRoomForArray()
+{
+	if (m_bBindless == true)
+	{
+		return(true);
+	}
+
+	int arrayCount = (int)m_arrays.size();
+	if (m_placeholderArray < 0)
+	{
+		arrayCount++;
+	}
+	if (arrayCount < MAX_BOUND_ARRAYS)
+	{
+		return(true);
+	}
+
+	if (m_bReportedArrayLimit == false)
+	{
+		std::cout << "Only " << MAX_BOUND_ARRAYS << " texture arrays can be bound, the textures that need more are shown with the placeholder" << std::endl;
+		m_bReportedArrayLimit = true;
+	}
+
+	return(false);
+}
+
+/***********************************************************
+ *  FindOpenArray()
+ *
+ *  This method is used for finding an array that has not
+ *  been built yet and matches the size and format of an
+ *  image.  A new array is added when none matches or the
+ *  matching one is full, and -1 is returned when there is
+ *  no room for it.
+ ***********************************************************/
+int TextureArrays::FindOpenArray(int width, int height, int colorChannels)
+{
+	CheckBindless();
+
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if ((textureArray.bBuilt == false) &&
+			(textureArray.width == width) &&
+			(textureArray.height == height) &&
+			(textureArray.colorChannels == colorChannels) &&
+			(textureArray.layerCount < m_maxLayers))
+		{
+			return(i);
+		}
+	}
+
+	if (HasRoomForArray() == false)
+	{
+		return(-1);
+	}
+
+	return(AddArray(width, height, colorChannels));
+}
+
+/***********************************************************
+ *  MatchesCompressed()
+ *
+ *  This method is used for checking whether a compressed
+ *  image has the size, format and mip levels of an array.
+ ***********************************************************/
+bool TextureArrays::MatchesCompressed(
+	const TEXTURE_ARRAY& textureArray,
+	const TextureCompression::COMPRESSED_IMAGE& image)
+{
+	return((textureArray.compressedFormat == image.format) &&
+		(textureArray.width == image.width) &&
+		(textureArray.height == image.height) &&
+		(textureArray.levels.size() == image.levels.size()));
+}
+
+/***********************************************************
+ *  FindOpenArray()
+ *
+ *  This method is used for finding an array that has not
+ *  been built yet for a block compressed image, or adding
+ *  a new one, or -1 when there is no room for it.
+ ***********************************************************/
+int TextureArrays::FindOpenArray(const TextureCompression::COMPRESSED_IMAGE& image)
+{
+	CheckBindless();
+
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if ((textureArray.bBuilt == false) &&
+			(MatchesCompressed(textureArray, image) == true) &&
+			(textureArray.layerCount < m_maxLayers))
+		{
+			return(i);
+		}
+	}
+
+	if (HasRoomForArray() == false)
+	{
+		return(-1);
+	}
+
+	int arrayIndex = AddArray(image.width, image.height, 0);
+	m_arrays[arrayIndex].compressedFormat = image.format;
+	m_arrays[arrayIndex].levels = image.levels;
+
+	return(arrayIndex);
+}
+
+/***********************************************************
+ *  AddPendingLayer()
+ *
+ *  This method is used for giving a new image the next
+ *  layer of an array that is not built yet, copying its
+ *  data until the array is built.
+ ***********************************************************/
+int TextureArrays::AddPendingLayer(int arrayIndex, const unsigned char* pixels, size_t size)
+{
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	TEXTURE_LOCATION location;
+	location.arrayIndex = arrayIndex;
+	location.layer = textureArray.layerCount;
+	m_locations.push_back(location);
+
+	PENDING_LAYER layer;
+	layer.textureSlot = (int)m_locations.size() - 1;
+	layer.pixels.assign(pixels, pixels + size);
+	textureArray.pending.push_back(layer);
+	textureArray.layerCount++;
+
+	return(layer.textureSlot);
+}
+
+/***********************************************************
+ *  AddImage()
+ *
+ *  This method is used for adding a loaded image.  The
+ *  pixels are copied and kept until the next Build(), since
+ *  the size of an array has to be known to create it.  An
+ *  image that needs an array when no more can be added is
+ *  shown with the placeholder.
+ ***********************************************************/
+int TextureArrays::AddImage(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int colorChannels)
+{
+	if ((pixels == NULL) || (width <= 0) || (height <= 0))
+	{
+		return(-1);
+	}
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return(-1);
+	}
+
+	int arrayIndex = FindOpenArray(width, height, colorChannels);
+	if (arrayIndex < 0)
+	{
+		return(ReserveSlot());
+	}
+
+	return(AddPendingLayer(arrayIndex, pixels, (size_t)width * height * colorChannels));
+}
+
+/***********************************************************
+ *  AddCompressedImage()
+ *
+ *  This method is used for adding a block compressed image
+ *  with its prebuilt mip levels.  The data is copied and
+ *  kept until the next Build(), or the placeholder is shown
+ *  when no more arrays can be added.
+ ***********************************************************/
+int TextureArrays::AddCompressedImage(const TextureCompression::COMPRESSED_IMAGE& image)
+{
+	if ((SupportsCompression() == false) || (image.levels.size() == 0))
+	{
+		return(-1);
+	}
+
+	int arrayIndex = FindOpenArray(image);
+	if (arrayIndex < 0)
+	{
+		return(ReserveSlot());
+	}
+
+	return(AddPendingLayer(arrayIndex, image.data.data(), image.data.size()));
+}
+
+/***********************************************************
+ *  BindArray()
+ *
+ *  This method is used for binding an array to the texture
+ *  unit matching its index, where the shader samples it.
+ *  The state cache skips the bind while the array is still
+ *  in place.
+ ***********************************************************/
+void TextureArrays::BindArray(int arrayIndex)
+{
+	GLStateCache::BindTexture(arrayIndex, GL_TEXTURE_2D_ARRAY, m_arrays[arrayIndex].textureID);
+}
+
+/***********************************************************
+ *  EditArray()
+ *
+ *  This method is used for binding an array to upload into.
+ *  It is bound to its own texture unit as well, which is
+ *  made active, so that an upload never takes another array
+ *  off the unit the shader samples it from.
+ ***********************************************************/
+void TextureArrays::EditArray(int arrayIndex)
+{
+	GLStateCache::EditTexture(arrayIndex, GL_TEXTURE_2D_ARRAY, m_arrays[arrayIndex].textureID);
+}
+
+/***********************************************************
+ *  CreateArrayStorage()
+ *
+ *  This method is used for creating an array in OpenGL with
+ *  room for its capacity of layers, without any pixels.
+ ***********************************************************/
+void TextureArrays::CreateArrayStorage(int arrayIndex)
+{
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	GLint internalFormat = GL_RGB8;
+	GLenum pixelFormat = GL_RGB;
+	if (textureArray.colorChannels == 4)
+	{
+		// RGBA format - it supports transparency
+		internalFormat = GL_RGBA8;
+		pixelFormat = GL_RGBA;
+	}
+
+	glGenTextures(1, &textureArray.textureID);
+	EditArray(arrayIndex);
+
+	// set the texture wrapping parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	// set texture filtering parameters
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+	if (textureArray.compressedFormat != 0)
+	{
+		// every prebuilt mip level gets its own storage, so
+		// the chain is complete without generating mipmaps
+		for (int l = 0; l < textureArray.levels.size(); l++)
+		{
+			const TextureCompression::MIP_LEVEL& level = textureArray.levels[l];
+			glCompressedTexImage3D(
+				GL_TEXTURE_2D_ARRAY,
+				l,
+				textureArray.compressedFormat,
+				level.width,
+				level.height,
+				textureArray.capacity,
+				0,
+				(GLsizei)(level.size * textureArray.capacity),
+				NULL);
+		}
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)textureArray.levels.size() - 1);
+		if (textureArray.levels.size() > 1)
+		{
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		}
+		return;
+	}
+
+	glTexImage3D(
+		GL_TEXTURE_2D_ARRAY,
+		0,
+		internalFormat,
+		textureArray.width,
+		textureArray.height,
+		textureArray.capacity,
+		0,
+		pixelFormat,
+		GL_UNSIGNED_BYTE,
+		NULL);
+}
+
+/***********************************************************
+ *  ActivateArray()
+ *
+ *  This method is used for making a created array usable
+ *  by the shader, either as a resident bindless handle or
+ *  bound to the texture unit matching its index, which
+ *  HasRoomForArray() keeps below MAX_BOUND_ARRAYS.  The
+ *  texture parameters cannot change once the handle exists.
+ ***********************************************************/
+void TextureArrays::ActivateArray(int arrayIndex)
+{
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	if (m_bBindless == true)
+	{
+		textureArray.handle = glGetTextureHandleARB(textureArray.textureID);
+		glMakeTextureHandleResidentARB(textureArray.handle);
+		return;
+	}
+
+	BindArray(arrayIndex);
+}
+
+/***********************************************************
+ *  BuildArray()
+ *
+ *  This method is used for creating one texture array in
+ *  OpenGL, uploading its pending images as layers and
+ *  generating the mipmaps.
+ ***********************************************************/
+bool TextureArrays::BuildArray(int arrayIndex)
+{
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	GLenum pixelFormat = GL_RGB;
+	if (textureArray.colorChannels == 4)
+	{
+		pixelFormat = GL_RGBA;
+	}
+
+	textureArray.capacity = textureArray.layerCount;
+	CreateArrayStorage(arrayIndex);
+
+	if (textureArray.compressedFormat != 0)
+	{
+		for (int i = 0; i < textureArray.pending.size(); i++)
+		{
+			const PENDING_LAYER& layer = textureArray.pending[i];
+			UploadCompressedLayer(
+				arrayIndex,
+				m_locations[layer.textureSlot].layer,
+				layer.pixels.data());
+		}
+
+		// free the image data from local memory
+		textureArray.pending.clear();
+		textureArray.pending.shrink_to_fit();
+		textureArray.bBuilt = true;
+
+		std::cout << "Packed " << textureArray.layerCount << " compressed textures of " << textureArray.width << "x" << textureArray.height << " into texture array " << arrayIndex << std::endl;
+
+		return(true);
+	}
+
+	// rows of RGB images are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	for (int i = 0; i < textureArray.pending.size(); i++)
+	{
+		const PENDING_LAYER& layer = textureArray.pending[i];
+		glTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY,
+			0,
+			0, 0, m_locations[layer.textureSlot].layer,
+			textureArray.width,
+			textureArray.height,
+			1,
+			pixelFormat,
+			GL_UNSIGNED_BYTE,
+			layer.pixels.data());
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	// generate the texture mipmaps for mapping textures to lower resolutions
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+
+	// free the image data from local memory
+	textureArray.pending.clear();
+	textureArray.pending.shrink_to_fit();
+	textureArray.bBuilt = true;
+
+	std::cout << "Packed " << textureArray.layerCount << " textures of " << textureArray.width << "x" << textureArray.height << " into texture array " << arrayIndex << std::endl;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPlaceholderArray()
+ *
+ *  This method is used for getting the array of the small
+ *  grey placeholder, creating it the first time.
+ ***********************************************************/
+int TextureArrays::GetPlaceholderArray()
+{
+	if (m_placeholderArray < 0)
+	{
+		const unsigned char grey[2 * 2 * 4] =
+		{
+			128, 128, 128, 255,   160, 160, 160, 255,
+			160, 160, 160, 255,   128, 128, 128, 255
+		};
+
+		m_placeholderArray = AddArray(2, 2, 4);
+		TEXTURE_ARRAY& placeholder = m_arrays[m_placeholderArray];
+		placeholder.capacity = 1;
+		placeholder.layerCount = 1;
+		placeholder.bBuilt = true;
+
+		CreateArrayStorage(m_placeholderArray);
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 2, 2, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+		ActivateArray(m_placeholderArray);
+	}
+
+	return(m_placeholderArray);
+}
+
+/***********************************************************
+ *  ReserveSlot()
+ *
+ *  This method is used for reserving a texture slot for an
+ *  image that is still loading.  Until StreamImage() fills
+ *  the slot, it points at the placeholder so that the scene
+ *  can already be drawn.
+ ***********************************************************/
+int TextureArrays::ReserveSlot()
+{
+	CheckBindless();
+
+	TEXTURE_LOCATION location;
+	location.arrayIndex = GetPlaceholderArray();
+	location.layer = 0;
+	m_locations.push_back(location);
+
+	return((int)m_locations.size() - 1);
+}
+
+/***********************************************************
+ *  AddStreamingArray()
+ *
+ *  This method is used for creating a streaming array from
+ *  an added array description, with room for the passed in
+ *  number of layers.
+ ***********************************************************/
+int TextureArrays::AddStreamingArray(int arrayIndex, int capacity)
+{
+	if (capacity > m_maxLayers)
+	{
+		capacity = m_maxLayers;
+	}
+
+	TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+	textureArray.capacity = capacity;
+	textureArray.bBuilt = true;
+	textureArray.bStreaming = true;
+
+	CreateArrayStorage(arrayIndex);
+	ActivateArray(arrayIndex);
+
+	return(arrayIndex);
+}
+
+/***********************************************************
+ *  FindStreamingArray()
+ *
+ *  This method is used for finding a streaming array with a
+ *  free layer for an image.  When every matching array is
+ *  full, a new one is created with twice the capacity of the
+ *  last, so that the number of arrays grows slowly.  -1 is
+ *  returned when no more arrays can be added.
+ ***********************************************************/
+int TextureArrays::FindStreamingArray(int width, int height, int colorChannels)
+{
+	int capacity = 4;
+
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if ((textureArray.bStreaming == true) &&
+			(textureArray.compressedFormat == 0) &&
+			(textureArray.width == width) &&
+			(textureArray.height == height) &&
+			(textureArray.colorChannels == colorChannels))
+		{
+			if (textureArray.layerCount < textureArray.capacity)
+			{
+				return(i);
+			}
+			capacity = textureArray.capacity * 2;
+		}
+	}
+
+	if (HasRoomForArray() == false)
+	{
+		return(-1);
+	}
+
+	return(AddStreamingArray(AddArray(width, height, colorChannels), capacity));
+}
+
+/***********************************************************
+ *  FindStreamingArray()
+ *
+ *  This method is used for finding a streaming array with a
+ *  free layer for a block compressed image, or -1 when no
+ *  more arrays can be added.
+ ***********************************************************/
+int TextureArrays::FindStreamingArray(const TextureCompression::COMPRESSED_IMAGE& image)
+{
+	int capacity = 4;
+
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		const TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if ((textureArray.bStreaming == true) &&
+			(MatchesCompressed(textureArray, image) == true))
+		{
+			if (textureArray.layerCount < textureArray.capacity)
+			{
+				return(i);
+			}
+			capacity = textureArray.capacity * 2;
+		}
+	}
+
+	if (HasRoomForArray() == false)
+	{
+		return(-1);
+	}
+
+	int arrayIndex = AddArray(image.width, image.height, 0);
+	m_arrays[arrayIndex].compressedFormat = image.format;
+	m_arrays[arrayIndex].levels = image.levels;
+
+	return(AddStreamingArray(arrayIndex, capacity));
+}
+
+/***********************************************************
+ *  UploadCompressedLayer()
+ *
+ *  This method is used for uploading every mip level of a
+ *  block compressed image into one layer of an array.  The
+ *  data can be an offset into the bound
+ *  GL_PIXEL_UNPACK_BUFFER.
+ ***********************************************************/
+void TextureArrays::UploadCompressedLayer(
+	int arrayIndex,
+	int layer,
+	const unsigned char* data)
+{
+	const TEXTURE_ARRAY& textureArray = m_arrays[arrayIndex];
+
+	EditArray(arrayIndex);
+
+	for (int l = 0; l < textureArray.levels.size(); l++)
+	{
+		const TextureCompression::MIP_LEVEL& level = textureArray.levels[l];
+		glCompressedTexSubImage3D(
+			GL_TEXTURE_2D_ARRAY,
+			l,
+			0, 0, layer,
+			level.width,
+			level.height,
+			1,
+			textureArray.compressedFormat,
+			(GLsizei)level.size,
+			data + level.offset);
+	}
+}
+
+/***********************************************************
+ *  StreamCompressedImage()
+ *
+ *  This method is used for uploading a block compressed
+ *  image of a slot reserved by ReserveSlot(), with its
+ *  prebuilt mip levels, into a free layer of a streaming
+ *  array.
+ ***********************************************************/
+bool TextureArrays::StreamCompressedImage(
+	int textureSlot,
+	const TextureCompression::COMPRESSED_IMAGE& image,
+	const unsigned char* data)
+{
+	if ((textureSlot < 0) || (textureSlot >= m_locations.size()) ||
+		(image.levels.size() == 0) || (SupportsCompression() == false))
+	{
+		return(false);
+	}
+
+	CheckBindless();
+
+	// a texture that is loaded again keeps its layer while the
+	// image still matches it
+	TEXTURE_LOCATION& location = m_locations[textureSlot];
+	const TEXTURE_ARRAY& currentArray = m_arrays[location.arrayIndex];
+	if ((currentArray.bStreaming == false) ||
+		(MatchesCompressed(currentArray, image) == false))
+	{
+		int arrayIndex = FindStreamingArray(image);
+		if (arrayIndex < 0)
+		{
+			location.arrayIndex = GetPlaceholderArray();
+			location.layer = 0;
+			return(false);
+		}
+		location.arrayIndex = arrayIndex;
+		location.layer = m_arrays[arrayIndex].layerCount++;
+	}
+
+	UploadCompressedLayer(location.arrayIndex, location.layer, data);
+
+	return(true);
+}
+
+/***********************************************************
+ *  SupportsCompression()
+ *
+ *  This method is used for checking whether block
+ *  compressed textures can be created.
+ ***********************************************************/
+bool TextureArrays::SupportsCompression() const
+{
+	return(GLEW_EXT_texture_compression_s3tc == GL_TRUE);
+}
+
+/***********************************************************
+ *  StreamImage()
+ *
+ *  This method is used for uploading the image of a slot
+ *  reserved by ReserveSlot() into a free layer of a
+ *  streaming array, and pointing the slot at that layer.
+ *  A slot streamed again overwrites its layer in place when
+ *  the image has the same size and channels.  Streamed
+ *  layers have no mipmaps, since the arrays are sampled
+ *  without them.
+ ***********************************************************/
+bool TextureArrays::StreamImage(
+	int textureSlot,
+	const void* pixels,
+	int width,
+	int height,
+	int colorChannels)
+{
+	if ((textureSlot < 0) || (textureSlot >= m_locations.size()) ||
+		(width <= 0) || (height <= 0))
+	{
+		return(false);
+	}
+
+	if ((colorChannels != 3) && (colorChannels != 4))
+	{
+		std::cout << "Not implemented to handle image with " << colorChannels << " channels" << std::endl;
+		return(false);
+	}
+
+	CheckBindless();
+
+	// a texture that is loaded again keeps its layer while the
+	// image still matches it
+	TEXTURE_LOCATION& location = m_locations[textureSlot];
+	const TEXTURE_ARRAY& currentArray = m_arrays[location.arrayIndex];
+	if ((currentArray.bStreaming == false) ||
+		(currentArray.compressedFormat != 0) ||
+		(currentArray.width != width) ||
+		(currentArray.height != height) ||
+		(currentArray.colorChannels != colorChannels))
+	{
+		int arrayIndex = FindStreamingArray(width, height, colorChannels);
+		if (arrayIndex < 0)
+		{
+			location.arrayIndex = GetPlaceholderArray();
+			location.layer = 0;
+			return(false);
+		}
+		location.arrayIndex = arrayIndex;
+		location.layer = m_arrays[arrayIndex].layerCount++;
+	}
+
+	GLenum pixelFormat = GL_RGB;
+	if (colorChannels == 4)
+	{
+		pixelFormat = GL_RGBA;
+	}
+
+	// rows of RGB images are not padded to four bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	EditArray(location.arrayIndex);
+	glTexSubImage3D(
+		GL_TEXTURE_2D_ARRAY,
+		0,
+		0, 0, location.layer,
+		width,
+		height,
+		1,
+		pixelFormat,
+		GL_UNSIGNED_BYTE,
+		pixels);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+	return(true);
+}
+
+/***********************************************************
+ *  Build()
+ *
+ *  This method is used for creating the texture arrays of
+ *  the images added since the last build.  Bindless handles
+ *  are used when the driver supports them.
+ ***********************************************************/
+bool TextureArrays::Build()
+{
+	CheckBindless();
+
+	bool bReturn = true;
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		if (m_arrays[i].bBuilt == false)
+		{
+			bReturn = BuildArray(i) && bReturn;
+			if (m_bBindless == true)
+			{
+				ActivateArray(i);
+			}
+		}
+	}
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  Bind()
+ *
+ *  This method is used for binding every texture array to
+ *  the texture unit matching its index.  Bindless arrays are
+ *  already resident and need no binding.
+ ***********************************************************/
+void TextureArrays::Bind()
+{
+	if (m_bBindless == true)
+	{
+		return;
+	}
+
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		// bind arrays on corresponding texture units; arrays
+		// that are still in place are skipped by the state cache
+		BindArray(i);
+	}
+}
+
+/***********************************************************
+ *  Destroy()
+ *
+ *  This method is used for freeing all the texture arrays.
+ ***********************************************************/
+void TextureArrays::Destroy()
+{
+	for (int i = 0; i < m_arrays.size(); i++)
+	{
+		TEXTURE_ARRAY& textureArray = m_arrays[i];
+		if (textureArray.handle != 0)
+		{
+			glMakeTextureHandleNonResidentARB(textureArray.handle);
+			textureArray.handle = 0;
+		}
+		if (textureArray.textureID != 0)
+		{
+			glDeleteTextures(1, &textureArray.textureID);
+			textureArray.textureID = 0;
+		}
+	}
+	m_arrays.clear();
+	m_locations.clear();
+	m_placeholderArray = -1;
+	m_bReportedArrayLimit = false;
+	GLStateCache::Invalidate();
+}
+
+/***********************************************************
+ *  GetLocation()
+ *
+ *  This method is used for getting the array and layer
+ *  that the texture in the passed in slot was packed into.
+ ***********************************************************/
+const TextureArrays::TEXTURE_LOCATION& TextureArrays::GetLocation(int textureSlot) const
+{
+	return(m_locations[textureSlot]);
+}
+
+/***********************************************************
+ *  GetArrayHandle()
+ *
+ *  This method is used for getting the bindless handle of
+ *  a texture array.
+ ***********************************************************/
+GLuint64 TextureArrays::GetArrayHandle(int arrayIndex) const
+{
+	return(m_arrays[arrayIndex].handle);
+}
+
+/***********************************************************
+ *  IsBindless()
+ *
+ *  This method is used for checking whether the arrays are
+ *  used through bindless handles.
+ ***********************************************************/
+bool TextureArrays::IsBindless() const
+{
+	return(m_bBindless);
+}
+
+/***********************************************************
+ *  GetTextureCount()
+ *
+ *  This method is used for getting the number of textures
+ *  that were added.
+ ***********************************************************/
+int TextureArrays::GetTextureCount() const
+{
+	return((int)m_locations.size());
+}
+
+/***********************************************************
+ *  GetArrayCount()
+ *
+ *  This method is used for getting the number of texture
+ *  arrays.
+ ***********************************************************/
+int TextureArrays::GetArrayCount() const
+{
+	return((int)m_arrays.size());
+}
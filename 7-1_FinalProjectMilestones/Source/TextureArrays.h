@@ -0,0 +1,187 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturearrays.h
+// ============
+// pack the scene textures into 2D texture arrays grouped by size and format
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderUniforms.h"
+#include "TextureCompression.h"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+/***********************************************************
+ *  TextureArrays
+ *
+ *  This class contains the code for packing loaded images
+ *  of the same size and format into the layers of one
+ *  GL_TEXTURE_2D_ARRAY.  Every array stays bound to its own
+ *  texture unit, or is made resident as a bindless handle
+ *  where ARB_bindless_texture is available, so drawing a new
+ *  texture only changes uniforms and never rebinds.
+ ***********************************************************/
+class TextureArrays
+{
+public:
+	// constructor
+	TextureArrays();
+	// destructor
+	~TextureArrays();
+
+	// most arrays that can be bound without bindless handles;
+	// array i is bound to texture unit i, and the units from
+	// here on are kept for the samplers of other types
+	static const int MAX_BOUND_ARRAYS = ShaderUniforms::CLUSTER_LIGHT_COUNT_UNIT;
+
+	// array and layer that a texture was packed into
+	struct TEXTURE_LOCATION
+	{
+		int arrayIndex;
+		int layer;
+	};
+
+private:
+	// image waiting to be uploaded into its array
+	struct PENDING_LAYER
+	{
+		int textureSlot;
+		std::vector<unsigned char> pixels;
+	};
+
+	// one texture array and the images packed into it
+	struct TEXTURE_ARRAY
+	{
+		int width;
+		int height;
+		int colorChannels;
+		// block compressed format, or 0 for 8-bit pixels
+		GLenum compressedFormat;
+		// prebuilt mip levels of block compressed layers
+		std::vector<TextureCompression::MIP_LEVEL> levels;
+		GLuint textureID;
+		GLuint64 handle;
+		int layerCount;
+		// number of layers the array was created with
+		int capacity;
+		// true once the array was created in OpenGL; later
+		// images of the same size start a new array
+		bool bBuilt;
+		// true when layers are uploaded one at a time as
+		// streamed images arrive
+		bool bStreaming;
+		std::vector<PENDING_LAYER> pending;
+	};
+
+	// created texture arrays
+	std::vector<TEXTURE_ARRAY> m_arrays;
+	// location of every added texture, indexed by slot
+	std::vector<TEXTURE_LOCATION> m_locations;
+	// true when the arrays are used through bindless handles
+	bool m_bBindless;
+	// true once bindless support has been checked
+	bool m_bBindlessChecked;
+	// largest number of layers in one array
+	int m_maxLayers;
+	// array holding the placeholder of textures still loading
+	int m_placeholderArray;
+	// true once running out of arrays that can be bound has
+	// been reported
+	bool m_bReportedArrayLimit;
+
+	// check once whether bindless handles can be used
+	void CheckBindless();
+	// add an array description that is not created yet
+	int AddArray(int width, int height, int colorChannels);
+	// check whether another array can be added and bound
+	bool HasRoomForArray();
+	// create the placeholder array the first time it is needed
+	int GetPlaceholderArray();
+	// check whether a compressed image can share an array
+	static bool MatchesCompressed(
+		const TEXTURE_ARRAY& textureArray,
+		const TextureCompression::COMPRESSED_IMAGE& image);
+	// find or add an array that the next image can be packed
+	// into, or -1 when no array can be added
+	int FindOpenArray(int width, int height, int colorChannels);
+	int FindOpenArray(const TextureCompression::COMPRESSED_IMAGE& image);
+	// add a layer for a new image to an array that is not built
+	int AddPendingLayer(int arrayIndex, const unsigned char* pixels, size_t size);
+	// bind an array to the texture unit matching its index, to
+	// be sampled or to upload into
+	void BindArray(int arrayIndex);
+	void EditArray(int arrayIndex);
+	// create the OpenGL storage of an array with its capacity
+	void CreateArrayStorage(int arrayIndex);
+	// make a newly created array usable by the shader
+	void ActivateArray(int arrayIndex);
+	// create one array in OpenGL and upload its pending images
+	bool BuildArray(int arrayIndex);
+	// find or create a streaming array with a free layer, or -1
+	// when no array can be added
+	int FindStreamingArray(int width, int height, int colorChannels);
+	int FindStreamingArray(const TextureCompression::COMPRESSED_IMAGE& image);
+	// create a streaming array after the matching ones are full
+	int AddStreamingArray(int arrayIndex, int capacity);
+	// upload every mip level of a compressed image into a layer
+	void UploadCompressedLayer(
+		int arrayIndex,
+		int layer,
+		const unsigned char* data);
+
+public:
+	// add an image, copying its pixels until the next Build();
+	// the texture slot of the image is returned, or -1
+	int AddImage(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels);
+
+	// add a block compressed image with its prebuilt mip levels,
+	// copying the data until the next Build()
+	int AddCompressedImage(const TextureCompression::COMPRESSED_IMAGE& image);
+
+	// reserve a slot for a texture that is still loading; it
+	// shows the placeholder texture until StreamImage() fills it
+	int ReserveSlot();
+
+	// upload the image of a reserved slot into a free layer of
+	// a streaming array; the pixels can be an offset into the
+	// bound GL_PIXEL_UNPACK_BUFFER
+	bool StreamImage(
+		int textureSlot,
+		const void* pixels,
+		int width,
+		int height,
+		int colorChannels);
+	// upload a block compressed image of a reserved slot; the
+	// data can be the bound GL_PIXEL_UNPACK_BUFFER, passed as NULL
+	bool StreamCompressedImage(
+		int textureSlot,
+		const TextureCompression::COMPRESSED_IMAGE& image,
+		const unsigned char* data);
+
+	// true when block compressed textures can be created
+	bool SupportsCompression() const;
+
+	// create the arrays holding images added since the last build
+	bool Build();
+	// bind every array to the texture unit matching its index
+	void Bind();
+	// free all the texture arrays
+	void Destroy();
+
+	// location of the texture in the passed in slot
+	const TEXTURE_LOCATION& GetLocation(int textureSlot) const;
+	// bindless handle of an array, or 0 when not bindless
+	GLuint64 GetArrayHandle(int arrayIndex) const;
+	// true when the arrays are used through bindless handles
+	bool IsBindless() const;
+
+	int GetTextureCount() const;
+	int GetArrayCount() const;
+};
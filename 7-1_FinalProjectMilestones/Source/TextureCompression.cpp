@@ -0,0 +1,737 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompression.cpp
+// ============
+// load, encode and cache block compressed textures with prebuilt mipmaps
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureCompression.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// declaration of global variables
+namespace
+{
+	// directory the transcoded textures are cached in
+	const char* g_CacheDirectory = "texturecache";
+
+	// file identifier and pixel format codes of DDS files
+	const uint32_t g_DDSMagic = 0x20534444;       // "DDS "
+	const uint32_t g_FourCCDXT1 = 0x31545844;     // "DXT1"
+	const uint32_t g_FourCCDXT5 = 0x35545844;     // "DXT5"
+
+	// DDS header flags
+	const uint32_t g_DDSDCaps = 0x1;
+	const uint32_t g_DDSDHeight = 0x2;
+	const uint32_t g_DDSDWidth = 0x4;
+	const uint32_t g_DDSDPixelFormat = 0x1000;
+	const uint32_t g_DDSDMipMapCount = 0x20000;
+	const uint32_t g_DDSDLinearSize = 0x80000;
+	const uint32_t g_DDPFFourCC = 0x4;
+	const uint32_t g_DDSCapsComplex = 0x8;
+	const uint32_t g_DDSCapsTexture = 0x1000;
+	const uint32_t g_DDSCapsMipMap = 0x400000;
+
+	// layout of the DDS header following the file identifier
+	struct DDS_HEADER
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		uint32_t pixelFormatSize;
+		uint32_t pixelFormatFlags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t bitMasks[4];
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	/*******************************************************
+	 *  BlockBytes()
+	 *
+	 *  Bytes in one 4x4 block of a compressed format.
+	 *******************************************************/
+	size_t BlockBytes(GLenum format)
+	{
+		if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+		{
+			return(8);
+		}
+		return(16);
+	}
+
+	/*******************************************************
+	 *  LevelBytes()
+	 *
+	 *  Bytes of one compressed level of the passed in size.
+	 *******************************************************/
+	size_t LevelBytes(GLenum format, int width, int height)
+	{
+		size_t blocksX = (width + 3) / 4;
+		size_t blocksY = (height + 3) / 4;
+		return(blocksX * blocksY * BlockBytes(format));
+	}
+
+	/*******************************************************
+	 *  Pack565()
+	 *
+	 *  Pack an 8-bit color into the 5:6:5 format of BC1.
+	 *******************************************************/
+	uint16_t Pack565(const unsigned char* color)
+	{
+		return((uint16_t)(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3)));
+	}
+
+	/*******************************************************
+	 *  Unpack565()
+	 *
+	 *  Expand a 5:6:5 color back to 8-bit channels.
+	 *******************************************************/
+	void Unpack565(uint16_t packed, int* color)
+	{
+		int r = (packed >> 11) & 0x1F;
+		int g = (packed >> 5) & 0x3F;
+		int b = packed & 0x1F;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	/*******************************************************
+	 *  EncodeColorBlock()
+	 *
+	 *  Encode the colors of a 4x4 RGBA block into BC1 by
+	 *  fitting the endpoints to the bounding box of the
+	 *  block, slightly inset, and picking the nearest of the
+	 *  four palette colors for each pixel.
+	 *******************************************************/
+	void EncodeColorBlock(const unsigned char* block, unsigned char* output)
+	{
+		unsigned char minColor[3] = { 255, 255, 255 };
+		unsigned char maxColor[3] = { 0, 0, 0 };
+
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				unsigned char value = block[i * 4 + c];
+				if (value < minColor[c]) minColor[c] = value;
+				if (value > maxColor[c]) maxColor[c] = value;
+			}
+		}
+
+		// inset the box so the endpoints are not skewed by outliers
+		for (int c = 0; c < 3; c++)
+		{
+			int inset = (maxColor[c] - minColor[c]) >> 4;
+			minColor[c] = (unsigned char)(minColor[c] + inset);
+			maxColor[c] = (unsigned char)(maxColor[c] - inset);
+		}
+
+		uint16_t color0 = Pack565(maxColor);
+		uint16_t color1 = Pack565(minColor);
+
+		uint32_t indices = 0;
+		if (color0 < color1)
+		{
+			// the larger endpoint has to come first for four colors
+			uint16_t swap = color0;
+			color0 = color1;
+			color1 = swap;
+		}
+
+		if (color0 != color1)
+		{
+			int palette[4][3];
+			Unpack565(color0, palette[0]);
+			Unpack565(color1, palette[1]);
+			for (int c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int bestIndex = 0;
+				int bestDistance = -1;
+				for (int p = 0; p < 4; p++)
+				{
+					int distance = 0;
+					for (int c = 0; c < 3; c++)
+					{
+						int delta = block[i * 4 + c] - palette[p][c];
+						distance += delta * delta;
+					}
+					if ((bestDistance < 0) || (distance < bestDistance))
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint32_t)bestIndex << (i * 2);
+			}
+		}
+
+		output[0] = (unsigned char)(color0 & 0xFF);
+		output[1] = (unsigned char)(color0 >> 8);
+		output[2] = (unsigned char)(color1 & 0xFF);
+		output[3] = (unsigned char)(color1 >> 8);
+		for (int i = 0; i < 4; i++)
+		{
+			output[4 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/*******************************************************
+	 *  EncodeAlphaBlock()
+	 *
+	 *  Encode the alpha of a 4x4 RGBA block into the alpha
+	 *  half of a BC3 block, using the eight value mode
+	 *  between the smallest and largest alpha.
+	 *******************************************************/
+	void EncodeAlphaBlock(const unsigned char* block, unsigned char* output)
+	{
+		int minAlpha = 255;
+		int maxAlpha = 0;
+
+		for (int i = 0; i < 16; i++)
+		{
+			int alpha = block[i * 4 + 3];
+			if (alpha < minAlpha) minAlpha = alpha;
+			if (alpha > maxAlpha) maxAlpha = alpha;
+		}
+
+		uint64_t indices = 0;
+		if (maxAlpha > minAlpha)
+		{
+			int palette[8];
+			palette[0] = maxAlpha;
+			palette[1] = minAlpha;
+			for (int p = 1; p < 7; p++)
+			{
+				palette[p + 1] = ((7 - p) * maxAlpha + p * minAlpha) / 7;
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int alpha = block[i * 4 + 3];
+				int bestIndex = 0;
+				int bestDistance = 256;
+				for (int p = 0; p < 8; p++)
+				{
+					int distance = alpha - palette[p];
+					if (distance < 0) distance = -distance;
+					if (distance < bestDistance)
+					{
+						bestDistance = distance;
+						bestIndex = p;
+					}
+				}
+				indices |= (uint64_t)bestIndex << (i * 3);
+			}
+		}
+
+		output[0] = (unsigned char)maxAlpha;
+		output[1] = (unsigned char)minAlpha;
+		for (int i = 0; i < 6; i++)
+		{
+			output[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/*******************************************************
+	 *  FlipColorBlock()
+	 *
+	 *  Reverse the first rows of a BC1 color block, one
+	 *  index byte per row.
+	 *******************************************************/
+	void FlipColorBlock(unsigned char* block, int rows)
+	{
+		for (int r = 0; r < rows / 2; r++)
+		{
+			unsigned char swap = block[4 + r];
+			block[4 + r] = block[4 + rows - 1 - r];
+			block[4 + rows - 1 - r] = swap;
+		}
+	}
+
+	/*******************************************************
+	 *  FlipAlphaBlock()
+	 *
+	 *  Reverse the first rows of a BC3 alpha block, twelve
+	 *  index bits per row.
+	 *******************************************************/
+	void FlipAlphaBlock(unsigned char* block, int rows)
+	{
+		uint64_t indices = 0;
+		for (int i = 0; i < 6; i++)
+		{
+			indices |= (uint64_t)block[2 + i] << (i * 8);
+		}
+
+		uint64_t flipped = indices;
+		for (int r = 0; r < rows; r++)
+		{
+			uint64_t row = (indices >> (r * 12)) & 0xFFF;
+			int target = rows - 1 - r;
+			flipped &= ~((uint64_t)0xFFF << (target * 12));
+			flipped |= row << (target * 12);
+		}
+
+		for (int i = 0; i < 6; i++)
+		{
+			block[2 + i] = (unsigned char)((flipped >> (i * 8)) & 0xFF);
+		}
+	}
+
+	/*******************************************************
+	 *  FileTime()
+	 *
+	 *  Modification time of a file, or -1 when it is missing.
+	 *******************************************************/
+	long long FileTime(const std::string& filename)
+	{
+		struct stat fileInfo;
+		if (stat(filename.c_str(), &fileInfo) != 0)
+		{
+			return(-1);
+		}
+		return((long long)fileInfo.st_mtime);
+	}
+
+	/*******************************************************
+	 *  HasExtension()
+	 *
+	 *  Check the extension of a file name, ignoring case.
+	 *******************************************************/
+	bool HasExtension(const std::string& filename, const char* extension)
+	{
+		size_t length = strlen(extension);
+		if (filename.size() < length)
+		{
+			return(false);
+		}
+		for (size_t i = 0; i < length; i++)
+		{
+			char c = filename[filename.size() - length + i];
+			if ((c >= 'A') && (c <= 'Z'))
+			{
+				c = (char)(c - 'A' + 'a');
+			}
+			if (c != extension[i])
+			{
+				return(false);
+			}
+		}
+		return(true);
+	}
+}
+
+/***********************************************************
+ *  FlipRows()
+ *
+ *  This method is used for converting every level between
+ *  the top row first order of DDS files and the bottom row
+ *  first order of OpenGL.  This is exact for levels whose
+ *  height is a multiple of four or smaller than one block.
+ ***********************************************************/
+bool TextureCompression::FlipRows(COMPRESSED_IMAGE& image)
+{
+	size_t blockBytes = BlockBytes(image.format);
+
+	for (int l = 0; l < image.levels.size(); l++)
+	{
+		const MIP_LEVEL& level = image.levels[l];
+		if ((level.height % 4 != 0) && (level.height > 4))
+		{
+			return(false);
+		}
+
+		int rows = (level.height < 4) ? level.height : 4;
+		size_t blocksX = (level.width + 3) / 4;
+		size_t blocksY = (level.height + 3) / 4;
+		unsigned char* data = image.data.data() + level.offset;
+		size_t rowBytes = blocksX * blockBytes;
+
+		// reverse the order of the block rows
+		std::vector<unsigned char> swap(rowBytes);
+		for (size_t y = 0; y < blocksY / 2; y++)
+		{
+			unsigned char* top = data + y * rowBytes;
+			unsigned char* bottom = data + (blocksY - 1 - y) * rowBytes;
+			memcpy(swap.data(), top, rowBytes);
+			memcpy(top, bottom, rowBytes);
+			memcpy(bottom, swap.data(), rowBytes);
+		}
+
+		// reverse the rows inside every block
+		for (size_t b = 0; b < blocksX * blocksY; b++)
+		{
+			unsigned char* block = data + b * blockBytes;
+			if (blockBytes == 16)
+			{
+				FlipAlphaBlock(block, rows);
+				FlipColorBlock(block + 8, rows);
+			}
+			else
+			{
+				FlipColorBlock(block, rows);
+			}
+		}
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  LoadDDS()
+ *
+ *  This method is used for loading a DDS file holding BC1
+ *  or BC3 data and all of its mip levels.  The rows are
+ *  flipped into OpenGL order like the images loaded by the
+ *  other texture paths.
+ ***********************************************************/
+bool TextureCompression::LoadDDS(const std::string& filename, COMPRESSED_IMAGE& image)
+{
+	std::ifstream file(filename.c_str(), std::ios::binary);
+	if (!file)
+	{
+		return(false);
+	}
+
+	uint32_t magic = 0;
+	DDS_HEADER header;
+	file.read((char*)&magic, sizeof(magic));
+	file.read((char*)&header, sizeof(header));
+	if (!file || (magic != g_DDSMagic) || (header.size != sizeof(DDS_HEADER)))
+	{
+		std::cout << "Not a DDS file:" << filename << std::endl;
+		return(false);
+	}
+
+	if ((header.pixelFormatFlags & g_DDPFFourCC) == 0)
+	{
+		std::cout << "Not implemented to handle uncompressed DDS file:" << filename << std::endl;
+		return(false);
+	}
+
+	if (header.fourCC == g_FourCCDXT1)
+	{
+		image.format = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	}
+	else if (header.fourCC == g_FourCCDXT5)
+	{
+		image.format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	}
+	else
+	{
+		std::cout << "Not implemented to handle the pixel format of DDS file:" << filename << std::endl;
+		return(false);
+	}
+
+	image.width = (int)header.width;
+	image.height = (int)header.height;
+	image.levels.clear();
+	image.data.clear();
+
+	int levelCount = 1;
+	if ((header.flags & g_DDSDMipMapCount) && (header.mipMapCount > 0))
+	{
+		levelCount = (int)header.mipMapCount;
+	}
+
+	int width = image.width;
+	int height = image.height;
+	size_t offset = 0;
+	for (int l = 0; l < levelCount; l++)
+	{
+		MIP_LEVEL level;
+		level.width = width;
+		level.height = height;
+		level.offset = offset;
+		level.size = LevelBytes(image.format, width, height);
+		image.levels.push_back(level);
+
+		offset += level.size;
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+	}
+
+	image.data.resize(offset);
+	file.read((char*)image.data.data(), offset);
+	if (!file)
+	{
+		std::cout << "DDS file is truncated:" << filename << std::endl;
+		return(false);
+	}
+
+	if (FlipRows(image) == false)
+	{
+		std::cout << "Not implemented to flip the mip levels of DDS file:" << filename << std::endl;
+		return(false);
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  SaveDDS()
+ *
+ *  This method is used for saving a compressed texture as a
+ *  DDS file in the usual top row first order.
+ ***********************************************************/
+bool TextureCompression::SaveDDS(const std::string& filename, const COMPRESSED_IMAGE& image)
+{
+	COMPRESSED_IMAGE flipped = image;
+	if (FlipRows(flipped) == false)
+	{
+		return(false);
+	}
+
+	DDS_HEADER header;
+	memset(&header, 0, sizeof(header));
+	header.size = sizeof(DDS_HEADER);
+	header.flags = g_DDSDCaps | g_DDSDHeight | g_DDSDWidth |
+		g_DDSDPixelFormat | g_DDSDMipMapCount | g_DDSDLinearSize;
+	header.height = (uint32_t)image.height;
+	header.width = (uint32_t)image.width;
+	header.pitchOrLinearSize = (uint32_t)image.levels[0].size;
+	header.mipMapCount = (uint32_t)image.levels.size();
+	header.pixelFormatSize = 32;
+	header.pixelFormatFlags = g_DDPFFourCC;
+	header.fourCC = (image.format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) ? g_FourCCDXT1 : g_FourCCDXT5;
+	header.caps = g_DDSCapsTexture;
+	if (image.levels.size() > 1)
+	{
+		header.caps |= g_DDSCapsComplex | g_DDSCapsMipMap;
+	}
+
+	// write to a temporary file first, so that a run that is
+	// stopped halfway never leaves a truncated cache file
+	std::string tempName = filename + ".tmp";
+	{
+		std::ofstream file(tempName.c_str(), std::ios::binary | std::ios::trunc);
+		if (!file)
+		{
+			return(false);
+		}
+		file.write((const char*)&g_DDSMagic, sizeof(g_DDSMagic));
+		file.write((const char*)&header, sizeof(header));
+		file.write((const char*)flipped.data.data(), flipped.data.size());
+		if (!file)
+		{
+			return(false);
+		}
+	}
+
+	remove(filename.c_str());
+	return(rename(tempName.c_str(), filename.c_str()) == 0);
+}
+
+/***********************************************************
+ *  Compress()
+ *
+ *  This method is used for encoding 8-bit pixels into BC1,
+ *  or BC3 when there is an alpha channel.  The mip chain is
+ *  built with a box filter down to the last level whose
+ *  size is still a multiple of the block size, so that no
+ *  mipmaps have to be generated at runtime.
+ ***********************************************************/
+bool TextureCompression::Compress(
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int colorChannels,
+	COMPRESSED_IMAGE& image)
+{
+	if ((pixels == NULL) || (width <= 0) || (height <= 0) ||
+		(width % 4 != 0) || (height % 4 != 0) ||
+		((colorChannels != 3) && (colorChannels != 4)))
+	{
+		return(false);
+	}
+
+	image.format = (colorChannels == 4) ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	image.width = width;
+	image.height = height;
+	image.levels.clear();
+	image.data.clear();
+
+	// the encoder and the box filter work on RGBA pixels
+	std::vector<unsigned char> level((size_t)width * height * 4);
+	for (size_t i = 0; i < (size_t)width * height; i++)
+	{
+		level[i * 4 + 0] = pixels[i * colorChannels + 0];
+		level[i * 4 + 1] = pixels[i * colorChannels + 1];
+		level[i * 4 + 2] = pixels[i * colorChannels + 2];
+		level[i * 4 + 3] = (colorChannels == 4) ? pixels[i * colorChannels + 3] : 255;
+	}
+
+	size_t blockBytes = BlockBytes(image.format);
+	int levelWidth = width;
+	int levelHeight = height;
+
+	while (true)
+	{
+		MIP_LEVEL mip;
+		mip.width = levelWidth;
+		mip.height = levelHeight;
+		mip.offset = image.data.size();
+		mip.size = LevelBytes(image.format, levelWidth, levelHeight);
+		image.levels.push_back(mip);
+		image.data.resize(mip.offset + mip.size);
+
+		unsigned char* output = image.data.data() + mip.offset;
+		unsigned char block[16 * 4];
+		for (int by = 0; by < levelHeight; by += 4)
+		{
+			for (int bx = 0; bx < levelWidth; bx += 4)
+			{
+				for (int y = 0; y < 4; y++)
+				{
+					memcpy(
+						block + y * 16,
+						level.data() + ((size_t)(by + y) * levelWidth + bx) * 4,
+						16);
+				}
+				if (blockBytes == 16)
+				{
+					EncodeAlphaBlock(block, output);
+					EncodeColorBlock(block, output + 8);
+				}
+				else
+				{
+					EncodeColorBlock(block, output);
+				}
+				output += blockBytes;
+			}
+		}
+
+		// stop at the last level that still fills whole blocks
+		int nextWidth = levelWidth / 2;
+		int nextHeight = levelHeight / 2;
+		if ((nextWidth < 4) || (nextHeight < 4) ||
+			(nextWidth % 4 != 0) || (nextHeight % 4 != 0))
+		{
+			break;
+		}
+
+		// box filter the level down to the next one
+		std::vector<unsigned char> next((size_t)nextWidth * nextHeight * 4);
+		for (int y = 0; y < nextHeight; y++)
+		{
+			for (int x = 0; x < nextWidth; x++)
+			{
+				for (int c = 0; c < 4; c++)
+				{
+					const unsigned char* source = level.data() + ((size_t)(y * 2) * levelWidth + x * 2) * 4 + c;
+					int sum = source[0] + source[4] + source[levelWidth * 4] + source[levelWidth * 4 + 4];
+					next[((size_t)y * nextWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+				}
+			}
+		}
+		level.swap(next);
+		levelWidth = nextWidth;
+		levelHeight = nextHeight;
+	}
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetCachePath()
+ *
+ *  This method is used for getting the path of the cache
+ *  file for a source image, named after the source file.
+ ***********************************************************/
+std::string TextureCompression::GetCachePath(const std::string& filename)
+{
+	size_t separator = filename.find_last_of("/\\");
+	std::string baseName = filename;
+	if (separator != std::string::npos)
+	{
+		baseName = filename.substr(separator + 1);
+	}
+
+	return(std::string(g_CacheDirectory) + "/" + baseName + ".dds");
+}
+
+/***********************************************************
+ *  LoadCached()
+ *
+ *  This method is used for loading a compressed texture.
+ *  DDS files are loaded directly; for other images the
+ *  cached transcode is loaded when it is newer than the
+ *  source.  False is returned when the source has to be
+ *  decoded and transcoded.
+ ***********************************************************/
+bool TextureCompression::LoadCached(const std::string& filename, COMPRESSED_IMAGE& image)
+{
+	if (HasExtension(filename, ".dds") == true)
+	{
+		return(LoadDDS(filename, image));
+	}
+
+	std::string cachePath = GetCachePath(filename);
+	long long cacheTime = FileTime(cachePath);
+	if ((cacheTime < 0) || (cacheTime < FileTime(filename)))
+	{
+		return(false);
+	}
+
+	return(LoadDDS(cachePath, image));
+}
+
+/***********************************************************
+ *  CompressAndCache()
+ *
+ *  This method is used for transcoding decoded source
+ *  pixels into a compressed texture and writing it to the
+ *  texture cache for the following runs.
+ ***********************************************************/
+bool TextureCompression::CompressAndCache(
+	const std::string& filename,
+	const unsigned char* pixels,
+	int width,
+	int height,
+	int colorChannels,
+	COMPRESSED_IMAGE& image)
+{
+	if (Compress(pixels, width, height, colorChannels, image) == false)
+	{
+		return(false);
+	}
+
+#ifdef _WIN32
+	_mkdir(g_CacheDirectory);
+#else
+	mkdir(g_CacheDirectory, 0755);
+#endif
+
+	std::string cachePath = GetCachePath(filename);
+	if (SaveDDS(cachePath, image) == false)
+	{
+		// the texture can still be used, it is just not cached
+		std::cout << "Could not write texture cache file:" << cachePath << std::endl;
+	}
+
+	return(true);
+}
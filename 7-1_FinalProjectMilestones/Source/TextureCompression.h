@@ -0,0 +1,81 @@
+///////////////////////////////////////////////////////////////////////////////
+// texturecompression.h
+// ============
+// load, encode and cache block compressed textures with prebuilt mipmaps
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+
+/***********************************************************
+ *  TextureCompression
+ *
+ *  This class contains the code for block compressed (BCn)
+ *  textures.  DDS files holding BC1 (DXT1) or BC3 (DXT5)
+ *  data with their mip chains can be loaded directly, and
+ *  JPEG or PNG sources are transcoded once into a DDS file
+ *  in the texture cache directory, which is loaded instead
+ *  of the source on the following runs.
+ ***********************************************************/
+class TextureCompression
+{
+public:
+	// one mip level inside the compressed data
+	struct MIP_LEVEL
+	{
+		int width;
+		int height;
+		size_t offset;
+		size_t size;
+	};
+
+	// compressed texture in OpenGL row order, bottom row first
+	struct COMPRESSED_IMAGE
+	{
+		GLenum format;
+		int width;
+		int height;
+		std::vector<MIP_LEVEL> levels;
+		std::vector<unsigned char> data;
+	};
+
+	// load a DDS file holding BC1 or BC3 data
+	static bool LoadDDS(const std::string& filename, COMPRESSED_IMAGE& image);
+	// save a compressed texture as a DDS file
+	static bool SaveDDS(const std::string& filename, const COMPRESSED_IMAGE& image);
+
+	// encode 8-bit RGB or RGBA pixels with a mip chain; BC1 is
+	// used for RGB and BC3 for RGBA.  The size has to be a
+	// multiple of the 4x4 block size.
+	static bool Compress(
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels,
+		COMPRESSED_IMAGE& image);
+
+	// load a DDS file, or the cached transcode of a source
+	// image when it is newer than the source
+	static bool LoadCached(const std::string& filename, COMPRESSED_IMAGE& image);
+	// transcode decoded source pixels and write them to the cache
+	static bool CompressAndCache(
+		const std::string& filename,
+		const unsigned char* pixels,
+		int width,
+		int height,
+		int colorChannels,
+		COMPRESSED_IMAGE& image);
+
+	// path of the cache file for a source image
+	static std::string GetCachePath(const std::string& filename);
+
+private:
+	// flip the block rows and the rows inside the blocks of
+	// every level between DDS and OpenGL row order
+	static bool FlipRows(COMPRESSED_IMAGE& image);
+};
@@ -0,0 +1,336 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.cpp
+// ============
+// decode texture images on worker threads and upload them on the GL thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TextureLoader.h"
+
+#include "stb_image.h"
+
+#include <cstring>
+#include <iostream>
+
+/***********************************************************
+ *  TextureLoader()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+TextureLoader::TextureLoader(int workerCount)
+{
+	m_bStopping = false;
+	m_bCompress = false;
+	m_pendingCount = 0;
+	m_pixelBuffer = 0;
+
+	if (workerCount <= 0)
+	{
+		workerCount = (int)std::thread::hardware_concurrency() - 1;
+		if (workerCount < 1)
+		{
+			workerCount = 1;
+		}
+	}
+
+	for (int i = 0; i < workerCount; i++)
+	{
+		m_workers.push_back(std::thread(&TextureLoader::WorkerLoop, this));
+	}
+}
+
+/***********************************************************
+ *  ~TextureLoader()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+TextureLoader::~TextureLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_bStopping = true;
+		m_requests.clear();
+	}
+	m_requestReady.notify_all();
+
+	for (int i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+	m_workers.clear();
+
+	// free the images that were never uploaded
+	for (int i = 0; i < m_decoded.size(); i++)
+	{
+		if (m_decoded[i].pixels != NULL)
+		{
+			stbi_image_free(m_decoded[i].pixels);
+		}
+	}
+	m_decoded.clear();
+
+	if (m_pixelBuffer != 0)
+	{
+		glDeleteBuffers(1, &m_pixelBuffer);
+		m_pixelBuffer = 0;
+	}
+}
+
+/***********************************************************
+ *  WorkerLoop()
+ *
+ *  This method is used by the worker threads for decoding
+ *  the requested image files until the loader is stopped.
+ ***********************************************************/
+void TextureLoader::WorkerLoop()
+{
+	while (true)
+	{
+		LOAD_REQUEST request;
+		{
+			std::unique_lock<std::mutex> lock(m_requestMutex);
+			while ((m_bStopping == false) && (m_requests.empty() == true))
+			{
+				m_requestReady.wait(lock);
+			}
+			if (m_bStopping == true)
+			{
+				return;
+			}
+			request = m_requests.front();
+			m_requests.pop_front();
+		}
+
+		DECODED_IMAGE image;
+		image.filename = request.filename;
+		image.textureSlot = request.textureSlot;
+		DecodeImage(image);
+
+		std::lock_guard<std::mutex> lock(m_decodedMutex);
+		m_decoded.push_back(image);
+	}
+}
+
+/***********************************************************
+ *  DecodeImage()
+ *
+ *  This method is used by the worker threads for loading
+ *  one image.  With compression on, a DDS file or a cached
+ *  transcode is used when there is one; otherwise the
+ *  source is decoded and, if possible, transcoded into the
+ *  cache so that the next run skips the decode.
+ ***********************************************************/
+void TextureLoader::DecodeImage(DECODED_IMAGE& image)
+{
+	image.pixels = NULL;
+	image.width = 0;
+	image.height = 0;
+	image.colorChannels = 0;
+	image.bCompressed = false;
+
+	if ((m_bCompress == true) &&
+		(TextureCompression::LoadCached(image.filename, image.compressed) == true))
+	{
+		image.bCompressed = true;
+		image.width = image.compressed.width;
+		image.height = image.compressed.height;
+		return;
+	}
+
+	image.pixels = stbi_load(
+		image.filename.c_str(),
+		&image.width,
+		&image.height,
+		&image.colorChannels,
+		0);
+
+	if ((image.pixels != NULL) && (m_bCompress == true) &&
+		(TextureCompression::CompressAndCache(
+			image.filename,
+			image.pixels,
+			image.width,
+			image.height,
+			image.colorChannels,
+			image.compressed) == true))
+	{
+		stbi_image_free(image.pixels);
+		image.pixels = NULL;
+		image.bCompressed = true;
+	}
+}
+
+/***********************************************************
+ *  SetCompression()
+ *
+ *  This method is used for turning block compressed
+ *  textures on or off.  It has to be set before the first
+ *  request, since the workers read it without locking.
+ ***********************************************************/
+void TextureLoader::SetCompression(bool bCompress)
+{
+	m_bCompress = bCompress;
+}
+
+/***********************************************************
+ *  RequestTexture()
+ *
+ *  This method is used for queueing an image file to be
+ *  decoded by a worker thread.  The texture slot should be
+ *  reserved in the texture arrays, so that it shows the
+ *  placeholder until the image is uploaded.
+ ***********************************************************/
+void TextureLoader::RequestTexture(const char* filename, int textureSlot)
+{
+	if ((filename == NULL) || (textureSlot < 0))
+	{
+		return;
+	}
+
+	// the flip setting is global in stb_image, so it is set
+	// here on the GL thread before any worker reads it
+	stbi_set_flip_vertically_on_load(true);
+
+	LOAD_REQUEST request;
+	request.filename = filename;
+	request.textureSlot = textureSlot;
+
+	{
+		std::lock_guard<std::mutex> lock(m_requestMutex);
+		m_requests.push_back(request);
+	}
+	m_pendingCount++;
+	m_requestReady.notify_one();
+}
+
+/***********************************************************
+ *  UploadImage()
+ *
+ *  This method is used for copying a decoded image into the
+ *  pixel buffer object and uploading it from there into its
+ *  reserved slot.  The buffer is orphaned before each copy,
+ *  so the driver never waits for the previous upload.
+ ***********************************************************/
+bool TextureLoader::UploadImage(TextureArrays* pTextureArrays, const DECODED_IMAGE& image)
+{
+	GLsizeiptr size = (GLsizeiptr)image.width * image.height * image.colorChannels;
+	const unsigned char* source = image.pixels;
+	if (image.bCompressed == true)
+	{
+		size = (GLsizeiptr)image.compressed.data.size();
+		source = image.compressed.data.data();
+	}
+
+	if (m_pixelBuffer == 0)
+	{
+		glGenBuffers(1, &m_pixelBuffer);
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pixelBuffer);
+	glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+
+	void* mapped = glMapBufferRange(
+		GL_PIXEL_UNPACK_BUFFER,
+		0,
+		size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+
+	bool bReturn = false;
+	if (mapped != NULL)
+	{
+		memcpy(mapped, source, size);
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		// with a pixel buffer bound, the pixels are an offset
+		if (image.bCompressed == true)
+		{
+			bReturn = pTextureArrays->StreamCompressedImage(
+				image.textureSlot,
+				image.compressed,
+				NULL);
+		}
+		else
+		{
+			bReturn = pTextureArrays->StreamImage(
+				image.textureSlot,
+				NULL,
+				image.width,
+				image.height,
+				image.colorChannels);
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return(bReturn);
+}
+
+/***********************************************************
+ *  UploadDecoded()
+ *
+ *  This method is used for uploading the images decoded
+ *  since the last call.  At most the passed in number of
+ *  images is uploaded, so that a frame is not held up by a
+ *  burst of finished images.  The number uploaded is
+ *  returned.
+ ***********************************************************/
+int TextureLoader::UploadDecoded(TextureArrays* pTextureArrays, int maxUploads)
+{
+	if (pTextureArrays == NULL)
+	{
+		return(0);
+	}
+
+	int uploads = 0;
+	while (uploads < maxUploads)
+	{
+		DECODED_IMAGE image;
+		{
+			std::lock_guard<std::mutex> lock(m_decodedMutex);
+			if (m_decoded.empty() == true)
+			{
+				break;
+			}
+			image = m_decoded.front();
+			m_decoded.pop_front();
+		}
+
+		if (image.bCompressed == true)
+		{
+			std::cout << "Successfully loaded compressed image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", levels:" << image.compressed.levels.size() << std::endl;
+
+			if (UploadImage(pTextureArrays, image) == true)
+			{
+				uploads++;
+			}
+		}
+		else if (image.pixels != NULL)
+		{
+			std::cout << "Successfully loaded image:" << image.filename << ", width:" << image.width << ", height:" << image.height << ", channels:" << image.colorChannels << std::endl;
+
+			if (UploadImage(pTextureArrays, image) == true)
+			{
+				uploads++;
+			}
+			stbi_image_free(image.pixels);
+		}
+		else
+		{
+			// the slot keeps showing the placeholder
+			std::cout << "Could not load image:" << image.filename << std::endl;
+		}
+		m_pendingCount--;
+	}
+
+	return(uploads);
+}
+
+/***********************************************************
+ *  GetPendingCount()
+ *
+ *  This method is used for getting the number of requested
+ *  images that have not been uploaded yet.
+ ***********************************************************/
+int TextureLoader::GetPendingCount() const
+{
+	return(m_pendingCount);
+}
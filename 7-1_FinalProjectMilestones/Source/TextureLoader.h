@@ -0,0 +1,103 @@
+///////////////////////////////////////////////////////////////////////////////
+// textureloader.h
+// ============
+// decode texture images on worker threads and upload them on the GL thread
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "TextureArrays.h"
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***********************************************************
+ *  TextureLoader
+ *
+ *  This class contains the code for loading texture images
+ *  in the background.  Image files are decoded in parallel
+ *  by a pool of worker threads, and the decoded images are
+ *  handed back through a queue to the thread owning the
+ *  OpenGL context, which uploads them through a pixel
+ *  buffer object into slots reserved in the texture arrays.
+ ***********************************************************/
+class TextureLoader
+{
+public:
+	// constructor; a worker count of 0 uses one worker for
+	// each hardware thread besides the GL thread
+	TextureLoader(int workerCount = 0);
+	// destructor
+	~TextureLoader();
+
+private:
+	// image file waiting to be decoded
+	struct LOAD_REQUEST
+	{
+		std::string filename;
+		int textureSlot;
+	};
+
+	// image decoded by a worker, waiting to be uploaded
+	struct DECODED_IMAGE
+	{
+		std::string filename;
+		int textureSlot;
+		unsigned char* pixels;
+		int width;
+		int height;
+		int colorChannels;
+		// block compressed levels, used instead of the pixels
+		// when bCompressed is true
+		bool bCompressed;
+		TextureCompression::COMPRESSED_IMAGE compressed;
+	};
+
+	// worker threads decoding the requested images
+	std::vector<std::thread> m_workers;
+	// requests waiting for a worker
+	std::deque<LOAD_REQUEST> m_requests;
+	std::mutex m_requestMutex;
+	std::condition_variable m_requestReady;
+	// decoded images waiting for the GL thread
+	std::deque<DECODED_IMAGE> m_decoded;
+	std::mutex m_decodedMutex;
+	// true when the workers have to exit
+	bool m_bStopping;
+	// true when the workers load and produce compressed textures
+	bool m_bCompress;
+	// number of requests not uploaded yet
+	std::atomic<int> m_pendingCount;
+	// pixel buffer object the images are uploaded through
+	GLuint m_pixelBuffer;
+
+	// decode requests until the loader is stopped
+	void WorkerLoop();
+	// decode one requested image file
+	void DecodeImage(DECODED_IMAGE& image);
+	// upload one decoded image through the pixel buffer
+	bool UploadImage(TextureArrays* pTextureArrays, const DECODED_IMAGE& image);
+
+public:
+	// load DDS files and the texture cache, and transcode new
+	// source images into the cache; set before any request
+	void SetCompression(bool bCompress);
+
+	// queue an image file to be decoded into a reserved slot
+	void RequestTexture(const char* filename, int textureSlot);
+
+	// upload up to the passed in number of decoded images; this
+	// has to be called on the thread owning the GL context
+	int UploadDecoded(TextureArrays* pTextureArrays, int maxUploads);
+
+	// number of requested images that are not uploaded yet
+	int GetPendingCount() const;
+};
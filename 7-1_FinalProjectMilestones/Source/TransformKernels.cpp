@@ -0,0 +1,957 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernels.cpp
+// ============
+// compose model matrices and cull bounds of many objects at a time
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "TransformKernels.h"
+
+#include <cmath>
+#include <cstring>
+
+// the vector kernels are only built for x86 processors, the
+// others always use the scalar kernels
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_KERNELS_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// the compiler takes AVX2 intrinsics in any function
+#define AVX2_FUNCTION
+#else
+#include <cpuid.h>
+// the AVX2 kernels are built for AVX2 alone, while the rest
+// of the program keeps running on any x86 processor
+#define AVX2_FUNCTION __attribute__((target("avx2")))
+#endif
+#endif
+
+// declaration of the global variables and defines
+namespace
+{
+	/***********************************************************
+	 *  ComposeScalar()
+	 *
+	 *  Compose the model matrices and world bounds of a range
+	 *  of transforms one at a time.  The matrix equals
+	 *  translation * rotationX * rotationY * rotationZ * scale,
+	 *  and the world bounds are the local center moved as a
+	 *  point and the half extents by the absolute values of
+	 *  the rotation and scale.
+	 ***********************************************************/
+	void ComposeScalar(
+		const TransformKernels::TRANSFORM_STREAMS& streams,
+		int first,
+		int last,
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds)
+	{
+		for (int i = first; i < last; i++)
+		{
+			float sinX = streams.sine[0][i];
+			float sinY = streams.sine[1][i];
+			float sinZ = streams.sine[2][i];
+			float cosX = streams.cosine[0][i];
+			float cosY = streams.cosine[1][i];
+			float cosZ = streams.cosine[2][i];
+			float scaleX = streams.scale[0][i];
+			float scaleY = streams.scale[1][i];
+			float scaleZ = streams.scale[2][i];
+
+			// each column is a column of rotationX * rotationY *
+			// rotationZ multiplied by the matching scale value
+			glm::mat4& model = modelMatrices[i];
+			model[0][0] = (cosY * cosZ) * scaleX;
+			model[0][1] = (sinX * sinY * cosZ + cosX * sinZ) * scaleX;
+			model[0][2] = (sinX * sinZ - cosX * sinY * cosZ) * scaleX;
+			model[0][3] = 0.0f;
+
+			model[1][0] = (-cosY * sinZ) * scaleY;
+			model[1][1] = (cosX * cosZ - sinX * sinY * sinZ) * scaleY;
+			model[1][2] = (cosX * sinY * sinZ + sinX * cosZ) * scaleY;
+			model[1][3] = 0.0f;
+
+			model[2][0] = sinY * scaleZ;
+			model[2][1] = (-sinX * cosY) * scaleZ;
+			model[2][2] = (cosX * cosY) * scaleZ;
+			model[2][3] = 0.0f;
+
+			model[3][0] = streams.position[0][i];
+			model[3][1] = streams.position[1][i];
+			model[3][2] = streams.position[2][i];
+			model[3][3] = 1.0f;
+
+			float centerX = streams.localCenter[0][i];
+			float centerY = streams.localCenter[1][i];
+			float centerZ = streams.localCenter[2][i];
+			float extentX = streams.localExtent[0][i];
+			float extentY = streams.localExtent[1][i];
+			float extentZ = streams.localExtent[2][i];
+
+			BoundingVolumes::BOUNDING_BOX& box = worldBounds[i];
+			for (int row = 0; row < 3; row++)
+			{
+				float worldCenter =
+					model[0][row] * centerX +
+					model[1][row] * centerY +
+					model[2][row] * centerZ +
+					model[3][row];
+				float worldExtent =
+					fabsf(model[0][row]) * extentX +
+					fabsf(model[1][row]) * extentY +
+					fabsf(model[2][row]) * extentZ;
+
+				box.minPoint[row] = worldCenter - worldExtent;
+				box.maxPoint[row] = worldCenter + worldExtent;
+			}
+		}
+	}
+
+	/***********************************************************
+	 *  CullScalar()
+	 *
+	 *  Test a range of boxes against the frustum one at a time.
+	 *  For each plane only the corner furthest along the plane
+	 *  normal is tested, as in BoundingVolumes::IsBoxVisible().
+	 ***********************************************************/
+	void CullScalar(
+		const BoundingVolumes::FRUSTUM& frustum,
+		const TransformKernels::BOX_STREAMS& boxes,
+		int first,
+		int last,
+		const int* objectIndices,
+		std::vector<int>& visible)
+	{
+		for (int i = first; i < last; i++)
+		{
+			bool bInside = true;
+			for (int p = 0; (p < 6) && (bInside == true); p++)
+			{
+				const glm::vec4& plane = frustum.planes[p];
+				float cornerX = (plane.x >= 0.0f) ? boxes.maxPoint[0][i] : boxes.minPoint[0][i];
+				float cornerY = (plane.y >= 0.0f) ? boxes.maxPoint[1][i] : boxes.minPoint[1][i];
+				float cornerZ = (plane.z >= 0.0f) ? boxes.maxPoint[2][i] : boxes.minPoint[2][i];
+
+				float distance = plane.x * cornerX + plane.y * cornerY + plane.z * cornerZ + plane.w;
+				bInside = !(distance < 0.0f);
+			}
+
+			if (bInside == true)
+			{
+				visible.push_back(objectIndices[i]);
+			}
+		}
+	}
+
+#ifdef TRANSFORM_KERNELS_X86
+	/***********************************************************
+	 *  StoreResults4()
+	 *
+	 *  Write the model matrices and world bounds of 4 objects
+	 *  held one component per register; the columns are
+	 *  transposed into place, and every column is stored whole.
+	 ***********************************************************/
+	void StoreResults4(
+		const __m128 columns[4][3],
+		const __m128 bounds[6],
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds)
+	{
+		const __m128 fourth[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_set1_ps(1.0f) };
+
+		for (int c = 0; c < 4; c++)
+		{
+			__m128 row0 = columns[c][0];
+			__m128 row1 = columns[c][1];
+			__m128 row2 = columns[c][2];
+			__m128 row3 = fourth[c];
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+			_mm_storeu_ps(&modelMatrices[0][c][0], row0);
+			_mm_storeu_ps(&modelMatrices[1][c][0], row1);
+			_mm_storeu_ps(&modelMatrices[2][c][0], row2);
+			_mm_storeu_ps(&modelMatrices[3][c][0], row3);
+		}
+
+		// the boxes are only 6 floats, so they are written
+		// from a copy on the stack
+		float values[6][4];
+		for (int j = 0; j < 6; j++)
+		{
+			_mm_storeu_ps(values[j], bounds[j]);
+		}
+		for (int k = 0; k < 4; k++)
+		{
+			worldBounds[k].minPoint = glm::vec3(values[0][k], values[1][k], values[2][k]);
+			worldBounds[k].maxPoint = glm::vec3(values[3][k], values[4][k], values[5][k]);
+		}
+	}
+
+	/***********************************************************
+	 *  ComposeSSE()
+	 *
+	 *  Compose the model matrices and world bounds of a range
+	 *  of transforms 4 at a time, with the same operations as
+	 *  ComposeScalar(), which takes the objects left over.
+	 ***********************************************************/
+	void ComposeSSE(
+		const TransformKernels::TRANSFORM_STREAMS& streams,
+		int first,
+		int last,
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds)
+	{
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+
+		int i = first;
+		for (; i + 4 <= last; i += 4)
+		{
+			__m128 sinX = _mm_loadu_ps(&streams.sine[0][i]);
+			__m128 sinY = _mm_loadu_ps(&streams.sine[1][i]);
+			__m128 sinZ = _mm_loadu_ps(&streams.sine[2][i]);
+			__m128 cosX = _mm_loadu_ps(&streams.cosine[0][i]);
+			__m128 cosY = _mm_loadu_ps(&streams.cosine[1][i]);
+			__m128 cosZ = _mm_loadu_ps(&streams.cosine[2][i]);
+			__m128 scaleX = _mm_loadu_ps(&streams.scale[0][i]);
+			__m128 scaleY = _mm_loadu_ps(&streams.scale[1][i]);
+			__m128 scaleZ = _mm_loadu_ps(&streams.scale[2][i]);
+
+			__m128 columns[4][3];
+			columns[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), scaleX);
+			columns[0][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinX, sinY), cosZ), _mm_mul_ps(cosX, sinZ)), scaleX);
+			columns[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sinX, sinZ), _mm_mul_ps(_mm_mul_ps(cosX, sinY), cosZ)), scaleX);
+
+			columns[1][0] = _mm_mul_ps(_mm_mul_ps(_mm_xor_ps(cosY, signMask), sinZ), scaleY);
+			columns[1][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cosX, cosZ), _mm_mul_ps(_mm_mul_ps(sinX, sinY), sinZ)), scaleY);
+			columns[1][2] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_mul_ps(cosX, sinY), sinZ), _mm_mul_ps(sinX, cosZ)), scaleY);
+
+			columns[2][0] = _mm_mul_ps(sinY, scaleZ);
+			columns[2][1] = _mm_mul_ps(_mm_mul_ps(_mm_xor_ps(sinX, signMask), cosY), scaleZ);
+			columns[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), scaleZ);
+
+			columns[3][0] = _mm_loadu_ps(&streams.position[0][i]);
+			columns[3][1] = _mm_loadu_ps(&streams.position[1][i]);
+			columns[3][2] = _mm_loadu_ps(&streams.position[2][i]);
+
+			__m128 centerX = _mm_loadu_ps(&streams.localCenter[0][i]);
+			__m128 centerY = _mm_loadu_ps(&streams.localCenter[1][i]);
+			__m128 centerZ = _mm_loadu_ps(&streams.localCenter[2][i]);
+			__m128 extentX = _mm_loadu_ps(&streams.localExtent[0][i]);
+			__m128 extentY = _mm_loadu_ps(&streams.localExtent[1][i]);
+			__m128 extentZ = _mm_loadu_ps(&streams.localExtent[2][i]);
+
+			__m128 bounds[6];
+			for (int row = 0; row < 3; row++)
+			{
+				__m128 worldCenter = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(columns[0][row], centerX),
+					_mm_mul_ps(columns[1][row], centerY)),
+					_mm_mul_ps(columns[2][row], centerZ)),
+					columns[3][row]);
+				__m128 worldExtent = _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_andnot_ps(signMask, columns[0][row]), extentX),
+					_mm_mul_ps(_mm_andnot_ps(signMask, columns[1][row]), extentY)),
+					_mm_mul_ps(_mm_andnot_ps(signMask, columns[2][row]), extentZ));
+
+				bounds[row] = _mm_sub_ps(worldCenter, worldExtent);
+				bounds[row + 3] = _mm_add_ps(worldCenter, worldExtent);
+			}
+
+			StoreResults4(columns, bounds, modelMatrices + i, worldBounds + i);
+		}
+
+		ComposeScalar(streams, i, last, modelMatrices, worldBounds);
+	}
+
+	/***********************************************************
+	 *  CullSSE()
+	 *
+	 *  Test a range of boxes against the frustum 4 at a time,
+	 *  with the same operations as CullScalar(), which takes
+	 *  the boxes left over.  The corner tested for a plane is
+	 *  the same for all boxes, so it is chosen once per plane.
+	 ***********************************************************/
+	void CullSSE(
+		const BoundingVolumes::FRUSTUM& frustum,
+		const TransformKernels::BOX_STREAMS& boxes,
+		int first,
+		int last,
+		const int* objectIndices,
+		std::vector<int>& visible)
+	{
+		const float* corners[6][3];
+		__m128 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				corners[p][axis] = (frustum.planes[p][axis] >= 0.0f) ? boxes.maxPoint[axis].data() : boxes.minPoint[axis].data();
+			}
+			for (int j = 0; j < 4; j++)
+			{
+				planes[p][j] = _mm_set1_ps(frustum.planes[p][j]);
+			}
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		int i = first;
+		for (; i + 4 <= last; i += 4)
+		{
+			int insideMask = 0xF;
+			for (int p = 0; (p < 6) && (insideMask != 0); p++)
+			{
+				__m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(planes[p][0], _mm_loadu_ps(corners[p][0] + i)),
+					_mm_mul_ps(planes[p][1], _mm_loadu_ps(corners[p][1] + i))),
+					_mm_mul_ps(planes[p][2], _mm_loadu_ps(corners[p][2] + i))),
+					planes[p][3]);
+				insideMask &= _mm_movemask_ps(_mm_cmpnlt_ps(distance, zero));
+			}
+
+			for (int k = 0; k < 4; k++)
+			{
+				if ((insideMask & (1 << k)) != 0)
+				{
+					visible.push_back(objectIndices[i + k]);
+				}
+			}
+		}
+
+		CullScalar(frustum, boxes, i, last, objectIndices, visible);
+	}
+
+	/***********************************************************
+	 *  ComposeAVX2()
+	 *
+	 *  Compose the model matrices and world bounds of a range
+	 *  of transforms 8 at a time, with the same operations as
+	 *  ComposeScalar(), and let ComposeSSE() take the objects
+	 *  left over.  The halves of every register are written
+	 *  out the same way as by the SSE kernel.
+	 ***********************************************************/
+	AVX2_FUNCTION void ComposeAVX2(
+		const TransformKernels::TRANSFORM_STREAMS& streams,
+		int first,
+		int last,
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds)
+	{
+		const __m256 signMask = _mm256_set1_ps(-0.0f);
+
+		int i = first;
+		for (; i + 8 <= last; i += 8)
+		{
+			__m256 sinX = _mm256_loadu_ps(&streams.sine[0][i]);
+			__m256 sinY = _mm256_loadu_ps(&streams.sine[1][i]);
+			__m256 sinZ = _mm256_loadu_ps(&streams.sine[2][i]);
+			__m256 cosX = _mm256_loadu_ps(&streams.cosine[0][i]);
+			__m256 cosY = _mm256_loadu_ps(&streams.cosine[1][i]);
+			__m256 cosZ = _mm256_loadu_ps(&streams.cosine[2][i]);
+			__m256 scaleX = _mm256_loadu_ps(&streams.scale[0][i]);
+			__m256 scaleY = _mm256_loadu_ps(&streams.scale[1][i]);
+			__m256 scaleZ = _mm256_loadu_ps(&streams.scale[2][i]);
+
+			__m256 columns[4][3];
+			columns[0][0] = _mm256_mul_ps(_mm256_mul_ps(cosY, cosZ), scaleX);
+			columns[0][1] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(sinX, sinY), cosZ), _mm256_mul_ps(cosX, sinZ)), scaleX);
+			columns[0][2] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(sinX, sinZ), _mm256_mul_ps(_mm256_mul_ps(cosX, sinY), cosZ)), scaleX);
+
+			columns[1][0] = _mm256_mul_ps(_mm256_mul_ps(_mm256_xor_ps(cosY, signMask), sinZ), scaleY);
+			columns[1][1] = _mm256_mul_ps(_mm256_sub_ps(_mm256_mul_ps(cosX, cosZ), _mm256_mul_ps(_mm256_mul_ps(sinX, sinY), sinZ)), scaleY);
+			columns[1][2] = _mm256_mul_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(cosX, sinY), sinZ), _mm256_mul_ps(sinX, cosZ)), scaleY);
+
+			columns[2][0] = _mm256_mul_ps(sinY, scaleZ);
+			columns[2][1] = _mm256_mul_ps(_mm256_mul_ps(_mm256_xor_ps(sinX, signMask), cosY), scaleZ);
+			columns[2][2] = _mm256_mul_ps(_mm256_mul_ps(cosX, cosY), scaleZ);
+
+			columns[3][0] = _mm256_loadu_ps(&streams.position[0][i]);
+			columns[3][1] = _mm256_loadu_ps(&streams.position[1][i]);
+			columns[3][2] = _mm256_loadu_ps(&streams.position[2][i]);
+
+			__m256 centerX = _mm256_loadu_ps(&streams.localCenter[0][i]);
+			__m256 centerY = _mm256_loadu_ps(&streams.localCenter[1][i]);
+			__m256 centerZ = _mm256_loadu_ps(&streams.localCenter[2][i]);
+			__m256 extentX = _mm256_loadu_ps(&streams.localExtent[0][i]);
+			__m256 extentY = _mm256_loadu_ps(&streams.localExtent[1][i]);
+			__m256 extentZ = _mm256_loadu_ps(&streams.localExtent[2][i]);
+
+			__m256 bounds[6];
+			for (int row = 0; row < 3; row++)
+			{
+				__m256 worldCenter = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(columns[0][row], centerX),
+					_mm256_mul_ps(columns[1][row], centerY)),
+					_mm256_mul_ps(columns[2][row], centerZ)),
+					columns[3][row]);
+				__m256 worldExtent = _mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, columns[0][row]), extentX),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, columns[1][row]), extentY)),
+					_mm256_mul_ps(_mm256_andnot_ps(signMask, columns[2][row]), extentZ));
+
+				bounds[row] = _mm256_sub_ps(worldCenter, worldExtent);
+				bounds[row + 3] = _mm256_add_ps(worldCenter, worldExtent);
+			}
+
+			__m128 lowColumns[4][3];
+			__m128 highColumns[4][3];
+			for (int c = 0; c < 4; c++)
+			{
+				for (int row = 0; row < 3; row++)
+				{
+					lowColumns[c][row] = _mm256_castps256_ps128(columns[c][row]);
+					highColumns[c][row] = _mm256_extractf128_ps(columns[c][row], 1);
+				}
+			}
+			__m128 lowBounds[6];
+			__m128 highBounds[6];
+			for (int j = 0; j < 6; j++)
+			{
+				lowBounds[j] = _mm256_castps256_ps128(bounds[j]);
+				highBounds[j] = _mm256_extractf128_ps(bounds[j], 1);
+			}
+
+			StoreResults4(lowColumns, lowBounds, modelMatrices + i, worldBounds + i);
+			StoreResults4(highColumns, highBounds, modelMatrices + i + 4, worldBounds + i + 4);
+		}
+
+		ComposeSSE(streams, i, last, modelMatrices, worldBounds);
+	}
+
+	/***********************************************************
+	 *  CullAVX2()
+	 *
+	 *  Test a range of boxes against the frustum 8 at a time,
+	 *  with the same operations as CullScalar(), and let
+	 *  CullSSE() take the boxes left over.
+	 ***********************************************************/
+	AVX2_FUNCTION void CullAVX2(
+		const BoundingVolumes::FRUSTUM& frustum,
+		const TransformKernels::BOX_STREAMS& boxes,
+		int first,
+		int last,
+		const int* objectIndices,
+		std::vector<int>& visible)
+	{
+		const float* corners[6][3];
+		__m256 planes[6][4];
+		for (int p = 0; p < 6; p++)
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				corners[p][axis] = (frustum.planes[p][axis] >= 0.0f) ? boxes.maxPoint[axis].data() : boxes.minPoint[axis].data();
+			}
+			for (int j = 0; j < 4; j++)
+			{
+				planes[p][j] = _mm256_set1_ps(frustum.planes[p][j]);
+			}
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		int i = first;
+		for (; i + 8 <= last; i += 8)
+		{
+			int insideMask = 0xFF;
+			for (int p = 0; (p < 6) && (insideMask != 0); p++)
+			{
+				__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(
+					_mm256_mul_ps(planes[p][0], _mm256_loadu_ps(corners[p][0] + i)),
+					_mm256_mul_ps(planes[p][1], _mm256_loadu_ps(corners[p][1] + i))),
+					_mm256_mul_ps(planes[p][2], _mm256_loadu_ps(corners[p][2] + i))),
+					planes[p][3]);
+				insideMask &= _mm256_movemask_ps(_mm256_cmp_ps(distance, zero, _CMP_NLT_US));
+			}
+
+			for (int k = 0; k < 8; k++)
+			{
+				if ((insideMask & (1 << k)) != 0)
+				{
+					visible.push_back(objectIndices[i + k]);
+				}
+			}
+		}
+
+		CullSSE(frustum, boxes, i, last, objectIndices, visible);
+	}
+
+	// read the processor's identification registers
+	void ReadCpuid(int leaf, int subleaf, unsigned int registers[4])
+	{
+#ifdef _MSC_VER
+		int info[4];
+		__cpuidex(info, leaf, subleaf);
+		for (int i = 0; i < 4; i++)
+		{
+			registers[i] = (unsigned int)info[i];
+		}
+#else
+		__cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+	}
+
+	// read the register telling which states the system saves
+	unsigned long long ReadEnabledStates()
+	{
+#ifdef _MSC_VER
+		return(_xgetbv(0));
+#else
+		unsigned int low = 0;
+		unsigned int high = 0;
+		__asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+		return(((unsigned long long)high << 32) | low);
+#endif
+	}
+#endif
+
+	/***********************************************************
+	 *  DetectBestPath()
+	 *
+	 *  Find the widest kernels the processor can run.  AVX2
+	 *  also needs the system to save the wide registers.
+	 ***********************************************************/
+	TransformKernels::KERNEL_PATH DetectBestPath()
+	{
+#ifdef TRANSFORM_KERNELS_X86
+		unsigned int registers[4];
+		ReadCpuid(0, 0, registers);
+		int highestLeaf = (int)registers[0];
+
+		ReadCpuid(1, 0, registers);
+		bool bSSE = ((registers[3] & (1u << 25)) != 0);
+		bool bSavedStates = ((registers[2] & (1u << 27)) != 0);
+		bool bAVX = ((registers[2] & (1u << 28)) != 0);
+		if (bSSE == false)
+		{
+			return(TransformKernels::PATH_SCALAR);
+		}
+
+		if ((bSavedStates == true) && (bAVX == true) && (highestLeaf >= 7) &&
+			((ReadEnabledStates() & 0x6) == 0x6))
+		{
+			ReadCpuid(7, 0, registers);
+			if ((registers[1] & (1u << 5)) != 0)
+			{
+				return(TransformKernels::PATH_AVX2);
+			}
+		}
+		return(TransformKernels::PATH_SSE);
+#else
+		return(TransformKernels::PATH_SCALAR);
+#endif
+	}
+
+	// widest path that can run, and the path the kernels run on
+	const TransformKernels::KERNEL_PATH g_BestPath = DetectBestPath();
+	TransformKernels::KERNEL_PATH g_Path = g_BestPath;
+
+	// names of the paths, in KERNEL_PATH order
+	const char* g_PathNames[TransformKernels::PATH_COUNT] = { "scalar", "sse", "avx2" };
+
+	// compose a range of transforms on the chosen path
+	void ComposeRange(
+		const TransformKernels::TRANSFORM_STREAMS& streams,
+		int first,
+		int last,
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds)
+	{
+#ifdef TRANSFORM_KERNELS_X86
+		if (g_Path == TransformKernels::PATH_AVX2)
+		{
+			ComposeAVX2(streams, first, last, modelMatrices, worldBounds);
+			return;
+		}
+		if (g_Path == TransformKernels::PATH_SSE)
+		{
+			ComposeSSE(streams, first, last, modelMatrices, worldBounds);
+			return;
+		}
+#endif
+		ComposeScalar(streams, first, last, modelMatrices, worldBounds);
+	}
+
+	// set the sines and cosines of a rotation
+	void SetRotation(
+		TransformKernels::TRANSFORM_STREAMS& streams,
+		int index,
+		const float rotationDegrees[3])
+	{
+		for (int axis = 0; axis < 3; axis++)
+		{
+			streams.rotationDegrees[axis][index] = rotationDegrees[axis];
+			streams.sine[axis][index] = sinf(glm::radians(rotationDegrees[axis]));
+			streams.cosine[axis][index] = cosf(glm::radians(rotationDegrees[axis]));
+		}
+	}
+}
+
+/***********************************************************
+ *  ClearTransforms()
+ *
+ *  This method is used for removing every transform from
+ *  the streams, keeping their memory.
+ ***********************************************************/
+void TransformKernels::ClearTransforms(TRANSFORM_STREAMS& streams)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		streams.position[axis].clear();
+		streams.scale[axis].clear();
+		streams.rotationDegrees[axis].clear();
+		streams.sine[axis].clear();
+		streams.cosine[axis].clear();
+		streams.localCenter[axis].clear();
+		streams.localExtent[axis].clear();
+	}
+	streams.dirty.clear();
+}
+
+/***********************************************************
+ *  ReserveTransforms()
+ *
+ *  This method is used for making room in the streams for
+ *  the passed in number of transforms.
+ ***********************************************************/
+void TransformKernels::ReserveTransforms(TRANSFORM_STREAMS& streams, int count)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		streams.position[axis].reserve(count);
+		streams.scale[axis].reserve(count);
+		streams.rotationDegrees[axis].reserve(count);
+		streams.sine[axis].reserve(count);
+		streams.cosine[axis].reserve(count);
+		streams.localCenter[axis].reserve(count);
+		streams.localExtent[axis].reserve(count);
+	}
+	streams.dirty.reserve(count);
+}
+
+/***********************************************************
+ *  AddTransform()
+ *
+ *  This method is used for appending a transform over a
+ *  mesh with the passed in local bounds.  The transform is
+ *  dirty until it is composed, and its index is returned.
+ ***********************************************************/
+int TransformKernels::AddTransform(
+	TRANSFORM_STREAMS& streams,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ,
+	const BoundingVolumes::BOUNDING_BOX& localBounds)
+{
+	glm::vec3 center = (localBounds.minPoint + localBounds.maxPoint) * 0.5f;
+	glm::vec3 extent = (localBounds.maxPoint - localBounds.minPoint) * 0.5f;
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		streams.position[axis].push_back(positionXYZ[axis]);
+		streams.scale[axis].push_back(scaleXYZ[axis]);
+		streams.rotationDegrees[axis].push_back(0.0f);
+		streams.sine[axis].push_back(0.0f);
+		streams.cosine[axis].push_back(1.0f);
+		streams.localCenter[axis].push_back(center[axis]);
+		streams.localExtent[axis].push_back(extent[axis]);
+	}
+	streams.dirty.push_back(1);
+
+	int index = (int)streams.dirty.size() - 1;
+	const float rotationDegrees[3] = { XrotationDegrees, YrotationDegrees, ZrotationDegrees };
+	SetRotation(streams, index, rotationDegrees);
+
+	return(index);
+}
+
+/***********************************************************
+ *  CopyTransform()
+ *
+ *  This method is used for appending a copy of a transform
+ *  moved by the passed in offset.  The copy is dirty until
+ *  it is composed, and its index is returned.
+ ***********************************************************/
+int TransformKernels::CopyTransform(
+	TRANSFORM_STREAMS& streams,
+	int index,
+	glm::vec3 offset)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		streams.position[axis].push_back(streams.position[axis][index] + offset[axis]);
+		streams.scale[axis].push_back(streams.scale[axis][index]);
+		streams.rotationDegrees[axis].push_back(streams.rotationDegrees[axis][index]);
+		streams.sine[axis].push_back(streams.sine[axis][index]);
+		streams.cosine[axis].push_back(streams.cosine[axis][index]);
+		streams.localCenter[axis].push_back(streams.localCenter[axis][index]);
+		streams.localExtent[axis].push_back(streams.localExtent[axis][index]);
+	}
+	streams.dirty.push_back(1);
+
+	return((int)streams.dirty.size() - 1);
+}
+
+/***********************************************************
+ *  SetTransform()
+ *
+ *  This method is used for changing the values of a
+ *  transform.  The transform is only marked dirty when one
+ *  of the values actually changed, and true is returned
+ *  then; the sines and cosines are only taken again when
+ *  the rotation changed.
+ ***********************************************************/
+bool TransformKernels::SetTransform(
+	TRANSFORM_STREAMS& streams,
+	int index,
+	glm::vec3 scaleXYZ,
+	float XrotationDegrees,
+	float YrotationDegrees,
+	float ZrotationDegrees,
+	glm::vec3 positionXYZ)
+{
+	const float rotationDegrees[3] = { XrotationDegrees, YrotationDegrees, ZrotationDegrees };
+
+	bool bRotationChanged = false;
+	bool bChanged = false;
+	for (int axis = 0; axis < 3; axis++)
+	{
+		if (streams.rotationDegrees[axis][index] != rotationDegrees[axis])
+		{
+			bRotationChanged = true;
+		}
+		if ((streams.position[axis][index] != positionXYZ[axis]) ||
+			(streams.scale[axis][index] != scaleXYZ[axis]))
+		{
+			bChanged = true;
+		}
+	}
+	if ((bChanged == false) && (bRotationChanged == false))
+	{
+		return(false);
+	}
+
+	for (int axis = 0; axis < 3; axis++)
+	{
+		streams.position[axis][index] = positionXYZ[axis];
+		streams.scale[axis][index] = scaleXYZ[axis];
+	}
+	if (bRotationChanged == true)
+	{
+		SetRotation(streams, index, rotationDegrees);
+	}
+	streams.dirty[index] = 1;
+
+	return(true);
+}
+
+/***********************************************************
+ *  GetPosition()
+ *
+ *  This method is used for getting the position of the
+ *  transform at the passed in index.
+ ***********************************************************/
+glm::vec3 TransformKernels::GetPosition(const TRANSFORM_STREAMS& streams, int index)
+{
+	return(glm::vec3(
+		streams.position[0][index],
+		streams.position[1][index],
+		streams.position[2][index]));
+}
+
+/***********************************************************
+ *  MarkAllDirty()
+ *
+ *  This method is used for making every transform compose
+ *  again the next time the dirty ones are composed.
+ ***********************************************************/
+void TransformKernels::MarkAllDirty(TRANSFORM_STREAMS& streams)
+{
+	if (streams.dirty.empty() == false)
+	{
+		memset(streams.dirty.data(), 1, streams.dirty.size());
+	}
+}
+
+/***********************************************************
+ *  ComposeDirty()
+ *
+ *  This method is used for composing the model matrices and
+ *  world bounds of the dirty transforms in a range, which
+ *  are written at the index of the transform.  Runs of
+ *  dirty transforms go through the kernels of the chosen
+ *  path together, and are clean afterwards.  Jobs can
+ *  compose ranges that do not overlap at the same time.
+ ***********************************************************/
+int TransformKernels::ComposeDirty(
+	TRANSFORM_STREAMS& streams,
+	int first,
+	int last,
+	glm::mat4* modelMatrices,
+	BoundingVolumes::BOUNDING_BOX* worldBounds)
+{
+	int composed = 0;
+
+	int i = first;
+	while (i < last)
+	{
+		if (streams.dirty[i] == 0)
+		{
+			i++;
+			continue;
+		}
+
+		int runEnd = i + 1;
+		while ((runEnd < last) && (streams.dirty[runEnd] != 0))
+		{
+			runEnd++;
+		}
+
+		ComposeRange(streams, i, runEnd, modelMatrices, worldBounds);
+		memset(&streams.dirty[i], 0, runEnd - i);
+		composed += runEnd - i;
+		i = runEnd;
+	}
+
+	return(composed);
+}
+
+/***********************************************************
+ *  ResizeBoxes()
+ *
+ *  This method is used for sizing the box streams to the
+ *  passed in number of boxes.
+ ***********************************************************/
+void TransformKernels::ResizeBoxes(BOX_STREAMS& boxes, int count)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boxes.minPoint[axis].resize(count);
+		boxes.maxPoint[axis].resize(count);
+	}
+}
+
+/***********************************************************
+ *  SetBox()
+ *
+ *  This method is used for setting the box at the passed
+ *  in index of the box streams.
+ ***********************************************************/
+void TransformKernels::SetBox(
+	BOX_STREAMS& boxes,
+	int index,
+	const BoundingVolumes::BOUNDING_BOX& box)
+{
+	for (int axis = 0; axis < 3; axis++)
+	{
+		boxes.minPoint[axis][index] = box.minPoint[axis];
+		boxes.maxPoint[axis][index] = box.maxPoint[axis];
+	}
+}
+
+/***********************************************************
+ *  CullBoxes()
+ *
+ *  This method is used for testing a range of the boxes
+ *  against the frustum on the chosen path.  For every box
+ *  at least partly inside, the object index at the same
+ *  position is appended to the visible objects, in order.
+ ***********************************************************/
+void TransformKernels::CullBoxes(
+	const BoundingVolumes::FRUSTUM& frustum,
+	const BOX_STREAMS& boxes,
+	int first,
+	int last,
+	const int* objectIndices,
+	std::vector<int>& visible)
+{
+#ifdef TRANSFORM_KERNELS_X86
+	if (g_Path == PATH_AVX2)
+	{
+		CullAVX2(frustum, boxes, first, last, objectIndices, visible);
+		return;
+	}
+	if (g_Path == PATH_SSE)
+	{
+		CullSSE(frustum, boxes, first, last, objectIndices, visible);
+		return;
+	}
+#endif
+	CullScalar(frustum, boxes, first, last, objectIndices, visible);
+}
+
+/***********************************************************
+ *  GetBestPath()
+ *
+ *  This method is used for getting the widest path the
+ *  processor and the system support.
+ ***********************************************************/
+TransformKernels::KERNEL_PATH TransformKernels::GetBestPath()
+{
+	return(g_BestPath);
+}
+
+/***********************************************************
+ *  GetPath()
+ *
+ *  This method is used for getting the path the kernels
+ *  run on.
+ ***********************************************************/
+TransformKernels::KERNEL_PATH TransformKernels::GetPath()
+{
+	return(g_Path);
+}
+
+/***********************************************************
+ *  SetPath()
+ *
+ *  This method is used for choosing the path the kernels
+ *  run on, such as the scalar path for comparing against.
+ *  Paths wider than the best one are refused.  The path
+ *  must not change while kernels are running on any thread.
+ ***********************************************************/
+bool TransformKernels::SetPath(KERNEL_PATH path)
+{
+	if ((path < PATH_SCALAR) || (path > g_BestPath))
+	{
+		return(false);
+	}
+
+	g_Path = path;
+	return(true);
+}
+
+/***********************************************************
+ *  GetPathName()
+ *
+ *  This method is used for getting the name of a path, as
+ *  reported by the benchmark and chosen on the command line.
+ ***********************************************************/
+const char* TransformKernels::GetPathName(KERNEL_PATH path)
+{
+	if ((path < PATH_SCALAR) || (path >= PATH_COUNT))
+	{
+		return("unknown");
+	}
+	return(g_PathNames[path]);
+}
+
+/***********************************************************
+ *  FindPath()
+ *
+ *  This method is used for finding a kernel path by its
+ *  name.  False is returned when no path has the name.
+ ***********************************************************/
+bool TransformKernels::FindPath(const char* name, KERNEL_PATH& path)
+{
+	for (int i = 0; i < PATH_COUNT; i++)
+	{
+		if (strcmp(name, g_PathNames[i]) == 0)
+		{
+			path = (KERNEL_PATH)i;
+			return(true);
+		}
+	}
+
+	return(false);
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+///////////////////////////////////////////////////////////////////////////////
+// transformkernels.h
+// ============
+// compose model matrices and cull bounds of many objects at a time
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "BoundingVolumes.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+
+/***********************************************************
+ *  TransformKernels
+ *
+ *  This class contains the kernels that compose the model
+ *  matrices and world bounds of the scene objects and test
+ *  bounds against a view frustum.  The transformation
+ *  values are kept in streams with one array per component,
+ *  so the kernels load them for 4 objects at a time with
+ *  SSE or 8 with AVX2, and the scalar kernels handle the
+ *  objects left over and processors without either.  Every
+ *  kernel does the same operations in the same order, so
+ *  all of them give the same results.
+ ***********************************************************/
+class TransformKernels
+{
+public:
+	// instruction sets the kernels can run on, each one
+	// including the ones before it
+	enum KERNEL_PATH
+	{
+		PATH_SCALAR = 0,
+		PATH_SSE,
+		PATH_AVX2,
+		PATH_COUNT
+	};
+
+	// transformation values of many objects, one array per
+	// component and one entry per object
+	struct TRANSFORM_STREAMS
+	{
+		std::vector<float> position[3];
+		std::vector<float> scale[3];
+		std::vector<float> rotationDegrees[3];
+		// sines and cosines of the rotation angles, taken once
+		// when the rotation is set instead of in every compose
+		std::vector<float> sine[3];
+		std::vector<float> cosine[3];
+		// center and half extents of the local bounds of the mesh
+		std::vector<float> localCenter[3];
+		std::vector<float> localExtent[3];
+		// non-zero when the model matrix has to be composed again
+		std::vector<unsigned char> dirty;
+	};
+
+	// bounding boxes of many objects, one array per component
+	struct BOX_STREAMS
+	{
+		std::vector<float> minPoint[3];
+		std::vector<float> maxPoint[3];
+	};
+
+	// remove every transform, or make room for more of them
+	static void ClearTransforms(TRANSFORM_STREAMS& streams);
+	static void ReserveTransforms(TRANSFORM_STREAMS& streams, int count);
+	// append a transform over a mesh with the passed in local
+	// bounds; the index of the new transform is returned
+	static int AddTransform(
+		TRANSFORM_STREAMS& streams,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ,
+		const BoundingVolumes::BOUNDING_BOX& localBounds);
+	// append a copy of a transform moved by an offset
+	static int CopyTransform(
+		TRANSFORM_STREAMS& streams,
+		int index,
+		glm::vec3 offset);
+	// change a transform; returns true when a value changed
+	static bool SetTransform(
+		TRANSFORM_STREAMS& streams,
+		int index,
+		glm::vec3 scaleXYZ,
+		float XrotationDegrees,
+		float YrotationDegrees,
+		float ZrotationDegrees,
+		glm::vec3 positionXYZ);
+	// position of a transform
+	static glm::vec3 GetPosition(const TRANSFORM_STREAMS& streams, int index);
+	// make every transform compose again
+	static void MarkAllDirty(TRANSFORM_STREAMS& streams);
+
+	// compose the model matrices and world bounds of the dirty
+	// transforms in a range; returns the number composed
+	static int ComposeDirty(
+		TRANSFORM_STREAMS& streams,
+		int first,
+		int last,
+		glm::mat4* modelMatrices,
+		BoundingVolumes::BOUNDING_BOX* worldBounds);
+
+	// size the box streams, and set one of the boxes
+	static void ResizeBoxes(BOX_STREAMS& boxes, int count);
+	static void SetBox(
+		BOX_STREAMS& boxes,
+		int index,
+		const BoundingVolumes::BOUNDING_BOX& box);
+	// append the object index of every box in a range that is
+	// at least partly inside the frustum
+	static void CullBoxes(
+		const BoundingVolumes::FRUSTUM& frustum,
+		const BOX_STREAMS& boxes,
+		int first,
+		int last,
+		const int* objectIndices,
+		std::vector<int>& visible);
+
+	// widest path the processor and the system support
+	static KERNEL_PATH GetBestPath();
+	// path the kernels run on, the best one unless chosen; it
+	// is only changed while no kernels are running, and false
+	// is returned for a path that is not supported
+	static KERNEL_PATH GetPath();
+	static bool SetPath(KERNEL_PATH path);
+	// name of a path, as used on the command line
+	static const char* GetPathName(KERNEL_PATH path);
+	// find a path by its name; false when there is none
+	static bool FindPath(const char* name, KERNEL_PATH& path);
+};
\ No newline at end of file
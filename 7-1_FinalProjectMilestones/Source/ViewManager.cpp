@@ -1,275 +1,589 @@
-///////////////////////////////////////////////////////////////////////////////
-// viewmanager.h
-// ============
-// manage the viewing of 3D objects within the viewport
-//
-///////////////////////////////////////////////////////////////////////////////
-
-#include "ViewManager.h"
-
-// GLM Math Header inclusions
-#include <glm/glm.hpp>
-#include <glm/gtx/transform.hpp>
-#include <glm/gtc/type_ptr.hpp>    
-
-// declaration of the global variables and defines
-namespace
-{
-	// Variables for window width and height
-	const int WINDOW_WIDTH = 1000;
-	const int WINDOW_HEIGHT = 800;
-	const char* g_ViewName = "view";
-	const char* g_ProjectionName = "projection";
-
-	// camera object used for viewing and interacting with
-	// the 3D scene
-	Camera* g_pCamera = nullptr;
-
-	// these variables are used for mouse movement processing
-	float gLastX = WINDOW_WIDTH / 2.0f;
-	float gLastY = WINDOW_HEIGHT / 2.0f;
-	bool gFirstMouse = true;
-
-	// time between current frame and last frame
-	float gDeltaTime = 0.0f; 
-	float gLastFrame = 0.0f;
-
-	// the following variable is false when orthographic projection
-	// is off and true when it is on
-	bool bOrthographicProjection = false;
-}
-
-/***********************************************************
- *  ViewManager()
- *
- *  The constructor for the class
- ***********************************************************/
-ViewManager::ViewManager(
-	ShaderManager *pShaderManager)
-{
-	// initialize the member variables
-	m_pShaderManager = pShaderManager;
-	m_pWindow = NULL;
-	g_pCamera = new Camera();
-	// default camera view parameters
-	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
-	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
-	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
-	g_pCamera->Zoom = 80;
-	//g_pCamera->MovementSpeed = 25;
-}
-
-/***********************************************************
- *  ~ViewManager()
- *
- *  The destructor for the class
- ***********************************************************/
-ViewManager::~ViewManager()
-{
-	// free up allocated memory
-	m_pShaderManager = NULL;
-	m_pWindow = NULL;
-	if (NULL != g_pCamera)
-	{
-		delete g_pCamera;
-		g_pCamera = NULL;
-	}
-}
-
-/***********************************************************
- *  CreateDisplayWindow()
- *
- *  This method is used to create the main display window.
- ***********************************************************/
-GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
-{
-	GLFWwindow* window = nullptr;
-
-	// try to create the displayed OpenGL window
-	window = glfwCreateWindow(
-		WINDOW_WIDTH,
-		WINDOW_HEIGHT,
-		windowTitle,
-		NULL, NULL);
-	if (window == NULL)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return NULL;
-	}
-	glfwMakeContextCurrent(window);
-
-	// tell GLFW to capture all mouse events
-	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// this callback is used to receive mouse moving events
-	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
-
-	// created to set scroll callback for mouse scroll wheel
-	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
-
-	// enable blending for supporting tranparent rendering
-	glEnable(GL_BLEND);
-	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-	m_pWindow = window;
-
-	return(window);
-}
-
-/***********************************************************
- *  Mouse_Position_Callback()
- *
- *  This method is automatically called from GLFW whenever
- *  the mouse is moved within the active GLFW display window.
- ***********************************************************/
-void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
-{
-	// when the first mouse move event is received, this needs to be recorded so that
-	// all subsequent mouse moves can correctly calculate the X position offset and Y
-	// position offset for proper operation
-	if (gFirstMouse)
-	{
-		gLastX = xMousePos;
-		gLastY = yMousePos;
-		gFirstMouse = false;
-	}
-
-	// calculate the X offset and Y offset values for moving the 3D camera accordingly
-	float xOffset = (float)xMousePos - gLastX;
-	float yOffset = gLastY - (float)yMousePos; // reversed since y-coordinates go from bottom to top
-
-	// set the current positions into the last position variables
-	gLastX = xMousePos;
-	gLastY = yMousePos;
-
-	// move the 3D camera according to the calculated offsets
-	g_pCamera->ProcessMouseMovement(xOffset, yOffset);
-}
-
-/***********************************************************
- *  Mouse_Scroll_Callback()
- *  This method is automatically called from GLFW whenever
- *  the user scrolls the mouse wheel in the active window.
- *  We use it to increase/decrease the camera's movement
- *  speed so that WASD/QE become faster/slower
- ***********************************************************/
-
-void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
-{
-	if (g_pCamera)
-	{
-		// This function should modifies the camera's
-		// movement speed or zoom/FOV.
-		g_pCamera->ProcessMouseScroll((float)yOffset);
-	}
-}
-
-/***********************************************************
- *  ProcessKeyboardEvents()
- *
- *  This method is called to process any keyboard events
- *  that may be waiting in the event queue.
- ***********************************************************/
-void ViewManager::ProcessKeyboardEvents()
-{
-	// close the window if the escape key has been pressed
-	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-	{
-		glfwSetWindowShouldClose(m_pWindow, true);
-	}
-
-	// process camera zooming in and out
-	if (glfwGetKey(m_pWindow, GLFW_KEY_W) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(FORWARD, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_S) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(BACKWARD, gDeltaTime);
-	}
-
-	// process camera panning left and right
-	if (glfwGetKey(m_pWindow, GLFW_KEY_A) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(LEFT, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_D) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(RIGHT, gDeltaTime);
-	}
-
-	//process up and down movement
-	if (glfwGetKey(m_pWindow, GLFW_KEY_Q) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(UP, gDeltaTime);
-	}
-	if (glfwGetKey(m_pWindow, GLFW_KEY_E) == GLFW_PRESS)
-	{
-		g_pCamera->ProcessKeyboard(DOWN, gDeltaTime);
-	}
-
-	if (glfwGetKey(m_pWindow, GLFW_KEY_P) == GLFW_PRESS)
-	{
-		bOrthographicProjection = false;
-	}
-
-	// Orthographic
-	if (glfwGetKey(m_pWindow, GLFW_KEY_O) == GLFW_PRESS)
-	{
-		bOrthographicProjection = true;
-	}
-}
-
-/***********************************************************
- *  PrepareSceneView()
- *
- *  This method is used for preparing the 3D scene by loading
- *  the shapes, textures in memory to support the 3D scene 
- *  rendering
- ***********************************************************/
-void ViewManager::PrepareSceneView()
-{
-	glm::mat4 view;
-	glm::mat4 projection;
-
-	// per-frame timing
-	float currentFrame = glfwGetTime();
-	gDeltaTime = currentFrame - gLastFrame;
-	gLastFrame = currentFrame;
-
-	// process any keyboard events that may be waiting in the 
-	// event queue
-	ProcessKeyboardEvents();
-
-	// get the current view matrix from the camera
-	view = g_pCamera->GetViewMatrix();
-
-	// define the current projection matrix
-	if (bOrthographicProjection)
-	{
-		// Orthographic
-		float orthoSize = 5.0f;
-		float yOffset = 6.5;// shift down
-		projection = glm::ortho(-orthoSize,// left
-			orthoSize,    // right
-			-orthoSize - yOffset,   // bottom
-			orthoSize - yOffset,    // top
-			4.0f,         // near
-			100.0f);      // far
-	}
-	else {
-		projection = glm::perspective(glm::radians(g_pCamera->Zoom), (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT, 0.1f, 100.0f);
-	}
-
-	// if the shader manager object is valid
-	if (NULL != m_pShaderManager)
-	{
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ViewName, view);
-		// set the view matrix into the shader for proper rendering
-		m_pShaderManager->setMat4Value(g_ProjectionName, projection);
-		// set the view position of the camera into the shader for proper rendering
-		m_pShaderManager->setVec3Value("viewPosition", g_pCamera->Position);
-	}
-}
+///////////////////////////////////////////////////////////////////////////////
+// viewmanager.h
+// ============
+// manage the viewing of 3D objects within the viewport
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "ViewManager.h"
+#include "GLStateCache.h"
+
+// GLM Math Header inclusions
+#include <glm/glm.hpp>
+#include <glm/gtx/transform.hpp>
+#include <glm/gtc/type_ptr.hpp>    
+
+// declaration of the global variables and defines
+namespace
+{
+	// Variables for the window width and height it is created with
+	const int WINDOW_WIDTH = 1000;
+	const int WINDOW_HEIGHT = 800;
+
+	// size of the window client area, in the screen coordinates
+	// of the mouse positions, and of its framebuffer in pixels,
+	// kept by the resize callbacks
+	int gWindowWidth = WINDOW_WIDTH;
+	int gWindowHeight = WINDOW_HEIGHT;
+	int gFramebufferWidth = WINDOW_WIDTH;
+	int gFramebufferHeight = WINDOW_HEIGHT;
+	// aspect ratio of the framebuffer, kept while the window is
+	// minimized and its framebuffer has no size
+	float gAspectRatio = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+
+	// camera object used for viewing and interacting with
+	// the 3D scene
+	Camera* g_pCamera = nullptr;
+
+	// these variables are used for mouse movement processing
+	float gLastX = WINDOW_WIDTH / 2.0f;
+	float gLastY = WINDOW_HEIGHT / 2.0f;
+	bool gFirstMouse = true;
+
+	// mouse movement and wheel scrolling collected by the
+	// callbacks since the input was last captured
+	float gMouseOffsetX = 0.0f;
+	float gMouseOffsetY = 0.0f;
+	float gScrollOffset = 0.0f;
+
+	// true when the left mouse button was clicked and the
+	// click has not been captured with the input yet
+	bool gPickRequested = false;
+
+	// the following variable is false when orthographic projection
+	// is off and true when it is on
+	bool bOrthographicProjection = false;
+}
+
+/***********************************************************
+ *  ViewManager()
+ *
+ *  The constructor for the class
+ ***********************************************************/
+ViewManager::ViewManager(
+	ShaderManager *pShaderManager,
+	ShaderUniforms *pShaderUniforms)
+{
+	// initialize the member variables
+	m_pShaderManager = pShaderManager;
+	m_pShaderUniforms = pShaderUniforms;
+	m_pWindow = NULL;
+	m_bCameraPose = false;
+	m_cameraPosition = glm::vec3(0.0f);
+	m_cameraTarget = glm::vec3(0.0f);
+	m_lastInputTime = -1.0;
+	g_pCamera = new Camera();
+	// default camera view parameters
+	g_pCamera->Position = glm::vec3(0.0f, 5.0f, 12.0f);
+	g_pCamera->Front = glm::vec3(0.0f, -0.5f, -2.0f);
+	g_pCamera->Up = glm::vec3(0.0f, 1.0f, 0.0f);
+	g_pCamera->Zoom = 80;
+	//g_pCamera->MovementSpeed = 25;
+}
+
+/***********************************************************
+ *  ~ViewManager()
+ *
+ *  The destructor for the class
+ ***********************************************************/
+ViewManager::~ViewManager()
+{
+	// free up allocated memory
+	m_pShaderManager = NULL;
+	m_pShaderUniforms = NULL;
+	m_pWindow = NULL;
+	if (NULL != g_pCamera)
+	{
+		delete g_pCamera;
+		g_pCamera = NULL;
+	}
+}
+
+/***********************************************************
+ *  CreateDisplayWindow()
+ *
+ *  This method is used to create the main display window.
+ ***********************************************************/
+GLFWwindow* ViewManager::CreateDisplayWindow(const char* windowTitle)
+{
+	GLFWwindow* window = nullptr;
+
+	// try to create the displayed OpenGL window
+	window = glfwCreateWindow(
+		WINDOW_WIDTH,
+		WINDOW_HEIGHT,
+		windowTitle,
+		NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return NULL;
+	}
+	glfwMakeContextCurrent(window);
+
+	// tell GLFW to capture all mouse events
+	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	// this callback is used to receive mouse moving events
+	glfwSetCursorPosCallback(window, &ViewManager::Mouse_Position_Callback);
+
+	// created to set scroll callback for mouse scroll wheel
+	glfwSetScrollCallback(window, &ViewManager::Mouse_Scroll_Callback);
+
+	// this callback is used to pick scene objects by clicking
+	glfwSetMouseButtonCallback(window, &ViewManager::Mouse_Button_Callback);
+
+	// these callbacks are used to follow the window as it is
+	// resized; the sizes start from the created window, whose
+	// framebuffer can have more pixels than screen coordinates
+	glfwSetFramebufferSizeCallback(window, &ViewManager::Framebuffer_Size_Callback);
+	glfwSetWindowSizeCallback(window, &ViewManager::Window_Size_Callback);
+	int width = 0;
+	int height = 0;
+	glfwGetFramebufferSize(window, &width, &height);
+	Framebuffer_Size_Callback(window, width, height);
+	glfwGetWindowSize(window, &width, &height);
+	Window_Size_Callback(window, width, height);
+
+	// enable blending for supporting tranparent rendering
+	GLStateCache::SetCapability(GL_BLEND, true);
+	GLStateCache::SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	m_pWindow = window;
+
+	return(window);
+}
+
+/***********************************************************
+ *  Mouse_Position_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the mouse is moved within the active GLFW display window.
+ *  The movement is collected until the next captured input.
+ ***********************************************************/
+void ViewManager::Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos)
+{
+	// when the first mouse move event is received, this needs to be recorded so that
+	// all subsequent mouse moves can correctly calculate the X position offset and Y
+	// position offset for proper operation
+	if (gFirstMouse)
+	{
+		gLastX = xMousePos;
+		gLastY = yMousePos;
+		gFirstMouse = false;
+	}
+
+	// calculate the X offset and Y offset values for moving the 3D camera accordingly
+	float xOffset = (float)xMousePos - gLastX;
+	float yOffset = gLastY - (float)yMousePos; // reversed since y-coordinates go from bottom to top
+
+	// set the current positions into the last position variables
+	gLastX = xMousePos;
+	gLastY = yMousePos;
+
+	// the 3D camera is moved by the collected offsets when the
+	// view is updated
+	gMouseOffsetX += xOffset;
+	gMouseOffsetY += yOffset;
+}
+
+/***********************************************************
+ *  Mouse_Scroll_Callback()
+ *  This method is automatically called from GLFW whenever
+ *  the user scrolls the mouse wheel in the active window.
+ *  We use it to increase/decrease the camera's movement
+ *  speed so that WASD/QE become faster/slower
+ ***********************************************************/
+
+void ViewManager::Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset)
+{
+	// the scrolling is handed to the camera's movement speed
+	// or zoom/FOV when the view is updated
+	gScrollOffset += (float)yOffset;
+}
+
+/***********************************************************
+ *  Mouse_Button_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  a mouse button is pressed or released in the active
+ *  window.  A left click requests a pick ray through the
+ *  mouse position recorded by Mouse_Position_Callback().
+ ***********************************************************/
+void ViewManager::Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods)
+{
+	if ((button == GLFW_MOUSE_BUTTON_LEFT) && (action == GLFW_PRESS))
+	{
+		gPickRequested = true;
+	}
+}
+
+/***********************************************************
+ *  Framebuffer_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the framebuffer of the window is resized.  The size is
+ *  kept for drawing the frames and for the aspect ratio of
+ *  the projection, which stays as it was while the window
+ *  is minimized.
+ ***********************************************************/
+void ViewManager::Framebuffer_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gFramebufferWidth = width;
+	gFramebufferHeight = height;
+	if ((width > 0) && (height > 0))
+	{
+		gAspectRatio = (float)width / (float)height;
+	}
+}
+
+/***********************************************************
+ *  Window_Size_Callback()
+ *
+ *  This method is automatically called from GLFW whenever
+ *  the window is resized.  The size is in screen
+ *  coordinates, like the mouse positions that are picked.
+ ***********************************************************/
+void ViewManager::Window_Size_Callback(GLFWwindow* window, int width, int height)
+{
+	gWindowWidth = width;
+	gWindowHeight = height;
+}
+
+/***********************************************************
+ *  GetFramebufferSize()
+ *
+ *  This method is used for getting the size of the window
+ *  framebuffer in pixels, as of the last resize.
+ ***********************************************************/
+void ViewManager::GetFramebufferSize(int& width, int& height) const
+{
+	width = gFramebufferWidth;
+	height = gFramebufferHeight;
+}
+
+/***********************************************************
+ *  CaptureInput()
+ *
+ *  This method is used for capturing the keyboard and mouse
+ *  input since the last capture, so that the camera can be
+ *  updated on another thread than the one owning the
+ *  window.  The escape key is handled right here.
+ ***********************************************************/
+void ViewManager::CaptureInput(INPUT_STATE& input)
+{
+	input.time = glfwGetTime();
+	input.heldKeys = 0;
+	input.mouseOffset = glm::vec2(gMouseOffsetX, gMouseOffsetY);
+	input.scrollOffset = gScrollOffset;
+	input.bPickRequested = gPickRequested;
+	input.pickPosition = glm::vec2(gLastX, gLastY);
+	input.windowSize = glm::vec2((float)gWindowWidth, (float)gWindowHeight);
+	input.aspectRatio = gAspectRatio;
+	input.bCameraPose = m_bCameraPose;
+	input.cameraPosition = m_cameraPosition;
+	input.cameraTarget = m_cameraTarget;
+
+	gMouseOffsetX = 0.0f;
+	gMouseOffsetY = 0.0f;
+	gScrollOffset = 0.0f;
+	gPickRequested = false;
+	m_bCameraPose = false;
+
+	if (NULL == m_pWindow)
+	{
+		return;
+	}
+
+	// close the window if the escape key has been pressed
+	if (glfwGetKey(m_pWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	{
+		glfwSetWindowShouldClose(m_pWindow, true);
+	}
+
+	// while the cursor is captured for looking around, picks go
+	// through the center of the window
+	if (glfwGetInputMode(m_pWindow, GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+	{
+		input.pickPosition = input.windowSize / 2.0f;
+	}
+
+	const int keys[] = {
+		GLFW_KEY_W, GLFW_KEY_S, GLFW_KEY_A, GLFW_KEY_D,
+		GLFW_KEY_Q, GLFW_KEY_E, GLFW_KEY_P, GLFW_KEY_O };
+	const unsigned int keyBits[] = {
+		KEY_FORWARD, KEY_BACKWARD, KEY_LEFT, KEY_RIGHT,
+		KEY_UP, KEY_DOWN, KEY_PERSPECTIVE, KEY_ORTHOGRAPHIC };
+	for (int i = 0; i < 8; i++)
+	{
+		if (glfwGetKey(m_pWindow, keys[i]) == GLFW_PRESS)
+		{
+			input.heldKeys |= keyBits[i];
+		}
+	}
+}
+
+/***********************************************************
+ *  AccumulateInput()
+ *
+ *  This method is used for merging input captured later
+ *  into input that has not been used yet.  The held keys
+ *  and the time are taken from the later input, while the
+ *  mouse movement, scrolling, clicks and projection key
+ *  presses of both add up so that none of them are lost.
+ *  A click keeps the window size it was picked in.
+ ***********************************************************/
+void ViewManager::AccumulateInput(INPUT_STATE& pending, const INPUT_STATE& input)
+{
+	const unsigned int projectionKeys = KEY_PERSPECTIVE | KEY_ORTHOGRAPHIC;
+
+	pending.time = input.time;
+	pending.heldKeys = input.heldKeys | (pending.heldKeys & projectionKeys);
+	pending.mouseOffset += input.mouseOffset;
+	pending.scrollOffset += input.scrollOffset;
+	pending.aspectRatio = input.aspectRatio;
+	if (input.bPickRequested == true)
+	{
+		pending.bPickRequested = true;
+		pending.pickPosition = input.pickPosition;
+		pending.windowSize = input.windowSize;
+	}
+	if (input.bCameraPose == true)
+	{
+		pending.bCameraPose = true;
+		pending.cameraPosition = input.cameraPosition;
+		pending.cameraTarget = input.cameraTarget;
+	}
+}
+
+/***********************************************************
+ *  ConsumeInput()
+ *
+ *  This method is used for clearing the events of input
+ *  that has been used for updating the view, keeping the
+ *  time and the held keys for the next update.
+ ***********************************************************/
+void ViewManager::ConsumeInput(INPUT_STATE& pending)
+{
+	pending.heldKeys &= ~(unsigned int)(KEY_PERSPECTIVE | KEY_ORTHOGRAPHIC);
+	pending.mouseOffset = glm::vec2(0.0f);
+	pending.scrollOffset = 0.0f;
+	pending.bPickRequested = false;
+	pending.bCameraPose = false;
+}
+
+/***********************************************************
+ *  ProcessKeyboardEvents()
+ *
+ *  This method is called to apply the keys held while the
+ *  input was captured to the camera.
+ ***********************************************************/
+void ViewManager::ProcessKeyboardEvents(const INPUT_STATE& input, float deltaTime)
+{
+	// process camera zooming in and out
+	if ((input.heldKeys & KEY_FORWARD) != 0)
+	{
+		g_pCamera->ProcessKeyboard(FORWARD, deltaTime);
+	}
+	if ((input.heldKeys & KEY_BACKWARD) != 0)
+	{
+		g_pCamera->ProcessKeyboard(BACKWARD, deltaTime);
+	}
+
+	// process camera panning left and right
+	if ((input.heldKeys & KEY_LEFT) != 0)
+	{
+		g_pCamera->ProcessKeyboard(LEFT, deltaTime);
+	}
+	if ((input.heldKeys & KEY_RIGHT) != 0)
+	{
+		g_pCamera->ProcessKeyboard(RIGHT, deltaTime);
+	}
+
+	//process up and down movement
+	if ((input.heldKeys & KEY_UP) != 0)
+	{
+		g_pCamera->ProcessKeyboard(UP, deltaTime);
+	}
+	if ((input.heldKeys & KEY_DOWN) != 0)
+	{
+		g_pCamera->ProcessKeyboard(DOWN, deltaTime);
+	}
+
+	if ((input.heldKeys & KEY_PERSPECTIVE) != 0)
+	{
+		bOrthographicProjection = false;
+	}
+
+	// Orthographic
+	if ((input.heldKeys & KEY_ORTHOGRAPHIC) != 0)
+	{
+		bOrthographicProjection = true;
+	}
+}
+
+/***********************************************************
+ *  UpdateView()
+ *
+ *  This method is used for moving the camera by captured
+ *  input and building the view and projection matrices of
+ *  the next frame, along with the pick ray of a click.  No
+ *  OpenGL calls are made, so the view can be updated on
+ *  another thread than the one drawing the frames.
+ ***********************************************************/
+void ViewManager::UpdateView(const INPUT_STATE& input, VIEW_STATE& view)
+{
+	// per-frame timing, taken from the capture times so that
+	// the camera moves by the time between the captured input
+	float deltaTime = 0.0f;
+	if (m_lastInputTime >= 0.0)
+	{
+		deltaTime = (float)(input.time - m_lastInputTime);
+	}
+	m_lastInputTime = input.time;
+
+	// a scripted camera pose replaces the keyboard movement
+	if ((input.bCameraPose == true) && (input.cameraPosition != input.cameraTarget))
+	{
+		g_pCamera->Position = input.cameraPosition;
+		g_pCamera->Front = glm::normalize(input.cameraTarget - input.cameraPosition);
+	}
+
+	// apply the keys, mouse movement and scrolling captured
+	// since the last update
+	ProcessKeyboardEvents(input, deltaTime);
+	if ((input.mouseOffset.x != 0.0f) || (input.mouseOffset.y != 0.0f))
+	{
+		g_pCamera->ProcessMouseMovement(input.mouseOffset.x, input.mouseOffset.y);
+	}
+	if (input.scrollOffset != 0.0f)
+	{
+		// This function should modifies the camera's
+		// movement speed or zoom/FOV.
+		g_pCamera->ProcessMouseScroll(input.scrollOffset);
+	}
+
+	// get the current view matrix from the camera
+	view.view = g_pCamera->GetViewMatrix();
+
+	// define the current projection matrix
+	if (bOrthographicProjection)
+	{
+		// Orthographic
+		float orthoSize = 5.0f;
+		float yOffset = 6.5;// shift down
+		view.projection = glm::ortho(-orthoSize,// left
+			orthoSize,    // right
+			-orthoSize - yOffset,   // bottom
+			orthoSize - yOffset,    // top
+			4.0f,         // near
+			100.0f);      // far
+	}
+	else {
+		// the aspect ratio follows the window as it is resized
+		float aspectRatio = input.aspectRatio;
+		if (aspectRatio <= 0.0f)
+		{
+			aspectRatio = (GLfloat)WINDOW_WIDTH / (GLfloat)WINDOW_HEIGHT;
+		}
+		view.projection = glm::perspective(glm::radians(g_pCamera->Zoom), aspectRatio, 0.1f, 100.0f);
+	}
+
+	view.cameraPosition = g_pCamera->Position;
+
+	// the pick ray uses the view of the frame the click is
+	// handled in, so it works for the orthographic projection
+	view.bPickRay = false;
+	if (input.bPickRequested == true)
+	{
+		view.bPickRay = BuildPickRay(
+			input.pickPosition,
+			input.windowSize,
+			view.view,
+			view.projection,
+			view.pickOrigin,
+			view.pickDirection);
+	}
+}
+
+/***********************************************************
+ *  ApplyView()
+ *
+ *  This method is used for setting the view and projection
+ *  matrices of a built view into the shaders, for the
+ *  conversion from 3D object display to 2D scene display.
+ ***********************************************************/
+void ViewManager::ApplyView(const VIEW_STATE& view)
+{
+	// if the shader uniforms object is valid
+	if (NULL != m_pShaderUniforms)
+	{
+		// set the view matrix, the projection matrix and the view
+		// position of the camera into the frame block, which is only
+		// uploaded when the camera actually changed
+		m_pShaderUniforms->SetFrameData(view.view, view.projection, view.cameraPosition);
+	}
+}
+
+/***********************************************************
+ *  SetCameraPose()
+ *
+ *  This method is used for placing the camera at a position
+ *  and pointing it at a target, so that the camera can be
+ *  driven along a path instead of by the keyboard and mouse.
+ *  The pose is handed on with the next captured input.
+ ***********************************************************/
+void ViewManager::SetCameraPose(const glm::vec3& position, const glm::vec3& target)
+{
+	if (position == target)
+	{
+		return;
+	}
+
+	m_bCameraPose = true;
+	m_cameraPosition = position;
+	m_cameraTarget = target;
+}
+
+/***********************************************************
+ *  BuildPickRay()
+ *
+ *  This method is used for building the world space ray
+ *  through a position in window coordinates, such as the
+ *  mouse position of a click in a window of the passed in
+ *  size.  The near and far points are
+ *  unprojected with the passed in view and projection;
+ *  false is returned when the ray cannot be built.
+ ***********************************************************/
+bool ViewManager::BuildPickRay(
+	const glm::vec2& position,
+	const glm::vec2& windowSize,
+	const glm::mat4& view,
+	const glm::mat4& projection,
+	glm::vec3& origin,
+	glm::vec3& direction)
+{
+	if ((windowSize.x <= 0.0f) || (windowSize.y <= 0.0f))
+	{
+		return(false);
+	}
+
+	// normalized device coordinates, with y pointing up
+	float ndcX = (2.0f * position.x) / windowSize.x - 1.0f;
+	float ndcY = 1.0f - (2.0f * position.y) / windowSize.y;
+
+	// unproject the points on the near and far planes
+	glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+	glm::vec4 nearPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+	glm::vec4 farPoint = inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+	if ((nearPoint.w == 0.0f) || (farPoint.w == 0.0f))
+	{
+		return(false);
+	}
+
+	origin = glm::vec3(nearPoint) / nearPoint.w;
+	direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+
+	return(true);
+}
\ No newline at end of file
@@ -1,48 +1,144 @@
-///////////////////////////////////////////////////////////////////////////////
-// viewmanager.h
-// ============
-// manage the viewing of 3D objects within the viewport
-//
-///////////////////////////////////////////////////////////////////////////////
-
-#pragma once
-
-#include "ShaderManager.h"
-#include "camera.h"
-
-// GLFW library
-#include "GLFW/glfw3.h" 
-
-class ViewManager
-{
-public:
-	// constructor
-	ViewManager(
-		ShaderManager* pShaderManager);
-	// destructor
-	~ViewManager();
-
-	// mouse position callback for mouse interaction with the 3D scene
-	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
-
-public:
-
-	// CALLBACK for mouse scroll
-	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
-
-private:
-	// pointer to shader manager object
-	ShaderManager* m_pShaderManager;
-	// active OpenGL display window
-	GLFWwindow* m_pWindow;
-
-	// process keyboard events for interaction with the 3D scene
-	void ProcessKeyboardEvents();
-
-public:
-	// create the initial OpenGL display window
-	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
-	
-	// prepare the conversion from 3D object display to 2D scene display
-	void PrepareSceneView();
-};
+///////////////////////////////////////////////////////////////////////////////
+// viewmanager.h
+// ============
+// manage the viewing of 3D objects within the viewport
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include "ShaderManager.h"
+#include "ShaderUniforms.h"
+#include "camera.h"
+
+// GLFW library
+#include "GLFW/glfw3.h" 
+
+class ViewManager
+{
+public:
+	// constructor
+	ViewManager(
+		ShaderManager* pShaderManager,
+		ShaderUniforms* pShaderUniforms);
+	// destructor
+	~ViewManager();
+
+	// mouse position callback for mouse interaction with the 3D scene
+	static void Mouse_Position_Callback(GLFWwindow* window, double xMousePos, double yMousePos);
+
+public:
+
+	// CALLBACK for mouse scroll
+	static void Mouse_Scroll_Callback(GLFWwindow* window, double xOffset, double yOffset);
+
+	// CALLBACK for mouse buttons, used for picking scene objects
+	static void Mouse_Button_Callback(GLFWwindow* window, int button, int action, int mods);
+
+	// CALLBACKS for resizing the window, which change the size
+	// of its framebuffer and the range of the mouse positions
+	static void Framebuffer_Size_Callback(GLFWwindow* window, int width, int height);
+	static void Window_Size_Callback(GLFWwindow* window, int width, int height);
+
+	// movement and projection keys held while input was captured
+	enum INPUT_KEY
+	{
+		KEY_FORWARD = 1,
+		KEY_BACKWARD = 2,
+		KEY_LEFT = 4,
+		KEY_RIGHT = 8,
+		KEY_UP = 16,
+		KEY_DOWN = 32,
+		KEY_PERSPECTIVE = 64,
+		KEY_ORTHOGRAPHIC = 128
+	};
+
+	// keyboard and mouse input captured on the thread owning
+	// the window, for updating the camera on another thread
+	struct INPUT_STATE
+	{
+		// time the input was captured, in seconds
+		double time;
+		// held keys, as a combination of INPUT_KEY bits
+		unsigned int heldKeys;
+		// mouse movement and wheel scrolling since the last capture
+		glm::vec2 mouseOffset;
+		float scrollOffset;
+		// true after a click, with the window position picked
+		bool bPickRequested;
+		glm::vec2 pickPosition;
+		// size of the window the position is picked in, and the
+		// aspect ratio of its framebuffer
+		glm::vec2 windowSize;
+		float aspectRatio;
+		// true when a camera pose was set with SetCameraPose()
+		bool bCameraPose;
+		glm::vec3 cameraPosition;
+		glm::vec3 cameraTarget;
+	};
+
+	// view of one frame, built from the input by UpdateView()
+	struct VIEW_STATE
+	{
+		glm::mat4 view;
+		glm::mat4 projection;
+		glm::vec3 cameraPosition;
+		// true when the input asked for a pick, with the world
+		// space ray through the picked position
+		bool bPickRay;
+		glm::vec3 pickOrigin;
+		glm::vec3 pickDirection;
+	};
+
+private:
+	// pointer to shader manager object
+	ShaderManager* m_pShaderManager;
+	// pointer to the cached shader uniforms and uniform blocks
+	ShaderUniforms* m_pShaderUniforms;
+	// active OpenGL display window
+	GLFWwindow* m_pWindow;
+	// camera pose set with SetCameraPose(), handed on with the
+	// next captured input
+	bool m_bCameraPose;
+	glm::vec3 m_cameraPosition;
+	glm::vec3 m_cameraTarget;
+	// capture time of the input of the last updated view
+	double m_lastInputTime;
+
+	// apply the held keys to the camera
+	void ProcessKeyboardEvents(const INPUT_STATE& input, float deltaTime);
+	// build the world space ray through a window position
+	bool BuildPickRay(
+		const glm::vec2& position,
+		const glm::vec2& windowSize,
+		const glm::mat4& view,
+		const glm::mat4& projection,
+		glm::vec3& origin,
+		glm::vec3& direction);
+
+public:
+	// create the initial OpenGL display window
+	GLFWwindow* CreateDisplayWindow(const char* windowTitle);
+
+	// capture the keyboard and mouse input since the last
+	// capture; call on the thread owning the window
+	void CaptureInput(INPUT_STATE& input);
+	// move the camera by captured input and build the view and
+	// projection matrices; this makes no OpenGL calls
+	void UpdateView(const INPUT_STATE& input, VIEW_STATE& view);
+	// set a built view into the frame block of the shaders
+	void ApplyView(const VIEW_STATE& view);
+
+	// size of the window framebuffer, following every resize;
+	// it is 0 by 0 while the window is minimized
+	void GetFramebufferSize(int& width, int& height) const;
+
+	// merge input captured later into input not used yet, and
+	// clear the events of input once it has been used
+	static void AccumulateInput(INPUT_STATE& pending, const INPUT_STATE& input);
+	static void ConsumeInput(INPUT_STATE& pending);
+
+	// place the camera at a position looking at a target, for
+	// driving the camera along a scripted path
+	void SetCameraPose(const glm::vec3& position, const glm::vec3& target);
+};
\ No newline at end of file
@@ -0,0 +1,143 @@
+///////////////////////////////////////////////////////////////////////////////
+// clusterCompute.glsl
+// ============
+// bin the light sources into the screen tiles and depth slices of the view,
+// so that the fragment shader only visits the lights reaching its cluster
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#version 430 core
+
+#define MAX_LIGHTS 128
+
+layout (local_size_x = 64) in;
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+	float range;
+};
+
+// per-frame camera data, shared with the scene shaders
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+// light sources, shared with the scene shaders
+layout (std140) uniform LightBlock
+{
+	ivec4 lightCount;
+	LightSource lightSources[MAX_LIGHTS];
+};
+
+// size of the cluster grid and the spacing of its depth slices
+layout (std140) uniform ClusterBlock
+{
+	uvec4 clusterCounts;
+	vec4 clusterScale;
+};
+
+// number of lights of every cluster
+layout (std430, binding = 3) writeonly buffer ClusterLightCounts
+{
+	uint lightCounts[];
+};
+
+// indices of the lights of every cluster, MAX_LIGHTS per cluster
+layout (std430, binding = 4) writeonly buffer ClusterLightIndices
+{
+	uint lightIndices[];
+};
+
+// view space positions of the lights with their range in w,
+// transformed once per work group
+shared vec4 viewLights[MAX_LIGHTS];
+
+// point in view space at a normalized device position
+vec3 Unproject(mat4 inverseProjection, vec3 ndc)
+{
+	vec4 point = inverseProjection * vec4(ndc, 1.0f);
+	return(point.xyz / point.w);
+}
+
+// point of an edge of the view volume at a view depth
+vec3 CutEdge(vec3 nearPoint, vec3 farPoint, float depth)
+{
+	return(mix(nearPoint, farPoint, (-depth - nearPoint.z) / (farPoint.z - nearPoint.z)));
+}
+
+void main()
+{
+	int count = min(lightCount.x, MAX_LIGHTS);
+	for (int i = int(gl_LocalInvocationIndex); i < count; i += int(gl_WorkGroupSize.x))
+	{
+		viewLights[i] = vec4((view * vec4(lightSources[i].position, 1.0f)).xyz, lightSources[i].range);
+	}
+	memoryBarrierShared();
+	barrier();
+
+	uint cluster = gl_GlobalInvocationID.x;
+	if (cluster >= clusterCounts.x * clusterCounts.y * clusterCounts.z)
+	{
+		return;
+	}
+
+	uint tileX = cluster % clusterCounts.x;
+	uint tileY = (cluster / clusterCounts.x) % clusterCounts.y;
+	uint slice = cluster / (clusterCounts.x * clusterCounts.y);
+
+	// depths of the slice, inverting the mapping of the fragment
+	// shader; the first and last slices run to the clip planes
+	float nearDepth = exp((float(slice) + clusterScale.w) / clusterScale.z);
+	float farDepth = exp((float(slice + 1u) + clusterScale.w) / clusterScale.z);
+
+	// view space bounds of the four edges of the tile, cut at
+	// the depths of the slice; this holds for both projections
+	mat4 inverseProjection = inverse(projection);
+	vec2 tileMin = vec2(tileX, tileY) / vec2(clusterCounts.xy) * 2.0f - 1.0f;
+	vec2 tileMax = vec2(tileX + 1u, tileY + 1u) / vec2(clusterCounts.xy) * 2.0f - 1.0f;
+	vec3 boundsMin = vec3(1.0e30f);
+	vec3 boundsMax = vec3(-1.0e30f);
+	for (int corner = 0; corner < 4; corner++)
+	{
+		vec2 ndc = vec2(
+			((corner & 1) != 0) ? tileMax.x : tileMin.x,
+			((corner & 2) != 0) ? tileMax.y : tileMin.y);
+		vec3 nearPoint = Unproject(inverseProjection, vec3(ndc, -1.0f));
+		vec3 farPoint = Unproject(inverseProjection, vec3(ndc, 1.0f));
+
+		vec3 sliceNear = (slice == 0u) ? nearPoint : CutEdge(nearPoint, farPoint, nearDepth);
+		vec3 sliceFar = (slice == clusterCounts.z - 1u) ? farPoint : CutEdge(nearPoint, farPoint, farDepth);
+		boundsMin = min(boundsMin, min(sliceNear, sliceFar));
+		boundsMax = max(boundsMax, max(sliceNear, sliceFar));
+	}
+
+	uint firstIndex = cluster * MAX_LIGHTS;
+	uint binned = 0u;
+	for (int i = 0; i < count; i++)
+	{
+		// lights without a range reach every cluster; the others
+		// when their sphere touches the bounds
+		vec4 light = viewLights[i];
+		if (light.w > 0.0f)
+		{
+			vec3 offset = clamp(light.xyz, boundsMin, boundsMax) - light.xyz;
+			if (dot(offset, offset) > light.w * light.w)
+			{
+				continue;
+			}
+		}
+
+		lightIndices[firstIndex + binned] = uint(i);
+		binned++;
+	}
+	lightCounts[cluster] = binned;
+}
\ No newline at end of file
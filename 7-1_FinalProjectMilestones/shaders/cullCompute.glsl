@@ -0,0 +1,213 @@
+///////////////////////////////////////////////////////////////////////////////
+// cullCompute.glsl
+// ============
+// cull the scene objects against the view frustum and the depth of the last
+// frame, pick their level of detail and write one indirect draw command per
+// object
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#version 460 core
+
+#define LOD_LEVELS 3
+
+layout (local_size_x = 64) in;
+
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsMin;
+	vec4 boundsMax;
+	int materialIndex;
+	int textureArray;
+	int textureLayer;
+	int meshRangeIndex;
+	vec2 UVscale;
+	int lodLevel;
+	int lodCount;
+};
+
+struct MeshRange
+{
+	uint indexCount;
+	uint firstIndex;
+	int baseVertex;
+	uint padding;
+};
+
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+// per-object data; the level of detail is kept here between frames
+layout (std430, binding = 0) buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+layout (std430, binding = 1) writeonly buffer CommandBuffer
+{
+	DrawCommand commands[];
+};
+
+layout (std430, binding = 2) readonly buffer MeshRangeBuffer
+{
+	MeshRange meshRanges[];
+};
+
+uniform uint objectCount;
+// frustum planes with normals pointing inwards
+uniform vec4 frustumPlanes[6];
+uniform vec3 cameraPosition;
+uniform float projectionScale;
+uniform bool bOrthographic;
+uniform bool bFrustumCulling;
+uniform bool bLevelOfDetail;
+uniform float lodScreenSizes[LOD_LEVELS - 1];
+uniform float lodHysteresis;
+// depth pyramid of the last frame, the view it was drawn with and its
+// number of levels
+uniform bool bOcclusionCulling;
+uniform sampler2D hiZBuffer;
+uniform mat4 occlusionViewProjection;
+uniform int hiZLevels;
+
+// true when the box is at least partly inside the frustum
+bool IsBoxVisible(vec3 boxMin, vec3 boxMax)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		vec4 plane = frustumPlanes[i];
+		vec3 corner = mix(boxMin, boxMax, greaterThanEqual(plane.xyz, vec3(0.0f)));
+		if (dot(plane.xyz, corner) + plane.w < 0.0f)
+		{
+			return(false);
+		}
+	}
+
+	return(true);
+}
+
+// true when the box lies behind the farthest depth of the texels of the
+// pyramid covering it, at the level where it covers no more than 2 by 2
+bool IsBoxOccluded(vec3 boxMin, vec3 boxMax)
+{
+	vec2 rectMin = vec2(1.0e30f);
+	vec2 rectMax = vec2(-1.0e30f);
+	float nearestDepth = 1.0f;
+	for (int c = 0; c < 8; c++)
+	{
+		vec3 corner = mix(boxMin, boxMax, bvec3((c & 1) != 0, (c & 2) != 0, (c & 4) != 0));
+		vec4 clip = occlusionViewProjection * vec4(corner, 1.0f);
+		// boxes reaching behind the eye are never hidden
+		if (clip.w <= 1.0e-5f)
+		{
+			return(false);
+		}
+
+		vec3 ndc = clip.xyz / clip.w;
+		rectMin = min(rectMin, ndc.xy);
+		rectMax = max(rectMax, ndc.xy);
+		nearestDepth = min(nearestDepth, ndc.z * 0.5f + 0.5f);
+	}
+
+	ivec2 fullSize = textureSize(hiZBuffer, 0);
+	ivec2 first = clamp(ivec2(floor((rectMin * 0.5f + 0.5f) * vec2(fullSize))), ivec2(0), fullSize - 1);
+	ivec2 last = clamp(ivec2(floor((rectMax * 0.5f + 0.5f) * vec2(fullSize))), ivec2(0), fullSize - 1);
+
+	int span = max(last.x - first.x, last.y - first.y) + 1;
+	int level = 0;
+	while ((level < hiZLevels - 1) && ((1 << level) < span))
+	{
+		level++;
+	}
+
+	// follow the pixels down to the texels covering them
+	for (int k = 1; k <= level; k++)
+	{
+		ivec2 sourceSize = textureSize(hiZBuffer, k - 1);
+		ivec2 levelSize = textureSize(hiZBuffer, k);
+		first = (first * levelSize) / sourceSize;
+		last = (last * levelSize) / sourceSize;
+	}
+
+	float farthestDepth = max(
+		max(texelFetch(hiZBuffer, first, level).r, texelFetch(hiZBuffer, ivec2(last.x, first.y), level).r),
+		max(texelFetch(hiZBuffer, ivec2(first.x, last.y), level).r, texelFetch(hiZBuffer, last, level).r));
+
+	return(nearestDepth > farthestDepth);
+}
+
+// level of detail from the projected size of the bounding sphere,
+// leaving the current level only past the hysteresis band
+int SelectLevelOfDetail(ObjectData object)
+{
+	vec3 center = (object.boundsMin.xyz + object.boundsMax.xyz) * 0.5f;
+	float radius = length(object.boundsMax.xyz - object.boundsMin.xyz) * 0.5f;
+
+	float screenSize = radius * projectionScale;
+	if (bOrthographic == false)
+	{
+		float distance = length(center - cameraPosition);
+		screenSize = (distance > radius) ? (screenSize / distance) : 1.0e30f;
+	}
+
+	int level = clamp(object.lodLevel, 0, object.lodCount - 1);
+	while ((level < object.lodCount - 1) &&
+		(screenSize < lodScreenSizes[level] * (1.0f - lodHysteresis)))
+	{
+		level++;
+	}
+	while ((level > 0) &&
+		(screenSize > lodScreenSizes[level - 1] * (1.0f + lodHysteresis)))
+	{
+		level--;
+	}
+
+	return(level);
+}
+
+void main()
+{
+	uint objectIndex = gl_GlobalInvocationID.x;
+	if (objectIndex >= objectCount)
+	{
+		return;
+	}
+
+	ObjectData object = objects[objectIndex];
+
+	bool bVisible = true;
+	if (bFrustumCulling == true)
+	{
+		bVisible = IsBoxVisible(object.boundsMin.xyz, object.boundsMax.xyz);
+	}
+	if ((bVisible == true) && (bOcclusionCulling == true))
+	{
+		bVisible = !IsBoxOccluded(object.boundsMin.xyz, object.boundsMax.xyz);
+	}
+
+	int level = 0;
+	if ((bVisible == true) && (bLevelOfDetail == true) && (object.lodCount > 1))
+	{
+		level = SelectLevelOfDetail(object);
+		objects[objectIndex].lodLevel = level;
+	}
+
+	MeshRange range = meshRanges[object.meshRangeIndex + level];
+
+	// culled objects keep their command with no instances, so the
+	// command of every object stays at the index of the object
+	DrawCommand command;
+	command.count = range.indexCount;
+	command.instanceCount = bVisible ? 1u : 0u;
+	command.firstIndex = range.firstIndex;
+	command.baseVertex = range.baseVertex;
+	command.baseInstance = objectIndex;
+	commands[objectIndex] = command;
+}
@@ -0,0 +1,268 @@
+///////////////////////////////////////////////////////////////////////////////
+// fragmentShader.glsl
+// ============
+// shade the scene fragments with the Phong lighting model, using the
+// material selected by the draw or by the instance being drawn; built with
+// GPU_DRIVEN defined, the material and texture come from the object buffer;
+// with clustered lighting on, only the lights of the fragment's cluster
+// are visited; the key light, the first one, is shadowed by cascaded
+// shadow maps
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+// the texture arrays are set as bindless handles where the
+// driver supports it, and bound to texture units otherwise
+#ifdef GL_ARB_bindless_texture
+#extension GL_ARB_bindless_texture : enable
+#endif
+
+#define MAX_LIGHTS 128
+#define MAX_MATERIALS 64
+#define MAX_TEXTURE_ARRAYS 16
+#define MAX_CASCADES 4
+
+struct Material
+{
+	vec3 ambientColor;
+	float ambientStrength;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float shininess;
+};
+
+struct LightSource
+{
+	vec3 position;
+	vec3 ambientColor;
+	vec3 diffuseColor;
+	vec3 specularColor;
+	float focalStrength;
+	float specularIntensity;
+	// fades out at this distance; 0 reaches everything
+	float range;
+};
+
+in vec3 fragmentPosition;
+in vec3 fragmentVertexNormal;
+in vec2 fragmentTextureCoordinate;
+flat in int fragmentMaterialIndex;
+#ifdef GPU_DRIVEN
+flat in int fragmentTextureArray;
+flat in int fragmentTextureLayer;
+flat in vec2 fragmentUVscale;
+#endif
+
+out vec4 outFragmentColor;
+
+// per-frame camera data, shared with the vertex shader
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+// light sources, only uploaded when a light changes;
+// only the first lightCount.x entries are defined
+layout (std140) uniform LightBlock
+{
+	ivec4 lightCount;
+	LightSource lightSources[MAX_LIGHTS];
+};
+
+// defined materials, only uploaded when a material changes
+layout (std140) uniform MaterialBlock
+{
+	Material materials[MAX_MATERIALS];
+};
+
+// light clusters of the view, binned by the cluster compute pass;
+// clusterCounts.w is 0 while every fragment visits every light
+layout (std140) uniform ClusterBlock
+{
+	// tiles across and down, depth slices and the lighting mode
+	uvec4 clusterCounts;
+	// tiles per pixel, and the scale and bias turning the log of
+	// the view depth into a depth slice
+	vec4 clusterScale;
+};
+
+// number of lights of every cluster, and their indices with
+// MAX_LIGHTS entries set aside for every cluster
+uniform usamplerBuffer clusterLightCounts;
+uniform usamplerBuffer clusterLightIndices;
+
+// cascades of the key light's shadow maps; shadowParams.x is 0
+// while there are no shadows
+layout (std140) uniform ShadowBlock
+{
+	// world to shadow map texture coordinates of each cascade
+	mat4 cascadeMatrices[MAX_CASCADES];
+	// view depths at which each cascade ends
+	vec4 cascadeSplits;
+	// world size of a shadow map texel of each cascade
+	vec4 cascadeTexelSizes;
+	ivec4 shadowParams;
+};
+
+// depth of the casters, one layer per cascade
+uniform sampler2DArrayShadow shadowMap;
+
+uniform bool bUseTexture = false;
+uniform bool bUseLighting = false;
+uniform vec4 objectColor = vec4(1.0f);
+// texture array of the object and the layer of its texture
+uniform sampler2DArray objectTexture;
+uniform int textureLayer = 0;
+uniform vec2 UVscale = vec2(1.0f, 1.0f);
+// material of a draw that is not instanced
+uniform int materialIndex = 0;
+#ifdef GPU_DRIVEN
+// every texture array of the scene; the index is the same for a
+// whole draw command, so it is dynamically uniform
+uniform sampler2DArray sceneTextures[MAX_TEXTURE_ARRAYS];
+#endif
+
+vec3 CalcLightSource(Material surface, LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float visibility);
+int FindCluster(float viewDepth);
+float CalcShadow(float viewDepth, vec3 lightNormal);
+
+void main()
+{
+	Material surface = materials[materialIndex];
+	if (fragmentMaterialIndex >= 0)
+	{
+		surface = materials[fragmentMaterialIndex];
+	}
+
+	vec4 baseColor = objectColor;
+#ifdef GPU_DRIVEN
+	if (fragmentTextureArray >= 0)
+	{
+		baseColor = texture(sceneTextures[fragmentTextureArray], vec3(fragmentTextureCoordinate * fragmentUVscale, fragmentTextureLayer));
+	}
+#else
+	if (bUseTexture == true)
+	{
+		baseColor = texture(objectTexture, vec3(fragmentTextureCoordinate * UVscale, textureLayer));
+	}
+#endif
+
+	if (bUseLighting == true)
+	{
+		vec3 lightNormal = normalize(fragmentVertexNormal);
+		vec3 viewDirection = normalize(viewPosition.xyz - fragmentPosition);
+		float viewDepth = -(view * vec4(fragmentPosition, 1.0f)).z;
+		vec3 phongResult = vec3(0.0f);
+
+		// only the key light casts shadows
+		float keyVisibility = CalcShadow(viewDepth, lightNormal);
+
+		if (clusterCounts.w != 0u)
+		{
+			// only the lights that reach the cluster of the fragment
+			int cluster = FindCluster(viewDepth);
+			int clusterLights = int(texelFetch(clusterLightCounts, cluster).x);
+			for (int i = 0; i < clusterLights; i++)
+			{
+				int lightIndex = int(texelFetch(clusterLightIndices, cluster * MAX_LIGHTS + i).x);
+				float visibility = (lightIndex == 0) ? keyVisibility : 1.0f;
+				phongResult += CalcLightSource(surface, lightSources[lightIndex], lightNormal, fragmentPosition, viewDirection, visibility);
+			}
+		}
+		else
+		{
+			for (int i = 0; i < lightCount.x; i++)
+			{
+				float visibility = (i == 0) ? keyVisibility : 1.0f;
+				phongResult += CalcLightSource(surface, lightSources[i], lightNormal, fragmentPosition, viewDirection, visibility);
+			}
+		}
+
+		outFragmentColor = vec4(phongResult * baseColor.xyz, baseColor.w);
+	}
+	else
+	{
+		outFragmentColor = baseColor;
+	}
+}
+
+vec3 CalcLightSource(Material surface, LightSource light, vec3 lightNormal, vec3 vertexPosition, vec3 viewDirection, float visibility)
+{
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+
+	// ambient lighting
+	ambient = surface.ambientStrength * light.ambientColor * surface.ambientColor;
+
+	// diffuse lighting
+	vec3 lightDirection = normalize(light.position - vertexPosition);
+	float impact = max(dot(lightNormal, lightDirection), 0.0f);
+	diffuse = impact * light.diffuseColor * surface.diffuseColor;
+
+	// specular lighting
+	vec3 reflectDirection = reflect(-lightDirection, lightNormal);
+	float specularComponent = pow(max(dot(viewDirection, reflectDirection), 0.0f), light.focalStrength);
+	specular = light.specularIntensity * specularComponent * light.specularColor * surface.specularColor;
+
+	// a light with a range fades out smoothly towards it, so the
+	// clusters beyond the range can leave it out
+	float falloff = 1.0f;
+	if (light.range > 0.0f)
+	{
+		float distanceRatio = length(light.position - vertexPosition) / light.range;
+		falloff = clamp(1.0f - pow(distanceRatio, 4.0f), 0.0f, 1.0f);
+		falloff *= falloff;
+	}
+
+	// shadows only hide the direct light
+	return(falloff * (ambient + visibility * (diffuse + specular)));
+}
+
+int FindCluster(float viewDepth)
+{
+	// tile of the fragment on the screen
+	uvec2 tile = min(uvec2(gl_FragCoord.xy * clusterScale.xy), clusterCounts.xy - 1u);
+
+	// depth slices are spaced logarithmically in view depth
+	float slice = log(max(viewDepth, 0.0001f)) * clusterScale.z - clusterScale.w;
+	uint depthSlice = uint(clamp(slice, 0.0f, float(clusterCounts.z - 1u)));
+
+	return(int((depthSlice * clusterCounts.y + tile.y) * clusterCounts.x + tile.x));
+}
+
+
+float CalcShadow(float viewDepth, vec3 lightNormal)
+{
+	int cascadeCount = shadowParams.x;
+	if ((cascadeCount == 0) || (viewDepth > cascadeSplits[cascadeCount - 1]))
+	{
+		return(1.0f);
+	}
+
+	// the first cascade that reaches the depth of the fragment
+	int cascade = 0;
+	while ((cascade < cascadeCount - 1) && (viewDepth > cascadeSplits[cascade]))
+	{
+		cascade++;
+	}
+
+	// the position is pushed out along the normal by a texel and
+	// a half, so that surfaces do not shadow themselves
+	vec3 offsetPosition = fragmentPosition + lightNormal * (cascadeTexelSizes[cascade] * 1.5f);
+	vec3 shadowCoord = (cascadeMatrices[cascade] * vec4(offsetPosition, 1.0f)).xyz;
+
+	// four filtered comparisons half a texel apart soften the edge
+	// over a few texels
+	vec2 texelOffset = 0.5f / vec2(textureSize(shadowMap, 0).xy);
+	float visibility = 0.0f;
+	visibility += texture(shadowMap, vec4(shadowCoord.xy + vec2(-texelOffset.x, -texelOffset.y), float(cascade), shadowCoord.z));
+	visibility += texture(shadowMap, vec4(shadowCoord.xy + vec2(texelOffset.x, -texelOffset.y), float(cascade), shadowCoord.z));
+	visibility += texture(shadowMap, vec4(shadowCoord.xy + vec2(-texelOffset.x, texelOffset.y), float(cascade), shadowCoord.z));
+	visibility += texture(shadowMap, vec4(shadowCoord.xy + vec2(texelOffset.x, texelOffset.y), float(cascade), shadowCoord.z));
+
+	return(visibility * 0.25f);
+}
\ No newline at end of file
@@ -0,0 +1,45 @@
+///////////////////////////////////////////////////////////////////////////////
+// hizCompute.glsl
+// ============
+// reduce one level of the depth pyramid into the next, keeping the farthest
+// depth of the texels every texel covers
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+// depth of the frame for the first level, or the pyramid itself
+uniform sampler2D sourceDepth;
+uniform int sourceLevel;
+
+layout (r32f, binding = 0) writeonly uniform image2D destination;
+
+void main()
+{
+	ivec2 coord = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 destinationSize = imageSize(destination);
+	if (any(greaterThanEqual(coord, destinationSize)))
+	{
+		return;
+	}
+
+	// the source texels covered by this texel, 2 by 2, and 3
+	// along a side where the source size is odd, so that no
+	// texel is left out; the first level covers just one
+	ivec2 sourceSize = textureSize(sourceDepth, sourceLevel);
+	ivec2 first = (coord * sourceSize) / destinationSize;
+	ivec2 last = ((coord + 1) * sourceSize + destinationSize - 1) / destinationSize - 1;
+
+	float depth = 0.0f;
+	for (int y = first.y; y <= last.y; y++)
+	{
+		for (int x = first.x; x <= last.x; x++)
+		{
+			depth = max(depth, texelFetch(sourceDepth, ivec2(x, y), sourceLevel).r);
+		}
+	}
+
+	imageStore(destination, coord, vec4(depth));
+}
\ No newline at end of file
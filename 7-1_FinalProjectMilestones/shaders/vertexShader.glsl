@@ -0,0 +1,89 @@
+///////////////////////////////////////////////////////////////////////////////
+// vertexShader.glsl
+// ============
+// transform the mesh vertices into the 3D scene, either with the model
+// uniform or with the per-instance model matrix of an instanced draw; built
+// with GPU_DRIVEN defined, the object data is read from the object buffer
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#version 330 core
+
+layout (location = 0) in vec3 inVertexPosition;
+layout (location = 1) in vec3 inVertexNormal;
+layout (location = 2) in vec2 inTextureCoordinate;
+#ifndef GPU_DRIVEN
+// per-instance attributes, only read for instanced draws
+layout (location = 3) in mat4 inInstanceModel;
+layout (location = 7) in int inInstanceMaterial;
+#endif
+
+out vec3 fragmentPosition;
+out vec3 fragmentVertexNormal;
+out vec2 fragmentTextureCoordinate;
+flat out int fragmentMaterialIndex;
+
+#ifdef GPU_DRIVEN
+struct ObjectData
+{
+	mat4 model;
+	vec4 boundsMin;
+	vec4 boundsMax;
+	int materialIndex;
+	int textureArray;
+	int textureLayer;
+	int meshRangeIndex;
+	vec2 UVscale;
+	int lodLevel;
+	int lodCount;
+};
+
+// per-object data, indexed by the base instance of the draw command
+layout (std430, binding = 0) readonly buffer ObjectBuffer
+{
+	ObjectData objects[];
+};
+
+flat out int fragmentTextureArray;
+flat out int fragmentTextureLayer;
+flat out vec2 fragmentUVscale;
+#endif
+
+// per-frame camera data, shared with the fragment shader
+layout (std140) uniform FrameBlock
+{
+	mat4 view;
+	mat4 projection;
+	vec4 viewPosition;
+};
+
+uniform mat4 model;
+uniform bool bUseInstancing = false;
+
+void main()
+{
+	mat4 objectModel = model;
+	fragmentMaterialIndex = -1;
+
+#ifdef GPU_DRIVEN
+	ObjectData object = objects[gl_BaseInstance];
+	objectModel = object.model;
+	fragmentMaterialIndex = object.materialIndex;
+	fragmentTextureArray = object.textureArray;
+	fragmentTextureLayer = object.textureLayer;
+	fragmentUVscale = object.UVscale;
+#else
+	if (bUseInstancing == true)
+	{
+		objectModel = inInstanceModel;
+		fragmentMaterialIndex = inInstanceMaterial;
+	}
+#endif
+
+	// vertex position and normal in world space for the lighting
+	fragmentPosition = vec3(objectModel * vec4(inVertexPosition, 1.0f));
+	fragmentVertexNormal = mat3(transpose(inverse(objectModel))) * inVertexNormal;
+	fragmentTextureCoordinate = inTextureCoordinate;
+
+	gl_Position = projection * view * objectModel * vec4(inVertexPosition, 1.0f);
+}